@@ -0,0 +1,1199 @@
+#include "cache.h"
+
+/**
+ * The starting value of a hash (the 64-bit FNV-1a offset basis).
+ */
+#define CACHE_HASH_BASIS 14695981039346656037ULL
+
+/**
+ * The multiplier of a hash (the 64-bit FNV-1a prime).
+ */
+#define CACHE_HASH_PRIME 1099511628211ULL
+
+/**
+ * The number of bytes in the hash which ends a compiled program.
+ */
+#define CACHE_HASH_SIZE 8
+
+/**
+ * Continues hashing a sequence of bytes.
+ *
+ * \param [in] hash The hash of the bytes before \a data.
+ *
+ * \param [in] data The bytes to hash.
+ *
+ * \param [in] size The number of bytes in \a data.
+ *
+ * \return The hash of the bytes before \a data followed by \a data.
+ */
+unsigned long long hashCacheBytes(unsigned long long hash,
+                                  const char *data,
+                                  size_t size)
+{
+	size_t n;
+	for (n = 0; n < size; n++) {
+		hash ^= (unsigned char)data[n];
+		hash *= CACHE_HASH_PRIME;
+	}
+	return hash;
+}
+
+/**
+ * Gets the name of the compiled program of a source file.
+ *
+ * \param [in] fname The name of the source file.
+ *
+ * \return The name of the compiled program of \a fname.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+char *getCachePath(const char *fname)
+{
+	size_t len = strlen(fname);
+	char *path = malloc(sizeof(char) * (len + strlen(CACHE_SUFFIX) + 1));
+	if (!path) {
+		perror("malloc");
+		return NULL;
+	}
+	strcpy(path, fname);
+	strcpy(path + len, CACHE_SUFFIX);
+	return path;
+}
+
+/**
+ * Writes a byte to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] byte The byte to write.
+ */
+static void writeCacheByte(CacheWriter *writer,
+                           unsigned char byte)
+{
+	fputc(byte, writer->file);
+	writer->hash ^= byte;
+	writer->hash *= CACHE_HASH_PRIME;
+}
+
+/**
+ * Writes a number to a compiled program, seven bits at a time, with the high
+ * bit of each byte set if more bytes follow.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] num The number to write.
+ */
+static void writeCacheNumber(CacheWriter *writer,
+                             unsigned long long num)
+{
+	while (num >= 0x80) {
+		writeCacheByte(writer, (unsigned char)(num | 0x80));
+		num >>= 7;
+	}
+	writeCacheByte(writer, (unsigned char)num);
+}
+
+/**
+ * Writes a string to a compiled program as its length plus one (or zero if it
+ * is NULL) followed by its characters.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] str The string to write, or NULL.
+ */
+static void writeCacheString(CacheWriter *writer,
+                             const char *str)
+{
+	size_t n, len;
+	if (!str) {
+		writeCacheNumber(writer, 0);
+		return;
+	}
+	len = strlen(str);
+	writeCacheNumber(writer, len + 1);
+	for (n = 0; n < len; n++)
+		writeCacheByte(writer, (unsigned char)str[n]);
+}
+
+/**
+ * Reads a number written by writeCacheNumber() from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The number read, or 0 if reading failed.
+ *
+ * \post \a reader will be marked as failed if the number could not be read.
+ */
+static unsigned long long readCacheNumber(CacheReader *reader)
+{
+	unsigned long long num = 0;
+	unsigned int shift = 0;
+	while (reader->pos < reader->size && shift < 64) {
+		unsigned char byte = reader->data[reader->pos++];
+		num |= (unsigned long long)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return num;
+		shift += 7;
+	}
+	reader->failed = 1;
+	return 0;
+}
+
+/**
+ * Reads a string written by writeCacheString() from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The string read, or NULL if the string written was NULL or reading
+ * failed.
+ *
+ * \post \a reader will be marked as failed if the string could not be read.
+ */
+static char *readCacheString(CacheReader *reader)
+{
+	char *str = NULL;
+	unsigned long long len = readCacheNumber(reader);
+	if (!len--) return NULL;
+	if (len > reader->size - reader->pos) {
+		reader->failed = 1;
+		return NULL;
+	}
+	str = copyNodeString((const char *)reader->data + reader->pos, len);
+	if (!str) {
+		reader->failed = 1;
+		return NULL;
+	}
+	reader->pos += len;
+	return str;
+}
+
+/**
+ * Writes an identifier to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The identifier to write, or NULL.
+ *
+ * \retval 0 \a node could not be written.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeIdentifierNode(CacheWriter *writer,
+                        IdentifierNode *node)
+{
+	if (!node) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, node->type + 1);
+	switch (node->type) {
+		case IT_DIRECT:
+			writeCacheString(writer, node->id);
+			break;
+		case IT_INDIRECT:
+			if (!writeExprNode(writer, node->id)) return 0;
+			break;
+		default:
+			return 0;
+	}
+	if (!writeIdentifierNode(writer, node->slot)) return 0;
+	writeCacheNumber(writer, node->line);
+	return 1;
+}
+
+/**
+ * Writes an identifier list to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] list The identifier list to write, or NULL.
+ *
+ * \retval 0 \a list could not be written.
+ *
+ * \retval 1 \a list was written.
+ */
+int writeIdentifierNodeList(CacheWriter *writer,
+                            IdentifierNodeList *list)
+{
+	unsigned int n;
+	if (!list) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, (unsigned long long)list->num + 1);
+	for (n = 0; n < list->num; n++)
+		if (!writeIdentifierNode(writer, list->ids[n])) return 0;
+	return 1;
+}
+
+/**
+ * Writes a type to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The type to write, or NULL.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeTypeNode(CacheWriter *writer,
+                  TypeNode *node)
+{
+	writeCacheNumber(writer, node ? node->type + 1 : 0);
+	return 1;
+}
+
+/**
+ * Writes a constant to a compiled program.  Integers are written with their
+ * sign in the lowest bit so that small negative integers stay small, and
+ * decimals are written as the bits of their representation.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The constant to write, or NULL.
+ *
+ * \retval 0 \a node could not be written.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeConstantNode(CacheWriter *writer,
+                      ConstantNode *node)
+{
+	if (!node) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, node->type + 1);
+	switch (node->type) {
+		case CT_INTEGER: {
+			unsigned long long i = (unsigned long long)node->data.i;
+			writeCacheNumber(writer, node->data.i < 0 ? ~(i << 1) : i << 1);
+			break;
+		}
+		case CT_FLOAT: {
+			unsigned int bits = 0;
+			memcpy(&bits, &node->data.f, sizeof(float));
+			writeCacheNumber(writer, bits);
+			break;
+		}
+		case CT_BOOLEAN:
+			writeCacheNumber(writer, node->data.i);
+			break;
+		case CT_STRING: {
+			StringTemplateNode *tmpl = node->tmpl;
+			unsigned int n;
+			writeCacheString(writer, node->data.s);
+			if (!tmpl) {
+				writeCacheNumber(writer, 0);
+				break;
+			}
+			writeCacheNumber(writer, (unsigned long long)tmpl->num + 1);
+			for (n = 0; n < tmpl->num; n++) {
+				writeCacheString(writer, tmpl->strs[n]);
+				if (!writeExprNode(writer, tmpl->vars[n])) return 0;
+			}
+			break;
+		}
+		default:
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Writes an expression to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The expression to write, or NULL.
+ *
+ * \retval 0 \a node could not be written.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeExprNode(CacheWriter *writer,
+                  ExprNode *node)
+{
+	if (!node) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, node->type + 1);
+	switch (node->type) {
+		case ET_CAST: {
+			CastExprNode *expr = node->expr;
+			return writeExprNode(writer, expr->target)
+					&& writeTypeNode(writer, expr->newtype);
+		}
+		case ET_CONSTANT:
+			return writeConstantNode(writer, node->expr);
+		case ET_IDENTIFIER:
+			return writeIdentifierNode(writer, node->expr);
+		case ET_FUNCCALL: {
+			FuncCallExprNode *expr = node->expr;
+			return writeIdentifierNode(writer, expr->scope)
+					&& writeIdentifierNode(writer, expr->name)
+					&& writeExprNodeList(writer, expr->args);
+		}
+		case ET_OP: {
+			OpExprNode *expr = node->expr;
+			writeCacheNumber(writer, expr->type);
+			return writeExprNodeList(writer, expr->args);
+		}
+		case ET_IMPVAR:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Writes an expression list to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] list The expression list to write, or NULL.
+ *
+ * \retval 0 \a list could not be written.
+ *
+ * \retval 1 \a list was written.
+ */
+int writeExprNodeList(CacheWriter *writer,
+                      ExprNodeList *list)
+{
+	unsigned int n;
+	if (!list) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, (unsigned long long)list->num + 1);
+	for (n = 0; n < list->num; n++)
+		if (!writeExprNode(writer, list->exprs[n])) return 0;
+	return 1;
+}
+
+/**
+ * Writes a statement to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The statement to write, or NULL.
+ *
+ * \retval 0 \a node could not be written.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeStmtNode(CacheWriter *writer,
+                  StmtNode *node)
+{
+	if (!node) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, node->type + 1);
+	writeCacheNumber(writer, node->line);
+	switch (node->type) {
+		case ST_CAST: {
+			CastStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->target)
+					&& writeTypeNode(writer, stmt->newtype);
+		}
+		case ST_PRINT: {
+			PrintStmtNode *stmt = node->stmt;
+			writeCacheNumber(writer, stmt->nonl);
+			return writeExprNodeList(writer, stmt->args);
+		}
+		case ST_INPUT: {
+			InputStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->target);
+		}
+		case ST_ASSIGNMENT: {
+			AssignmentStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->target)
+					&& writeExprNode(writer, stmt->expr);
+		}
+		case ST_DECLARATION: {
+			DeclarationStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->scope)
+					&& writeIdentifierNode(writer, stmt->target)
+					&& writeExprNode(writer, stmt->expr)
+					&& writeTypeNode(writer, stmt->type)
+					&& writeIdentifierNode(writer, stmt->parent);
+		}
+		case ST_IFTHENELSE: {
+			IfThenElseStmtNode *stmt = node->stmt;
+			return writeBlockNode(writer, stmt->yes)
+					&& writeBlockNode(writer, stmt->no)
+					&& writeExprNodeList(writer, stmt->guards)
+					&& writeBlockNodeList(writer, stmt->blocks);
+		}
+		case ST_SWITCH: {
+			SwitchStmtNode *stmt = node->stmt;
+			return writeExprNodeList(writer, stmt->guards)
+					&& writeBlockNodeList(writer, stmt->blocks)
+					&& writeBlockNode(writer, stmt->def);
+		}
+		case ST_BREAK:
+			return 1;
+		case ST_RETURN: {
+			ReturnStmtNode *stmt = node->stmt;
+			return writeExprNode(writer, stmt->value);
+		}
+		case ST_LOOP: {
+			LoopStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->name)
+					&& writeIdentifierNode(writer, stmt->var)
+					&& writeExprNode(writer, stmt->guard)
+					&& writeExprNode(writer, stmt->update)
+					&& writeBlockNode(writer, stmt->body);
+		}
+		case ST_DEALLOCATION: {
+			DeallocationStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->target);
+		}
+		case ST_FUNCDEF: {
+			FuncDefStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->scope)
+					&& writeIdentifierNode(writer, stmt->name)
+					&& writeIdentifierNodeList(writer, stmt->args)
+					&& writeBlockNode(writer, stmt->body);
+		}
+		case ST_EXPR:
+			return writeExprNode(writer, node->stmt);
+		case ST_ALTARRAYDEF: {
+			AltArrayDefStmtNode *stmt = node->stmt;
+			return writeIdentifierNode(writer, stmt->name)
+					&& writeBlockNode(writer, stmt->body)
+					&& writeIdentifierNode(writer, stmt->parent);
+		}
+		default:
+			return 0;
+	}
+}
+
+/**
+ * Writes a code block to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] node The code block to write, or NULL.
+ *
+ * \retval 0 \a node could not be written.
+ *
+ * \retval 1 \a node was written.
+ */
+int writeBlockNode(CacheWriter *writer,
+                   BlockNode *node)
+{
+	unsigned int n;
+	if (!node) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, (unsigned long long)node->stmts->num + 1);
+	for (n = 0; n < node->stmts->num; n++)
+		if (!writeStmtNode(writer, node->stmts->stmts[n])) return 0;
+	return 1;
+}
+
+/**
+ * Writes a code block list to a compiled program.
+ *
+ * \param [in,out] writer The compiled program to write to.
+ *
+ * \param [in] list The code block list to write, or NULL.
+ *
+ * \retval 0 \a list could not be written.
+ *
+ * \retval 1 \a list was written.
+ */
+int writeBlockNodeList(CacheWriter *writer,
+                       BlockNodeList *list)
+{
+	unsigned int n;
+	if (!list) {
+		writeCacheNumber(writer, 0);
+		return 1;
+	}
+	writeCacheNumber(writer, (unsigned long long)list->num + 1);
+	for (n = 0; n < list->num; n++)
+		if (!writeBlockNode(writer, list->blocks[n])) return 0;
+	return 1;
+}
+
+/**
+ * Writes a parse tree to a compiled program.
+ *
+ * \param [in] node The parse tree to write.
+ *
+ * \param [in] path The name of the compiled program to write.
+ *
+ * \param [in] buffer The source \a node was parsed from.
+ *
+ * \param [in] size The number of characters in \a buffer.
+ *
+ * \retval 0 \a node could not be written to \a path.
+ *
+ * \retval 1 \a node was written to \a path.
+ */
+int saveMainNode(MainNode *node,
+                 const char *path,
+                 const char *buffer,
+                 size_t size)
+{
+	CacheWriter writer;
+	unsigned long long hash;
+	unsigned int n;
+	int status;
+	writer.file = fopen(path, "wb");
+	writer.hash = CACHE_HASH_BASIS;
+	if (!writer.file) return 0;
+	for (n = 0; n < strlen(CACHE_MAGIC); n++)
+		writeCacheByte(&writer, (unsigned char)CACHE_MAGIC[n]);
+	writeCacheNumber(&writer, CACHE_VERSION);
+	writeCacheNumber(&writer, size);
+	writeCacheNumber(&writer, hashCacheBytes(CACHE_HASH_BASIS, buffer, size));
+	status = writeBlockNode(&writer, node->block);
+	/* End with the hash of everything written, lowest byte first */
+	hash = writer.hash;
+	for (n = 0; n < CACHE_HASH_SIZE; n++)
+		writeCacheByte(&writer, (unsigned char)(hash >> (8 * n)));
+	if (ferror(writer.file)) status = 0;
+	if (fclose(writer.file)) status = 0;
+	/* Never leave a partial compiled program behind */
+	if (!status) remove(path);
+	return status;
+}
+
+/**
+ * Checks that a node which the parser always creates was read.  A compiled
+ * program in which such a node is missing, or which breaks any other rule the
+ * parser keeps, has been damaged, and its parse tree must not be run.
+ *
+ * \param [in,out] reader The compiled program the node was read from.
+ *
+ * \param [in] node The node read.
+ *
+ * \return \a node.
+ *
+ * \post \a reader will be marked as failed if \a node is NULL.
+ */
+static void *requireNode(CacheReader *reader,
+                         void *node)
+{
+	if (!node) reader->failed = 1;
+	return node;
+}
+
+/**
+ * Checks the number of arguments to an operation, which the parser sets by the
+ * type of operation.
+ *
+ * \param [in] op The type of operation.
+ *
+ * \param [in] num The number of arguments.
+ *
+ * \retval 0 The parser would not have given \a op \a num arguments.
+ *
+ * \retval 1 \a num is a valid number of arguments for \a op.
+ */
+static int isOpArity(OpType op,
+                     unsigned int num)
+{
+	switch (op) {
+		case OP_NOT:
+			return num == 1;
+		case OP_AND:
+		case OP_OR:
+		case OP_CAT:
+			return num >= 1;
+		default:
+			return num == 2;
+	}
+}
+
+/**
+ * Reads an identifier from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The identifier read, or NULL if the identifier written was NULL or
+ * reading failed.
+ *
+ * \post \a reader will be marked as failed if the identifier could not be
+ * read.
+ */
+IdentifierNode *readIdentifierNode(CacheReader *reader)
+{
+	unsigned long long type = readCacheNumber(reader);
+	void *id = NULL;
+	IdentifierNode *slot = NULL;
+	unsigned int line;
+	IdentifierNode *ret = NULL;
+	if (!type--) return NULL;
+	switch (type) {
+		case IT_DIRECT:
+			id = readCacheString(reader);
+			break;
+		case IT_INDIRECT:
+			id = readExprNode(reader);
+			break;
+		default:
+			reader->failed = 1;
+			return NULL;
+	}
+	if (!id) reader->failed = 1;
+	if (reader->failed) goto readIdentifierNodeAbort;
+	slot = readIdentifierNode(reader);
+	if (reader->failed) goto readIdentifierNodeAbort;
+	line = (unsigned int)readCacheNumber(reader);
+	if (reader->failed) goto readIdentifierNodeAbort;
+	ret = createIdentifierNode(type, id, slot, reader->fname, line);
+	if (!ret) goto readIdentifierNodeAbort;
+	return ret;
+
+readIdentifierNodeAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads an identifier list from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The identifier list read, or NULL if the identifier list written
+ * was NULL or reading failed.
+ *
+ * \post \a reader will be marked as failed if the identifier list could not
+ * be read.
+ */
+IdentifierNodeList *readIdentifierNodeList(CacheReader *reader)
+{
+	unsigned long long num = readCacheNumber(reader);
+	IdentifierNode *id = NULL;
+	IdentifierNodeList *list = NULL;
+	if (!num--) return NULL;
+	list = createIdentifierNodeList();
+	if (!list) goto readIdentifierNodeListAbort;
+	while (num--) {
+		id = requireNode(reader, readIdentifierNode(reader));
+		if (reader->failed) goto readIdentifierNodeListAbort;
+		if (!addIdentifierNode(list, id)) goto readIdentifierNodeListAbort;
+	}
+	return list;
+
+readIdentifierNodeListAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a type from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The type read, or NULL if the type written was NULL or reading
+ * failed.
+ *
+ * \post \a reader will be marked as failed if the type could not be read.
+ */
+TypeNode *readTypeNode(CacheReader *reader)
+{
+	unsigned long long type = readCacheNumber(reader);
+	TypeNode *ret = NULL;
+	if (!type--) return NULL;
+	if (type > CT_ARRAY || !(ret = createTypeNode(type))) reader->failed = 1;
+	return ret;
+}
+
+/**
+ * Reads an interpolated string from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The interpolated string read, or NULL if the string written was not
+ * interpolated or reading failed.
+ *
+ * \post \a reader will be marked as failed if the interpolated string could
+ * not be read.
+ */
+static StringTemplateNode *readStringTemplateNode(CacheReader *reader)
+{
+	unsigned long long num = readCacheNumber(reader);
+	char *str = NULL;
+	ExprNode *var = NULL;
+	StringTemplateNode *tmpl = NULL;
+	if (!num--) return NULL;
+	tmpl = createStringTemplateNode();
+	if (!tmpl) goto readStringTemplateNodeAbort;
+	while (num--) {
+		str = requireNode(reader, readCacheString(reader));
+		if (reader->failed) goto readStringTemplateNodeAbort;
+		var = readExprNode(reader);
+		/* Only the last part has no variable */
+		if (!num != !var) reader->failed = 1;
+		if (reader->failed) goto readStringTemplateNodeAbort;
+		if (!addStringTemplatePart(tmpl, str, var))
+			goto readStringTemplateNodeAbort;
+	}
+	return tmpl;
+
+readStringTemplateNodeAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a constant from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The constant read, or NULL if the constant written was NULL or
+ * reading failed.
+ *
+ * \post \a reader will be marked as failed if the constant could not be read.
+ */
+ConstantNode *readConstantNode(CacheReader *reader)
+{
+	unsigned long long type = readCacheNumber(reader);
+	ConstantNode *ret = NULL;
+	if (!type--) return NULL;
+	switch (type) {
+		case CT_INTEGER: {
+			unsigned long long i = readCacheNumber(reader);
+			if (reader->failed) return NULL;
+			ret = createIntegerConstantNode((long long int)(i & 1 ? ~(i >> 1) : i >> 1));
+			break;
+		}
+		case CT_FLOAT: {
+			unsigned int bits = (unsigned int)readCacheNumber(reader);
+			float f;
+			if (reader->failed) return NULL;
+			memcpy(&f, &bits, sizeof(float));
+			ret = createFloatConstantNode(f);
+			break;
+		}
+		case CT_BOOLEAN: {
+			int b = (int)readCacheNumber(reader);
+			if (reader->failed) return NULL;
+			ret = createBooleanConstantNode(b);
+			break;
+		}
+		case CT_STRING: {
+			char *data = readCacheString(reader);
+			StringTemplateNode *tmpl = NULL;
+			if (reader->failed) return NULL;
+			tmpl = readStringTemplateNode(reader);
+			/* A string is either plain or interpolated */
+			if (reader->failed || !data == !tmpl) {
+				reader->failed = 1;
+				return NULL;
+			}
+			ret = createStringConstantNode(data, tmpl);
+			break;
+		}
+		default:
+			break;
+	}
+	if (!ret) reader->failed = 1;
+	return ret;
+}
+
+/**
+ * Reads an expression from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The expression read, or NULL if the expression written was NULL or
+ * reading failed.
+ *
+ * \post \a reader will be marked as failed if the expression could not be
+ * read.
+ */
+ExprNode *readExprNode(CacheReader *reader)
+{
+	unsigned long long type = readCacheNumber(reader);
+	IdentifierNode *scope = NULL;
+	IdentifierNode *name = NULL;
+	ExprNode *target = NULL;
+	TypeNode *newtype = NULL;
+	ExprNodeList *args = NULL;
+	void *expr = NULL;
+	ExprNode *ret = NULL;
+	if (!type--) return NULL;
+	switch (type) {
+		case ET_CAST:
+			target = requireNode(reader, readExprNode(reader));
+			if (reader->failed) goto readExprNodeAbort;
+			newtype = requireNode(reader, readTypeNode(reader));
+			if (reader->failed) goto readExprNodeAbort;
+			expr = createCastExprNode(target, newtype);
+			break;
+		case ET_CONSTANT:
+			expr = readConstantNode(reader);
+			break;
+		case ET_IDENTIFIER:
+			expr = readIdentifierNode(reader);
+			break;
+		case ET_FUNCCALL:
+			scope = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readExprNodeAbort;
+			name = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readExprNodeAbort;
+			args = requireNode(reader, readExprNodeList(reader));
+			if (reader->failed) goto readExprNodeAbort;
+			expr = createFuncCallExprNode(scope, name, args);
+			break;
+		case ET_OP: {
+			OpType op = (OpType)readCacheNumber(reader);
+			if (reader->failed || op > OP_CAT) goto readExprNodeAbort;
+			args = requireNode(reader, readExprNodeList(reader));
+			if (reader->failed || !isOpArity(op, args->num))
+				goto readExprNodeAbort;
+			expr = createOpExprNode(op, args);
+			break;
+		}
+		case ET_IMPVAR:
+			ret = createExprNode(ET_IMPVAR, NULL);
+			if (!ret) reader->failed = 1;
+			return ret;
+		default:
+			goto readExprNodeAbort;
+	}
+	if (!expr) goto readExprNodeAbort;
+	ret = createExprNode(type, expr);
+	if (!ret) goto readExprNodeAbort;
+	return ret;
+
+readExprNodeAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads an expression list from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The expression list read, or NULL if the expression list written
+ * was NULL or reading failed.
+ *
+ * \post \a reader will be marked as failed if the expression list could not
+ * be read.
+ */
+ExprNodeList *readExprNodeList(CacheReader *reader)
+{
+	unsigned long long num = readCacheNumber(reader);
+	ExprNode *expr = NULL;
+	ExprNodeList *list = NULL;
+	if (!num--) return NULL;
+	list = createExprNodeList();
+	if (!list) goto readExprNodeListAbort;
+	while (num--) {
+		expr = requireNode(reader, readExprNode(reader));
+		if (reader->failed) goto readExprNodeListAbort;
+		if (!addExprNode(list, expr)) goto readExprNodeListAbort;
+	}
+	return list;
+
+readExprNodeListAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a statement from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The statement read, or NULL if the statement written was NULL or
+ * reading failed.
+ *
+ * \post \a reader will be marked as failed if the statement could not be
+ * read.
+ */
+StmtNode *readStmtNode(CacheReader *reader)
+{
+	unsigned long long type = readCacheNumber(reader);
+	IdentifierNode *scope = NULL;
+	IdentifierNode *target = NULL;
+	IdentifierNode *parent = NULL;
+	ExprNode *expr = NULL;
+	ExprNode *update = NULL;
+	TypeNode *newtype = NULL;
+	BlockNode *yes = NULL;
+	BlockNode *no = NULL;
+	ExprNodeList *guards = NULL;
+	BlockNodeList *blocks = NULL;
+	IdentifierNodeList *args = NULL;
+	void *stmt = NULL;
+	StmtNode *ret = NULL;
+	unsigned int line;
+	if (!type--) return NULL;
+	line = (unsigned int)readCacheNumber(reader);
+	if (reader->failed) goto readStmtNodeAbort;
+	switch (type) {
+		case ST_CAST:
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			newtype = requireNode(reader, readTypeNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createCastStmtNode(target, newtype);
+			break;
+		case ST_PRINT: {
+			int nonl = (int)readCacheNumber(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			guards = requireNode(reader, readExprNodeList(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createPrintStmtNode(guards, nonl);
+			break;
+		}
+		case ST_INPUT:
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createInputStmtNode(target);
+			break;
+		case ST_ASSIGNMENT:
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			expr = requireNode(reader, readExprNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createAssignmentStmtNode(target, expr);
+			break;
+		case ST_DECLARATION:
+			scope = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			expr = readExprNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			newtype = readTypeNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			parent = readIdentifierNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createDeclarationStmtNode(scope, target, expr, newtype, parent);
+			break;
+		case ST_IFTHENELSE:
+			yes = requireNode(reader, readBlockNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			no = readBlockNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			guards = requireNode(reader, readExprNodeList(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			blocks = requireNode(reader, readBlockNodeList(reader));
+			if (reader->failed || guards->num != blocks->num)
+				goto readStmtNodeAbort;
+			stmt = createIfThenElseStmtNode(yes, no, guards, blocks);
+			break;
+		case ST_SWITCH:
+			guards = requireNode(reader, readExprNodeList(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			blocks = requireNode(reader, readBlockNodeList(reader));
+			if (reader->failed || guards->num != blocks->num)
+				goto readStmtNodeAbort;
+			no = readBlockNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createSwitchStmtNode(guards, blocks, no);
+			break;
+		case ST_BREAK:
+			ret = createStmtNode(ST_BREAK, NULL);
+			if (!ret) goto readStmtNodeAbort;
+			ret->fname = reader->fname;
+			ret->line = line;
+			return ret;
+		case ST_RETURN:
+			expr = requireNode(reader, readExprNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createReturnStmtNode(expr);
+			break;
+		case ST_LOOP:
+			scope = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			target = readIdentifierNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			expr = readExprNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			update = readExprNode(reader);
+			/* A loop updates its variable, if it has one */
+			if (reader->failed || !target != !update)
+				goto readStmtNodeAbort;
+			yes = requireNode(reader, readBlockNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createLoopStmtNode(scope, target, expr, update, yes);
+			break;
+		case ST_DEALLOCATION:
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createDeallocationStmtNode(target);
+			break;
+		case ST_FUNCDEF:
+			scope = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			args = requireNode(reader, readIdentifierNodeList(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			yes = requireNode(reader, readBlockNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createFuncDefStmtNode(scope, target, args, yes);
+			break;
+		case ST_EXPR:
+			stmt = readExprNode(reader);
+			break;
+		case ST_ALTARRAYDEF:
+			target = requireNode(reader, readIdentifierNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			yes = requireNode(reader, readBlockNode(reader));
+			if (reader->failed) goto readStmtNodeAbort;
+			parent = readIdentifierNode(reader);
+			if (reader->failed) goto readStmtNodeAbort;
+			stmt = createAltArrayDefStmtNode(target, yes, parent);
+			break;
+		default:
+			goto readStmtNodeAbort;
+	}
+	if (!stmt) goto readStmtNodeAbort;
+	ret = createStmtNode(type, stmt);
+	if (!ret) goto readStmtNodeAbort;
+	ret->fname = reader->fname;
+	ret->line = line;
+	return ret;
+
+readStmtNodeAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a code block from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The code block read, or NULL if the code block written was NULL or
+ * reading failed.
+ *
+ * \post \a reader will be marked as failed if the code block could not be
+ * read.
+ */
+BlockNode *readBlockNode(CacheReader *reader)
+{
+	unsigned long long num = readCacheNumber(reader);
+	StmtNode *stmt = NULL;
+	StmtNodeList *stmts = NULL;
+	BlockNode *block = NULL;
+	if (!num--) return NULL;
+	stmts = createStmtNodeList();
+	if (!stmts) goto readBlockNodeAbort;
+	while (num--) {
+		stmt = requireNode(reader, readStmtNode(reader));
+		if (reader->failed) goto readBlockNodeAbort;
+		if (!addStmtNode(stmts, stmt)) goto readBlockNodeAbort;
+	}
+	block = createBlockNode(stmts);
+	if (!block) goto readBlockNodeAbort;
+	return block;
+
+readBlockNodeAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a code block list from a compiled program.
+ *
+ * \param [in,out] reader The compiled program to read from.
+ *
+ * \return The code block list read, or NULL if the code block list written
+ * was NULL or reading failed.
+ *
+ * \post \a reader will be marked as failed if the code block list could not
+ * be read.
+ */
+BlockNodeList *readBlockNodeList(CacheReader *reader)
+{
+	unsigned long long num = readCacheNumber(reader);
+	BlockNode *block = NULL;
+	BlockNodeList *list = NULL;
+	if (!num--) return NULL;
+	list = createBlockNodeList();
+	if (!list) goto readBlockNodeListAbort;
+	while (num--) {
+		block = requireNode(reader, readBlockNode(reader));
+		if (reader->failed) goto readBlockNodeListAbort;
+		if (!addBlockNode(list, block)) goto readBlockNodeListAbort;
+	}
+	return list;
+
+readBlockNodeListAbort: /* Exception handling */
+	reader->failed = 1;
+	return NULL;
+}
+
+/**
+ * Reads a parse tree from a compiled program, if the compiled program was
+ * compiled from a given source.
+ *
+ * \param [in] path The name of the compiled program to read.
+ *
+ * \param [in] fname The name of the source file.
+ *
+ * \param [in] buffer The source the compiled program must be compiled from.
+ *
+ * \param [in] size The number of characters in \a buffer.
+ *
+ * \return The parse tree read from \a path.
+ *
+ * \retval NULL \a path does not exist, was not compiled from \a buffer, or
+ * could not be read.
+ */
+MainNode *loadMainNode(const char *path,
+                       const char *fname,
+                       const char *buffer,
+                       size_t size)
+{
+	FILE *file = NULL;
+	SourceBuffer *cache = NULL;
+	CacheReader reader;
+	unsigned long long hash = 0;
+	size_t len = strlen(CACHE_MAGIC);
+	unsigned int n;
+	BlockNode *block = NULL;
+	MainNode *ret = NULL;
+	file = fopen(path, "rb");
+	if (!file) return NULL;
+	cache = createSourceBuffer(file);
+	fclose(file);
+	if (!cache) return NULL;
+	if (cache->size < len + CACHE_HASH_SIZE
+			|| memcmp(cache->data, CACHE_MAGIC, len))
+		goto loadMainNodeAbort;
+	/* Check the hash before trusting anything else in the file */
+	reader.data = (const unsigned char *)cache->data;
+	reader.size = cache->size - CACHE_HASH_SIZE;
+	reader.pos = len;
+	reader.fname = fname;
+	reader.failed = 0;
+	for (n = 0; n < CACHE_HASH_SIZE; n++)
+		hash |= (unsigned long long)reader.data[reader.size + n] << (8 * n);
+	if (hash != hashCacheBytes(CACHE_HASH_BASIS, cache->data, reader.size))
+		goto loadMainNodeAbort;
+	if (readCacheNumber(&reader) != CACHE_VERSION
+			|| readCacheNumber(&reader) != size
+			|| readCacheNumber(&reader) != hashCacheBytes(CACHE_HASH_BASIS, buffer, size)
+			|| reader.failed)
+		goto loadMainNodeAbort;
+	block = readBlockNode(&reader);
+	if (reader.failed || !block || reader.pos != reader.size)
+		goto loadMainNodeAbort;
+	ret = createMainNode(block);
+	if (!ret) goto loadMainNodeAbort;
+	deleteSourceBuffer(cache);
+	return ret;
+
+loadMainNodeAbort: /* Exception handling */
+
+	/* Clean up any allocated structures */
+	discardNodes();
+	deleteSourceBuffer(cache);
+
+	return NULL;
+}
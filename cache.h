@@ -0,0 +1,128 @@
+/**
+ * Structures and functions for caching parse trees.  A parse tree (generated
+ * by the parser) can be written to a compiled program file and read back
+ * later, so a program which has not changed since it was compiled can be run
+ * without lexing, tokenizing, or parsing it again.
+ *
+ * \file   cache.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page cache Compiled Programs
+ *
+ * Running lci with \c --compile writes each FILE's parse tree to FILE with
+ * \c CACHE_SUFFIX appended (so \c hello.lol is compiled to \c hello.lolc)
+ * instead of executing it.  From then on, each time FILE is run, lci looks for
+ * its compiled program and, if the program was compiled from exactly the same
+ * source, reads the parse tree from it instead of parsing the source.
+ *
+ * A compiled program begins with \c CACHE_MAGIC, \c CACHE_VERSION, and the
+ * size and hash of the source it was compiled from, and ends with a hash of
+ * everything before it.  In between, the nodes of the parse tree are written
+ * in prefix order: each node is written as its type followed by its members,
+ * and numbers are written in a variable-length encoding, seven bits at a
+ * time.  Bindings computed by the resolver are not written; they are computed
+ * again when the parse tree is read.  A compiled program which does not match
+ * its source, or which is damaged in any way, is ignored and the source is
+ * parsed as usual.
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "parser.h"
+#include "source.h"
+
+#undef DEBUG
+
+/**
+ * The bytes a compiled program begins with.
+ */
+#define CACHE_MAGIC "LOLC"
+
+/**
+ * The version of the compiled program format.  This must be incremented
+ * whenever the format, or the parse tree it stores, changes.
+ */
+#define CACHE_VERSION 2
+
+/**
+ * The suffix appended to the name of a source file to name its compiled
+ * program.
+ */
+#define CACHE_SUFFIX "c"
+
+/**
+ * Stores the state of a compiled program being written.
+ */
+typedef struct {
+	FILE *file;              /**< The file being written to. */
+	unsigned long long hash; /**< The hash of the bytes written so far. */
+} CacheWriter;
+
+/**
+ * Stores the state of a compiled program being read.
+ */
+typedef struct {
+	const unsigned char *data; /**< The bytes of the compiled program. */
+	size_t size;               /**< The number of bytes in \a data. */
+	size_t pos;                /**< The position of the next byte to read. */
+	const char *fname;         /**< The name of the source file. */
+	int failed;                /**< Whether reading has failed. */
+} CacheReader;
+
+/**
+ * \name Utilities
+ *
+ * Functions for performing helper tasks.
+ */
+/**@{*/
+unsigned long long hashCacheBytes(unsigned long long, const char *, size_t);
+char *getCachePath(const char *);
+/**@}*/
+
+/**
+ * \name Writing functions
+ *
+ * Functions for writing parse tree nodes to a compiled program.
+ */
+/**@{*/
+int writeIdentifierNode(CacheWriter *, IdentifierNode *);
+int writeIdentifierNodeList(CacheWriter *, IdentifierNodeList *);
+int writeTypeNode(CacheWriter *, TypeNode *);
+int writeConstantNode(CacheWriter *, ConstantNode *);
+int writeExprNode(CacheWriter *, ExprNode *);
+int writeExprNodeList(CacheWriter *, ExprNodeList *);
+int writeStmtNode(CacheWriter *, StmtNode *);
+int writeBlockNode(CacheWriter *, BlockNode *);
+int writeBlockNodeList(CacheWriter *, BlockNodeList *);
+int saveMainNode(MainNode *, const char *, const char *, size_t);
+/**@}*/
+
+/**
+ * \name Reading functions
+ *
+ * Functions for reading parse tree nodes from a compiled program.
+ */
+/**@{*/
+IdentifierNode *readIdentifierNode(CacheReader *);
+IdentifierNodeList *readIdentifierNodeList(CacheReader *);
+TypeNode *readTypeNode(CacheReader *);
+ConstantNode *readConstantNode(CacheReader *);
+ExprNode *readExprNode(CacheReader *);
+ExprNodeList *readExprNodeList(CacheReader *);
+StmtNode *readStmtNode(CacheReader *);
+BlockNode *readBlockNode(CacheReader *);
+BlockNodeList *readBlockNodeList(CacheReader *);
+MainNode *loadMainNode(const char *, const char *, const char *, size_t);
+/**@}*/
+
+#endif /* __CACHE_H__ */
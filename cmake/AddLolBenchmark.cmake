@@ -0,0 +1,32 @@
+INCLUDE(ParseArguments)
+
+# Registers a benchmark to be run by the bench target.  The program is
+# LOLCODE (test.lol by default) or, with GENERATOR, the file that script
+# writes when given its output path, so large sources need not be checked in.
+FUNCTION(ADD_LOL_BENCHMARK BENCH_NAME)
+  PARSE_ARGUMENTS(ARG "LOLCODE;INPUT;GENERATOR" "" ${ARGN})
+
+  IF(ARG_GENERATOR)
+    SET(ARG_LOLCODE ${CMAKE_CURRENT_BINARY_DIR}/bench.lol)
+    ADD_CUSTOM_COMMAND(
+      OUTPUT ${ARG_LOLCODE}
+      COMMAND python ${CMAKE_CURRENT_SOURCE_DIR}/${ARG_GENERATOR} ${ARG_LOLCODE}
+      DEPENDS ${CMAKE_CURRENT_SOURCE_DIR}/${ARG_GENERATOR}
+    )
+    # Custom command outputs are only visible to targets in this directory
+    ADD_CUSTOM_TARGET(bench-${BENCH_NAME} DEPENDS ${ARG_LOLCODE})
+    SET_PROPERTY(GLOBAL APPEND PROPERTY LOL_BENCHMARK_TARGETS bench-${BENCH_NAME})
+  ELSEIF(NOT ARG_LOLCODE)
+    SET(ARG_LOLCODE ${CMAKE_CURRENT_SOURCE_DIR}/test.lol)
+  ENDIF(ARG_GENERATOR)
+
+  IF(ARG_INPUT)
+    SET(ARG_INPUT ${CMAKE_CURRENT_SOURCE_DIR}/${ARG_INPUT})
+  ELSE(ARG_INPUT)
+    SET(ARG_INPUT -)
+  ENDIF(ARG_INPUT)
+
+  SET_PROPERTY(GLOBAL APPEND PROPERTY LOL_BENCHMARKS
+    -b ${BENCH_NAME} ${ARG_LOLCODE} ${ARG_INPUT})
+
+ENDFUNCTION()
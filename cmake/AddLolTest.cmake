@@ -1,7 +1,7 @@
 INCLUDE(ParseArguments)
 
 FUNCTION(ADD_LOL_TEST TEST_NAME)
-  PARSE_ARGUMENTS(ARG "LOLCODE;OUTPUT;INPUT" "ERROR" ${ARGN})
+  PARSE_ARGUMENTS(ARG "LOLCODE;OUTPUT;INPUT" "ERROR;SAME_STREAM" ${ARGN})
 
   IF(NOT ARG_LOLCODE)
     SET(ARG_LOLCODE ${CMAKE_CURRENT_SOURCE_DIR}/test.lol)
@@ -21,10 +21,17 @@ FUNCTION(ADD_LOL_TEST TEST_NAME)
     LIST(APPEND TEST_COMMAND -e)
   ENDIF(ARG_ERROR)
 
+  IF(ARG_SAME_STREAM)
+    LIST(APPEND TEST_COMMAND -s)
+  ENDIF(ARG_SAME_STREAM)
+
   IF(PERFORM_MEM_TESTS)
     LIST(APPEND TEST_COMMAND -m)
   ENDIF(PERFORM_MEM_TESTS)
 
   ADD_TEST(NAME ${TEST_NAME} COMMAND ${TEST_COMMAND})
 
+  # Run every test on the virtual machine as well
+  ADD_TEST(NAME ${TEST_NAME}-vm COMMAND ${TEST_COMMAND} -a=--engine=vm)
+
 ENDFUNCTION()
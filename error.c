@@ -5,6 +5,16 @@ static const char *err_msgs[] = {
 	"Error opening file '%s'.\n",
 	/* MN_ERROR_CLOSING_FILE */
 	"Error closing file '%s'.\n",
+	/* MN_UNKNOWN_ENGINE */
+	"Unknown execution engine '%s'.\n",
+	/* MN_ERROR_WRITING_CACHE */
+	"Error writing compiled program '%s'.\n",
+	/* MN_UNKNOWN_OPTIMIZATION_LEVEL */
+	"Unknown optimization level '%s'.\n",
+	/* MN_ERROR_WRITING_PROFILE */
+	"Error writing profile '%s'.\n",
+	/* MN_INVALID_JOB_COUNT */
+	"Invalid number of jobs '%s'.\n",
 
 	/* LX_LINE_CONTINUATION */
 	"%s:%d: a line with continuation may not be followed by an empty line\n",
@@ -64,6 +74,16 @@ static const char *err_msgs[] = {
 	"%s:%u: expected matching loop name at: %s\n",
 	/* PR_EXPECTED_STATEMENT */
 	"%s:%u: expected statement at: %s\n",
+	/* PR_EXPECTED_CLOSING_PAREN */
+	"%s:%u: expected closing parenthesis after :( at: %s\n",
+	/* PR_INVALID_HEX_NUMBER */
+	"%s:%u: expected hexadecimal number after :( at: %s\n",
+	/* PR_INVALID_CODE_POINT */
+	"%s:%u: invalid Unicode character at: %s\n",
+	/* PR_EXPECTED_CLOSING_SQUARE_BRACKET */
+	"%s:%u: expected closing square bracket after :[ at: %s\n",
+	/* PR_EXPECTED_CLOSING_CURLY_BRACE */
+	"%s:%u: expected closing curly brace after :{ at: %s\n",
 
 	/* IN_INVALID_IDENTIFIER_TYPE */
 	"%s:%u invalid identifier type at: %s\n",
@@ -99,16 +119,6 @@ static const char *err_msgs[] = {
 	"Unknown value type encountered during floating point decimal cast\n",
 	/* IN_CANNOT_CAST_BOOLEAN_TO_STRING */
 	"Cannot cast boolean to string value\n",
-	/* IN_EXPECTED_CLOSING_PAREN */
-	"Expected closing parenthesis after :(\n",
-	/* IN_INVALID_HEX_NUMBER */
-	"Please supply a valid hexadecimal number\n",
-	/* IN_CODE_POINT_MUST_BE_POSITIVE */
-	"Code point is supposed to be positive\n",
-	/* IN_EXPECTED_CLOSING_SQUARE_BRACKET */
-	"Expected closing square bracket after :[\n",
-	/* IN_EXPECTED_CLOSING_CURLY_BRACE */
-	"Expected closing curly brace after :{\n",
 	/* IN_VARIABLE_NOT_AN_ARRAY */
 	"%s:%u variable is not an array: %s\n",
 	/* IN_CANNOT_CAST_FUNCTION_TO_STRING */
@@ -145,12 +155,26 @@ static const char *err_msgs[] = {
 	"%s:%u: function name already used by existing variable at: %s\n",
 	/* IN_CANNOT_CAST_VALUE_TO_ARRAY */
 	"%s:%u: cannot cast value to array at: %s\n",
+
+	/* VM_UNKNOWN_EXPRESSION_TYPE */
+	"Unable to compile unknown expression type\n",
+	/* VM_UNKNOWN_STATEMENT_TYPE */
+	"Unable to compile unknown statement type\n",
+	/* VM_UNKNOWN_OPERATION_TYPE */
+	"Unable to compile unknown operation type\n",
+	/* VM_UNKNOWN_OPCODE */
+	"Unknown opcode\n",
 };
 
 static const int err_codes[] = {
 	/* The 100 block is for the main body */
 	100, /* MN_ERROR_OPENING_FILE */
 	101, /* MN_ERROR_CLOSING_FILE */
+	102, /* MN_UNKNOWN_ENGINE */
+	103, /* MN_ERROR_WRITING_CACHE */
+	104, /* MN_UNKNOWN_OPTIMIZATION_LEVEL */
+	105, /* MN_ERROR_WRITING_PROFILE */
+	106, /* MN_INVALID_JOB_COUNT */
 
 	/* The 200 block is for the lexer */
 	200, /* LX_LINE_CONTINUATION */
@@ -185,6 +209,11 @@ static const int err_codes[] = {
 	419, /* PR_EXPECTED_UNARY_FUNCTION */
 	420, /* PR_EXPECTED_MATCHING_LOOP_NAME */
 	421, /* PR_EXPECTED_STATEMENT */
+	422, /* PR_EXPECTED_CLOSING_PAREN */
+	423, /* PR_INVALID_HEX_NUMBER */
+	424, /* PR_INVALID_CODE_POINT */
+	425, /* PR_EXPECTED_CLOSING_SQUARE_BRACKET */
+	426, /* PR_EXPECTED_CLOSING_CURLY_BRACE */
 
 	/* The 500 block is for the interpreter */
 	500, /* IN_INVALID_IDENTIFIER_TYPE */
@@ -204,11 +233,6 @@ static const int err_codes[] = {
 	514, /* IN_CANNOT_CAST_ARRAY_TO_DECIMAL */
 	515, /* IN_UNKNOWN_VALUE_DURING_DECIMAL_CAST */
 	516, /* IN_CANNOT_CAST_BOOLEAN_TO_STRING */
-	517, /* IN_EXPECTED_CLOSING_PAREN */
-	518, /* IN_INVALID_HEX_NUMBER */
-	519, /* IN_CODE_POINT_MUST_BE_POSITIVE */
-	520, /* IN_EXPECTED_CLOSING_SQUARE_BRACKET */
-	521, /* IN_EXPECTED_CLOSING_CURLY_BRACE */
 	522, /* IN_VARIABLE_NOT_AN_ARRAY */
 	523, /* IN_CANNOT_CAST_FUNCTION_TO_STRING */
 	524, /* IN_CANNOT_CAST_ARRAY_TO_STRING */
@@ -227,14 +251,66 @@ static const int err_codes[] = {
 	537, /* IN_INVALID_TYPE */
 	538, /* IN_FUNCTION_NAME_USED_BY_VARIABLE */
 	539, /* IN_CANNOT_CAST_VALUE_TO_ARRAY */
+
+	/* The 600 block is for the virtual machine */
+	600, /* VM_UNKNOWN_EXPRESSION_TYPE */
+	601, /* VM_UNKNOWN_STATEMENT_TYPE */
+	602, /* VM_UNKNOWN_OPERATION_TYPE */
+	603, /* VM_UNKNOWN_OPCODE */
 };
 
+/*
+ * The handler errors on this thread are passed to, if any.
+ */
+static THREAD_LOCAL ErrorHandler Handler = NULL;
+static THREAD_LOCAL void *HandlerData = NULL;
+
+/**
+ * Sets the handler errors on the calling thread are passed to.
+ *
+ * \param [in] handler The handler to pass errors to, or NULL to print them and
+ * end the program.
+ *
+ * \param [in] data The data to pass to \a handler.
+ *
+ * \note Errors passed to a handler do not end the program; the code that
+ * reported them fails instead, back out to whichever function was called.
+ */
+void setErrorHandler(ErrorHandler handler,
+                     void *data)
+{
+	Handler = handler;
+	HandlerData = data;
+}
+
 void error(ErrorType e, ...)
 {
 	va_list args;
+	char *message = NULL;
+	int len;
+
+	/* Make sure the output before the error is seen before it */
+	flushOutput();
+
+	if (!Handler) {
+		va_start(args, e);
+		vfprintf(stderr, err_msgs[e], args);
+		va_end(args);
+		exit(err_codes[e]);
+	}
+
 	va_start(args, e);
-	vfprintf(stderr, err_msgs[e], args);
+	len = vsnprintf(NULL, 0, err_msgs[e], args);
 	va_end(args);
-
-	exit(err_codes[e]);
+	if (len >= 0) message = malloc((size_t)len + 1);
+	if (!message) {
+		/* Report the error unformatted rather than not at all */
+		Handler(err_codes[e], err_msgs[e], HandlerData);
+		return;
+	}
+	va_start(args, e);
+	vsnprintf(message, (size_t)len + 1, err_msgs[e], args);
+	va_end(args);
+	Handler(err_codes[e], message, HandlerData);
+	free(message);
 }
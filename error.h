@@ -15,6 +15,9 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include "thread.h"
+#include "output.h"
+
 /**
  * Represents an error type.  The error types are organized based on which
  * module they occur in:
@@ -23,7 +26,8 @@
  *   - LX_* for the lexer,
  *   - TK_* for the tokenizer,
  *   - PR_* for the parser,
- *   - IN_* for the interpreter
+ *   - IN_* for the interpreter,
+ *   - VM_* for the virtual machine
  *
  * \note Remember to update the error message and error code arrays (in the
  * error C file) with the appropriate error message and code.
@@ -31,6 +35,11 @@
 typedef enum {
 	MN_ERROR_OPENING_FILE,
 	MN_ERROR_CLOSING_FILE,
+	MN_UNKNOWN_ENGINE,
+	MN_ERROR_WRITING_CACHE,
+	MN_UNKNOWN_OPTIMIZATION_LEVEL,
+	MN_ERROR_WRITING_PROFILE,
+	MN_INVALID_JOB_COUNT,
 
 	LX_LINE_CONTINUATION,
 	LX_MULTIPLE_LINE_COMMENT,
@@ -62,6 +71,11 @@ typedef enum {
 	PR_EXPECTED_UNARY_FUNCTION,
 	PR_EXPECTED_MATCHING_LOOP_NAME,
 	PR_EXPECTED_STATEMENT,
+	PR_EXPECTED_CLOSING_PAREN,
+	PR_INVALID_HEX_NUMBER,
+	PR_INVALID_CODE_POINT,
+	PR_EXPECTED_CLOSING_SQUARE_BRACKET,
+	PR_EXPECTED_CLOSING_CURLY_BRACE,
 
 	IN_INVALID_IDENTIFIER_TYPE,
 	IN_UNABLE_TO_STORE_VARIABLE,
@@ -80,11 +94,6 @@ typedef enum {
 	IN_CANNOT_CAST_ARRAY_TO_DECIMAL,
 	IN_UNKNOWN_VALUE_DURING_DECIMAL_CAST,
 	IN_CANNOT_CAST_BOOLEAN_TO_STRING,
-	IN_EXPECTED_CLOSING_PAREN,
-	IN_INVALID_HEX_NUMBER,
-	IN_CODE_POINT_MUST_BE_POSITIVE,
-	IN_EXPECTED_CLOSING_SQUARE_BRACKET,
-	IN_EXPECTED_CLOSING_CURLY_BRACE,
 	IN_VARIABLE_NOT_AN_ARRAY,
 	IN_CANNOT_CAST_FUNCTION_TO_STRING,
 	IN_CANNOT_CAST_ARRAY_TO_STRING,
@@ -102,9 +111,26 @@ typedef enum {
 	IN_INVALID_DECLARATION_TYPE,
 	IN_INVALID_TYPE,
 	IN_FUNCTION_NAME_USED_BY_VARIABLE,
-	IN_CANNOT_CAST_VALUE_TO_ARRAY
+	IN_CANNOT_CAST_VALUE_TO_ARRAY,
+
+	VM_UNKNOWN_EXPRESSION_TYPE,
+	VM_UNKNOWN_STATEMENT_TYPE,
+	VM_UNKNOWN_OPERATION_TYPE,
+	VM_UNKNOWN_OPCODE
 } ErrorType;
 
+/**
+ * Handles an error instead of it being printed and ending the program.
+ *
+ * \param [in] code The code lci would exit with.
+ *
+ * \param [in] message The error message.
+ *
+ * \param [in] data The data given to setErrorHandler().
+ */
+typedef void (*ErrorHandler)(int code, const char *message, void *data);
+
 void error(ErrorType, ...);
+void setErrorHandler(ErrorHandler, void *);
 
 #endif /* __ERROR_H__ */
@@ -0,0 +1,342 @@
+#include "intern.h"
+
+/*
+ * The interned strings, each preceded by its header.
+ */
+static Arena InternArena = ARENA_INITIALIZER;
+
+/*
+ * An open-addressing hash table of the interned strings.  It is sized to be at
+ * most half full so that probe sequences stay short.
+ */
+typedef struct interntable {
+	unsigned int numslots;     /* The number of slots, a power of two. */
+	struct interntable *prev;  /* The table this one replaced. */
+	const char **slots;        /* The interned strings, or NULL. */
+} InternTable;
+
+/*
+ * The current intern table.  Tables are published and filled with
+ * storeShared() so that findInternedString() may search them without taking
+ * the lock.  Tables which have been replaced are kept until
+ * deleteInternTable(), as a search may still be reading one; at worst, such a
+ * search misses a string interned since.
+ */
+static InternTable *InternSlots = NULL;
+static unsigned int InternNum = 0;
+
+/*
+ * Guards adding to the interned strings and the table of them, which are
+ * shared by every thread.
+ */
+static Mutex InternMutex = MUTEX_INITIALIZER;
+
+THREAD_LOCAL unsigned int *InternBinds = NULL;
+THREAD_LOCAL unsigned int InternNumBinds = 0;
+
+/**
+ * Hashes a string.  This uses the 32-bit FNV-1a hash.
+ *
+ * \param [in] data The characters to hash.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \return The hash of \a data.
+ */
+unsigned int hashString(const char *data,
+                        size_t len)
+{
+	unsigned int hash = 2166136261u;
+	size_t n;
+	for (n = 0; n < len; n++) {
+		hash ^= (unsigned char)data[n];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Finds the slot of an intern table holding a string, or the empty slot it
+ * would be added to.
+ *
+ * \param [in] table The intern table to search.
+ *
+ * \param [in] data The characters of the string to find.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \param [in] hash The hash of \a data.
+ *
+ * \pre \a table has at least one empty slot.
+ *
+ * \return The slot holding \a data, or the empty slot where it belongs.
+ */
+static unsigned int findInternSlot(InternTable *table,
+                                   const char *data,
+                                   size_t len,
+                                   unsigned int hash)
+{
+	unsigned int mask = table->numslots - 1;
+	unsigned int h = hash & mask;
+	const char *str = NULL;
+	while ((str = loadShared(table->slots[h]))) {
+		if (getInternHash(str) == hash && getInternLength(str) == len
+				&& !memcmp(str, data, len))
+			break;
+		h = (h + 1) & mask;
+	}
+	return h;
+}
+
+/**
+ * Grows the intern table to twice its size, or to its initial size if it is
+ * empty.
+ *
+ * \pre The calling thread holds the lock on the intern table.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The intern table was grown.
+ */
+static int growInternTable(void)
+{
+	InternTable *old = InternSlots;
+	unsigned int numslots = old ? old->numslots * 2 : 1024;
+	InternTable *table = calloc(1, sizeof(InternTable) + numslots * sizeof(const char *));
+	unsigned int n;
+	if (!table) {
+		perror("calloc");
+		return 0;
+	}
+	table->numslots = numslots;
+	table->prev = old;
+	table->slots = (const char **)(table + 1);
+	for (n = 0; old && n < old->numslots; n++) {
+		const char *str = old->slots[n];
+		unsigned int h;
+		if (!str) continue;
+		h = getInternHash(str) & (numslots - 1);
+		while (table->slots[h]) h = (h + 1) & (numslots - 1);
+		table->slots[h] = str;
+	}
+	storeShared(InternSlots, table);
+	return 1;
+}
+
+/**
+ * Finds an interned string without interning it.  This does not take the lock
+ * on the intern table, so it may be used freely as programs run.
+ *
+ * \param [in] data The characters of the string to find.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \note A string being interned by another thread at the same time may not be
+ * found.
+ *
+ * \return The interned string equal to \a data.
+ *
+ * \retval NULL No string equal to \a data has been interned.
+ */
+const char *findInternedString(const char *data,
+                               size_t len)
+{
+	InternTable *table = loadShared(InternSlots);
+	if (!table) return NULL;
+	return loadShared(table->slots[findInternSlot(table, data, len, hashString(data, len))]);
+}
+
+/**
+ * Creates a string with a header like that of an interned string, but without
+ * interning it.  Such an owned string is not equal by address to any other
+ * string, and it must be freed with releaseString().
+ *
+ * \param [in] data The characters of the string to create.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \note \a data need not be null-terminated, but the owned string is.
+ *
+ * \return An owned string equal to \a data.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+const char *createOwnedString(const char *data,
+                              size_t len)
+{
+	InternHeader *header = malloc(sizeof(InternHeader) + len + 1);
+	char *str = NULL;
+	if (!header) {
+		perror("malloc");
+		return NULL;
+	}
+	header->hash = hashString(data, len);
+	header->id = INTERN_OWNED;
+	/* Owned strings only name values looked up at run time */
+	header->found = 1;
+	header->len = len;
+	str = (char *)(header + 1);
+	memcpy(str, data, len);
+	str[len] = '\0';
+	return str;
+}
+
+/**
+ * Gets a name for a string computed at run time, such as an \c SRS key.  The
+ * interned string is used if there is one; otherwise an owned string is
+ * created, so that names which are only ever computed do not fill the intern
+ * table.
+ *
+ * \param [in] data The characters of the string.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \return A string equal to \a data, which must be released with
+ * releaseString().
+ *
+ * \retval NULL Memory allocation failed.
+ */
+const char *lookupString(const char *data,
+                         size_t len)
+{
+	const char *str = findInternedString(data, len);
+	if (str) return str;
+	return createOwnedString(data, len);
+}
+
+/**
+ * Releases a string returned by lookupString() or createOwnedString().
+ *
+ * \param [in] str The string to release, which may be NULL.
+ *
+ * \post If \a str is owned, the memory at \a str will be freed; interned
+ * strings are left alone.
+ */
+void releaseString(const char *str)
+{
+	if (str && isOwnedString(str)) free((InternHeader *)(str) - 1);
+}
+
+/**
+ * Checks whether two interned or owned strings are equal.
+ *
+ * \param [in] a The first string.
+ *
+ * \param [in] b The second string.
+ *
+ * \retval 0 The strings differ.
+ *
+ * \retval 1 The strings are equal.
+ */
+int isEqualString(const char *a,
+                  const char *b)
+{
+	return a == b || (getInternHash(a) == getInternHash(b)
+			&& getInternLength(a) == getInternLength(b)
+			&& !memcmp(a, b, getInternLength(a)));
+}
+
+/**
+ * Interns a string.
+ *
+ * \param [in] data The characters of the string to intern.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \note \a data need not be null-terminated, but the interned string is.
+ *
+ * \return The interned string equal to \a data, which is the same for every
+ * string equal to \a data.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+const char *internString(const char *data,
+                         size_t len)
+{
+	unsigned int hash = hashString(data, len);
+	unsigned int h;
+	InternHeader *header = NULL;
+	const char *ret = NULL;
+	char *str = NULL;
+	lockMutex(&InternMutex);
+	if ((!InternSlots || (InternNum + 1) * 2 > InternSlots->numslots)
+			&& !growInternTable())
+		goto internStringDone;
+	h = findInternSlot(InternSlots, data, len, hash);
+	if ((ret = InternSlots->slots[h])) goto internStringDone;
+	header = allocArenaObject(&InternArena, sizeof(InternHeader) + len + 1);
+	if (!header) goto internStringDone;
+	header->hash = hash;
+	header->id = InternNum;
+	header->found = 0;
+	header->len = len;
+	str = (char *)(header + 1);
+	memcpy(str, data, len);
+	str[len] = '\0';
+	/* Publish the string only once it is complete */
+	storeShared(InternSlots->slots[h], (const char *)str);
+	ret = str;
+	InternNum++;
+
+internStringDone:
+
+	unlockMutex(&InternMutex);
+	return ret;
+}
+
+/**
+ * Grows the counts of scope values named by interned strings on this thread to
+ * cover a string.
+ *
+ * \param [in] id The position of the string (see getInternId()).
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The counts were grown.
+ */
+int growInternBinds(unsigned int id)
+{
+	unsigned int num = InternNumBinds ? InternNumBinds : 1024;
+	unsigned int *mem = NULL;
+	while (num <= id) num *= 2;
+	mem = realloc(InternBinds, sizeof(unsigned int) * num);
+	if (!mem) {
+		perror("realloc");
+		return 0;
+	}
+	memset(mem + InternNumBinds, 0, sizeof(unsigned int) * (num - InternNumBinds));
+	InternBinds = mem;
+	InternNumBinds = num;
+	return 1;
+}
+
+/**
+ * Deletes the counts of scope values named by interned strings on this thread.
+ *
+ * \pre No scope values are left on this thread.
+ */
+void deleteInternBinds(void)
+{
+	free(InternBinds);
+	InternBinds = NULL;
+	InternNumBinds = 0;
+}
+
+/**
+ * Deletes every interned string.
+ *
+ * \pre No other thread is using interned strings.
+ *
+ * \post Every string returned by internString() will be freed.
+ */
+void deleteInternTable(void)
+{
+	deleteInternBinds();
+	deleteArena(&InternArena);
+	while (InternSlots) {
+		InternTable *prev = InternSlots->prev;
+		free(InternSlots);
+		InternSlots = prev;
+	}
+	InternNum = 0;
+}
@@ -0,0 +1,142 @@
+/**
+ * Structures and functions for interning strings.  Interning keeps a single
+ * copy of each distinct string, so interned strings may be compared by their
+ * addresses alone.  Each interned string also carries its hash and length,
+ * which are computed once, when the string is first interned.
+ *
+ * Identifier names and string constants are interned by the parser.  Interned
+ * strings are never deleted individually; they all live until
+ * deleteInternTable() is called.  Names computed as programs run, such as \c
+ * SRS keys, are not interned: lookupString() finds the interned string equal
+ * to one if there is one, and otherwise creates an \e owned string with the
+ * same header, which is freed with the scope value it names.  Owned strings are
+ * not equal by address to any other string, so names which may be owned are
+ * compared with isEqualString().
+ *
+ * The intern table is shared by every thread, so a program may be parsed on
+ * one thread and run on another.  Interning takes a lock, but finding an
+ * interned string does not.  Counts which change as programs run, such as
+ * the number of scope values a string names, are kept per thread.
+ *
+ * \file   intern.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pool.h"
+#include "thread.h"
+
+#undef DEBUG
+
+/**
+ * Stores the header of an interned string.  The characters of the string,
+ * followed by a null character, follow the header.
+ */
+typedef struct {
+	unsigned int hash;  /**< The hash of the string. */
+	unsigned int id;    /**< The position of the string in the order interned, or \ref INTERN_OWNED. */
+	unsigned int found; /**< Whether it is ever looked up by name. */
+	size_t len;         /**< The number of characters in the string. */
+} InternHeader;
+
+/**
+ * The position given to owned strings, which are not in the intern table.
+ */
+#define INTERN_OWNED ((unsigned int)-1)
+
+/*
+ * The number of scope values named by each interned string on this thread,
+ * indexed by the position of the string in the order interned.  These are
+ * only exposed so that the macros below can reach them.
+ */
+extern THREAD_LOCAL unsigned int *InternBinds;
+extern THREAD_LOCAL unsigned int InternNumBinds;
+
+/**
+ * Retrieves the hash of an interned string.
+ */
+#define getInternHash(str) (((const InternHeader *)(str) - 1)->hash)
+
+/**
+ * Retrieves the length of an interned string.
+ */
+#define getInternLength(str) (((const InternHeader *)(str) - 1)->len)
+
+/**
+ * Retrieves the position of an interned string in the order strings were
+ * interned.
+ */
+#define getInternId(str) (((const InternHeader *)(str) - 1)->id)
+
+/**
+ * Retrieves whether a string is owned rather than interned.
+ */
+#define isOwnedString(str) (getInternId(str) == INTERN_OWNED)
+
+/**
+ * Retrieves the number of scope values named by an interned string on this
+ * thread.  This is kept up to date by the interpreter, with
+ * bindInternString() and unbindInternString(), as values are added to and
+ * removed from scopes.
+ */
+#define getInternBinds(str) (getInternId(str) < InternNumBinds \
+		? InternBinds[getInternId(str)] : 0)
+
+/**
+ * Counts another scope value named by an interned string on this thread.
+ * Owned strings are not counted.  This evaluates to 0 if memory allocation
+ * failed, and to 1 otherwise.
+ */
+#define bindInternString(str) (isOwnedString(str) \
+		|| ((getInternId(str) < InternNumBinds \
+		|| growInternBinds(getInternId(str))) \
+		&& (InternBinds[getInternId(str)]++, 1)))
+
+/**
+ * Counts one less scope value named by an interned string on this thread.
+ *
+ * \pre The string was counted by bindInternString().
+ */
+#define unbindInternString(str) ((void)(isOwnedString(str) \
+		|| InternBinds[getInternId(str)]--))
+
+/**
+ * Retrieves whether an interned string is ever looked up by name, rather than
+ * through a static binding, at run time (see \ref binding).
+ */
+#define getInternFound(str) loadShared(((InternHeader *)(str) - 1)->found)
+
+/**
+ * Marks an interned string as looked up by name at run time.  This is done by
+ * the resolver.
+ */
+#define setInternFound(str) storeShared(((InternHeader *)(str) - 1)->found, 1)
+
+/**
+ * \name Intern table modifiers
+ *
+ * Functions for interning strings and looking them up.
+ */
+/**@{*/
+unsigned int hashString(const char *, size_t);
+const char *findInternedString(const char *, size_t);
+const char *internString(const char *, size_t);
+const char *createOwnedString(const char *, size_t);
+const char *lookupString(const char *, size_t);
+void releaseString(const char *);
+int isEqualString(const char *, const char *);
+int growInternBinds(unsigned int);
+void deleteInternBinds(void);
+void deleteInternTable(void);
+/**@}*/
+
+#endif /* __INTERN_H__ */
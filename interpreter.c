@@ -1,25 +1,153 @@
 #include "interpreter.h"
 
+/*
+ * Pools for the small objects created and deleted throughout interpretation.
+ * Each thread has its own, so that threads may run programs at the same time.
+ */
+static THREAD_LOCAL Pool ValuePool = POOL_INITIALIZER("values", ValueObject);
+static THREAD_LOCAL Pool ScopePool = POOL_INITIALIZER("scopes", ScopeObject);
+static THREAD_LOCAL Pool ReturnPool = POOL_INITIALIZER("returns", ReturnObject);
+
+/*
+ * The statistics of the pools of threads which have deleted theirs, such as
+ * the threads running --jobs, so that they are still reported.
+ */
+static Mutex PoolStatsMutex = MUTEX_INITIALIZER;
+static Pool ValueStats = POOL_INITIALIZER("values", ValueObject);
+static Pool ScopeStats = POOL_INITIALIZER("scopes", ScopeObject);
+static Pool ReturnStats = POOL_INITIALIZER("returns", ReturnObject);
+
+/*
+ * Shared return values for statements which do not return a value.  Only
+ * returns from functions, which carry a value, are allocated.
+ */
+static ReturnObject DefaultReturn = { RT_DEFAULT, NULL };
+static ReturnObject BreakReturn = { RT_BREAK, NULL };
+
+/*
+ * Function call frames cleared for reuse.  Frames are taken and returned in
+ * stack order, so recursive calls reuse the frames of calls which have
+ * returned, along with the storage those frames grew.
+ */
+static THREAD_LOCAL ScopeObject *FrameStack[FRAME_STACK_MAX];
+static THREAD_LOCAL unsigned int FrameStackNum = 0;
+
 /**
- * Creates a new string by copying the contents of another string.
+ * Prints allocation statistics for the pools of values, scopes, and return
+ * values.  For each pool, this reports the number of objects allocated, the
+ * number of those allocations which reused a deleted object, the number of
+ * objects still allocated, the most objects allocated at any one time, and the
+ * number of slabs allocated.  The pools of this thread are added to those of
+ * every thread which has deleted its pools (see deleteAllocationPools()).
+ *
+ * \param [in,out] file The file to print the statistics to.
+ */
+void printAllocationStats(FILE *file)
+{
+	Pool values, scopes, returns;
+	lockMutex(&PoolStatsMutex);
+	values = ValueStats;
+	scopes = ScopeStats;
+	returns = ReturnStats;
+	unlockMutex(&PoolStatsMutex);
+	addPoolStats(&values, &ValuePool);
+	addPoolStats(&scopes, &ScopePool);
+	addPoolStats(&returns, &ReturnPool);
+	fprintf(file, "%-8s %12s %12s %12s %12s %8s\n",
+			"pool", "allocs", "hits", "live", "peak", "slabs");
+	printPoolStats(&values, file);
+	printPoolStats(&scopes, file);
+	printPoolStats(&returns, file);
+}
+
+/**
+ * Gets the number of objects allocated so far from the pools of values, scopes,
+ * and return values.
+ *
+ * \return The total number of pool allocations.
+ */
+unsigned long getAllocationCount(void)
+{
+	return ValuePool.allocs + ScopePool.allocs + ReturnPool.allocs;
+}
+
+/**
+ * Creates a new string by copying characters.  The string is preceded by a
+ * StringHeader holding its length, so its length is known without scanning
+ * it and it may hold null characters.
+ *
+ * \param [in] data The characters to copy, or NULL to leave them uninitialized.
  *
- * \param [in] data The string to copy.
+ * \param [in] len The number of characters in \a data.
  *
- * \return A new string whose contents is a copy of \a data.
+ * \return A new, null-terminated string whose contents is a copy of \a data.
  *
  * \retval NULL Memory allocation failed.
  */
-char *copyString(char *data)
+char *createString(const char *data,
+                   size_t len)
 {
-	char *p = malloc(sizeof(char) * (strlen(data) + 1));
-	if (!p) {
+	StringHeader *header = malloc(sizeof(StringHeader) + sizeof(char) * (len + 1));
+	char *p = NULL;
+	if (!header) {
 		perror("malloc");
 		return NULL;
 	}
-	strcpy(p, data);
+	header->len = len;
+	header->cap = len;
+	p = (char *)(header + 1);
+	if (data) memcpy(p, data, len);
+	p[len] = '\0';
 	return p;
 }
 
+/**
+ * Resizes a string.  The capacity of the string is at least doubled when it
+ * grows, so that repeatedly appending to a string takes amortized constant
+ * time per character.
+ *
+ * \param [in,out] str The string to resize, created by createString().
+ *
+ * \param [in] len The new number of characters in \a str.
+ *
+ * \note Any characters past the old length of \a str are uninitialized.
+ *
+ * \return The resized, null-terminated string, which may have moved.
+ *
+ * \retval NULL Memory allocation failed; \a str is left unchanged.
+ */
+char *resizeString(char *str,
+                   size_t len)
+{
+	StringHeader *header = getStringHeader(str);
+	if (len > header->cap) {
+		size_t cap = header->cap * 2 > len ? header->cap * 2 : len;
+		void *mem = realloc(header, sizeof(StringHeader) + sizeof(char) * (cap + 1));
+		if (!mem) {
+			perror("realloc");
+			return NULL;
+		}
+		header = mem;
+		header->cap = cap;
+		str = (char *)(header + 1);
+	}
+	header->len = len;
+	str[len] = '\0';
+	return str;
+}
+
+/**
+ * Deletes a string.
+ *
+ * \param [in,out] str The string to delete, created by createString().
+ *
+ * \post The memory at \a str and its header will be freed.
+ */
+void deleteString(char *str)
+{
+	if (str) free(getStringHeader(str));
+}
+
 /**
  * Checks if a string follows the format of a decimal number.
  *
@@ -86,6 +214,41 @@ unsigned int isHexString(const char *data)
 	return 1;
 }
 
+/**
+ * Checks if a string is the decimal form of an integer which may be stored as
+ * an \ref elements "element": it has only digits, no leading zeros, and is no
+ * greater than \ref SCOPE_ELEMS_MAX.
+ *
+ * \param [in] data The characters to check the format of.
+ *
+ * \param [in] len The number of characters in \a data.
+ *
+ * \param [out] index The integer \a data is the decimal form of.
+ *
+ * \retval 0 The string is not the decimal form of an element key.
+ *
+ * \retval 1 The string is the decimal form of an element key.
+ */
+unsigned int isIndexString(const char *data,
+                           size_t len,
+                           unsigned int *index)
+{
+	unsigned long long value = 0;
+	size_t n;
+
+	/* Check for an empty, too long, or zero-padded string */
+	if (len == 0 || len > 10 || (len > 1 && data[0] == '0')) return 0;
+
+	for (n = 0; n < len; n++) {
+		if (!isdigit((unsigned char)data[n])) return 0;
+		value = value * 10 + (unsigned long long)(data[n] - '0');
+	}
+	if (value > SCOPE_ELEMS_MAX) return 0;
+
+	*index = (unsigned int)value;
+	return 1;
+}
+
 /**
  * Evaluates an identifier to produce its name as a string.
  *
@@ -93,24 +256,23 @@ unsigned int isHexString(const char *data)
  *
  * \param [in] scope The scope to evaluate \a id under.
  *
- * \return A new string containing the evaluated name of the identifier.
+ * \return The name of the identifier, which must be released with
+ * releaseString().
  *
- * \retval NULL Memory allocation failed.
+ * \retval NULL An error occurred while evaluating \a id.
  */
-char *resolveIdentifierName(IdentifierNode *id,
-                            ScopeObject *scope)
+const char *resolveIdentifierName(IdentifierNode *id,
+                                  ScopeObject *scope)
 {
 	ValueObject *val = NULL;
 	ValueObject *str = NULL;
-	char *ret = NULL;
+	const char *ret = NULL;
 
 	if (!id) goto resolveIdentifierNameAbort;
 
 	if (id->type == IT_DIRECT) {
-		/* Just return a copy of the character array */
-		const char *temp = (char *)(id->id);
-		ret = malloc(sizeof(char) * (strlen(temp) + 1));
-		strcpy(ret, temp);
+		/* Direct names are interned by the parser */
+		ret = (const char *)(id->id);
 	}
 	else if (id->type == IT_INDIRECT) {
 		ExprNode *expr = (ExprNode *)(id->id);
@@ -120,33 +282,107 @@ char *resolveIdentifierName(IdentifierNode *id,
 		if (!val) goto resolveIdentifierNameAbort;
 
 		/* Then cast it to a string */
-		str = castStringExplicit(val, scope);
+		str = castStringExplicit(val);
 		if (!str) goto resolveIdentifierNameAbort;
 		deleteValueObject(val);
 
-		/* Copy the evaluated string */
-		ret = copyString(getString(str));
-		if (!ret) goto resolveIdentifierNameAbort;
+		/* Use the interned string if there is one */
+		ret = lookupString(getString(str), getStringLength(str));
 		deleteValueObject(str);
 	}
-	else {
-		char *name = resolveIdentifierName(id, scope);
-		error(IN_INVALID_IDENTIFIER_TYPE, id->fname, id->line, name);
-		free(name);
-	}
+	else
+		error(IN_INVALID_IDENTIFIER_TYPE, id->fname, id->line, "");
 
 	return ret;
 
 resolveIdentifierNameAbort: /* Exception handline */
 
 	/* Clean up any allocated structures */
-	if (ret) free(ret);
 	if (str) deleteValueObject(str);
 	if (val) deleteValueObject(val);
 
 	return NULL;
 }
 
+/**
+ * Evaluates an identifier to produce its key in a scope.  Unlike
+ * resolveIdentifierName(), this does not build a name for identifiers which
+ * evaluate to integer keys (see \ref elements).
+ *
+ * \param [in] id The identifier to evaluate.
+ *
+ * \param [in] scope The scope to evaluate \a id under.
+ *
+ * \param [out] key The key of the identifier, whose name must be released with
+ * releaseString().
+ *
+ * \retval 0 An error occurred while evaluating \a id.
+ *
+ * \retval 1 \a key was set.
+ */
+int resolveScopeKey(IdentifierNode *id,
+                    ScopeObject *scope,
+                    ScopeKey *key)
+{
+	ValueObject *val = NULL;
+	ValueObject *str = NULL;
+
+	key->name = NULL;
+	if (!id || id->type != IT_INDIRECT) {
+		key->name = resolveIdentifierName(id, scope);
+		return key->name != NULL;
+	}
+
+	/* Interpret the identifier expression */
+	val = interpretExprNode((ExprNode *)(id->id), scope);
+	if (!val) return 0;
+
+	/* Use integers, and strings which spell them, as they are */
+	if (val->type == VT_INTEGER && getInteger(val) >= 0
+			&& getInteger(val) <= SCOPE_ELEMS_MAX) {
+		key->index = (unsigned int)getInteger(val);
+		deleteValueObject(val);
+		return 1;
+	}
+	if (val->type == VT_STRING
+			&& isIndexString(getString(val), getStringLength(val), &key->index)) {
+		deleteValueObject(val);
+		return 1;
+	}
+
+	/* Otherwise, name it by the value cast to a string */
+	str = castStringExplicit(val);
+	deleteValueObject(val);
+	if (!str) return 0;
+	key->name = lookupString(getString(str), getStringLength(str));
+	deleteValueObject(str);
+	return key->name != NULL;
+}
+
+/**
+ * Finds the scope holding the static binding of an identifier.
+ *
+ * \param [in] scope The scope the identifier is evaluated under.
+ *
+ * \param [in] id The identifier to find the binding of.
+ *
+ * \note Only the name of \a id is considered; any slots it accesses are not.
+ *
+ * \return The scope holding the value of \a id at index \a id->index.
+ *
+ * \retval NULL \a id has no static binding (see \ref binding).
+ */
+ScopeObject *getBoundScopeObject(ScopeObject *scope,
+                                 IdentifierNode *id)
+{
+	int depth;
+	if (id->depth < 0) return NULL;
+	for (depth = id->depth; depth > 0 && scope; depth--)
+		scope = scope->parent;
+	if (!scope || id->index >= scope->numvals) return NULL;
+	return scope;
+}
+
 /**
  * Creates a nil-type value.
  *
@@ -156,11 +392,8 @@ resolveIdentifierNameAbort: /* Exception handline */
  */
 ValueObject *createNilValueObject(void)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_NIL;
 	p->semaphore = 1;
 	return p;
@@ -177,11 +410,8 @@ ValueObject *createNilValueObject(void)
  */
 ValueObject *createBooleanValueObject(int data)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_BOOLEAN;
 	p->data.i = (data != 0);
 	p->semaphore = 1;
@@ -199,11 +429,8 @@ ValueObject *createBooleanValueObject(int data)
  */
 ValueObject *createIntegerValueObject(long long int data)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_INTEGER;
 	p->data.i = data;
 	p->semaphore = 1;
@@ -221,11 +448,8 @@ ValueObject *createIntegerValueObject(long long int data)
  */
 ValueObject *createFloatValueObject(float data)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_FLOAT;
 	p->data.f = data;
 	p->semaphore = 1;
@@ -237,6 +461,8 @@ ValueObject *createFloatValueObject(float data)
  *
  * \param [in] data The string data to store.
  *
+ * \pre \a data was created by createString().
+ *
  * \note \a data is stored as-is; no copy of it is made.
  *
  * \return A string-type value equalling \a data.
@@ -245,11 +471,8 @@ ValueObject *createFloatValueObject(float data)
  */
 ValueObject *createStringValueObject(char *data)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_STRING;
 	p->data.s = data;
 	p->semaphore = 1;
@@ -267,11 +490,8 @@ ValueObject *createStringValueObject(char *data)
  */
 ValueObject *createFunctionValueObject(FuncDefStmtNode *def)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_FUNC;
 	p->data.fn = def;
 	p->semaphore = 1;
@@ -291,21 +511,73 @@ ValueObject *createFunctionValueObject(FuncDefStmtNode *def)
  */
 ValueObject *createArrayValueObject(ScopeObject *parent)
 {
-	ValueObject *p = malloc(sizeof(ValueObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ValueObject *p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
 	p->type = VT_ARRAY;
 	p->data.a = createScopeObject(parent);
 	if (!p->data.a) {
-		free(p);
+		freePoolObject(&ValuePool, p);
 		return NULL;
 	}
+	if (parent) parent->owner = 1;
 	p->semaphore = 1;
 	return p;
 }
 
+/**
+ * Creates the immortal value of a constant.  The value and any string data it
+ * holds are allocated from an arena rather than the value pool, since an
+ * immortal value is never deleted (see \ref IMMORTAL_SEMAPHORE).
+ *
+ * \param [in] node The constant to create the value of.
+ *
+ * \param [in,out] arena The arena to allocate the value from.
+ *
+ * \pre \a node is not an interpolated string.
+ *
+ * \return An immortal value equalling \a node.
+ *
+ * \retval NULL Memory allocation failed or \a node has no value.
+ */
+ValueObject *createConstantValueObject(ConstantNode *node,
+                                       Arena *arena)
+{
+	ValueObject *p = allocArenaObject(arena, sizeof(ValueObject));
+	if (!p) return NULL;
+	switch (node->type) {
+		case CT_NIL:
+			p->type = VT_NIL;
+			break;
+		case CT_BOOLEAN:
+			p->type = VT_BOOLEAN;
+			p->data.i = node->data.i;
+			break;
+		case CT_INTEGER:
+			p->type = VT_INTEGER;
+			p->data.i = node->data.i;
+			break;
+		case CT_FLOAT:
+			p->type = VT_FLOAT;
+			p->data.f = node->data.f;
+			break;
+		case CT_STRING: {
+			size_t len = getInternLength(node->data.s);
+			StringHeader *header = allocArenaObject(arena, sizeof(StringHeader) + sizeof(char) * (len + 1));
+			if (!header) return NULL;
+			header->len = len;
+			header->cap = len;
+			memcpy(header + 1, node->data.s, len + 1);
+			p->type = VT_STRING;
+			p->data.s = (char *)(header + 1);
+			break;
+		}
+		default:
+			return NULL;
+	}
+	p->semaphore = IMMORTAL_SEMAPHORE;
+	return p;
+}
+
 /**
  * Copies a value.
  *
@@ -328,6 +600,36 @@ ValueObject *copyValueObject(ValueObject *value)
 	return value;
 }
 
+/**
+ * Duplicates a value.  Unlike copyValueObject(), this creates a new value
+ * which may be modified without affecting \a value.
+ *
+ * \param [in] value The value to duplicate.
+ *
+ * \pre \a value is not an array.
+ *
+ * \return A new value with the same type and contents as \a value.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ValueObject *duplicateValueObject(ValueObject *value)
+{
+	ValueObject *p = NULL;
+	if (value->type == VT_STRING) {
+		char *str = createString(getString(value), getStringLength(value));
+		if (!str) return NULL;
+		p = createStringValueObject(str);
+		if (!p) deleteString(str);
+		return p;
+	}
+	p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
+	p->type = value->type;
+	p->data = value->data;
+	p->semaphore = 1;
+	return p;
+}
+
 /**
  * Deletes a value.
  *
@@ -348,86 +650,711 @@ void deleteValueObject(ValueObject *value)
 	P(value);
 	if (!value->semaphore) {
 		if (value->type == VT_STRING)
-			free(value->data.s);
+			deleteString(value->data.s);
 		/* FuncDefStmtNode structures get freed with the parse tree */
 		else if (value->type == VT_ARRAY)
 			deleteScopeObject(value->data.a);
-		free(value);
+		freePoolObject(&ValuePool, value);
+	}
+}
+
+/**
+ * Creates an unboxed nil-type value.
+ *
+ * \return An unboxed nil-type value.
+ */
+ImmediateValue createNilImmediateValue(void)
+{
+	ImmediateValue p;
+	p.type = VT_NIL;
+	p.data.i = 0;
+	p.value = NULL;
+	return p;
+}
+
+/**
+ * Creates an unboxed boolean-type value.
+ *
+ * \param [in] data The boolean data to store.
+ *
+ * \return An unboxed boolean-type value equalling 0 if \a data equals 0 and 1
+ * otherwise.
+ */
+ImmediateValue createBooleanImmediateValue(int data)
+{
+	ImmediateValue p;
+	p.type = VT_BOOLEAN;
+	p.data.i = (data != 0);
+	p.value = NULL;
+	return p;
+}
+
+/**
+ * Creates an unboxed integer-type value.
+ *
+ * \param [in] data The integer data to store.
+ *
+ * \return An unboxed integer-type value equalling \a data.
+ */
+ImmediateValue createIntegerImmediateValue(long long int data)
+{
+	ImmediateValue p;
+	p.type = VT_INTEGER;
+	p.data.i = data;
+	p.value = NULL;
+	return p;
+}
+
+/**
+ * Creates an unboxed floating-point-type value.
+ *
+ * \param [in] data The floating-point data to store.
+ *
+ * \return An unboxed floating-point-type value equalling \a data.
+ */
+ImmediateValue createFloatImmediateValue(float data)
+{
+	ImmediateValue p;
+	p.type = VT_FLOAT;
+	p.data.f = data;
+	p.value = NULL;
+	return p;
+}
+
+/**
+ * Unboxes a value.  Scalar values are copied out of \a value, which is then
+ * deleted; other values keep \a value as their reference.
+ *
+ * \param [in,out] value The value to unbox.
+ *
+ * \post The reference held by the caller to \a value will be owned by the
+ * returned value.
+ *
+ * \return An unboxed value with the same type and contents as \a value.
+ */
+ImmediateValue unboxValueObject(ValueObject *value)
+{
+	ImmediateValue p;
+	p.type = value->type;
+	p.data = value->data;
+	if (isScalarType(value->type)) {
+		p.value = NULL;
+		deleteValueObject(value);
 	}
+	else
+		p.value = value;
+	return p;
+}
+
+/**
+ * Copies a value into an unboxed value.  Scalar values are copied out of
+ * \a value; other values are copied with copyValueObject().
+ *
+ * \param [in,out] value The value to copy.
+ *
+ * \return An unboxed value with the same type and contents as \a value.
+ */
+ImmediateValue copyImmediateValue(ValueObject *value)
+{
+	ImmediateValue p;
+	p.type = value->type;
+	p.data = value->data;
+	p.value = isScalarType(value->type) ? NULL : copyValueObject(value);
+	return p;
+}
+
+/**
+ * Boxes an unboxed value, creating a new value for scalar types.
+ *
+ * \param [in,out] value The unboxed value to box.
+ *
+ * \post The reference held by \a value will be owned by the returned value.
+ *
+ * \return A value with the same type and contents as \a value.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ValueObject *boxImmediateValue(ImmediateValue *value)
+{
+	ValueObject *p = NULL;
+	if (value->value) return value->value;
+	p = allocPoolObject(&ValuePool);
+	if (!p) return NULL;
+	p->type = value->type;
+	p->data = value->data;
+	p->semaphore = 1;
+	return p;
+}
+
+/**
+ * Stores an unboxed value in place of another value.  If the old value is a
+ * scalar which is not shared, it is overwritten rather than replaced, which
+ * saves allocating a new value.
+ *
+ * \param [in,out] dest The location of the value to replace.
+ *
+ * \param [in,out] value The unboxed value to store.
+ *
+ * \post The reference held by \a value will be owned by \a dest.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 \a value was stored.
+ */
+int storeImmediateValue(ValueObject **dest,
+                        ImmediateValue *value)
+{
+	ValueObject *old = *dest;
+	ValueObject *box = NULL;
+	if (old && old->semaphore == 1 && isScalarType(old->type)
+			&& !value->value) {
+		old->type = value->type;
+		old->data = value->data;
+		return 1;
+	}
+	box = boxImmediateValue(value);
+	if (!box) return 0;
+	deleteValueObject(old);
+	*dest = box;
+	return 1;
+}
+
+/**
+ * Releases an unboxed value.
+ *
+ * \param [in,out] value The unboxed value to release.
+ *
+ * \post The value referenced by \a value, if any, will be deleted.
+ */
+void releaseImmediateValue(ImmediateValue *value)
+{
+	deleteValueObject(value->value);
+	value->value = NULL;
 }
 
 /**
  * Creates a scope.
  *
- * Scopes are used to map identifiers to values.  Scopes are organized
- * hierarchically.
+ * Scopes are used to map identifiers to values.  Scopes are organized
+ * hierarchically.
+ *
+ * \param [in] parent The optional parent scope to use.
+ *
+ * \return An empty scope with parent \a parent.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ScopeObject *createScopeObject(ScopeObject *parent)
+{
+	ScopeObject *p = allocPoolObject(&ScopePool);
+	if (!p) return NULL;
+	p->impvar = createNilValueObject();
+	if (!p->impvar) {
+		freePoolObject(&ScopePool, p);
+		return NULL;
+	}
+	p->numvals = 0;
+	p->maxvals = 0;
+	p->names = NULL;
+	p->values = NULL;
+	p->numslots = 0;
+	p->slots = NULL;
+	p->numelems = 0;
+	p->maxelems = 0;
+	p->numsparse = 0;
+	p->numowned = 0;
+	p->elems = NULL;
+	p->spare = NULL;
+	p->owner = 0;
+	p->parent = parent;
+	p->root = parent ? parent->root : p;
+	if (parent) p->caller = parent->caller;
+	else p->caller = NULL;
+	return p;
+}
+
+/**
+ * Creates a scope with a specific caller.
+ *
+ * \param [in] parent The optional parent scope to use.
+ *
+ * \param [in] caller The caller scope to use.
+ *
+ * \return An empty scope with parent \a parent and caller \a caller.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ScopeObject *createScopeObjectCaller(ScopeObject *parent,
+                                     ScopeObject *caller)
+{
+	ScopeObject *p = createScopeObject(parent);
+	if (!p) return NULL;
+	if (caller) p->caller = caller;
+	return p;
+}
+
+/**
+ * Deletes a scope.
+ *
+ * \param [in,out] scope The scope to delete.
+ *
+ * \post The memory at \a scope and any of its members will be freed.
+ */
+void deleteScopeObject(ScopeObject *scope)
+{
+	unsigned int n;
+	if (!scope) return;
+	for (n = 0; n < scope->numvals; n++) {
+		unbindInternString(scope->names[n]);
+		releaseString(scope->names[n]);
+		deleteValueObject(scope->values[n]);
+	}
+	for (n = 0; n < scope->maxelems; n++)
+		deleteValueObject(scope->elems[n]);
+	free(scope->names);
+	free(scope->values);
+	free(scope->slots);
+	free(scope->elems);
+	deleteValueObject(scope->impvar);
+	deleteScopeObject(scope->spare);
+	freePoolObject(&ScopePool, scope);
+}
+
+/**
+ * Clears a scope in place so that it may be used again.  The arrays holding
+ * the scope's names, values, index, and elements stay allocated, so values
+ * declared the next time the scope is used do not need to allocate them again.
+ *
+ * \param [in,out] scope The scope to clear.
+ *
+ * \post \a scope will hold no values and its \ref impvar "implicit variable"
+ * will be nil.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 \a scope was cleared.
+ */
+int resetScopeObject(ScopeObject *scope)
+{
+	ImmediateValue nil = { VT_NIL, { 0 }, NULL };
+	unsigned int n;
+	for (n = 0; n < scope->numvals; n++) {
+		unbindInternString(scope->names[n]);
+		releaseString(scope->names[n]);
+		deleteValueObject(scope->values[n]);
+	}
+	scope->numvals = 0;
+	if (scope->slots)
+		memset(scope->slots, 0, scope->numslots * sizeof(unsigned int));
+	for (n = 0; n < scope->maxelems; n++) {
+		deleteValueObject(scope->elems[n]);
+		scope->elems[n] = NULL;
+	}
+	scope->numelems = 0;
+	scope->numsparse = 0;
+	scope->numowned = 0;
+	scope->owner = 0;
+	return storeImmediateValue(&scope->impvar, &nil);
+}
+
+/**
+ * Gets an empty child scope, reusing the one last released to \a parent with
+ * releaseScopeObject() if there is one.
+ *
+ * \param [in] parent The parent scope to use.
+ *
+ * \return An empty scope with parent \a parent.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ScopeObject *reuseScopeObject(ScopeObject *parent)
+{
+	ScopeObject *p = parent->spare;
+	if (!p) return createScopeObject(parent);
+	parent->spare = NULL;
+	/* The caller of a reused frame may have changed */
+	p->caller = parent->caller;
+	return p;
+}
+
+/**
+ * Releases a scope obtained from reuseScopeObject().  Unlike deleting it, this
+ * clears the scope and keeps it with its parent, so that a block executed over
+ * and over (such as the body of a loop) uses the same scope each time.
+ *
+ * \param [in,out] scope The scope to release.
+ *
+ * \pre The parent of \a scope has not been deleted.
+ *
+ * \post \a scope will be deleted, now or along with its parent.
+ */
+void releaseScopeObject(ScopeObject *scope)
+{
+	ScopeObject *parent = scope->parent;
+	if (parent->spare || !resetScopeObject(scope)) {
+		deleteScopeObject(scope);
+		return;
+	}
+	parent->spare = scope;
+}
+
+/**
+ * Creates the frame for a function call, reusing one released with
+ * releaseFrameScopeObject() if there is one.  The frame holds a nil value for
+ * each argument of the function, with room for them reserved up front.
+ *
+ * \param [in] parent The parent scope to use (the scope of the call).
+ *
+ * \param [in] caller The caller scope to use.
+ *
+ * \param [in] args The names of the arguments of the function.
+ *
+ * \return A frame with parent \a parent and caller \a caller.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ScopeObject *createFrameScopeObject(ScopeObject *parent,
+                                    ScopeObject *caller,
+                                    IdentifierNodeList *args)
+{
+	ScopeObject *p = NULL;
+	unsigned int n;
+	if (FrameStackNum) {
+		p = FrameStack[--FrameStackNum];
+		p->parent = parent;
+		p->root = parent ? parent->root : p;
+		p->caller = parent ? parent->caller : NULL;
+		if (caller) p->caller = caller;
+	}
+	else {
+		p = createScopeObjectCaller(parent, caller);
+		if (!p) return NULL;
+	}
+	if (!reserveScopeValues(p, args->num)) goto createFrameScopeObjectAbort;
+	for (n = 0; n < args->num; n++) {
+		if (!createScopeValue(parent, p, args->ids[n]))
+			goto createFrameScopeObjectAbort;
+	}
+	return p;
+
+createFrameScopeObjectAbort: /* In case something goes wrong... */
+
+	releaseFrameScopeObject(p);
+
+	return NULL;
+}
+
+/**
+ * Releases a frame obtained from createFrameScopeObject().  The frame is
+ * cleared and kept for the next call, unless \ref FRAME_STACK_MAX frames are
+ * already kept.
+ *
+ * \param [in,out] frame The frame to release.
+ *
+ * \post \a frame will be deleted, now or by deleteFrameStack().
+ */
+void releaseFrameScopeObject(ScopeObject *frame)
+{
+	if (FrameStackNum == FRAME_STACK_MAX || !resetScopeObject(frame)) {
+		deleteScopeObject(frame);
+		return;
+	}
+	FrameStack[FrameStackNum++] = frame;
+}
+
+/**
+ * Deletes the frames kept for reuse by releaseFrameScopeObject().
+ *
+ * \post Every kept frame will be deleted.
+ */
+void deleteFrameStack(void)
+{
+	while (FrameStackNum)
+		deleteScopeObject(FrameStack[--FrameStackNum]);
+}
+
+/**
+ * Deletes the pools objects are allocated from on this thread, along with the
+ * frames kept for reuse.  A thread which has run programs does this before it
+ * exits.
+ *
+ * \pre No objects allocated on this thread are still in use.
+ *
+ * \post The memory of the pools of this thread will be freed, and their
+ * statistics kept for printAllocationStats().
+ */
+void deleteAllocationPools(void)
+{
+	lockMutex(&PoolStatsMutex);
+	addPoolStats(&ValueStats, &ValuePool);
+	addPoolStats(&ScopeStats, &ScopePool);
+	addPoolStats(&ReturnStats, &ReturnPool);
+	unlockMutex(&PoolStatsMutex);
+	deleteFrameStack();
+	deletePool(&ValuePool);
+	deletePool(&ScopePool);
+	deletePool(&ReturnPool);
+}
+
+/**
+ * Rebuilds the index of a scope's values.  The index is an open-addressing
+ * hash table with linear probing whose slots hold one more than the position
+ * of a value in the scope, or 0 if they are empty.  It is sized to be at most
+ * half full so that probe sequences stay short.
+ *
+ * \param [in,out] scope The scope to index.
+ *
+ * \post If \a scope holds more than \ref SCOPE_INDEX_THRESHOLD values, its
+ * index will refer to each of them; otherwise, it will have no index.
+ *
+ * \retval 0 Memory allocation failed; \a scope will have no index.
+ *
+ * \retval 1 \a scope was indexed.
+ */
+int indexScopeObject(ScopeObject *scope)
+{
+	unsigned int numslots = 16;
+	unsigned int *slots = NULL;
+	unsigned int n;
+	if (scope->numvals <= SCOPE_INDEX_THRESHOLD) {
+		free(scope->slots);
+		scope->slots = NULL;
+		scope->numslots = 0;
+		return 1;
+	}
+	while (numslots < scope->numvals * 2) numslots *= 2;
+	slots = calloc(numslots, sizeof(unsigned int));
+	if (!slots) {
+		perror("calloc");
+		/* Fall back to searching linearly */
+		free(scope->slots);
+		scope->slots = NULL;
+		scope->numslots = 0;
+		return 0;
+	}
+	for (n = 0; n < scope->numvals; n++) {
+		unsigned int h = getInternHash(scope->names[n]) & (numslots - 1);
+		while (slots[h]) h = (h + 1) & (numslots - 1);
+		slots[h] = n + 1;
+	}
+	free(scope->slots);
+	scope->slots = slots;
+	scope->numslots = numslots;
+	return 1;
+}
+
+/**
+ * Finds the position of a value in a scope without accessing its ancestors.
+ * Because names are interned, they are compared by address alone unless \a
+ * name or a name in \a scope is owned (see lookupString()).
+ *
+ * \param [in] scope The scope to search.
+ *
+ * \param [in] name The name of the value to find.
+ *
+ * \return The position of the value named \a name in \a scope.
+ *
+ * \retval -1 \a scope does not hold a value named \a name.
+ */
+int findScopeValue(ScopeObject *scope,
+                   const char *name)
+{
+	int owned = scope->numowned || isOwnedString(name);
+	unsigned int n;
+	if (scope->slots) {
+		unsigned int mask = scope->numslots - 1;
+		unsigned int h = getInternHash(name) & mask;
+		while ((n = scope->slots[h])) {
+			if (scope->names[n - 1] == name
+					|| (owned && isEqualString(scope->names[n - 1], name)))
+				return n - 1;
+			h = (h + 1) & mask;
+		}
+		return -1;
+	}
+	for (n = 0; n < scope->numvals; n++) {
+		if (scope->names[n] == name
+				|| (owned && isEqualString(scope->names[n], name)))
+			return n;
+	}
+	return -1;
+}
+
+/**
+ * Reserves room for values in a scope.  Storage is grown geometrically so that
+ * adding \e n values costs \e O(n) time overall.
+ *
+ * \param [in,out] scope The scope to reserve room in.
+ *
+ * \param [in] num The number of values to make room for, in addition to those
+ * \a scope already holds.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 \a scope has room for \a num more values.
+ */
+int reserveScopeValues(ScopeObject *scope,
+                       unsigned int num)
+{
+	unsigned int newmaxvals = scope->maxvals ? scope->maxvals : 4;
+	void *mem = NULL;
+	if (scope->numvals + num <= scope->maxvals) return 1;
+	while (newmaxvals < scope->numvals + num) newmaxvals *= 2;
+	mem = realloc(scope->names, sizeof(const char *) * newmaxvals);
+	if (!mem) {
+		perror("realloc");
+		return 0;
+	}
+	scope->names = mem;
+	mem = realloc(scope->values, sizeof(ValueObject *) * newmaxvals);
+	if (!mem) {
+		perror("realloc");
+		return 0;
+	}
+	scope->values = mem;
+	scope->maxvals = newmaxvals;
+	return 1;
+}
+
+/**
+ * Adds a named value to the end of a scope.
+ *
+ * \param [in,out] scope The scope to add the value to.
+ *
+ * \param [in] name The name of the value to add.  If it is owned, \a scope
+ * keeps its own copy of it.
  *
- * \param [in] parent The optional parent scope to use.
+ * \param [in] value The value to add.
  *
- * \return An empty scope with parent \a parent.
+ * \post On success, \a scope will own \a value.
  *
- * \retval NULL Memory allocation failed.
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The value was added to \a scope.
  */
-ScopeObject *createScopeObject(ScopeObject *parent)
+int addScopeValue(ScopeObject *scope,
+                  const char *name,
+                  ValueObject *value)
 {
-	ScopeObject *p = malloc(sizeof(ScopeObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
+	if (!reserveScopeValues(scope, 1)) return 0;
+	if (isOwnedString(name)) {
+		name = createOwnedString(name, getInternLength(name));
+		if (!name) return 0;
+		scope->numowned++;
 	}
-	p->impvar = createNilValueObject();
-	if (!p->impvar) {
-		free(p);
-		return NULL;
+	else if (!bindInternString(name)) return 0;
+	scope->names[scope->numvals] = name;
+	scope->values[scope->numvals] = value;
+	scope->numvals++;
+	/* Rebuild the index if it is too full, otherwise add to it */
+	if (scope->numvals * 2 > scope->numslots) {
+		/* Without an index, the scope is still searched linearly */
+		indexScopeObject(scope);
 	}
-	p->numvals = 0;
-	p->names = NULL;
-	p->values = NULL;
-	p->parent = parent;
-	if (parent) p->caller = parent->caller;
-	else p->caller = NULL;
-	return p;
+	else {
+		unsigned int mask = scope->numslots - 1;
+		unsigned int h = getInternHash(name) & mask;
+		while (scope->slots[h]) h = (h + 1) & mask;
+		scope->slots[h] = scope->numvals;
+	}
+	return 1;
 }
 
 /**
- * Creates a scope with a specific caller.
+ * Finds a value in a scope by its key without accessing its ancestors.
  *
- * \param [in] parent The optional parent scope to use.
+ * \param [in] scope The scope to search.
  *
- * \param [in] caller The caller scope to use.
+ * \param [in] key The key of the value to find.
  *
- * \return An empty scope with parent \a parent and caller \a caller.
+ * \return The location in \a scope holding the value with key \a key.
  *
- * \retval NULL Memory allocation failed.
+ * \retval NULL \a scope does not hold a value with key \a key.
  */
-ScopeObject *createScopeObjectCaller(ScopeObject *parent,
-                                     ScopeObject *caller)
+ValueObject **findScopeKey(ScopeObject *scope,
+                           ScopeKey *key)
 {
-	ScopeObject *p = createScopeObject(parent);
-	if (!p) return NULL;
-	if (caller) p->caller = caller;
-	return p;
+	const char *name = key->name;
+	int n;
+	if (!name) {
+		char digits[16];
+		if (key->index < scope->maxelems && scope->elems[key->index])
+			return scope->elems + key->index;
+		/* The key may have been too sparse to be an element */
+		if (!scope->numsparse) return NULL;
+		sprintf(digits, "%u", key->index);
+		name = findInternedString(digits, strlen(digits));
+		if (!name) {
+			/* Then it can only be owned */
+			if (!scope->numowned) return NULL;
+			name = createOwnedString(digits, strlen(digits));
+			if (!name) return NULL;
+		}
+		n = findScopeValue(scope, name);
+		releaseString(name);
+	}
+	else
+		n = findScopeValue(scope, name);
+	if (n < 0) return NULL;
+	return scope->values + n;
 }
 
 /**
- * Deletes a scope.
+ * Adds a value to a scope by its key.  Integer keys are stored as \ref
+ * elements "elements" unless that would leave the element vector mostly
+ * empty, in which case they are stored by name.
  *
- * \param [in,out] scope The scope to delete.
+ * \param [in,out] scope The scope to add the value to.
  *
- * \post The memory at \a scope and any of its members will be freed.
+ * \param [in] key The key of the value to add.
+ *
+ * \param [in] value The value to add.
+ *
+ * \pre \a scope does not hold a value with key \a key.
+ *
+ * \post On success, \a scope will own \a value.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The value was added to \a scope.
  */
-void deleteScopeObject(ScopeObject *scope)
+int addScopeKey(ScopeObject *scope,
+                ScopeKey *key,
+                ValueObject *value)
 {
-	unsigned int n;
-	if (!scope) return;
-	for (n = 0; n < scope->numvals; n++) {
-		free(scope->names[n]);
-		deleteValueObject(scope->values[n]);
+	char digits[16];
+	const char *name = NULL;
+	if (key->name) return addScopeValue(scope, key->name, value);
+	if (key->index < scope->maxelems
+			|| key->index < SCOPE_ELEMS_MIN + scope->numelems * 2) {
+		if (key->index >= scope->maxelems) {
+			unsigned int newmaxelems = scope->maxelems ? scope->maxelems * 2 : SCOPE_ELEMS_MIN;
+			void *mem = NULL;
+			while (newmaxelems <= key->index) newmaxelems *= 2;
+			mem = realloc(scope->elems, sizeof(ValueObject *) * newmaxelems);
+			if (!mem) {
+				perror("realloc");
+				return 0;
+			}
+			scope->elems = mem;
+			memset(scope->elems + scope->maxelems, 0, sizeof(ValueObject *) * (newmaxelems - scope->maxelems));
+			scope->maxelems = newmaxelems;
+		}
+		scope->elems[key->index] = value;
+		scope->numelems++;
+		return 1;
 	}
-	free(scope->names);
-	free(scope->values);
-	deleteValueObject(scope->impvar);
-	free(scope);
+	/* The key is too sparse to be an element, so store it by name */
+	sprintf(digits, "%u", key->index);
+	name = lookupString(digits, strlen(digits));
+	if (!name) return 0;
+	if (!addScopeValue(scope, name, value)) {
+		releaseString(name);
+		return 0;
+	}
+	releaseString(name);
+	scope->numsparse++;
+	return 1;
 }
 
 /**
@@ -450,49 +1377,29 @@ ValueObject *createScopeValue(ScopeObject *src,
 	ScopeObject *parent = dest;
 	IdentifierNode *child = target;
 	int status;
-	unsigned int newnumvals;
-	void *mem1 = NULL;
-	void *mem2 = NULL;
-	char *name = NULL;
+	ScopeKey key = { NULL, 0 };
+	ValueObject *value = NULL;
 
 	/* Traverse the target to the terminal child and parent */
 	status = resolveTerminalSlot(src, dest, target, &parent, &child);
 	if (!status) goto createScopeValueAbort;
 
-	/* Store the new number of values */
-	newnumvals = dest->numvals + 1;
-
-	/* Look up the identifier name */
-	name = resolveIdentifierName(target, src);
-	if (!name) goto createScopeValueAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(target, src, &key)) goto createScopeValueAbort;
 
 	/* Add value to local scope */
-	mem1 = realloc(dest->names, sizeof(IdentifierNode *) * newnumvals);
-	if (!mem1) {
-		perror("realloc");
-		goto createScopeValueAbort;
-	}
-	mem2 = realloc(dest->values, sizeof(ValueObject *) * newnumvals);
-	if (!mem2) {
-		perror("realloc");
-		goto createScopeValueAbort;
-	}
-
-	dest->names = mem1;
-	dest->values = mem2;
-	dest->names[dest->numvals] = name;
-	dest->values[dest->numvals] = createNilValueObject();
-	if (!dest->values[dest->numvals]) goto createScopeValueAbort;
-	dest->numvals = newnumvals;
+	value = createNilValueObject();
+	if (!value) goto createScopeValueAbort;
+	if (!addScopeKey(dest, &key, value)) goto createScopeValueAbort;
 
-	return dest->values[dest->numvals - 1];
+	releaseString(key.name);
+	return value;
 
 createScopeValueAbort: /* In case something goes wrong... */
 
 	/* Clean up any allocated structures */
-	if (name) free(name);
-	if (mem1) free(mem1);
-	if (mem2) free(mem2);
+	releaseString(key.name);
+	if (value) deleteValueObject(value);
 
 	return NULL;
 }
@@ -521,51 +1428,99 @@ ValueObject *updateScopeValue(ScopeObject *src,
 	ScopeObject *parent = dest;
 	IdentifierNode *child = target;
 	int status;
-	char *name = NULL;
+	ScopeKey key;
+
+	/* Use the static binding of the target if it has one */
+	if (src == dest && !target->slot
+			&& (parent = getBoundScopeObject(src, target))) {
+		deleteValueObject(parent->values[target->index]);
+		if (value) {
+			parent->values[target->index] = value;
+		}
+		else {
+			parent->values[target->index] = createNilValueObject();
+		}
+		return parent->values[target->index];
+	}
 
 	/* Traverse the target to the terminal child and parent */
 	status = resolveTerminalSlot(src, dest, target, &parent, &child);
 	if (!status) goto updateScopeValueAbort;
 
-	/* Look up the identifier name */
-	name = resolveIdentifierName(child, src);
-	if (!name) goto updateScopeValueAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(child, src, &key)) goto updateScopeValueAbort;
 
 	/* Traverse upwards through scopes */
 	do {
-		unsigned int n;
 		/* Check for existing value in current scope */
-		for (n = 0; n < parent->numvals; n++) {
-			if (!strcmp(parent->names[n], name)) {
-				free(name);
-				/* Wipe out the old value */
-				deleteValueObject(parent->values[n]);
-				/* Assign the new value */
-				if (value) {
-					parent->values[n] = value;
-				}
-				else {
-					parent->values[n] = createNilValueObject();
-				}
-				return parent->values[n];
+		ValueObject **slot = findScopeKey(parent, &key);
+		if (slot) {
+			/* Wipe out the old value */
+			deleteValueObject(*slot);
+			/* Assign the new value */
+			if (value) {
+				*slot = value;
 			}
+			else {
+				*slot = createNilValueObject();
+			}
+			releaseString(key.name);
+			return *slot;
 		}
 	} while ((parent = parent->parent));
+	releaseString(key.name);
 
 	{
-		char *name = resolveIdentifierName(target, src);
+		const char *name = resolveIdentifierName(target, src);
 		error(IN_UNABLE_TO_STORE_VARIABLE, target->fname, target->line, name);
-		free(name);
+		releaseString(name);
 	}
 
 updateScopeValueAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-
 	return NULL;
 }
 
+/**
+ * Updates a value in a scope from an unboxed value.  This behaves like
+ * updateScopeValue() but, where possible, stores \a value without allocating a
+ * new value.
+ *
+ * \param [in] src The scope to evaluate \a target under.
+ *
+ * \param [in,out] dest The scope to update the value in.
+ *
+ * \param [in] target The name of the value to update.
+ *
+ * \param [in,out] value The unboxed value to store.
+ *
+ * \post On success, the reference held by \a value will be owned by \a dest.
+ *
+ * \retval 0 An error occurred while updating the value.
+ *
+ * \retval 1 The value was updated.
+ */
+int updateScopeImmediate(ScopeObject *src,
+                         ScopeObject *dest,
+                         IdentifierNode *target,
+                         ImmediateValue *value)
+{
+	ScopeObject *parent = NULL;
+	ValueObject *box = NULL;
+	/* Store directly into the static binding of the target if it has one */
+	if (src == dest && !target->slot
+			&& (parent = getBoundScopeObject(src, target)))
+		return storeImmediateValue(parent->values + target->index, value);
+	box = boxImmediateValue(value);
+	if (!box) return 0;
+	if (!updateScopeValue(src, dest, target, box)) {
+		/* Leave the reference with the caller */
+		if (!value->value) deleteValueObject(box);
+		return 0;
+	}
+	return 1;
+}
+
 /**
  * Gets a stored value in a scope.
  *
@@ -586,40 +1541,40 @@ ValueObject *getScopeValue(ScopeObject *src,
 {
 	ScopeObject *parent = dest;
 	IdentifierNode *child = target;
-	char *name = NULL;
+	ScopeKey key;
 	int status;
 
+	/* Use the static binding of the target if it has one */
+	if (src == dest && !target->slot
+			&& (parent = getBoundScopeObject(src, target)))
+		return parent->values[target->index];
+
 	/* Traverse the target to the terminal child and parent */
 	status = resolveTerminalSlot(src, dest, target, &parent, &child);
 	if (!status) goto getScopeValueAbort;
 
-	/* Look up the identifier name */
-	name = resolveIdentifierName(child, src);
-	if (!name) goto getScopeValueAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(child, src, &key)) goto getScopeValueAbort;
 
 	/* Traverse upwards through scopes */
 	do {
-		unsigned int n;
 		/* Check for value in current scope */
-		for (n = 0; n < parent->numvals; n++) {
-			if (!strcmp(parent->names[n], name)) {
-				free(name);
-				return parent->values[n];
-			}
+		ValueObject **slot = findScopeKey(parent, &key);
+		if (slot) {
+			releaseString(key.name);
+			return *slot;
 		}
 	} while ((parent = parent->parent));
+	releaseString(key.name);
 
 	{
-		char *name = resolveIdentifierName(child, src);
+		const char *name = resolveIdentifierName(child, src);
 		error(IN_VARIABLE_DOES_NOT_EXIST, child->fname, child->line, name);
-		free(name);
+		releaseString(name);
 	}
 
 getScopeValueAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-
 	return NULL;
 }
 
@@ -644,45 +1599,45 @@ ScopeObject *getScopeObjectLocal(ScopeObject *src,
                                  IdentifierNode *target)
 {
 	ScopeObject *current = dest;
-	char *name = NULL;
+	ScopeKey key;
+
+	/* Use the static binding of the target if it has one */
+	if (src == dest && (current = getBoundScopeObject(src, target)))
+		return getArray(current->values[target->index]);
+	current = dest;
 
-	/* Look up the identifier name */
-	name = resolveIdentifierName(target, src);
-	if (!name) goto getScopeObjectLocalAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(target, src, &key)) goto getScopeObjectLocalAbort;
 
 	/* Check for calling object reference variable */
-	if (!strcmp(name, "ME")) {
+	if (key.name && !strcmp(key.name, "ME")) {
+		releaseString(key.name);
 		/* Traverse upwards through callers */
 		for (current = dest;
 				current->caller;
 				current = current->caller);
-		free(name);
 		return current;
 	}
 
 	/* Traverse upwards through scopes */
 	do {
-		unsigned int n;
 		/* Check for value in current scope */
-		for (n = 0; n < current->numvals; n++) {
-			if (!strcmp(current->names[n], name)) {
-				free(name);
-				return getArray(current->values[n]);
-			}
+		ValueObject **slot = findScopeKey(current, &key);
+		if (slot) {
+			releaseString(key.name);
+			return getArray((*slot));
 		}
 	} while ((current = current->parent));
+	releaseString(key.name);
 
 	{
-		char *name = resolveIdentifierName(target, src);
+		const char *name = resolveIdentifierName(target, src);
 		error(IN_VARIABLE_DOES_NOT_EXIST, target->fname, target->line, name);
-		free(name);
+		releaseString(name);
 	}
 
 getScopeObjectLocalAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-
 	return NULL;
 }
 
@@ -705,8 +1660,8 @@ ValueObject *getScopeValueLocal(ScopeObject *src,
                                 ScopeObject *dest,
                                 IdentifierNode *target)
 {
-	unsigned int n;
-	char *name = NULL;
+	ValueObject **slot = NULL;
+	ScopeKey key;
 	ScopeObject *scope = NULL;
 
 	/* Access any slots */
@@ -722,23 +1677,18 @@ ValueObject *getScopeValueLocal(ScopeObject *src,
 		target = target->slot;
 	}
 
-	/* Look up the identifier name */
-	name = resolveIdentifierName(target, src);
-	if (!name) goto getScopeValueLocalAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(target, src, &key)) goto getScopeValueLocalAbort;
 
 	/* Check for value in current scope */
-	for (n = 0; n < dest->numvals; n++) {
-		if (!strcmp(dest->names[n], name)) {
-			free(name);
-			return dest->values[n];
-		}
+	slot = findScopeKey(dest, &key);
+	releaseString(key.name);
+	if (slot) {
+		return *slot;
 	}
 
 getScopeValueLocalAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-
 	return NULL;
 }
 
@@ -762,7 +1712,7 @@ ScopeObject *getScopeObject(ScopeObject *src,
                             IdentifierNode *target)
 {
 	ValueObject *val = NULL;
-	char *name = NULL;
+	ScopeKey key;
 #if 0 // unused
 	int status;
 #endif
@@ -770,15 +1720,13 @@ ScopeObject *getScopeObject(ScopeObject *src,
 	int isME;
 	ScopeObject *scope;
 	
-	/* Look up the identifier name */
-	name = resolveIdentifierName(target, src);
-	if (!name) goto getScopeObjectAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(target, src, &key)) goto getScopeObjectAbort;
 
 	/* Check for targets with special meanings */
-	isI = strcmp(name, "I");
-	isME = strcmp(name, "ME");
-	free(name);
-	name = NULL;
+	isI = !key.name || strcmp(key.name, "I");
+	isME = !key.name || strcmp(key.name, "ME");
+	releaseString(key.name);
 
 	if (!isI) {
 		/* The function scope variable */
@@ -807,9 +1755,9 @@ ScopeObject *getScopeObject(ScopeObject *src,
 	val = getScopeValue(src, dest, target);
 	if (!val) goto getScopeObjectAbort;
 	if (val->type != VT_ARRAY) {
-		char *name = resolveIdentifierName(target, src);
+		const char *name = resolveIdentifierName(target, src);
 		error(IN_VARIABLE_NOT_AN_ARRAY, target->fname, target->line, name);
-		free(name);
+		releaseString(name);
 		goto getScopeObjectAbort;
 	}
 
@@ -817,9 +1765,6 @@ ScopeObject *getScopeObject(ScopeObject *src,
 
 getScopeObjectAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-
 	return NULL;
 }
 
@@ -837,9 +1782,7 @@ void deleteScopeValue(ScopeObject *src,
                       IdentifierNode *target)
 {
 	ScopeObject *current = NULL;
-	char *name = NULL;
-	void *mem1 = NULL;
-	void *mem2 = NULL;
+	ScopeKey key;
 	ScopeObject *scope = NULL;
 
 	/* Access any slots */
@@ -855,61 +1798,110 @@ void deleteScopeValue(ScopeObject *src,
 	}
 	current = dest;
 
-	/* Look up the identifier name */
-	name = resolveIdentifierName(target, src);
-	if (!name) goto deleteScopeValueAbort;
+	/* Look up the identifier key */
+	if (!resolveScopeKey(target, src, &key)) goto deleteScopeValueAbort;
 
 	/* Traverse upwards through scopes */
 	do {
-		unsigned int n;
 		/* Check for existing value in current scope */
-		for (n = 0; n < current->numvals; n++) {
-			if (!strcmp(current->names[n], name)) {
-				unsigned int i;
-				unsigned int newnumvals = dest->numvals - 1;
-				free(name);
-				/* Wipe out the name and value */
-				free(current->names[n]);
-				deleteValueObject(current->values[n]);
-				/* Reorder the tables */
-				for (i = n; i < current->numvals - 1; i++) {
-					current->names[i] = current->names[i + 1];
-					current->values[i] = current->values[i + 1];
-				}
-				/* Resize the tables */
-				mem1 = realloc(dest->names, sizeof(IdentifierNode *) * newnumvals);
-				if (!mem1) {
-					perror("realloc");
-					goto deleteScopeValueAbort;
-				}
-				mem2 = realloc(dest->values, sizeof(ValueObject *) * newnumvals);
-				if (!mem2) {
-					perror("realloc");
-					goto deleteScopeValueAbort;
-				}
-				dest->names = mem1;
-				dest->values = mem2;
-				dest->numvals = newnumvals;
-				return;
+		ValueObject **slot = findScopeKey(current, &key);
+		if (!slot) continue;
+		/* Wipe out the value */
+		deleteValueObject(*slot);
+		if (!key.name && key.index < current->maxelems
+				&& slot == current->elems + key.index) {
+			/* Elements are left in place */
+			*slot = NULL;
+			current->numelems--;
+		}
+		else {
+			unsigned int i = (unsigned int)(slot - current->values);
+			unbindInternString(current->names[i]);
+			if (isOwnedString(current->names[i])) current->numowned--;
+			releaseString(current->names[i]);
+			/* Reorder the tables */
+			for (; i < current->numvals - 1; i++) {
+				current->names[i] = current->names[i + 1];
+				current->values[i] = current->values[i + 1];
 			}
+			current->numvals--;
+			if (!key.name) current->numsparse--;
+			/* Positions have shifted, so the index must be rebuilt */
+			indexScopeObject(current);
 		}
+		releaseString(key.name);
+		return;
 	} while ((current = current->parent));
-
-	free(name);
-
-	return;
+	releaseString(key.name);
 
 deleteScopeValueAbort: /* In case something goes wrong... */
 
-	/* Clean up any allocated structures */
-	if (name) free(name);
-	if (mem1) free(mem1);
-	if (mem2) free(mem2);
-	if (scope) free(scope);
-
 	return;
 }
 
+/**
+ * Gets the value a function call expression calls.
+ *
+ * Calls of a direct name in the current scope (\c I \c IZ) remember the scope
+ * and position where they found the function.  While the name of the function
+ * names only one value in any scope and that scope is an ancestor of \a scope,
+ * the remembered value must be the one a search would find, so later calls
+ * from the same call site skip the search.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \param [in,out] expr The function call expression.
+ *
+ * \param [out] target The scope to call the function from.
+ *
+ * \return The value named by \a expr, which may not be a function.
+ *
+ * \retval NULL The value could not be found.
+ */
+ValueObject *getFuncCallValue(ScopeObject *scope,
+                              FuncCallExprNode *expr,
+                              ScopeObject **target)
+{
+	IdentifierNode *id = expr->name;
+	const char *name = (const char *)(id->id);
+	ScopeObject *dest = NULL;
+	ScopeObject *holder = NULL;
+	*target = NULL;
+	if (expr->scope->type != IT_DIRECT || expr->scope->slot
+			|| strcmp((char *)(expr->scope->id), "I")
+			|| id->type != IT_DIRECT || id->slot || !strcmp(name, "ME")) {
+		dest = getScopeObject(scope, scope, expr->scope);
+		if (!dest) return NULL;
+		*target = getScopeObjectLocal(scope, dest, id);
+		if (!*target) return NULL;
+		return getScopeValue(scope, dest, id);
+	}
+	/*
+	 * Check whether the remembered value is still the one in scope.  While
+	 * it is the only value with its name, it is if it is held by this scope
+	 * or the outermost one, which are in scope without searching for them.
+	 */
+	holder = expr->holder;
+	if (holder && (holder == scope || holder == scope->root)
+			&& getInternBinds(name) == 1
+			&& expr->index < holder->numvals
+			&& holder->names[expr->index] == name) {
+		*target = getArray(holder->values[expr->index]);
+		return holder->values[expr->index];
+	}
+	/* Search for the value and remember where it was found */
+	for (holder = scope; holder; holder = holder->parent) {
+		int n = findScopeValue(holder, name);
+		if (n < 0) continue;
+		expr->holder = holder;
+		expr->index = (unsigned int)n;
+		*target = getArray(holder->values[n]);
+		return holder->values[n];
+	}
+	error(IN_VARIABLE_DOES_NOT_EXIST, id->fname, id->line, name);
+	return NULL;
+}
+
 /**
  * Creates a returned value.
  *
@@ -917,6 +1909,9 @@ deleteScopeValueAbort: /* In case something goes wrong... */
  *
  * \param [in] value An optional value to return.
  *
+ * \note Default and break returns do not carry a value and are shared rather
+ * than allocated, so \a value is only used for function returns.
+ *
  * \return A pointer to a returned value with the desired properties.
  *
  * \retval NULL Memory allocation failed.
@@ -924,11 +1919,11 @@ deleteScopeValueAbort: /* In case something goes wrong... */
 ReturnObject *createReturnObject(ReturnType type,
                                  ValueObject *value)
 {
-	ReturnObject *p = malloc(sizeof(ReturnObject));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ReturnObject *p = NULL;
+	if (type == RT_DEFAULT) return &DefaultReturn;
+	if (type == RT_BREAK) return &BreakReturn;
+	p = allocPoolObject(&ReturnPool);
+	if (!p) return NULL;
 	p->type = type;
 	p->value = value;
 	return p;
@@ -939,14 +1934,14 @@ ReturnObject *createReturnObject(ReturnType type,
  *
  * \param [in,out] object The returned value to be deleted.
  *
- * \post The memory at \a object and all of its members will be freed.
+ * \post The memory at \a object and all of its members will be freed, unless
+ * \a object is a shared default or break return.
  */
 void deleteReturnObject(ReturnObject *object)
 {
-	if (!object) return;
-	if (object->type == RT_RETURN)
-		deleteValueObject(object->value);
-	free(object);
+	if (!object || object->type != RT_RETURN) return;
+	deleteValueObject(object->value);
+	freePoolObject(&ReturnPool, object);
 }
 
 /**
@@ -1021,18 +2016,15 @@ resolveTerminalSlotAbort: /* In case something goes wrong... */
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * boolean type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castBooleanImplicit(ValueObject *node,
-                                 ScopeObject *scope)
+ValueObject *castBooleanImplicit(ValueObject *node)
 {
 	if (!node) return NULL;
-	return castBooleanExplicit(node, scope);
+	return castBooleanExplicit(node);
 }
 
 /**
@@ -1042,22 +2034,19 @@ ValueObject *castBooleanImplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * integer type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castIntegerImplicit(ValueObject *node,
-                                 ScopeObject *scope)
+ValueObject *castIntegerImplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	if (node->type == VT_NIL) {
 		error(IN_CANNOT_IMPLICITLY_CAST_NIL);
 		return NULL;
 	}
-	else return castIntegerExplicit(node, scope);
+	else return castIntegerExplicit(node);
 }
 
 /**
@@ -1067,22 +2056,19 @@ ValueObject *castIntegerImplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * decimal type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castFloatImplicit(ValueObject *node,
-                               ScopeObject *scope)
+ValueObject *castFloatImplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	if (node->type == VT_NIL) {
 		error(IN_CANNOT_IMPLICITLY_CAST_NIL);
 		return NULL;
 	}
-	else return castFloatExplicit(node, scope);
+	else return castFloatExplicit(node);
 }
 
 /**
@@ -1092,26 +2078,19 @@ ValueObject *castFloatImplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
- * \note \a scope is used to resolve variable interpolation within the string
- * before casting it.  Therefore, a simple way to interpolate the variables
- * within a string is to call this function with it.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * string type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castStringImplicit(ValueObject *node,
-                                ScopeObject *scope)
+ValueObject *castStringImplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	if (node->type == VT_NIL) {
 		error(IN_CANNOT_IMPLICITLY_CAST_NIL);
 		return NULL;
 	}
-	else return castStringExplicit(node, scope);
+	else return castStringExplicit(node);
 }
 
 /**
@@ -1121,15 +2100,12 @@ ValueObject *castStringImplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * boolean type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castBooleanExplicit(ValueObject *node,
-                                 ScopeObject *scope)
+ValueObject *castBooleanExplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	switch (node->type) {
@@ -1142,17 +2118,7 @@ ValueObject *castBooleanExplicit(ValueObject *node,
 		case VT_FLOAT:
 			return createBooleanValueObject(fabs(getFloat(node) - 0.0) > FLT_EPSILON);
 		case VT_STRING:
-			if (strstr(getString(node), ":{")) {
-				/* Perform interpolation */
-				ValueObject *ret = NULL;
-				ValueObject *interp = castStringExplicit(node, scope);
-				if (!interp) return NULL;
-				ret = createBooleanValueObject(getString(interp)[0] != '\0');
-				deleteValueObject(interp);
-				return ret;
-			}
-			else
-				return createBooleanValueObject(getString(node)[0] != '\0');
+			return createBooleanValueObject(getStringLength(node) != 0);
 		case VT_FUNC:
 			error(IN_CANNOT_CAST_FUNCTION_TO_BOOLEAN);
 			return NULL;
@@ -1172,15 +2138,12 @@ ValueObject *castBooleanExplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * integer type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castIntegerExplicit(ValueObject *node,
-                                 ScopeObject *scope)
+ValueObject *castIntegerExplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	switch (node->type) {
@@ -1191,39 +2154,18 @@ ValueObject *castIntegerExplicit(ValueObject *node,
 			return createIntegerValueObject(getInteger(node));
 		case VT_FLOAT:
 			return createIntegerValueObject((long long int)getFloat(node));
-		case VT_STRING:
-			if (strstr(getString(node), ":{")) {
-				/* Perform interpolation */
-				ValueObject *ret = NULL;
-				ValueObject *interp = castStringExplicit(node, scope);
-				long long int value;
-				if (!interp) return NULL;
-				if (!isDecString(getString(interp))) {
-					error(IN_UNABLE_TO_CAST_VALUE);
-					deleteValueObject(interp);
-					return NULL;
-				}
-				if (sscanf(getString(interp), "%lli", &value) != 1) {
-					error(IN_EXPECTED_INTEGER_VALUE);
-					deleteValueObject(interp);
-					return NULL;
-				}
-				ret = createIntegerValueObject(value);
-				deleteValueObject(interp);
-				return ret;
+		case VT_STRING: {
+			long long int value;
+			if (!isDecString(getString(node))) {
+				error(IN_UNABLE_TO_CAST_VALUE);
+				return NULL;
 			}
-			else {
-				long long int value;
-				if (!isDecString(getString(node))) {
-					error(IN_UNABLE_TO_CAST_VALUE);
-					return NULL;
-				}
-				if (sscanf(getString(node), "%lli", &value) != 1) {
-					error(IN_EXPECTED_INTEGER_VALUE);
-					return NULL;
-				}
-				return createIntegerValueObject(value);
+			if (sscanf(getString(node), "%lli", &value) != 1) {
+				error(IN_EXPECTED_INTEGER_VALUE);
+				return NULL;
 			}
+			return createIntegerValueObject(value);
+		}
 		case VT_FUNC:
 			error(IN_CANNOT_CAST_FUNCTION_TO_INTEGER);
 			return NULL;
@@ -1243,15 +2185,12 @@ ValueObject *castIntegerExplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * decimal type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castFloatExplicit(ValueObject *node,
-                               ScopeObject *scope)
+ValueObject *castFloatExplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	switch (node->type) {
@@ -1262,39 +2201,18 @@ ValueObject *castFloatExplicit(ValueObject *node,
 			return createFloatValueObject((float)getInteger(node));
 		case VT_FLOAT:
 			return createFloatValueObject(getFloat(node));
-		case VT_STRING:
-			if (strstr(getString(node), ":{")) {
-				/* Perform interpolation */
-				ValueObject *ret = NULL;
-				ValueObject *interp = castStringExplicit(node, scope);
-				float value;
-				if (!interp) return NULL;
-				if (!isDecString(getString(interp))) {
-					error(IN_UNABLE_TO_CAST_VALUE);
-					deleteValueObject(interp);
-					return NULL;
-				}
-				if (sscanf(getString(interp), "%f", &value) != 1) {
-					error(IN_EXPECTED_DECIMAL);
-					deleteValueObject(interp);
-					return NULL;
-				}
-				ret = createFloatValueObject(value);
-				deleteValueObject(interp);
-				return ret;
+		case VT_STRING: {
+			float value;
+			if (!isDecString(getString(node))) {
+				error(IN_UNABLE_TO_CAST_VALUE);
+				return NULL;
 			}
-			else {
-				float value;
-				if (!isDecString(getString(node))) {
-					error(IN_UNABLE_TO_CAST_VALUE);
-					return NULL;
-				}
-				if (sscanf(getString(node), "%f", &value) != 1) {
-					error(IN_EXPECTED_DECIMAL);
-					return NULL;
-				}
-				return createFloatValueObject(value);
+			if (sscanf(getString(node), "%f", &value) != 1) {
+				error(IN_EXPECTED_DECIMAL);
+				return NULL;
 			}
+			return createFloatValueObject(value);
+		}
 		case VT_FUNC:
 			error(IN_CANNOT_CAST_FUNCTION_TO_DECIMAL);
 			return NULL;
@@ -1314,26 +2232,25 @@ ValueObject *castFloatExplicit(ValueObject *node,
  *
  * \param [in] node The value to cast.
  * 
- * \param [in] scope The scope to use for variable interpolation.
- *
- * \note \a scope is used to resolve variable interpolation within the string
- * before casting it.  Therefore, a simple way to interpolate the variables
- * within a string is to call this function with it.
+ * \note Interpolation and escape sequences are handled when a string constant
+ * is parsed, so strings are copied as they are.
  *
  * \return A pointer to a value with a copy of the contents of \a node, cast to
  * string type.
  *
  * \retval NULL An error occurred while casting.
  */
-ValueObject *castStringExplicit(ValueObject *node,
-                                ScopeObject *scope)
+ValueObject *castStringExplicit(ValueObject *node)
 {
 	if (!node) return NULL;
 	switch (node->type) {
 		case VT_NIL: {
-			char *str = copyString("");
+			char *str = createString("", 0);
+			ValueObject *p = NULL;
 			if (!str) return NULL;
-			return createStringValueObject(str);
+			p = createStringValueObject(str);
+			if (!p) deleteString(str);
+			return p;
 		}
 		case VT_BOOLEAN: {
 			/*
@@ -1344,216 +2261,47 @@ ValueObject *castStringExplicit(ValueObject *node,
 			return NULL;
 		}
 		case VT_INTEGER: {
-			char *data = NULL;
 			/*
 			 * One character per integer bit plus one more for the
 			 * null character
 			 */
-			size_t size = sizeof(long long int) * 8 + 1;
-			data = malloc(sizeof(char) * size);
-			if (!data) return NULL;
-			sprintf(data, "%lli", getInteger(node));
-			return createStringValueObject(data);
+			char digits[sizeof(long long int) * 8 + 1];
+			int len = sprintf(digits, "%lli", getInteger(node));
+			char *str = createString(digits, (size_t)len);
+			ValueObject *p = NULL;
+			if (!str) return NULL;
+			p = createStringValueObject(str);
+			if (!p) deleteString(str);
+			return p;
 		}
 		case VT_FLOAT: {
-			char *data = NULL;
 			unsigned int precision = 2;
 			/*
-			 * One character per float bit plus one more for the
-			 * null character
+			 * Enough for the integer part of the largest decimal
+			 * and six places
 			 */
-			size_t size = sizeof(float) * 8 + 1;
-			data = malloc(sizeof(char) * size);
-			if (!data) return NULL;
-			sprintf(data, "%f", getFloat(node));
+			char digits[64];
+			char *point = NULL;
+			char *str = NULL;
+			ValueObject *p = NULL;
+			size_t len = (size_t)sprintf(digits, "%f", getFloat(node));
 			/* Truncate to a certain number of decimal places */
-			strchr(data, '.')[precision + 1] = '\0';
-			return createStringValueObject(data);
+			point = strchr(digits, '.');
+			if (point && point + precision + 1 < digits + len)
+				len = (size_t)(point + precision + 1 - digits);
+			str = createString(digits, len);
+			if (!str) return NULL;
+			p = createStringValueObject(str);
+			if (!p) deleteString(str);
+			return p;
 		}
 		case VT_STRING: {
-			char *temp = NULL;
-			char *data = NULL;
-			char *str = getString(node);
-			unsigned int a, b;
-			size_t size;
-			/* Perform interpolation */
-			size = strlen(getString(node)) + 1;
-			temp = malloc(sizeof(char) * size);
-			for (a = 0, b = 0; str[b] != '\0'; ) {
-				if (!strncmp(str + b, ":)", 2)) {
-					temp[a] = '\n';
-					a++, b += 2;
-				}
-				else if (!strncmp(str + b, ":>", 2)) {
-					temp[a] = '\t';
-					a++, b += 2;
-				}
-				else if (!strncmp(str + b, ":o", 2)) {
-					temp[a] = '\a';
-					a++, b += 2;
-				}
-				else if (!strncmp(str + b, ":\"", 2)) {
-					temp[a] = '"';
-					a++, b += 2;
-				}
-				else if (!strncmp(str + b, "::", 2)) {
-					temp[a] = ':';
-					a++, b += 2;
-				}
-				else if (!strncmp(str + b, ":(", 2)) {
-					const char *start = str + b + 2;
-					const char *end = strchr(start, ')');
-					size_t len;
-					char *image = NULL;
-					long codepoint;
-					char out[3];
-					size_t num;
-					void *mem = NULL;
-					if (end < start) {
-						error(IN_EXPECTED_CLOSING_PAREN);
-						free(temp);
-						return NULL;
-					}
-					len = (size_t)(end - start);
-					image = malloc(sizeof(char) * (len + 1));
-					strncpy(image, start, len);
-					image[len] = '\0';
-					if (!isHexString(image)) {
-						error(IN_INVALID_HEX_NUMBER);
-						free(temp);
-						free(image);
-						return NULL;
-					}
-					codepoint = strtol(image, NULL, 16);
-					free(image);
-					if (codepoint < 0) {
-						error(IN_CODE_POINT_MUST_BE_POSITIVE);
-						free(temp);
-						return NULL;
-					}
-					num = convertCodePointToUTF8((unsigned int)codepoint, out);
-					if (num == 0) {
-						free(temp);
-						return NULL;
-					}
-					size += num;
-					mem = realloc(temp, size);
-					if (!mem) {
-						perror("realloc");
-						free(temp);
-						return NULL;
-					}
-					temp = mem;
-					strncpy(temp + a, out, num);
-					a += num, b += len + 3;
-				}
-				else if (!strncmp(str + b, ":[", 2)) {
-					const char *start = str + b + 2;
-					const char *end = strchr(start, ']');
-					size_t len;
-					char *image = NULL;
-					long codepoint;
-					char out[3];
-					size_t num;
-					void *mem = NULL;
-					if (end < start) {
-						error(IN_EXPECTED_CLOSING_SQUARE_BRACKET);
-						free(temp);
-						return NULL;
-					}
-					len = (size_t)(end - start);
-					image = malloc(sizeof(char) * (len + 1));
-					strncpy(image, start, len);
-					strncpy(image, start, len);
-					image[len] = '\0';
-					codepoint = convertNormativeNameToCodePoint(image);
-					free(image);
-					if (codepoint < 0) {
-						error(IN_CODE_POINT_MUST_BE_POSITIVE);
-						free(temp);
-						return NULL;
-					}
-					num = convertCodePointToUTF8((unsigned int)codepoint, out);
-					size += num;
-					mem = realloc(temp, size);
-					if (!mem) {
-						perror("realloc");
-						free(temp);
-						return NULL;
-					}
-					temp = mem;
-					strncpy(temp + a, out, num);
-					a += num, b += len + 3;
-				}
-				else if (!strncmp(str + b, ":{", 2)) {
-					IdentifierNode *target = NULL;
-					ValueObject *val = NULL, *use = NULL;
-					/* Copy the variable name into image */
-					const char *start = str + b + 2;
-					const char *end = strchr(start, '}');
-					size_t len;
-					char *image = NULL;
-					void *mem = NULL;
-					if (end < start) {
-						error(IN_EXPECTED_CLOSING_CURLY_BRACE);
-						free(temp);
-						return NULL;
-					}
-					len = (size_t)(end - start);
-					image = malloc(sizeof(char) * (len + 1));
-					strncpy(image, start, len);
-					image[len] = '\0';
-					if (!strcmp(image, "IT"))
-						/* Lookup implicit variable */
-						val = scope->impvar;
-					else {
-						/*
-						 * Create a new IdentifierNode
-						 * structure and look up its
-						 * value
-						 */
-						target = createIdentifierNode(IT_DIRECT, image, NULL, NULL, 0);
-						if (!target) {
-							free(temp);
-							return NULL;
-						}
-						val = getScopeValue(scope, scope, target);
-						if (!val) {
-							error(IN_VARIABLE_DOES_NOT_EXIST, target->fname, target->line, image);
-							deleteIdentifierNode(target);
-							free(temp);
-							return NULL;
-						}
-						deleteIdentifierNode(target);
-					}
-					/* Cast the variable value to a string */
-					if (!(use = castStringImplicit(val, scope))) {
-						free(temp);
-						return NULL;
-					}
-					/* Update the size of the new string */
-					size += strlen(getString(use));
-					mem = realloc(temp, size);
-					if (!mem) {
-						perror("realloc");
-						free(temp);
-					}
-					temp = mem;
-					/* Copy the variable string into the new string */
-					strcpy(temp + a, getString(use));
-					a += strlen(getString(use)), b += len + 3;
-					deleteValueObject(use);
-				}
-				else {
-					temp[a] = str[b];
-					a++, b++;
-				}
-			}
-			temp[a] = '\0';
-			data = malloc(sizeof(char) * (strlen(temp) + 1));
-			strcpy(data, temp);
-			free(temp);
-			return createStringValueObject(data);
+			char *str = createString(getString(node), getStringLength(node));
+			ValueObject *p = NULL;
+			if (!str) return NULL;
+			p = createStringValueObject(str);
+			if (!p) deleteString(str);
+			return p;
 		}
 		case VT_FUNC: {
 			error(IN_CANNOT_CAST_FUNCTION_TO_STRING);
@@ -1563,8 +2311,147 @@ ValueObject *castStringExplicit(ValueObject *node,
 			error(IN_CANNOT_CAST_ARRAY_TO_STRING);
 			return NULL;
 		default:
-			error(IN_UNKNOWN_VALUE_DURING_STRING_CAST);
-			return NULL;
+			error(IN_UNKNOWN_VALUE_DURING_STRING_CAST);
+			return NULL;
+	}
+}
+
+/**
+ * Casts the contents of a value to a given type in an explicit way.  Casting is
+ * not done directly to \a node, instead, it is performed on a copy which is
+ * what is returned.
+ *
+ * \param [in] node The value to cast.
+ *
+ * \param [in] type The type to cast \a node to.
+ *
+ * \return A pointer to a value with a copy of the contents of \a node, cast to
+ * type \a type.
+ *
+ * \retval NULL An error occurred while casting.
+ */
+ValueObject *castValueExplicit(ValueObject *node,
+                               ConstantType type)
+{
+	switch (type) {
+		case CT_NIL:
+			return createNilValueObject();
+		case CT_BOOLEAN:
+			return castBooleanExplicit(node);
+		case CT_INTEGER:
+			return castIntegerExplicit(node);
+		case CT_FLOAT:
+			return castFloatExplicit(node);
+		case CT_STRING:
+			return castStringExplicit(node);
+		default:
+			error(IN_UNKNOWN_CAST_TYPE);
+			return NULL;
+	}
+}
+
+/**
+ * Gets the truth value of an unboxed value, as used by conditions and boolean
+ * operations: booleans and integers are used as-is and anything else is cast
+ * to a boolean.
+ *
+ * \param [in] node The unboxed value to get the truth value of.
+ *
+ * \param [out] truth The truth value of \a node.
+ *
+ * \retval 0 An error occurred while casting.
+ *
+ * \retval 1 \a truth was set.
+ */
+int castBooleanImmediate(ImmediateValue *node,
+                         int *truth)
+{
+	ValueObject *use = NULL;
+	switch (node->type) {
+		case VT_NIL:
+			*truth = 0;
+			return 1;
+		case VT_BOOLEAN:
+		case VT_INTEGER:
+			*truth = (int)getInteger(node);
+			return 1;
+		case VT_FLOAT:
+			*truth = fabs(getFloat(node) - 0.0) > FLT_EPSILON;
+			return 1;
+		default:
+			use = castBooleanImplicit(node->value);
+			if (!use) return 0;
+			*truth = (int)getInteger(use);
+			deleteValueObject(use);
+			return 1;
+	}
+}
+
+/**
+ * Casts an unboxed value to string type in an implicit way, in place.  Strings
+ * are left as they are, without being copied.
+ *
+ * \param [in,out] node The unboxed value to cast.
+ *
+ * \retval 0 An error occurred while casting; \a node will have been released.
+ *
+ * \retval 1 \a node was cast.
+ */
+int castStringImmediate(ImmediateValue *node)
+{
+	ValueObject tmp;
+	ValueObject *use = node->value;
+	if (node->type == VT_STRING) return 1;
+	if (!use) {
+		/* Casts never keep a reference to the value they cast */
+		tmp.type = node->type;
+		tmp.data = node->data;
+		tmp.semaphore = 1;
+		use = &tmp;
+	}
+	use = castStringImplicit(use);
+	releaseImmediateValue(node);
+	if (!use) return 0;
+	*node = unboxValueObject(use);
+	return 1;
+}
+
+/**
+ * Casts an unboxed value to string type in an implicit way and writes it as
+ * output.  Numbers are formatted directly into the output buffer and strings
+ * are written without being copied.
+ *
+ * \param [in] node The value to print.
+ *
+ * \retval 0 An error occurred while casting.
+ *
+ * \retval 1 \a node was printed.
+ */
+int printImmediateValue(ImmediateValue *node)
+{
+	ValueObject *use = NULL;
+	switch (node->type) {
+		case VT_NIL:
+			error(IN_CANNOT_IMPLICITLY_CAST_NIL);
+			return 0;
+		case VT_BOOLEAN:
+			error(IN_CANNOT_CAST_BOOLEAN_TO_STRING);
+			return 0;
+		case VT_INTEGER:
+			writeOutputInteger(getInteger(node));
+			return 1;
+		case VT_FLOAT:
+			writeOutputFloat(getFloat(node));
+			return 1;
+		case VT_STRING:
+			writeOutput(getString(node), getStringLength(node));
+			return 1;
+		default:
+			use = castStringImplicit(node->value);
+			if (!use) return 0;
+			writeOutput(getString(use), getStringLength(use));
+			deleteValueObject(use);
+			return 1;
 	}
 }
 
@@ -1579,13 +2466,13 @@ ValueObject *castStringExplicit(ValueObject *node,
  * prototype to allow this function to be stored in a jump table for fast
  * execution.
  *
- * \return A pointer to the value of \a scope's implicit variable.
+ * \return A pointer to a copy of the value of \a scope's implicit variable.
  */
 ValueObject *interpretImpVarExprNode(ExprNode *node,
                                      ScopeObject *scope)
 {
 	node = NULL;
-	return scope->impvar;
+	return copyValueObject(scope->impvar);
 }
 
 /**
@@ -1608,31 +2495,9 @@ ValueObject *interpretCastExprNode(ExprNode *node,
 	ValueObject *val = interpretExprNode(expr->target, scope);
 	ValueObject *ret = NULL;
 	if (!val) return NULL;
-	switch(expr->newtype->type) {
-		case CT_NIL:
-			deleteValueObject(val);
-			return createNilValueObject();
-		case CT_BOOLEAN:
-			ret = castBooleanExplicit(val, scope);
-			deleteValueObject(val);
-			return ret;
-		case CT_INTEGER:
-			ret = castIntegerExplicit(val, scope);
-			deleteValueObject(val);
-			return ret;
-		case CT_FLOAT:
-			ret = castFloatExplicit(val, scope);
-			deleteValueObject(val);
-			return ret;
-		case CT_STRING:
-			ret = castStringExplicit(val, scope);
-			deleteValueObject(val);
-			return ret;
-		default:
-			error(IN_UNKNOWN_CAST_TYPE);
-			deleteValueObject(val);
-			return NULL;
-	}
+	ret = castValueExplicit(val, expr->newtype->type);
+	deleteValueObject(val);
+	return ret;
 }
 
 /**
@@ -1657,52 +2522,40 @@ ValueObject *interpretFuncCallExprNode(ExprNode *node,
 	ValueObject *def = NULL;
 	ReturnObject *retval = NULL;
 	ValueObject *ret = NULL;
-	ScopeObject *dest = NULL;
 	ScopeObject *target = NULL;
 
-	dest = getScopeObject(scope, scope, expr->scope);
-
-	target = getScopeObjectLocal(scope, dest, expr->name);
+	def = getFuncCallValue(scope, expr, &target);
 	if (!target) return NULL;
 
-	outer = createScopeObjectCaller(scope, target);
-	if (!outer) return NULL;
-
-	def = getScopeValue(scope, dest, expr->name);
-
 	if (!def || def->type != VT_FUNC) {
 		IdentifierNode *id = (IdentifierNode *)(expr->name);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			error(IN_UNDEFINED_FUNCTION, id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
-		deleteScopeObject(outer);
 		return NULL;
 	}
 	/* Check for correct supplied arity */
 	if (getFunction(def)->args->num != expr->args->num) {
 		IdentifierNode *id = (IdentifierNode *)(expr->name);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			error(IN_INCORRECT_NUMBER_OF_ARGUMENTS, id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
-		deleteScopeObject(outer);
 		return NULL;
 	}
+	outer = createFrameScopeObject(scope, target, getFunction(def)->args);
+	if (!outer) return NULL;
 	for (n = 0; n < getFunction(def)->args->num; n++) {
 		ValueObject *val = NULL;
-		if (!createScopeValue(scope, outer, getFunction(def)->args->ids[n])) {
-			deleteScopeObject(outer);
-			return NULL;
-		}
 		if (!(val = interpretExprNode(expr->args->exprs[n], scope))) {
-			deleteScopeObject(outer);
+			releaseFrameScopeObject(outer);
 			return NULL;
 		}
 		if (!updateScopeValue(scope, outer, getFunction(def)->args->ids[n], val)) {
-			deleteScopeObject(outer);
+			releaseFrameScopeObject(outer);
 			deleteValueObject(val);
 			return NULL;
 		}
@@ -1713,7 +2566,7 @@ ValueObject *interpretFuncCallExprNode(ExprNode *node,
 	 * implicit variable in the case of a default return.
 	 */
 	if (!(retval = interpretStmtNodeList(getFunction(def)->body->stmts, outer))) {
-		deleteScopeObject(outer);
+		releaseFrameScopeObject(outer);
 		return NULL;
 	}
 	switch (retval->type) {
@@ -1735,7 +2588,7 @@ ValueObject *interpretFuncCallExprNode(ExprNode *node,
 			break;
 	}
 	deleteReturnObject(retval);
-	deleteScopeObject(outer);
+	releaseFrameScopeObject(outer);
 	return ret;
 }
 
@@ -1760,16 +2613,71 @@ ValueObject *interpretIdentifierExprNode(ExprNode *node,
 	return copyValueObject(val);
 }
 
+/**
+ * Interprets an interpolated string.
+ *
+ * \param [in] node A pointer to the interpolated string to interpret.
+ *
+ * \param [in] scope A pointer to a scope to evaluate \a node under.
+ *
+ * \return A pointer to a string value with the variables of \a node
+ * interpolated.
+ *
+ * \retval NULL An error occurred during interpretation.
+ */
+ValueObject *interpretStringTemplateNode(StringTemplateNode *node,
+                                         ScopeObject *scope)
+{
+	ValueObject *ret = NULL;
+	char *acc = createString(NULL, 0);
+	size_t len = 0;
+	unsigned int n;
+	if (!acc) return NULL;
+	for (n = 0; n < node->num; n++) {
+		size_t size = getInternLength(node->strs[n]);
+		size_t extra = 0;
+		ValueObject *use = NULL;
+		char *mem = NULL;
+		if (node->vars[n]) {
+			ValueObject *val = interpretExprNode(node->vars[n], scope);
+			if (!val) goto interpretStringTemplateNodeAbort;
+			use = castStringImplicit(val);
+			deleteValueObject(val);
+			if (!use) goto interpretStringTemplateNodeAbort;
+			extra = getStringLength(use);
+		}
+		mem = resizeString(acc, len + size + extra);
+		if (!mem) {
+			deleteValueObject(use);
+			goto interpretStringTemplateNodeAbort;
+		}
+		acc = mem;
+		memcpy(acc + len, node->strs[n], size);
+		len += size;
+		if (use) {
+			memcpy(acc + len, getString(use), extra);
+			len += extra;
+			deleteValueObject(use);
+		}
+	}
+	ret = createStringValueObject(acc);
+	if (!ret) goto interpretStringTemplateNodeAbort;
+	return ret;
+
+interpretStringTemplateNodeAbort: /* In case something goes wrong... */
+
+	deleteString(acc);
+
+	return NULL;
+}
+
 /**
  * Interprets a constant.
  *
  * \param [in] node A pointer to the expression to interpret.
  *
- * \param [in] scope Not used (see note).
- *
- * \note \a node is not used by this function but is still included in its
- * prototype to allow this function to be stored in a jump table for fast
- * execution.
+ * \param [in] scope A pointer to a scope to evaluate any variables interpolated
+ * into \a node under.
  *
  * \pre \a node contains a constant created by createXConstantNode(), where X is
  * either Boolean, Integer, Float, or String.
@@ -1782,7 +2690,8 @@ ValueObject *interpretConstantExprNode(ExprNode *node,
                                        ScopeObject *scope)
 {
 	ConstantNode *expr = (ConstantNode *)node->expr;
-	scope = NULL;
+	/* Optimized constants share one value */
+	if (expr->value) return copyValueObject(expr->value);
 	switch (expr->type) {
 		case CT_NIL:
 			return createNilValueObject();
@@ -1793,14 +2702,15 @@ ValueObject *interpretConstantExprNode(ExprNode *node,
 		case CT_FLOAT:
 			return createFloatValueObject(expr->data.f);
 		case CT_STRING: {
-			/*
-			 * \note For efficiency, string interpolation should be
-			 * performed by caller because it only needs to be
-			 * performed when necessary.
-			 */
-			char *str = copyString(expr->data.s);
+			char *str = NULL;
+			ValueObject *p = NULL;
+			if (expr->tmpl)
+				return interpretStringTemplateNode(expr->tmpl, scope);
+			str = createString(expr->data.s, getInternLength(expr->data.s));
 			if (!str) return NULL;
-			return createStringValueObject(str);
+			p = createStringValueObject(str);
+			if (!p) deleteString(str);
+			return p;
 		}
 		default:
 			error(IN_UNKNOWN_CONSTANT_TYPE);
@@ -1815,33 +2725,29 @@ ValueObject *interpretConstantExprNode(ExprNode *node,
  *
  * \param [in] scope A pointer to a scope to evaluate \a node under.
  *
+ * \param [out] ret The logical negation of the first element of \a args.
+ *
  * \note Only the first element of \a args is used.
  *
- * \return A pointer to the value of the logical negation of the first element
- * of \a args.
+ * \retval 0 An error occurred during interpretation.
  *
- * \retval NULL An error occurred during interpretation.
+ * \retval 1 \a ret was set.
  */
-ValueObject *interpretNotOpExprNode(OpExprNode *expr,
-                                    ScopeObject *scope)
+int interpretNotOpExprNode(OpExprNode *expr,
+                           ScopeObject *scope,
+                           ImmediateValue *ret)
 {
-	ValueObject *val = interpretExprNode(expr->args->exprs[0], scope);
-	ValueObject *use = val;
-	int retval;
-	unsigned short cast = 0;
-	if (!val) return NULL;
-	if (val->type != VT_BOOLEAN && val->type != VT_INTEGER) {
-		use = castBooleanImplicit(val, scope);
-		if (!use) {
-			deleteValueObject(val);
-			return NULL;
-		}
-		cast = 1;
+	ImmediateValue val;
+	int truth;
+	if (!interpretUnboxedExprNode(expr->args->exprs[0], scope, &val))
+		return 0;
+	if (!castBooleanImmediate(&val, &truth)) {
+		releaseImmediateValue(&val);
+		return 0;
 	}
-	retval = getInteger(use);
-	if (cast) deleteValueObject(use);
-	deleteValueObject(val);
-	return createBooleanValueObject(!retval);
+	releaseImmediateValue(&val);
+	*ret = createBooleanImmediateValue(!truth);
+	return 1;
 }
 
 /**
@@ -1851,12 +2757,12 @@ ValueObject *interpretNotOpExprNode(OpExprNode *expr,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the sum of \a a and \a b.
+ * \return The value of the sum of \a a and \a b.
  */
-ValueObject *opAddIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opAddIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createIntegerValueObject(getInteger(a) + getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) + getInteger(b));
 }
 
 /**
@@ -1866,12 +2772,12 @@ ValueObject *opAddIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the difference of \a a and \a b.
+ * \return The value of the difference of \a a and \a b.
  */
-ValueObject *opSubIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opSubIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createIntegerValueObject(getInteger(a) - getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) - getInteger(b));
 }
 
 /**
@@ -1881,12 +2787,12 @@ ValueObject *opSubIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the product of \a a and \a b.
+ * \return The value of the product of \a a and \a b.
  */
-ValueObject *opMultIntegerInteger(ValueObject *a,
-                                  ValueObject *b)
+ImmediateValue opMultIntegerInteger(ImmediateValue *a,
+                                    ImmediateValue *b)
 {
-	return createIntegerValueObject(getInteger(a) * getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) * getInteger(b));
 }
 
 /**
@@ -1896,18 +2802,18 @@ ValueObject *opMultIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the quotient of \a a and \a b.
+ * \return The value of the quotient of \a a and \a b.
  *
- * \retval NULL Division by zero.
+ * \retval nil Division by zero.
  */
-ValueObject *opDivIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opDivIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
 	if (getInteger(b) == 0) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createIntegerValueObject(getInteger(a) / getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) / getInteger(b));
 }
 
 /**
@@ -1917,12 +2823,12 @@ ValueObject *opDivIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the maximum of \a a and \a b.
+ * \return The value of the maximum of \a a and \a b.
  */
-ValueObject *opMaxIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opMaxIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createIntegerValueObject(getInteger(a) > getInteger(b) ? getInteger(a) : getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) > getInteger(b) ? getInteger(a) : getInteger(b));
 }
 
 /**
@@ -1932,12 +2838,12 @@ ValueObject *opMaxIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the minimum of \a a and \a b.
+ * \return The value of the minimum of \a a and \a b.
  */
-ValueObject *opMinIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opMinIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createIntegerValueObject(getInteger(a) < getInteger(b) ? getInteger(a) : getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) < getInteger(b) ? getInteger(a) : getInteger(b));
 }
 
 /**
@@ -1947,16 +2853,16 @@ ValueObject *opMinIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the modulus of \a a and \a b.
+ * \return The value of the modulus of \a a and \a b.
  */
-ValueObject *opModIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opModIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
 	if (getInteger(b) == 0) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createIntegerValueObject(getInteger(a) % getInteger(b));
+	return createIntegerImmediateValue(getInteger(a) % getInteger(b));
 }
 
 /**
@@ -1966,12 +2872,12 @@ ValueObject *opModIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the sum of \a a and \a b.
+ * \return The value of the sum of \a a and \a b.
  */
-ValueObject *opAddIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opAddIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject((float)(getInteger(a) + getFloat(b)));
+	return createFloatImmediateValue((float)(getInteger(a) + getFloat(b)));
 }
 
 /**
@@ -1981,12 +2887,12 @@ ValueObject *opAddIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the difference of \a a and \a b.
+ * \return The value of the difference of \a a and \a b.
  */
-ValueObject *opSubIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opSubIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject((float)(getInteger(a) - getFloat(b)));
+	return createFloatImmediateValue((float)(getInteger(a) - getFloat(b)));
 }
 
 /**
@@ -1996,12 +2902,12 @@ ValueObject *opSubIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the product of \a a and \a b.
+ * \return The value of the product of \a a and \a b.
  */
-ValueObject *opMultIntegerFloat(ValueObject *a,
-                                ValueObject *b)
+ImmediateValue opMultIntegerFloat(ImmediateValue *a,
+                                  ImmediateValue *b)
 {
-	return createFloatValueObject((float)(getInteger(a) * getFloat(b)));
+	return createFloatImmediateValue((float)(getInteger(a) * getFloat(b)));
 }
 
 /**
@@ -2011,18 +2917,18 @@ ValueObject *opMultIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the quotient of \a a and \a b.
+ * \return The value of the quotient of \a a and \a b.
  *
- * \retval NULL Division by zero.
+ * \retval nil Division by zero.
  */
-ValueObject *opDivIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opDivIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
 	if (fabs(getFloat(b) - 0.0) < FLT_EPSILON) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject((float)(getInteger(a) / getFloat(b)));
+	return createFloatImmediateValue((float)(getInteger(a) / getFloat(b)));
 }
 
 /**
@@ -2032,12 +2938,12 @@ ValueObject *opDivIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the maximum of \a a and \a b.
+ * \return The value of the maximum of \a a and \a b.
  */
-ValueObject *opMaxIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opMaxIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject((float)(getInteger(a)) > getFloat(b) ? (float)(getInteger(a)) : getFloat(b));
+	return createFloatImmediateValue((float)(getInteger(a)) > getFloat(b) ? (float)(getInteger(a)) : getFloat(b));
 }
 
 /**
@@ -2047,12 +2953,12 @@ ValueObject *opMaxIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the minimum of \a a and \a b.
+ * \return The value of the minimum of \a a and \a b.
  */
-ValueObject *opMinIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opMinIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject((float)(getInteger(a)) < getFloat(b) ? (float)(getInteger(a)) : getFloat(b));
+	return createFloatImmediateValue((float)(getInteger(a)) < getFloat(b) ? (float)(getInteger(a)) : getFloat(b));
 }
 
 /**
@@ -2062,16 +2968,16 @@ ValueObject *opMinIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the modulus of \a a and \a b.
+ * \return The value of the modulus of \a a and \a b.
  */
-ValueObject *opModIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opModIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
 	if (fabs(getFloat(b) - 0.0) < FLT_EPSILON) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject((float)(fmod((double)(getInteger(a)), getFloat(b))));
+	return createFloatImmediateValue((float)(fmod((double)(getInteger(a)), getFloat(b))));
 }
 
 /**
@@ -2081,12 +2987,12 @@ ValueObject *opModIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the sum of \a a and \a b.
+ * \return The value of the sum of \a a and \a b.
  */
-ValueObject *opAddFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opAddFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) + getInteger(b));
+	return createFloatImmediateValue(getFloat(a) + getInteger(b));
 }
 
 /**
@@ -2096,12 +3002,12 @@ ValueObject *opAddFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the difference of \a a and \a b.
+ * \return The value of the difference of \a a and \a b.
  */
-ValueObject *opSubFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opSubFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) - getInteger(b));
+	return createFloatImmediateValue(getFloat(a) - getInteger(b));
 }
 
 /**
@@ -2111,12 +3017,12 @@ ValueObject *opSubFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the product of \a a and \a b.
+ * \return The value of the product of \a a and \a b.
  */
-ValueObject *opMultFloatInteger(ValueObject *a,
-                                ValueObject *b)
+ImmediateValue opMultFloatInteger(ImmediateValue *a,
+                                  ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) * getInteger(b));
+	return createFloatImmediateValue(getFloat(a) * getInteger(b));
 }
 
 /**
@@ -2126,18 +3032,18 @@ ValueObject *opMultFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the quotient of \a a and \a b.
+ * \return The value of the quotient of \a a and \a b.
  *
- * \retval NULL Division by zero.
+ * \retval nil Division by zero.
  */
-ValueObject *opDivFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opDivFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
 	if (getInteger(b) == 0) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject(getFloat(a) / getInteger(b));
+	return createFloatImmediateValue(getFloat(a) / getInteger(b));
 }
 
 /**
@@ -2147,12 +3053,12 @@ ValueObject *opDivFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the maximum of \a a and \a b.
+ * \return The value of the maximum of \a a and \a b.
  */
-ValueObject *opMaxFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opMaxFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) > (float)(getInteger(b)) ? getFloat(a) : (float)(getInteger(b)));
+	return createFloatImmediateValue(getFloat(a) > (float)(getInteger(b)) ? getFloat(a) : (float)(getInteger(b)));
 }
 
 /**
@@ -2162,12 +3068,12 @@ ValueObject *opMaxFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the minimum of \a a and \a b.
+ * \return The value of the minimum of \a a and \a b.
  */
-ValueObject *opMinFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opMinFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) < (float)(getInteger(b)) ? getFloat(a) : (float)(getInteger(b)));
+	return createFloatImmediateValue(getFloat(a) < (float)(getInteger(b)) ? getFloat(a) : (float)(getInteger(b)));
 }
 
 /**
@@ -2177,16 +3083,16 @@ ValueObject *opMinFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the modulus of \a a and \a b.
+ * \return The value of the modulus of \a a and \a b.
  */
-ValueObject *opModFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opModFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
 	if (getInteger(b) == 0) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject((float)(fmod(getFloat(a), (double)(getInteger(b)))));
+	return createFloatImmediateValue((float)(fmod(getFloat(a), (double)(getInteger(b)))));
 }
 
 /**
@@ -2196,12 +3102,12 @@ ValueObject *opModFloatInteger(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the sum of \a a and \a b.
+ * \return The value of the sum of \a a and \a b.
  */
-ValueObject *opAddFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opAddFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) + getFloat(b));
+	return createFloatImmediateValue(getFloat(a) + getFloat(b));
 }
 
 /**
@@ -2211,12 +3117,12 @@ ValueObject *opAddFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the difference of \a a and \a b.
+ * \return The value of the difference of \a a and \a b.
  */
-ValueObject *opSubFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opSubFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) - getFloat(b));
+	return createFloatImmediateValue(getFloat(a) - getFloat(b));
 }
 
 /**
@@ -2226,12 +3132,12 @@ ValueObject *opSubFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the product of \a a and \a b.
+ * \return The value of the product of \a a and \a b.
  */
-ValueObject *opMultFloatFloat(ValueObject *a,
-                              ValueObject *b)
+ImmediateValue opMultFloatFloat(ImmediateValue *a,
+                                ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) * getFloat(b));
+	return createFloatImmediateValue(getFloat(a) * getFloat(b));
 }
 
 /**
@@ -2241,18 +3147,18 @@ ValueObject *opMultFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the quotient of \a a and \a b.
+ * \return The value of the quotient of \a a and \a b.
  *
- * \retval NULL Division by zero.
+ * \retval nil Division by zero.
  */
-ValueObject *opDivFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opDivFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
 	if (fabs(getFloat(b) - 0.0) < FLT_EPSILON) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject(getFloat(a) / getFloat(b));
+	return createFloatImmediateValue(getFloat(a) / getFloat(b));
 }
 
 /**
@@ -2262,12 +3168,12 @@ ValueObject *opDivFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the maximum of \a a and \a b.
+ * \return The value of the maximum of \a a and \a b.
  */
-ValueObject *opMaxFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opMaxFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) > getFloat(b) ? getFloat(a) : getFloat(b));
+	return createFloatImmediateValue(getFloat(a) > getFloat(b) ? getFloat(a) : getFloat(b));
 }
 
 /**
@@ -2277,12 +3183,12 @@ ValueObject *opMaxFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the minimum of \a a and \a b.
+ * \return The value of the minimum of \a a and \a b.
  */
-ValueObject *opMinFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opMinFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
-	return createFloatValueObject(getFloat(a) < getFloat(b) ? getFloat(a) : getFloat(b));
+	return createFloatImmediateValue(getFloat(a) < getFloat(b) ? getFloat(a) : getFloat(b));
 }
 
 /**
@@ -2292,16 +3198,16 @@ ValueObject *opMinFloatFloat(ValueObject *a,
  *
  * \param [in] b The second operand.
  *
- * \return A pointer to the value of the modulus of \a a and \a b.
+ * \return The value of the modulus of \a a and \a b.
  */
-ValueObject *opModFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opModFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
 	if (fabs(getFloat(b) - 0.0) < FLT_EPSILON) {
 		error(IN_DIVISION_BY_ZERO);
-		return NULL;
+		return createNilImmediateValue();
 	}
-	return createFloatValueObject((float)(fmod(getFloat(a), getFloat(b))));
+	return createFloatImmediateValue((float)(fmod(getFloat(a), getFloat(b))));
 }
 
 /*
@@ -2310,7 +3216,7 @@ ValueObject *opModFloatFloat(ValueObject *a,
  * type of the first argument, and the third index determines the type of the
  * second object.
  */
-static ValueObject *(*ArithOpJumpTable[7][2][2])(ValueObject *, ValueObject *) = {
+static ImmediateValue (*ArithOpJumpTable[7][2][2])(ImmediateValue *, ImmediateValue *) = {
 	{ { opAddIntegerInteger, opAddIntegerFloat }, { opAddFloatInteger, opAddFloatFloat } },
 	{ { opSubIntegerInteger, opSubIntegerFloat }, { opSubFloatInteger, opSubFloatFloat } },
 	{ { opMultIntegerInteger, opMultIntegerFloat }, { opMultFloatInteger, opMultFloatFloat } },
@@ -2321,121 +3227,259 @@ static ValueObject *(*ArithOpJumpTable[7][2][2])(ValueObject *, ValueObject *) =
 };
 
 /**
- * Interprets an arithmetic operation.
- *
- * \param [in] expr The operation to interpret.
+ * Casts an operand of an arithmetic operation to a number.  Strings are cast
+ * to a decimal if they contain a decimal point and to an integer otherwise.
  *
- * \param [in] scope The scope to evaluate \a expr under.
+ * \param [in] val The operand to cast.
  *
- * \note Only supports binary arithmetic operations.
+ * \param [out] use The operand cast to an integer or decimal.
  *
- * \return A pointer to the value of the arithmetic operation.
+ * \retval 0 An error occurred while casting.
  *
- * \retval NULL An error occurred during interpretation.
+ * \retval 1 \a use was set.
  */
-ValueObject *interpretArithOpExprNode(OpExprNode *expr,
-                                      ScopeObject *scope)
+static int castArithOperand(ImmediateValue *val,
+                            ImmediateValue *use)
 {
-	ValueObject *val1 = interpretExprNode(expr->args->exprs[0], scope);
-	ValueObject *val2 = interpretExprNode(expr->args->exprs[1], scope);
-	ValueObject *use1 = val1;
-	ValueObject *use2 = val2;
-	unsigned int cast1 = 0;
-	unsigned int cast2 = 0;
-	ValueObject *ret = NULL;
-	if (!val1 || !val2) {
-		deleteValueObject(val1);
-		deleteValueObject(val2);
-		return NULL;
-	}
-	/* Check if a floating point decimal string and cast */
-	switch (val1->type) {
+	switch (val->type) {
 		case VT_NIL:
+			error(IN_CANNOT_IMPLICITLY_CAST_NIL);
+			return 0;
 		case VT_BOOLEAN:
-			use1 = castIntegerImplicit(val1, scope);
-			if (!use1) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				return NULL;
-			}
-			cast1 = 1;
-			break;
+			*use = createIntegerImmediateValue(getInteger(val));
+			return 1;
 		case VT_INTEGER:
 		case VT_FLOAT:
-			break;
+			*use = *val;
+			return 1;
 		case VT_STRING: {
-			/* Perform interpolation */
-			ValueObject *interp = castStringExplicit(val1, scope);
-			if (!interp) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				return NULL;
-			}
-			if (strchr(getString(interp), '.'))
-				use1 = castFloatImplicit(interp, scope);
+			ValueObject *cast = NULL;
+			if (strchr(getString(val), '.'))
+				cast = castFloatImplicit(val->value);
 			else
-				use1 = castIntegerImplicit(interp, scope);
-			deleteValueObject(interp);
-			if (!use1) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				return NULL;
-			}
-			cast1 = 1;
-			break;
+				cast = castIntegerImplicit(val->value);
+			if (!cast) return 0;
+			*use = unboxValueObject(cast);
+			return 1;
 		}
 		default:
 			error(IN_INVALID_OPERAND_TYPE);
+			return 0;
 	}
-	switch (val2->type) {
-		case VT_NIL:
-		case VT_BOOLEAN:
-			use2 = castIntegerImplicit(val2, scope);
-			if (!use2) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				if (cast1) deleteValueObject(use1);
-				return NULL;
-			}
-			cast2 = 1;
+}
+
+/**
+ * Applies an arithmetic operation to a pair of values.
+ *
+ * \param [in] type The arithmetic operation to apply.
+ *
+ * \param [in] val1 The first operand.
+ *
+ * \param [in] val2 The second operand.
+ *
+ * \param [out] ret The value of the arithmetic operation.
+ *
+ * \note \a val1 and \a val2 are not released by this function.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
+ */
+int applyArithOp(OpType type,
+                 ImmediateValue *val1,
+                 ImmediateValue *val2,
+                 ImmediateValue *ret)
+{
+	ImmediateValue use1;
+	ImmediateValue use2;
+	/* Numbers need no casting */
+	if (val1->type <= VT_FLOAT && val2->type <= VT_FLOAT) {
+		*ret = ArithOpJumpTable[type][val1->type][val2->type](val1, val2);
+		return ret->type != VT_NIL;
+	}
+	/* Check if a floating point decimal string and cast */
+	if (!castArithOperand(val1, &use1)) return 0;
+	if (!castArithOperand(val2, &use2)) return 0;
+	/* Do math depending on value types */
+	*ret = ArithOpJumpTable[type][use1.type][use2.type](&use1, &use2);
+	/* Only division by zero results in nil */
+	return ret->type != VT_NIL;
+}
+
+/**
+ * Specializes an arithmetic or equality operation for the types of its
+ * operands.  The types seen the first time an operation is evaluated decide
+ * what it is specialized for; if other types are seen later, it falls back to
+ * handling any types for good, so that a polymorphic operation does not keep
+ * changing its mind.
+ *
+ * \param [in,out] expr The operation being evaluated.
+ *
+ * \param [in] val1 The first operand.
+ *
+ * \param [in] val2 The second operand.
+ *
+ * \return The operand types to apply \a expr for: OQ_INTEGER or OQ_FLOAT if
+ * \a expr is specialized for, and given, two integers or two decimals, and
+ * OQ_GENERIC otherwise.
+ */
+static OpQuickType quickenOpExprNode(OpExprNode *expr,
+                                     ImmediateValue *val1,
+                                     ImmediateValue *val2)
+{
+	OpQuickType seen = OQ_GENERIC;
+	if (val1->type == val2->type) {
+		if (val1->type == VT_INTEGER) seen = OQ_INTEGER;
+		else if (val1->type == VT_FLOAT) seen = OQ_FLOAT;
+	}
+	if (expr->quick != seen)
+		expr->quick = expr->quick == OQ_UNSEEN ? seen : OQ_GENERIC;
+	return expr->quick;
+}
+
+/**
+ * Applies an arithmetic operation to a pair of integers.  This is the same as
+ * applyArithOp() for integers, without checking their types.
+ *
+ * \param [in] type The arithmetic operation to apply.
+ *
+ * \param [in] a The first operand.
+ *
+ * \param [in] b The second operand.
+ *
+ * \param [out] ret The value of the arithmetic operation.
+ *
+ * \retval 0 Division by zero was attempted.
+ *
+ * \retval 1 \a ret was set.
+ */
+static int applyIntegerArithOp(OpType type,
+                               long long int a,
+                               long long int b,
+                               ImmediateValue *ret)
+{
+	switch (type) {
+		case OP_ADD:
+			ret->data.i = a + b;
 			break;
-		case VT_INTEGER:
-		case VT_FLOAT:
+		case OP_SUB:
+			ret->data.i = a - b;
 			break;
-		case VT_STRING: {
-			/* Perform interpolation */
-			ValueObject *interp = castStringExplicit(val2, scope);
-			if (!interp) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				if (cast1) deleteValueObject(use1);
-				return NULL;
+		case OP_MULT:
+			ret->data.i = a * b;
+			break;
+		case OP_DIV:
+		case OP_MOD:
+			if (b == 0) {
+				error(IN_DIVISION_BY_ZERO);
+				return 0;
 			}
-			if (strchr(getString(interp), '.'))
-				use2 = castFloatImplicit(interp, scope);
-			else
-				use2 = castIntegerImplicit(interp, scope);
-			deleteValueObject(interp);
-			if (!use2) {
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				if (cast1) deleteValueObject(use1);
-				return NULL;
+			ret->data.i = type == OP_DIV ? a / b : a % b;
+			break;
+		case OP_MAX:
+			ret->data.i = a > b ? a : b;
+			break;
+		default:
+			ret->data.i = a < b ? a : b;
+			break;
+	}
+	ret->type = VT_INTEGER;
+	ret->value = NULL;
+	return 1;
+}
+
+/**
+ * Applies an arithmetic operation to a pair of decimals.  This is the same as
+ * applyArithOp() for decimals, without checking their types.
+ *
+ * \param [in] type The arithmetic operation to apply.
+ *
+ * \param [in] a The first operand.
+ *
+ * \param [in] b The second operand.
+ *
+ * \param [out] ret The value of the arithmetic operation.
+ *
+ * \retval 0 Division by zero was attempted.
+ *
+ * \retval 1 \a ret was set.
+ */
+static int applyFloatArithOp(OpType type,
+                             float a,
+                             float b,
+                             ImmediateValue *ret)
+{
+	switch (type) {
+		case OP_ADD:
+			ret->data.f = a + b;
+			break;
+		case OP_SUB:
+			ret->data.f = a - b;
+			break;
+		case OP_MULT:
+			ret->data.f = a * b;
+			break;
+		case OP_DIV:
+		case OP_MOD:
+			if (fabs(b - 0.0) < FLT_EPSILON) {
+				error(IN_DIVISION_BY_ZERO);
+				return 0;
 			}
-			cast2 = 1;
+			ret->data.f = type == OP_DIV ? a / b : (float)fmod(a, b);
+			break;
+		case OP_MAX:
+			ret->data.f = a > b ? a : b;
 			break;
-		}
 		default:
-			error(IN_INVALID_OPERAND_TYPE);
+			ret->data.f = a < b ? a : b;
+			break;
 	}
-	/* Do math depending on value types */
-	ret = ArithOpJumpTable[expr->type][use1->type][use2->type](use1, use2);
-	/* Clean up after floating point decimal casts */
-	if (cast1) deleteValueObject(use1);
-	if (cast2) deleteValueObject(use2);
-	deleteValueObject(val1);
-	deleteValueObject(val2);
-	return ret;
+	ret->type = VT_FLOAT;
+	ret->value = NULL;
+	return 1;
+}
+
+/**
+ * Interprets an arithmetic operation.
+ *
+ * \param [in] expr The operation to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \param [out] ret The value of the arithmetic operation.
+ *
+ * \note Only supports binary arithmetic operations.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
+ */
+int interpretArithOpExprNode(OpExprNode *expr,
+                             ScopeObject *scope,
+                             ImmediateValue *ret)
+{
+	ImmediateValue val1;
+	ImmediateValue val2;
+	int status;
+	if (!interpretUnboxedExprNode(expr->args->exprs[0], scope, &val1))
+		return 0;
+	if (!interpretUnboxedExprNode(expr->args->exprs[1], scope, &val2)) {
+		releaseImmediateValue(&val1);
+		return 0;
+	}
+	/* Numbers of the types the operation is specialized for are not boxed */
+	switch (quickenOpExprNode(expr, &val1, &val2)) {
+		case OQ_INTEGER:
+			return applyIntegerArithOp(expr->type, val1.data.i, val2.data.i, ret);
+		case OQ_FLOAT:
+			return applyFloatArithOp(expr->type, val1.data.f, val2.data.f, ret);
+		default:
+			break;
+	}
+	status = applyArithOp(expr->type, &val1, &val2, ret);
+	releaseImmediateValue(&val1);
+	releaseImmediateValue(&val2);
+	return status;
 }
 
 /**
@@ -2445,12 +3489,15 @@ ValueObject *interpretArithOpExprNode(OpExprNode *expr,
  *
  * \param [in] scope The scope to evaluate \a expr under.
  *
- * \return A pointer to the value of the boolean operation.
+ * \param [out] ret The value of the boolean operation.
  *
- * \retval NULL An error occurred during interpretation.
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
  */
-ValueObject *interpretBoolOpExprNode(OpExprNode *expr,
-                                     ScopeObject *scope)
+int interpretBoolOpExprNode(OpExprNode *expr,
+                            ScopeObject *scope,
+                            ImmediateValue *ret)
 {
 	unsigned int n;
 	int acc = 0;
@@ -2459,22 +3506,15 @@ ValueObject *interpretBoolOpExprNode(OpExprNode *expr,
 	 * remaining arguments.
 	 */
 	for (n = 0; n < expr->args->num; n++) {
-		ValueObject *val = interpretExprNode(expr->args->exprs[n], scope);
-		ValueObject *use = val;
+		ImmediateValue val;
 		int temp;
-		unsigned int cast = 0;
-		if (!val) return NULL;
-		if (val->type != VT_BOOLEAN && val->type != VT_INTEGER) {
-			use = castBooleanImplicit(val, scope);
-			if (!use) {
-				deleteValueObject(val);
-				return NULL;
-			}
-			cast = 1;
+		if (!interpretUnboxedExprNode(expr->args->exprs[n], scope, &val))
+			return 0;
+		if (!castBooleanImmediate(&val, &temp)) {
+			releaseImmediateValue(&val);
+			return 0;
 		}
-		temp = getInteger(use);
-		if (cast) deleteValueObject(use);
-		deleteValueObject(val);
+		releaseImmediateValue(&val);
 		if (n == 0) acc = temp;
 		else {
 			switch (expr->type) {
@@ -2489,7 +3529,7 @@ ValueObject *interpretBoolOpExprNode(OpExprNode *expr,
 					break;
 				default:
 					error(IN_INVALID_BOOLEAN_OPERATION_TYPE);
-					return NULL;
+					return 0;
 			}
 		}
 		/**
@@ -2499,7 +3539,8 @@ ValueObject *interpretBoolOpExprNode(OpExprNode *expr,
 		if (expr->type == OP_AND && acc == 0) break;
 		else if (expr->type == OP_OR && acc == 1) break;
 	}
-	return createBooleanValueObject(acc);
+	*ret = createBooleanImmediateValue(acc);
+	return 1;
 }
 
 /**
@@ -2509,12 +3550,12 @@ ValueObject *interpretBoolOpExprNode(OpExprNode *expr,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqIntegerInteger(ValueObject *a,
-                                ValueObject *b)
+ImmediateValue opEqIntegerInteger(ImmediateValue *a,
+                                  ImmediateValue *b)
 {
-	return createBooleanValueObject(getInteger(a) == getInteger(b));
+	return createBooleanImmediateValue(getInteger(a) == getInteger(b));
 }
 
 /**
@@ -2524,12 +3565,12 @@ ValueObject *opEqIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqIntegerInteger(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opNeqIntegerInteger(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createBooleanValueObject(getInteger(a) != getInteger(b));
+	return createBooleanImmediateValue(getInteger(a) != getInteger(b));
 }
 
 /**
@@ -2539,12 +3580,12 @@ ValueObject *opNeqIntegerInteger(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqIntegerFloat(ValueObject *a,
-                              ValueObject *b)
+ImmediateValue opEqIntegerFloat(ImmediateValue *a,
+                                ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs((float)(getInteger(a)) - getFloat(b)) < FLT_EPSILON);
+	return createBooleanImmediateValue(fabs((float)(getInteger(a)) - getFloat(b)) < FLT_EPSILON);
 }
 
 /**
@@ -2554,12 +3595,12 @@ ValueObject *opEqIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqIntegerFloat(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opNeqIntegerFloat(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs((float)(getInteger(a)) - getFloat(b)) > FLT_EPSILON);
+	return createBooleanImmediateValue(fabs((float)(getInteger(a)) - getFloat(b)) > FLT_EPSILON);
 }
 
 /**
@@ -2569,12 +3610,12 @@ ValueObject *opNeqIntegerFloat(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqFloatInteger(ValueObject *a,
-                              ValueObject *b)
+ImmediateValue opEqFloatInteger(ImmediateValue *a,
+                                ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs(getFloat(a) - (float)(getInteger(b))) < FLT_EPSILON);
+	return createBooleanImmediateValue(fabs(getFloat(a) - (float)(getInteger(b))) < FLT_EPSILON);
 }
 
 /**
@@ -2584,12 +3625,12 @@ ValueObject *opEqFloatInteger(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqFloatInteger(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opNeqFloatInteger(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs(getFloat(a) - (float)(getInteger(b))) > FLT_EPSILON);
+	return createBooleanImmediateValue(fabs(getFloat(a) - (float)(getInteger(b))) > FLT_EPSILON);
 }
 
 /**
@@ -2599,12 +3640,12 @@ ValueObject *opNeqFloatInteger(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqFloatFloat(ValueObject *a,
-                            ValueObject *b)
+ImmediateValue opEqFloatFloat(ImmediateValue *a,
+                              ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs(getFloat(a) - getFloat(b)) < FLT_EPSILON);
+	return createBooleanImmediateValue(fabs(getFloat(a) - getFloat(b)) < FLT_EPSILON);
 }
 
 /**
@@ -2614,12 +3655,12 @@ ValueObject *opEqFloatFloat(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqFloatFloat(ValueObject *a,
-                             ValueObject *b)
+ImmediateValue opNeqFloatFloat(ImmediateValue *a,
+                               ImmediateValue *b)
 {
-	return createBooleanValueObject(fabs(getFloat(a) - getFloat(b)) > FLT_EPSILON);
+	return createBooleanImmediateValue(fabs(getFloat(a) - getFloat(b)) > FLT_EPSILON);
 }
 
 /**
@@ -2629,12 +3670,12 @@ ValueObject *opNeqFloatFloat(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqBooleanBoolean(ValueObject *a,
-                                ValueObject *b)
+ImmediateValue opEqBooleanBoolean(ImmediateValue *a,
+                                  ImmediateValue *b)
 {
-	return createBooleanValueObject(getInteger(a) == getInteger(b));
+	return createBooleanImmediateValue(getInteger(a) == getInteger(b));
 }
 
 /**
@@ -2644,12 +3685,12 @@ ValueObject *opEqBooleanBoolean(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqBooleanBoolean(ValueObject *a,
-                                 ValueObject *b)
+ImmediateValue opNeqBooleanBoolean(ImmediateValue *a,
+                                   ImmediateValue *b)
 {
-	return createBooleanValueObject(getInteger(a) != getInteger(b));
+	return createBooleanImmediateValue(getInteger(a) != getInteger(b));
 }
 
 /**
@@ -2659,12 +3700,14 @@ ValueObject *opNeqBooleanBoolean(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is equal to \a b.
+ * \return A boolean value indicating if \a is equal to \a b.
  */
-ValueObject *opEqStringString(ValueObject *a,
-                              ValueObject *b)
+ImmediateValue opEqStringString(ImmediateValue *a,
+                                ImmediateValue *b)
 {
-	return createBooleanValueObject(strcmp(getString(a), getString(b)) == 0);
+	return createBooleanImmediateValue(getString(a) == getString(b)
+			|| (getStringLength(a) == getStringLength(b)
+			&& !memcmp(getString(a), getString(b), getStringLength(a))));
 }
 
 /**
@@ -2674,12 +3717,14 @@ ValueObject *opEqStringString(ValueObject *a,
  *
  * \param [in] b The second value to check.
  *
- * \return A pointer to a boolean value indicating if \a is not equal to \a b.
+ * \return A boolean value indicating if \a is not equal to \a b.
  */
-ValueObject *opNeqStringString(ValueObject *a,
-                               ValueObject *b)
+ImmediateValue opNeqStringString(ImmediateValue *a,
+                                 ImmediateValue *b)
 {
-	return createBooleanValueObject(strcmp(getString(a), getString(b)) != 0);
+	return createBooleanImmediateValue(getString(a) != getString(b)
+			&& (getStringLength(a) != getStringLength(b)
+			|| memcmp(getString(a), getString(b), getStringLength(a))));
 }
 
 /**
@@ -2691,12 +3736,12 @@ ValueObject *opNeqStringString(ValueObject *a,
  *
  * \return A true boolean value.
  */
-ValueObject *opEqNilNil(ValueObject *a,
-                        ValueObject *b)
+ImmediateValue opEqNilNil(ImmediateValue *a,
+                          ImmediateValue *b)
 {
 	a = NULL;
 	b = NULL;
-	return createBooleanValueObject(1);
+	return createBooleanImmediateValue(1);
 }
 
 /**
@@ -2708,12 +3753,12 @@ ValueObject *opEqNilNil(ValueObject *a,
  *
  * \return A false boolean value.
  */
-ValueObject *opNeqNilNil(ValueObject *a,
-                         ValueObject *b)
+ImmediateValue opNeqNilNil(ImmediateValue *a,
+                           ImmediateValue *b)
 {
 	a = NULL;
 	b = NULL;
-	return createBooleanValueObject(0);
+	return createBooleanImmediateValue(0);
 }
 
 /*
@@ -2722,7 +3767,7 @@ ValueObject *opNeqNilNil(ValueObject *a,
  * of the first argument, and the third index determines the type of the second
  * object.
  */
-static ValueObject *(*BoolOpJumpTable[2][5][5])(ValueObject *, ValueObject *) = {
+static ImmediateValue (*BoolOpJumpTable[2][5][5])(ImmediateValue *, ImmediateValue *) = {
 	{ /* OP_EQ */
 	              /* Integer, Float, Boolean, String, Nil */
 	/* Integer */ { opEqIntegerInteger, opEqIntegerFloat, NULL, NULL, NULL },
@@ -2742,27 +3787,27 @@ static ValueObject *(*BoolOpJumpTable[2][5][5])(ValueObject *, ValueObject *) =
 };
 
 /**
- * Interprets an equality operation.
+ * Applies an equality operation to a pair of values.
  *
- * \param [in] expr The operation to interpret.
+ * \param [in] type The equality operation to apply.
  *
- * \param [in] scope The scope to evaluate \a expr under.
+ * \param [in] val1 The first operand.
  *
- * \return A pointer to the resulting value of the equality operation.
+ * \param [in] val2 The second operand.
  *
- * \retval NULL An error occurred during interpretation.
+ * \param [out] ret The value of the equality operation.
+ *
+ * \note \a val1 and \a val2 are not released by this function.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
  */
-ValueObject *interpretEqualityOpExprNode(OpExprNode *expr,
-                                         ScopeObject *scope)
+int applyEqualityOp(OpType type,
+                    ImmediateValue *val1,
+                    ImmediateValue *val2,
+                    ImmediateValue *ret)
 {
-	ValueObject *val1 = interpretExprNode(expr->args->exprs[0], scope);
-	ValueObject *val2 = interpretExprNode(expr->args->exprs[1], scope);
-	ValueObject *ret = NULL;
-	if (!val1 || !val2) {
-		deleteValueObject(val1);
-		deleteValueObject(val2);
-		return NULL;
-	}
 	/*
 	 * Since there is no automatic casting, an equality (inequality) test
 	 * against a non-number type will always fail (succeed).
@@ -2770,98 +3815,227 @@ ValueObject *interpretEqualityOpExprNode(OpExprNode *expr,
 	if ((val1->type != val2->type)
 			&& ((val1->type != VT_INTEGER && val1->type != VT_FLOAT)
 			|| (val2->type != VT_INTEGER && val2->type != VT_FLOAT))) {
-		switch (expr->type) {
+		switch (type) {
 			case OP_EQ:
-				ret = createBooleanValueObject(0);
-				break;
+				*ret = createBooleanImmediateValue(0);
+				return 1;
 			case OP_NEQ:
-				ret = createBooleanValueObject(1);
-				break;
+				*ret = createBooleanImmediateValue(1);
+				return 1;
 			default:
 				error(IN_INVALID_EQUALITY_OPERATION_TYPE);
-				deleteValueObject(val1);
-				deleteValueObject(val2);
-				return NULL;
+				return 0;
 		}
 	}
-	else
-		ret = BoolOpJumpTable[expr->type - OP_EQ][val1->type][val2->type](val1, val2);
-	deleteValueObject(val1);
-	deleteValueObject(val2);
-	return ret;
+	*ret = BoolOpJumpTable[type - OP_EQ][val1->type][val2->type](val1, val2);
+	return 1;
 }
 
 /**
- * Interprets a concatenation operation.
+ * Interprets an equality operation.
  *
  * \param [in] expr The operation to interpret.
  *
  * \param [in] scope The scope to evaluate \a expr under.
  *
- * \return A pointer to the resulting value of the concatenation operation.
+ * \param [out] ret The value of the equality operation.
  *
- * \retval NULL An error occurred during interpretation.
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
  */
-ValueObject *interpretConcatOpExprNode(OpExprNode *expr,
-                                       ScopeObject *scope)
+int interpretEqualityOpExprNode(OpExprNode *expr,
+                                ScopeObject *scope,
+                                ImmediateValue *ret)
 {
-	unsigned int n;
-	/* Start out with the first string to concatenate. */
-	ValueObject *val = interpretExprNode(expr->args->exprs[0], scope);
-	ValueObject *use = castStringImplicit(val, scope);
+	ImmediateValue val1;
+	ImmediateValue val2;
+	int status;
+	if (!interpretUnboxedExprNode(expr->args->exprs[0], scope, &val1))
+		return 0;
+	if (!interpretUnboxedExprNode(expr->args->exprs[1], scope, &val2)) {
+		releaseImmediateValue(&val1);
+		return 0;
+	}
+	/* Numbers of the types the operation is specialized for are not boxed */
+	switch (quickenOpExprNode(expr, &val1, &val2)) {
+		case OQ_INTEGER:
+			ret->type = VT_BOOLEAN;
+			ret->data.i = expr->type == OP_EQ
+					? val1.data.i == val2.data.i
+					: val1.data.i != val2.data.i;
+			ret->value = NULL;
+			return 1;
+		case OQ_FLOAT:
+			/* As in opEqFloatFloat() and opNeqFloatFloat() */
+			ret->type = VT_BOOLEAN;
+			ret->data.i = expr->type == OP_EQ
+					? fabs(val1.data.f - val2.data.f) < FLT_EPSILON
+					: fabs(val1.data.f - val2.data.f) > FLT_EPSILON;
+			ret->value = NULL;
+			return 1;
+		default:
+			break;
+	}
+	status = applyEqualityOp(expr->type, &val1, &val2, ret);
+	releaseImmediateValue(&val1);
+	releaseImmediateValue(&val2);
+	return status;
+}
+
+/**
+ * Concatenates strings.  The length of the result is summed up front so that
+ * it is built with a single allocation.  If the first string is the value
+ * stored at \a dest and no other references to it exist, the remaining strings
+ * are appended to it in place instead.  Since strings grow geometrically (see
+ * resizeString()), accumulating a string in a variable costs only the length
+ * of what is appended.
+ *
+ * \param [in,out] parts The unboxed strings to concatenate.
+ *
+ * \param [in] num The number of strings in \a parts.
+ *
+ * \param [in] dest The optional location the result will be stored to.
+ *
+ * \param [out] ret The concatenated string.
+ *
+ * \pre Every value in \a parts is a string.
+ *
+ * \post The values in \a parts will be released.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 \a ret was set.
+ */
+int applyConcatOp(ImmediateValue *parts,
+                  unsigned int num,
+                  ValueObject **dest,
+                  ImmediateValue *ret)
+{
+	ValueObject *val = NULL;
 	char *acc = NULL;
-	void *mem = NULL;
-	if (!val || !use) {
-		deleteValueObject(val);
-		deleteValueObject(use);
-		return NULL;
+	size_t len = 0;
+	size_t pos = 0;
+	unsigned int first = 0;
+	unsigned int n;
+	for (n = 0; n < num; n++)
+		len += getStringLength((parts + n));
+	if (dest && *dest && *dest == parts[0].value
+			&& parts[0].value->semaphore == 2) {
+		/* Only the destination and the first part refer to the string */
+		pos = getStringLength(parts);
+		acc = resizeString(getString(parts), len);
+		if (!acc) goto applyConcatOpAbort;
+		val = parts[0].value;
+		val->data.s = acc;
+		parts[0].value = NULL;
+		first = 1;
 	}
-	/* Start out an accumulator with the first string. */
-	mem = realloc(acc, sizeof(char) * (strlen(getString(use)) + 1));
-	if (!mem) {
-		perror("realloc");
-		deleteValueObject(val);
-		deleteValueObject(use);
-		free(acc);
-		return NULL;
+	else {
+		acc = createString(NULL, len);
+		if (!acc) goto applyConcatOpAbort;
 	}
-	acc = mem;
-	acc[0] = '\0';
-	strcat(acc, getString(use));
-	deleteValueObject(val);
-	deleteValueObject(use);
-	for (n = 1; n < expr->args->num; n++) {
-		/* Grab the next string to concatenate. */
-		val = interpretExprNode(expr->args->exprs[n], scope);
-		use = castStringImplicit(val, scope);
-		if (!val || !use) {
-			deleteValueObject(val);
-			deleteValueObject(use);
-			free(acc);
-			return NULL;
+	for (n = first; n < num; n++) {
+		size_t size = getStringLength((parts + n));
+		memcpy(acc + pos, getString((parts + n)), size);
+		pos += size;
+	}
+	for (n = 0; n < num; n++)
+		releaseImmediateValue(parts + n);
+	if (!val) {
+		val = createStringValueObject(acc);
+		if (!val) {
+			deleteString(acc);
+			return 0;
 		}
-		/* Add the next string to the accumulator. */
-		mem = realloc(acc, sizeof(char) * (strlen(acc) + strlen(getString(use)) + 1));
-		if (!mem) {
-			perror("realloc");
-			deleteValueObject(val);
-			deleteValueObject(use);
-			free(acc);
-			return NULL;
+	}
+	*ret = unboxValueObject(val);
+	return 1;
+
+applyConcatOpAbort: /* In case something goes wrong... */
+
+	/* Clean up any allocated structures */
+	for (n = 0; n < num; n++)
+		releaseImmediateValue(parts + n);
+
+	return 0;
+}
+
+/**
+ * Interprets a concatenation operation whose result will be stored to a given
+ * location, which allows the first string to be appended to in place (see
+ * applyConcatOp()).
+ *
+ * \param [in] expr The operation to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \param [in] dest The optional location the result will be stored to.
+ *
+ * \param [out] ret The resulting value of the concatenation operation.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
+ */
+int appendConcatOpExprNode(OpExprNode *expr,
+                           ScopeObject *scope,
+                           ValueObject **dest,
+                           ImmediateValue *ret)
+{
+	ImmediateValue buf[CONCAT_STACK_PARTS];
+	ImmediateValue *parts = buf;
+	unsigned int num = expr->args->num;
+	unsigned int n;
+	int status = 0;
+	if (num > CONCAT_STACK_PARTS) {
+		parts = malloc(sizeof(ImmediateValue) * num);
+		if (!parts) {
+			perror("malloc");
+			return 0;
 		}
-		acc = mem;
-		strcat(acc, getString(use));
-		deleteValueObject(val);
-		deleteValueObject(use);
 	}
-	return createStringValueObject(acc);
+	for (n = 0; n < num; n++) {
+		if (!interpretUnboxedExprNode(expr->args->exprs[n], scope, parts + n))
+			break;
+		if (!castStringImmediate(parts + n))
+			break;
+	}
+	if (n == num)
+		status = applyConcatOp(parts, num, dest, ret);
+	else {
+		while (n > 0)
+			releaseImmediateValue(parts + --n);
+	}
+	if (parts != buf) free(parts);
+	return status;
+}
+
+/**
+ * Interprets a concatenation operation.
+ *
+ * \param [in] expr The operation to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \param [out] ret The resulting value of the concatenation operation.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
+ */
+int interpretConcatOpExprNode(OpExprNode *expr,
+                              ScopeObject *scope,
+                              ImmediateValue *ret)
+{
+	return appendConcatOpExprNode(expr, scope, NULL, ret);
 }
 
 /*
  * A jump table for operations.  The index of a function in the table is given
  * by its its index in the enumerated OpType type.
  */
-static ValueObject *(*OpExprJumpTable[14])(OpExprNode *, ScopeObject *) = {
+static int (*OpExprJumpTable[14])(OpExprNode *, ScopeObject *, ImmediateValue *) = {
 	interpretArithOpExprNode,
 	interpretArithOpExprNode,
 	interpretArithOpExprNode,
@@ -2892,14 +4066,20 @@ ValueObject *interpretOpExprNode(ExprNode *node,
                                  ScopeObject *scope)
 {
 	OpExprNode *expr = (OpExprNode *)node->expr;
-	return OpExprJumpTable[expr->type](expr, scope);
+	ImmediateValue val;
+	ValueObject *ret = NULL;
+	if (!OpExprJumpTable[expr->type](expr, scope, &val)) return NULL;
+	ret = boxImmediateValue(&val);
+	if (!ret) releaseImmediateValue(&val);
+	return ret;
 }
 
 /*
  * A jump table for expressions.  The index of a function in the table is given
- * by its its index in the enumerated ExprType type.
+ * by its its index in the enumerated ExprType type.  Each thread has its own,
+ * so that hookInterpreter() only affects the thread calling it.
  */
-static ValueObject *(*ExprJumpTable[6])(ExprNode *, ScopeObject *) = {
+static THREAD_LOCAL ValueObject *(*ExprJumpTable[6])(ExprNode *, ScopeObject *) = {
 	interpretCastExprNode,
 	interpretConstantExprNode,
 	interpretIdentifierExprNode,
@@ -2924,6 +4104,67 @@ ValueObject *interpretExprNode(ExprNode *node,
 	return ExprJumpTable[node->type](node, scope);
 }
 
+/**
+ * Interprets an expression without boxing its value.  Constants, identifiers,
+ * and operations on scalar values are evaluated without allocating any memory.
+ *
+ * \param [in] node The expression to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \param [out] ret The value of \a expr evaluated under \a scope.
+ *
+ * \retval 0 An error occurred during interpretation.
+ *
+ * \retval 1 \a ret was set.
+ */
+int interpretUnboxedExprNode(ExprNode *node,
+                             ScopeObject *scope,
+                             ImmediateValue *ret)
+{
+	ValueObject *val = NULL;
+	switch (node->type) {
+		case ET_CONSTANT: {
+			ConstantNode *expr = (ConstantNode *)node->expr;
+			switch (expr->type) {
+				case CT_NIL:
+					*ret = createNilImmediateValue();
+					return 1;
+				case CT_BOOLEAN:
+					*ret = createBooleanImmediateValue(expr->data.i);
+					return 1;
+				case CT_INTEGER:
+					*ret = createIntegerImmediateValue(expr->data.i);
+					return 1;
+				case CT_FLOAT:
+					*ret = createFloatImmediateValue(expr->data.f);
+					return 1;
+				default:
+					break;
+			}
+			break;
+		}
+		case ET_IDENTIFIER:
+			val = getScopeValue(scope, scope, node->expr);
+			if (!val) return 0;
+			*ret = copyImmediateValue(val);
+			return 1;
+		case ET_OP: {
+			OpExprNode *expr = (OpExprNode *)node->expr;
+			return OpExprJumpTable[expr->type](expr, scope, ret);
+		}
+		case ET_IMPVAR:
+			*ret = copyImmediateValue(scope->impvar);
+			return 1;
+		default:
+			break;
+	}
+	val = interpretExprNode(node, scope);
+	if (!val) return 0;
+	*ret = unboxValueObject(val);
+	return 1;
+}
+
 /**
  * Interprets a cast statement.
  *
@@ -2945,10 +4186,10 @@ ReturnObject *interpretCastStmtNode(StmtNode *node,
 	ValueObject *cast = NULL;
 	if (!val) {
 		IdentifierNode *id = (IdentifierNode *)(stmt->target);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			error(IN_VARIABLE_DOES_NOT_EXIST, id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
 		return NULL;
 	}
@@ -2957,23 +4198,23 @@ ReturnObject *interpretCastStmtNode(StmtNode *node,
 			if (!(cast = createNilValueObject())) return NULL;
 			break;
 		case CT_BOOLEAN:
-			if (!(cast = castBooleanExplicit(val, scope))) return NULL;
+			if (!(cast = castBooleanExplicit(val))) return NULL;
 			break;
 		case CT_INTEGER:
-			if (!(cast = castIntegerExplicit(val, scope))) return NULL;
+			if (!(cast = castIntegerExplicit(val))) return NULL;
 			break;
 		case CT_FLOAT:
-			if (!(cast = castFloatExplicit(val, scope))) return NULL;
+			if (!(cast = castFloatExplicit(val))) return NULL;
 			break;
 		case CT_STRING:
-			if (!(cast = castStringExplicit(val, scope))) return NULL;
+			if (!(cast = castStringExplicit(val))) return NULL;
 			break;
 		case CT_ARRAY: {
 			IdentifierNode *id = (IdentifierNode *)(stmt->target);
-			char *name = resolveIdentifierName(id, scope);
+			const char *name = resolveIdentifierName(id, scope);
 			if (name) {
 				error(IN_CANNOT_CAST_VALUE_TO_ARRAY, id->fname, id->line, name);
-				free(name);
+				releaseString(name);
 			}
 			return NULL;
 			break;
@@ -2983,7 +4224,7 @@ ReturnObject *interpretCastStmtNode(StmtNode *node,
 		deleteValueObject(cast);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3005,20 +4246,26 @@ ReturnObject *interpretPrintStmtNode(StmtNode *node,
 	PrintStmtNode *stmt = (PrintStmtNode *)node->stmt;
 	unsigned int n;
 	for (n = 0; n < stmt->args->num; n++) {
-		ValueObject *val = interpretExprNode(stmt->args->exprs[n], scope);
-		ValueObject *use = castStringImplicit(val, scope);
-		if (!val || !use) {
-			deleteValueObject(val);
-			deleteValueObject(use);
+		ExprNode *arg = stmt->args->exprs[n];
+		ImmediateValue val;
+		/* String constants are printed without creating a value */
+		if (arg->type == ET_CONSTANT) {
+			ConstantNode *expr = (ConstantNode *)arg->expr;
+			if (expr->type == CT_STRING && !expr->tmpl) {
+				writeOutput(expr->data.s, getInternLength(expr->data.s));
+				continue;
+			}
+		}
+		if (!interpretUnboxedExprNode(arg, scope, &val)) return NULL;
+		if (!printImmediateValue(&val)) {
+			releaseImmediateValue(&val);
 			return NULL;
 		}
-		printf("%s", getString(use));
-		deleteValueObject(val);
-		deleteValueObject(use);
+		releaseImmediateValue(&val);
 	}
 	if (!stmt->nonl)
-		printf("\n");
-	return createReturnObject(RT_DEFAULT, NULL);
+		writeOutput("\n", 1);
+	return &DefaultReturn;
 }
 
 /**
@@ -3037,45 +4284,31 @@ ReturnObject *interpretPrintStmtNode(StmtNode *node,
 ReturnObject *interpretInputStmtNode(StmtNode *node,
                                      ScopeObject *scope)
 {
-	unsigned int size = 16;
-	unsigned int cur = 0;
-	char *temp = malloc(sizeof(char) * size);
-	int c;
-	void *mem = NULL;
 	InputStmtNode *stmt = (InputStmtNode *)node->stmt;
 	ValueObject *val = NULL;
-	while ((c = getchar()) && !feof(stdin)) {
-		/**
-		 * \note The specification is unclear as to the exact semantics
-		 * of input.  Here, we read up until the first newline or EOF
-		 * but do not store it.
-		 */
-		if (c == EOF || c == (int)'\r' || c == (int)'\n') break;
-		if (cur > size - 1) {
-			/* Increasing buffer size. */
-			size *= 2;
-			mem = realloc(temp, sizeof(char) * size);
-			if (!mem) {
-				perror("realloc");
-				free(temp);
-				return NULL;
-			}
-			temp = mem;
-		}
-		temp[cur] = (char)c;
-		cur++;
-	}
-	temp[cur] = '\0';
-	val = createStringValueObject(temp);
+	const char *line = NULL;
+	char *str = NULL;
+	size_t len = 0;
+	/**
+	 * \note The specification is unclear as to the exact semantics of
+	 * input.  Here, we read up until the first newline or EOF but do not
+	 * store it.  Any null characters read are kept.
+	 */
+	line = readInputLine(&len);
+	if (!line) return NULL;
+	/* The line is still in the input buffer, so this is its only copy */
+	str = createString(line, len);
+	if (!str) return NULL;
+	val = createStringValueObject(str);
 	if (!val) {
-		free(temp);
+		deleteString(str);
 		return NULL;
 	}
 	if (!updateScopeValue(scope, scope, stmt->target, val)) {
 		deleteValueObject(val);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3095,13 +4328,24 @@ ReturnObject *interpretAssignmentStmtNode(StmtNode *node,
                                           ScopeObject *scope)
 {
 	AssignmentStmtNode *stmt = (AssignmentStmtNode *)node->stmt;
-	ValueObject *val = interpretExprNode(stmt->expr, scope);
-	if (!val) return NULL;
-	if (!updateScopeValue(scope, scope, stmt->target, val)) {
-		deleteValueObject(val);
+	ScopeObject *parent = NULL;
+	ImmediateValue val;
+	if (stmt->expr->type == ET_OP
+			&& ((OpExprNode *)stmt->expr->expr)->type == OP_CAT
+			&& !stmt->target->slot
+			&& (parent = getBoundScopeObject(scope, stmt->target))) {
+		/* Let the concatenation append to the target in place */
+		if (!appendConcatOpExprNode(stmt->expr->expr, scope,
+				parent->values + stmt->target->index, &val))
+			return NULL;
+	}
+	else if (!interpretUnboxedExprNode(stmt->expr, scope, &val))
+		return NULL;
+	if (!updateScopeImmediate(scope, scope, stmt->target, &val)) {
+		releaseImmediateValue(&val);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3127,10 +4371,10 @@ ReturnObject *interpretDeclarationStmtNode(StmtNode *node,
 	if (!dest) return NULL;
 	if (getScopeValueLocal(scope, dest, stmt->target)) {
 		IdentifierNode *id = (IdentifierNode *)(stmt->target);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			error(IN_REDEFINITION_OF_VARIABLE, id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
 		return NULL;
 	}
@@ -3150,9 +4394,13 @@ ReturnObject *interpretDeclarationStmtNode(StmtNode *node,
 			case CT_FLOAT:
 				init = createFloatValueObject(0.0);
 				break;
-			case CT_STRING:
-				init = createStringValueObject(copyString(""));
+			case CT_STRING: {
+				char *str = createString("", 0);
+				if (!str) return NULL;
+				init = createStringValueObject(str);
+				if (!init) deleteString(str);
 				break;
+			}
 			case CT_ARRAY:
 				init = createArrayValueObject(scope);
 				break;
@@ -3177,7 +4425,7 @@ ReturnObject *interpretDeclarationStmtNode(StmtNode *node,
 		deleteValueObject(init);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3197,39 +4445,29 @@ ReturnObject *interpretIfThenElseStmtNode(StmtNode *node,
                                           ScopeObject *scope)
 {
 	IfThenElseStmtNode *stmt = (IfThenElseStmtNode *)node->stmt;
-	ValueObject *use1 = scope->impvar;
+	ImmediateValue use1 = copyImmediateValue(scope->impvar);
 	int use1val;
-	unsigned int cast1 = 0;
 	BlockNode *path = NULL;
-	if (scope->impvar->type != VT_BOOLEAN && scope->impvar->type != VT_INTEGER) {
-		use1 = castBooleanImplicit(scope->impvar, scope);
-		if (!use1) return NULL;
-		cast1 = 1;
+	if (!castBooleanImmediate(&use1, &use1val)) {
+		releaseImmediateValue(&use1);
+		return NULL;
 	}
-	use1val = getInteger(use1);
-	if (cast1) deleteValueObject(use1);
+	releaseImmediateValue(&use1);
 	/* Determine which block of code to execute */
 	if (use1val)
 		path = stmt->yes;
 	else {
 		unsigned int n;
 		for (n = 0; n < stmt->guards->num; n++) {
-			ValueObject *val = interpretExprNode(stmt->guards->exprs[n], scope);
-			ValueObject *use2 = val;
+			ImmediateValue use2;
 			int use2val;
-			unsigned int cast2 = 0;
-			if (!val) return NULL;
-			if (val->type != VT_BOOLEAN && val->type != VT_INTEGER) {
-				use2 = castBooleanImplicit(val, scope);
-				if (!use2) {
-					deleteValueObject(val);
-					return NULL;
-				}
-				cast2 = 1;
+			if (!interpretUnboxedExprNode(stmt->guards->exprs[n], scope, &use2))
+				return NULL;
+			if (!castBooleanImmediate(&use2, &use2val)) {
+				releaseImmediateValue(&use2);
+				return NULL;
 			}
-			use2val = getInteger(use2);
-			deleteValueObject(val);
-			if (cast2) deleteValueObject(use2);
+			releaseImmediateValue(&use2);
 			if (use2val) {
 				path = stmt->blocks->blocks[n];
 				break;
@@ -3250,7 +4488,51 @@ ReturnObject *interpretIfThenElseStmtNode(StmtNode *node,
 		else
 			deleteReturnObject(r);
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
+}
+
+/**
+ * Finds the guard of a switch statement which matches a value.
+ *
+ * \param [in] stmt The switch statement to search.
+ *
+ * \param [in] val The value being switched on.
+ *
+ * \return The index of the guard of \a stmt matching \a val, or the number of
+ * guards of \a stmt if none of them match.
+ */
+unsigned int matchSwitchGuard(SwitchStmtNode *stmt,
+                              ValueObject *val)
+{
+	ConstantNode key;
+	int n;
+	if (!val) return stmt->guards->num;
+	switch (val->type) {
+		case VT_BOOLEAN:
+			key.type = CT_BOOLEAN;
+			key.data.i = getInteger(val);
+			break;
+		case VT_INTEGER:
+			key.type = CT_INTEGER;
+			key.data.i = getInteger(val);
+			break;
+		case VT_FLOAT:
+			key.type = CT_FLOAT;
+			key.data.f = getFloat(val);
+			break;
+		case VT_STRING:
+			/* String guards are interned, so other strings never match */
+			key.type = CT_STRING;
+			key.data.s = (char *)findInternedString(getString(val), getStringLength(val));
+			if (!key.data.s) return stmt->guards->num;
+			break;
+		default:
+			/* Guards are never nil, functions, or arrays */
+			return stmt->guards->num;
+	}
+	key.tmpl = NULL;
+	n = findSwitchGuard(stmt, &key);
+	return n < 0 ? stmt->guards->num : (unsigned int)n;
 }
 
 /**
@@ -3277,45 +4559,8 @@ ReturnObject *interpretSwitchStmtNode(StmtNode *node,
 {
 	SwitchStmtNode *stmt = (SwitchStmtNode *)node->stmt;
 	unsigned int n;
-	/*
-	 * Loop over each of the guards, checking if any match the implicit
-	 * variable.
-	 */
-	for (n = 0; n < stmt->guards->num; n++) {
-		ValueObject *use1 = scope->impvar;
-		ValueObject *use2 = interpretExprNode(stmt->guards->exprs[n], scope);
-		unsigned int done = 0;
-		if (!use2) return NULL;
-		if (use1->type == use2->type) {
-			switch (use1->type) {
-				case VT_NIL:
-					break;
-				case VT_BOOLEAN:
-				case VT_INTEGER:
-					if (getInteger(use1) == getInteger(use2))
-						done = 1;
-					break;
-				case VT_FLOAT:
-					if (fabs(getFloat(use1) - getFloat(use2)) < FLT_EPSILON)
-						done = 1;
-					break;
-				case VT_STRING:
-					/**
-					 * \note Strings with interpolation
-					 * should have already been checked for.
-					 */
-					if (!strcmp(getString(use1), getString(use2)))
-						done = 1;
-					break;
-				default:
-					error(IN_INVALID_TYPE);
-					deleteValueObject(use2);
-					return NULL;
-			}
-		}
-		deleteValueObject(use2);
-		if (done) break;
-	}
+	/* Find the guard matching the implicit variable */
+	n = matchSwitchGuard(stmt, scope->impvar);
 	/* If none of the guards match and a default block exists */
 	if (n == stmt->blocks->num && stmt->def) {
 		ReturnObject *r = interpretBlockNode(stmt->def, scope);
@@ -3345,7 +4590,7 @@ ReturnObject *interpretSwitchStmtNode(StmtNode *node,
 				deleteReturnObject(r);
 		}
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3371,7 +4616,7 @@ ReturnObject *interpretBreakStmtNode(StmtNode *node,
 {
 	node = NULL;
 	scope = NULL;
-	return createReturnObject(RT_BREAK, NULL);
+	return &BreakReturn;
 }
 
 /**
@@ -3430,26 +4675,30 @@ ReturnObject *interpretLoopStmtNode(StmtNode *node,
 	}
 	while (1) {
 		if (stmt->guard) {
-			ValueObject *val = interpretExprNode(stmt->guard, outer);
-			ValueObject *use = val;
-			unsigned short cast = 0;
+			ImmediateValue val;
 			int guardval;
-			if (val->type != VT_BOOLEAN && val->type != VT_INTEGER) {
-				use = castBooleanImplicit(val, scope);
-				if (!use) {
-					deleteScopeObject(outer);
-					deleteValueObject(val);
-					return NULL;
-				}
-				cast = 1;
+			if (!interpretUnboxedExprNode(stmt->guard, outer, &val)) {
+				deleteScopeObject(outer);
+				return NULL;
 			}
-			guardval = getInteger(use);
-			if (cast) deleteValueObject(use);
-			deleteValueObject(val);
+			if (!castBooleanImmediate(&val, &guardval)) {
+				deleteScopeObject(outer);
+				releaseImmediateValue(&val);
+				return NULL;
+			}
+			releaseImmediateValue(&val);
 			if (guardval == 0) break;
 		}
 		if (stmt->body) {
-			ReturnObject *result = interpretBlockNode(stmt->body, outer);
+			/* Each iteration reuses the body scope of the last one */
+			ScopeObject *inner = reuseScopeObject(outer);
+			ReturnObject *result = NULL;
+			if (!inner) {
+				deleteScopeObject(outer);
+				return NULL;
+			}
+			result = interpretStmtNodeList(stmt->body->stmts, inner);
+			releaseScopeObject(inner);
 			if (!result) {
 				deleteScopeObject(outer);
 				return NULL;
@@ -3473,8 +4722,20 @@ ReturnObject *interpretLoopStmtNode(StmtNode *node,
 			 * variable.
 			 */
 			if (stmt->update->type == ET_OP) {
-				var = getScopeValue(scope, outer, stmt->var);
 				OpExprNode *op = (OpExprNode *)stmt->update->expr;
+				/* The loop variable is the only value in the loop scope */
+				var = outer->values[0];
+				/* Leave any copies of the variable unchanged */
+				if (var->semaphore > 1 && var->type != VT_STRING
+						&& var->type != VT_ARRAY) {
+					ValueObject *copy = duplicateValueObject(var);
+					if (!copy) {
+						deleteScopeObject(outer);
+						return NULL;
+					}
+					deleteValueObject(var);
+					outer->values[0] = var = copy;
+				}
 				if (op->type == OP_ADD)
 					var->data.i++;
 				else if (op->type == OP_SUB)
@@ -3495,7 +4756,7 @@ ReturnObject *interpretLoopStmtNode(StmtNode *node,
 		}
 	}
 	deleteScopeObject(outer);
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3519,7 +4780,7 @@ ReturnObject *interpretDeallocationStmtNode(StmtNode *node,
 	/* If we want to completely remove the variable, use:
 	deleteScopeValue(scope, stmt->target);
 	*/
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3547,10 +4808,10 @@ ReturnObject *interpretFuncDefStmtNode(StmtNode *node,
 	if (!dest) return NULL;
 	if (getScopeValueLocal(scope, dest, stmt->name)) {
 		IdentifierNode *id = (IdentifierNode *)(stmt->name);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			error(IN_FUNCTION_NAME_USED_BY_VARIABLE, id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
 		return NULL;
 	}
@@ -3564,7 +4825,7 @@ ReturnObject *interpretFuncDefStmtNode(StmtNode *node,
 		deleteValueObject(init);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /**
@@ -3588,10 +4849,13 @@ ReturnObject *interpretExprStmtNode(StmtNode *node,
 {
 	/* Set the implicit variable to the result of the expression */
 	ExprNode *expr = (ExprNode *)node->stmt;
-	deleteValueObject(scope->impvar);
-	scope->impvar = interpretExprNode(expr, scope);
-	if (!scope->impvar) return NULL;
-	return createReturnObject(RT_DEFAULT, NULL);
+	ImmediateValue val;
+	if (!interpretUnboxedExprNode(expr, scope, &val)) return NULL;
+	if (!storeImmediateValue(&scope->impvar, &val)) {
+		releaseImmediateValue(&val);
+		return NULL;
+	}
+	return &DefaultReturn;
 }
 
 /**
@@ -3616,10 +4880,10 @@ ReturnObject *interpretAltArrayDefStmtNode(StmtNode *node,
 	ReturnObject *ret = NULL;
 	if (getScopeValueLocal(scope, dest, stmt->name)) {
 		IdentifierNode *id = (IdentifierNode *)(stmt->name);
-		char *name = resolveIdentifierName(id, scope);
+		const char *name = resolveIdentifierName(id, scope);
 		if (name) {
 			fprintf(stderr, "%s:%u: redefinition of existing variable at: %s\n", id->fname, id->line, name);
-			free(name);
+			releaseString(name);
 		}
 		return NULL;
 	}
@@ -3648,14 +4912,15 @@ ReturnObject *interpretAltArrayDefStmtNode(StmtNode *node,
 		deleteValueObject(init);
 		return NULL;
 	}
-	return createReturnObject(RT_DEFAULT, NULL);
+	return &DefaultReturn;
 }
 
 /*
  * A jump table for statements.  The index of a function in the table is given
- * by its its index in the enumerated StmtType type.
+ * by its its index in the enumerated StmtType type.  Each thread has its own,
+ * so that hookInterpreter() only affects the thread calling it.
  */
-static ReturnObject *(*StmtJumpTable[14])(StmtNode *, ScopeObject *) = {
+static THREAD_LOCAL ReturnObject *(*StmtJumpTable[14])(StmtNode *, ScopeObject *) = {
 	interpretCastStmtNode,
 	interpretPrintStmtNode,
 	interpretInputStmtNode,
@@ -3691,6 +4956,84 @@ ReturnObject *interpretStmtNode(StmtNode *node,
 	return StmtJumpTable[node->type](node, scope);
 }
 
+/*
+ * The jump table for statements, and the interpreter for function calls, as
+ * they were before hookInterpreter() replaced them.
+ */
+static THREAD_LOCAL StmtInterpreter StmtHandlers[14];
+static THREAD_LOCAL ExprInterpreter FuncCallHandler = NULL;
+
+/**
+ * Interprets a statement without going through the hook installed by
+ * hookInterpreter().
+ *
+ * \param [in] node The statement to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a node under.
+ *
+ * \pre hookInterpreter() has been called.
+ *
+ * \return A pointer to a return value set appropriately depending on the
+ * statement interpreted.
+ *
+ * \retval NULL An error occurred during interpretation.
+ */
+ReturnObject *interpretUnhookedStmtNode(StmtNode *node,
+                                        ScopeObject *scope)
+{
+	return StmtHandlers[node->type](node, scope);
+}
+
+/**
+ * Routes every statement and function call interpreted from now on through a
+ * hook.  The jump tables themselves are changed, rather than checked for a
+ * hook each time, so interpretation is no slower unless this is called.
+ *
+ * \param [in] stmt The function to interpret every statement with, which may
+ * call interpretUnhookedStmtNode().
+ *
+ * \param [in] call The function to interpret every function call with, which
+ * may call interpretFuncCallExprNode().
+ *
+ * \post Any hook installed before will have been replaced.
+ *
+ * \note Only the interpreter is hooked, and only on the calling thread;
+ * compiled code run by the virtual machine, and programs run by other threads,
+ * are not.
+ *
+ * \see unhookInterpreter()
+ */
+void hookInterpreter(StmtInterpreter stmt,
+                     ExprInterpreter call)
+{
+	unsigned int n;
+	if (StmtJumpTable[0] == stmt) return;
+	unhookInterpreter();
+	for (n = 0; n < sizeof(StmtJumpTable) / sizeof(StmtJumpTable[0]); n++) {
+		StmtHandlers[n] = StmtJumpTable[n];
+		StmtJumpTable[n] = stmt;
+	}
+	FuncCallHandler = ExprJumpTable[ET_FUNCCALL];
+	ExprJumpTable[ET_FUNCCALL] = call;
+}
+
+/**
+ * Restores the jump tables replaced by hookInterpreter() on the calling
+ * thread, so that statements and function calls are no longer routed through
+ * its hook.
+ *
+ * \note Does nothing if the interpreter is not hooked.
+ */
+void unhookInterpreter(void)
+{
+	unsigned int n;
+	if (!FuncCallHandler) return;
+	for (n = 0; n < sizeof(StmtJumpTable) / sizeof(StmtJumpTable[0]); n++)
+		StmtJumpTable[n] = StmtHandlers[n];
+	ExprJumpTable[ET_FUNCCALL] = FuncCallHandler;
+	FuncCallHandler = NULL;
+}
+
 /**
  * Interprets a list of statements.
  *
@@ -3710,17 +5053,10 @@ ReturnObject *interpretStmtNodeList(StmtNodeList *list,
 	unsigned int n;
 	for (n = 0; n < list->num; n++) {
 		ret = interpretStmtNode(list->stmts[n], scope);
-		if (!ret)
-			return NULL;
-		else if (ret->type == RT_BREAK || ret->type == RT_RETURN)
+		if (!ret || ret->type != RT_DEFAULT)
 			return ret;
-		else {
-			deleteReturnObject(ret);
-			ret = NULL;
-		}
 	}
-	if (!ret) ret = createReturnObject(RT_DEFAULT, NULL);
-	return ret;
+	return &DefaultReturn;
 }
 
 /**
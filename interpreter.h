@@ -11,15 +11,37 @@
  * \date   2010-2012
  */
 
+/**
+ * \page elements Array Elements
+ *
+ * Arrays are scopes, so each of their slots is a named value.  Programs which
+ * use an array as a list, though, name its slots with integers (as in \c
+ * arr'Z \c SRS \c i), and turning each integer into a name costs a string
+ * conversion and a hash lookup on every access.
+ *
+ * Instead, a slot named by a non-negative integer, either a NUMBR or a YARN
+ * holding the integer's decimal digits (with no sign or leading zeros), is an
+ * element of its scope.  Elements are kept in a vector indexed by the integer
+ * itself, so they are found without building a name.  The vector only grows
+ * to cover keys below \ref SCOPE_ELEMS_MIN plus twice the number of elements;
+ * a key past that is stored by name, like any other slot, and is counted so
+ * that lookups of integer keys only search names when such keys exist.
+ *
+ * Either way, the integer 5 and the YARN "5" name the same slot.
+ */
+
 #ifndef __INTERPRETER_H__
 #define __INTERPRETER_H__
 
 #include <stdio.h>
 #include <ctype.h>
 #include <math.h>
+#include <limits.h>
 
 #include "parser.h"
 #include "unicode.h"
+#include "pool.h"
+#include "output.h"
 
 /**
  * Retrieves a value's integer data.
@@ -36,6 +58,11 @@
  */
 #define getString(value) (value->data.s)
 
+/**
+ * Retrieves the length of a value's string data.
+ */
+#define getStringLength(value) (getStringHeader(getString(value))->len)
+
 /**
  * Retrieves a value's function data.
  */
@@ -59,13 +86,28 @@ typedef enum {
 	VT_ARRAY    /**< An array. */
 } ValueType;
 
+/**
+ * Stores the header of a string value's data.  The characters of the string,
+ * followed by a null character, follow the header.  Because the length is
+ * stored, the characters may include null characters.
+ */
+typedef struct {
+	size_t len; /**< The number of characters in the string. */
+	size_t cap; /**< The number of characters allocated for the string. */
+} StringHeader;
+
+/**
+ * Retrieves the header of a string created by createString().
+ */
+#define getStringHeader(str) ((StringHeader *)(str) - 1)
+
 /**
  * Stores value data.
  */
 typedef union {
 	long long int i;       /**< Integer data. */
 	float f;               /**< Decimal data. */
-	char *s;               /**< String data. */
+	char *s;               /**< String data (see StringHeader). */
 	FuncDefStmtNode *fn;   /**< Function data. */
 	struct scopeobject *a; /**< Array data. */
 } ValueData;
@@ -83,12 +125,36 @@ typedef union {
 /**
  * Stores a value.
  */
-typedef struct {
-	ValueType type;           /**< The type of value stored. */
-	ValueData data;           /**< The value data. */
-	unsigned short semaphore; /**< A semaphore for value usage. */
+typedef struct valueobject {
+	ValueType type;         /**< The type of value stored. */
+	ValueData data;         /**< The value data. */
+	unsigned int semaphore; /**< A semaphore for value usage. */
 } ValueObject;
 
+/**
+ * The semaphore an immortal value starts with.  Immortal values, such as the
+ * values of constants, are shared rather than copied, and their semaphore is
+ * so large that it never reaches 0, so they are never deleted.
+ */
+#define IMMORTAL_SEMAPHORE (UINT_MAX / 2)
+
+/**
+ * Checks if a value type is a scalar type (integer, decimal, boolean, or nil).
+ */
+#define isScalarType(type) ((type) <= VT_BOOLEAN || (type) == VT_NIL)
+
+/**
+ * Stores an unboxed value.  Unlike a ValueObject, an unboxed value is passed
+ * around by value.  Scalar types are stored directly and need no memory to be
+ * allocated; other types (strings, functions, and arrays) keep a reference to
+ * the ValueObject that holds them.
+ */
+typedef struct {
+	ValueType type;     /**< The type of value stored. */
+	ValueData data;     /**< The value data. */
+	ValueObject *value; /**< The referenced value, or NULL for scalar types. */
+} ImmediateValue;
+
 /**
  * Represents the return type.
  */
@@ -111,13 +177,74 @@ typedef struct {
  */
 typedef struct scopeobject {
 	struct scopeobject *parent; /**< The parent scope. */
+	struct scopeobject *root;   /**< The outermost scope \a parent descends from. */
 	struct scopeobject *caller; /**< The caller scope (if in a function). */
 	ValueObject *impvar;        /**< The \ref impvar "implicit variable". */
 	unsigned int numvals;       /**< The number of values in the scope. */
-	char **names;               /**< The names of the values. */
+	unsigned int maxvals;       /**< The number of values allocated. */
+	const char **names;         /**< The (interned or owned) names of the values. */
 	ValueObject **values;       /**< The values in the scope. */
+	unsigned int numslots;      /**< The number of slots in the index. */
+	unsigned int *slots;        /**< The index of values by name hash. */
+	unsigned int numelems;      /**< The number of elements in the scope. */
+	unsigned int maxelems;      /**< The number of elements allocated. */
+	unsigned int numsparse;     /**< The number of integer keys named. */
+	unsigned int numowned;      /**< The number of owned names. */
+	ValueObject **elems;        /**< The values with integer keys, or NULL. */
+	struct scopeobject *spare;  /**< A cleared child scope kept for reuse. */
+	int owner;                  /**< Whether it is the parent of an array. */
 } ScopeObject;
 
+/**
+ * Stores the key of a value in a scope.  Values whose keys are small,
+ * non-negative integers (as from \c SRS with a NUMBR) are \ref elements
+ * "elements", kept in a vector indexed by the integer rather than by name.
+ */
+typedef struct {
+	const char *name;   /**< The name, or NULL for an integer key. */
+	unsigned int index; /**< The integer key, if \a name is NULL. */
+} ScopeKey;
+
+/**
+ * The number of values a scope may hold before its values are indexed.
+ * Smaller scopes are searched linearly.
+ */
+#define SCOPE_INDEX_THRESHOLD 8
+
+/**
+ * The number of elements allocated when a scope's first element is added.  An
+ * integer key is also stored as an element, rather than by name, as long as it
+ * is less than this plus twice the number of elements, which keeps the element
+ * vector at least about half full.
+ */
+#define SCOPE_ELEMS_MIN 16
+
+/**
+ * The largest integer key which may be stored as an element.
+ */
+#define SCOPE_ELEMS_MAX 0x7fffffff
+
+/**
+ * The number of strings a concatenation may join before the list of strings
+ * is allocated rather than kept on the stack.
+ */
+#define CONCAT_STACK_PARTS 8
+
+/**
+ * The number of cleared function call frames kept for reuse by later calls.
+ */
+#define FRAME_STACK_MAX 64
+
+/**
+ * Represents a function which interprets a statement.
+ */
+typedef ReturnObject *(*StmtInterpreter)(StmtNode *, ScopeObject *);
+
+/**
+ * Represents a function which interprets an expression.
+ */
+typedef ValueObject *(*ExprInterpreter)(ExprNode *, ScopeObject *);
+
 /**
  * \name Utilities
  *
@@ -125,11 +252,17 @@ typedef struct scopeobject {
  */
 /**@{*/
 void printInterpreterError(const char *, IdentifierNode *, ScopeObject *);
-char *copyString(char *);
+char *createString(const char *, size_t);
+char *resizeString(char *, size_t);
+void deleteString(char *);
 unsigned int isDecString(const char *);
 unsigned int isHexString(const char *);
-char *resolveIdentifierName(IdentifierNode *, ScopeObject *);
+unsigned int isIndexString(const char *, size_t, unsigned int *);
+const char *resolveIdentifierName(IdentifierNode *, ScopeObject *);
 int resolveTerminalSlot(ScopeObject *, ScopeObject *, IdentifierNode *, ScopeObject **, IdentifierNode **);
+ScopeObject *getBoundScopeObject(ScopeObject *, IdentifierNode *);
+void printAllocationStats(FILE *);
+unsigned long getAllocationCount(void);
 /**@}*/
 
 /**
@@ -145,10 +278,29 @@ ValueObject *createFloatValueObject(float);
 ValueObject *createStringValueObject(char *);
 ValueObject *createFunctionValueObject(FuncDefStmtNode *);
 ValueObject *createArrayValueObject(ScopeObject *);
+ValueObject *createConstantValueObject(ConstantNode *, Arena *);
 ValueObject *copyValueObject(ValueObject *);
+ValueObject *duplicateValueObject(ValueObject *);
 void deleteValueObject(ValueObject *);
 /**@}*/
 
+/**
+ * \name Immediate value modifiers
+ *
+ * Functions for creating, converting, and releasing unboxed values.
+ */
+/**@{*/
+ImmediateValue createNilImmediateValue(void);
+ImmediateValue createBooleanImmediateValue(int);
+ImmediateValue createIntegerImmediateValue(long long int);
+ImmediateValue createFloatImmediateValue(float);
+ImmediateValue unboxValueObject(ValueObject *);
+ImmediateValue copyImmediateValue(ValueObject *);
+ValueObject *boxImmediateValue(ImmediateValue *);
+int storeImmediateValue(ValueObject **, ImmediateValue *);
+void releaseImmediateValue(ImmediateValue *);
+/**@}*/
+
 /**
  * \name Scope object modifiers
  *
@@ -158,13 +310,29 @@ void deleteValueObject(ValueObject *);
 ScopeObject *createScopeObject(ScopeObject *);
 ScopeObject *createScopeObjectCaller(ScopeObject *, ScopeObject *);
 void deleteScopeObject(ScopeObject *);
+int resetScopeObject(ScopeObject *);
+ScopeObject *reuseScopeObject(ScopeObject *);
+void releaseScopeObject(ScopeObject *);
+ScopeObject *createFrameScopeObject(ScopeObject *, ScopeObject *, IdentifierNodeList *);
+void releaseFrameScopeObject(ScopeObject *);
+void deleteFrameStack(void);
+void deleteAllocationPools(void);
+int indexScopeObject(ScopeObject *);
+int findScopeValue(ScopeObject *, const char *);
+int reserveScopeValues(ScopeObject *, unsigned int);
+int addScopeValue(ScopeObject *, const char *, ValueObject *);
+int resolveScopeKey(IdentifierNode *, ScopeObject *, ScopeKey *);
+ValueObject **findScopeKey(ScopeObject *, ScopeKey *);
+int addScopeKey(ScopeObject *, ScopeKey *, ValueObject *);
 ValueObject *createScopeValue(ScopeObject *, ScopeObject *, IdentifierNode *);
 ValueObject *updateScopeValue(ScopeObject *, ScopeObject *, IdentifierNode *, ValueObject *);
+int updateScopeImmediate(ScopeObject *, ScopeObject *, IdentifierNode *, ImmediateValue *);
 ValueObject *getScopeValue(ScopeObject *, ScopeObject *, IdentifierNode *);
 ValueObject *getScopeValueLocal(ScopeObject *, ScopeObject *, IdentifierNode *);
 ScopeObject *getScopeObject(ScopeObject *, ScopeObject *, IdentifierNode *);
 ScopeObject *getScopeObjectLocal(ScopeObject *, ScopeObject *, IdentifierNode *);
 void deleteScopeValue(ScopeObject *, ScopeObject *, IdentifierNode *);
+ValueObject *getFuncCallValue(ScopeObject *, FuncCallExprNode *, ScopeObject **);
 /**@}*/
 
 /**
@@ -183,14 +351,18 @@ void deleteReturnObject(ReturnObject *);
  * Functions for performing casts between different types of values.
  */
 /**@{*/
-ValueObject *castBooleanImplicit(ValueObject *, ScopeObject *);
-ValueObject *castIntegerImplicit(ValueObject *, ScopeObject *);
-ValueObject *castFloatImplicit(ValueObject *, ScopeObject *);
-ValueObject *castStringImplicit(ValueObject *, ScopeObject *);
-ValueObject *castBooleanExplicit(ValueObject *, ScopeObject *);
-ValueObject *castIntegerExplicit(ValueObject *, ScopeObject *);
-ValueObject *castFloatExplicit(ValueObject *, ScopeObject *);
-ValueObject *castStringExplicit(ValueObject *, ScopeObject *);
+ValueObject *castBooleanImplicit(ValueObject *);
+ValueObject *castIntegerImplicit(ValueObject *);
+ValueObject *castFloatImplicit(ValueObject *);
+ValueObject *castStringImplicit(ValueObject *);
+ValueObject *castBooleanExplicit(ValueObject *);
+ValueObject *castIntegerExplicit(ValueObject *);
+ValueObject *castFloatExplicit(ValueObject *);
+ValueObject *castStringExplicit(ValueObject *);
+ValueObject *castValueExplicit(ValueObject *, ConstantType);
+int castBooleanImmediate(ImmediateValue *, int *);
+int castStringImmediate(ImmediateValue *);
+int printImmediateValue(ImmediateValue *);
 /**@}*/
 
 /**
@@ -200,7 +372,11 @@ ValueObject *castStringExplicit(ValueObject *, ScopeObject *);
  */
 /**@{*/
 ValueObject *interpretExprNode(ExprNode *, ScopeObject *);
+int interpretUnboxedExprNode(ExprNode *, ScopeObject *, ImmediateValue *);
 ReturnObject *interpretStmtNode(StmtNode *, ScopeObject *);
+ReturnObject *interpretUnhookedStmtNode(StmtNode *, ScopeObject *);
+void hookInterpreter(StmtInterpreter, ExprInterpreter);
+void unhookInterpreter(void);
 ReturnObject *interpretStmtNodeList(StmtNodeList *, ScopeObject *);
 ReturnObject *interpretBlockNode(BlockNode *, ScopeObject *);
 int interpretMainNode(MainNode *);
@@ -217,6 +393,7 @@ ValueObject *interpretCastExprNode(ExprNode *, ScopeObject *);
 ValueObject *interpretFuncCallExprNode(ExprNode *, ScopeObject *);
 ValueObject *interpretIdentifierExprNode(ExprNode *, ScopeObject *);
 ValueObject *interpretConstantExprNode(ExprNode *, ScopeObject *);
+ValueObject *interpretStringTemplateNode(StringTemplateNode *, ScopeObject *);
 /**@}*/
 
 /**
@@ -225,11 +402,15 @@ ValueObject *interpretConstantExprNode(ExprNode *, ScopeObject *);
  * Functions for interpreting operation parse tree nodes.
  */
 /**@{*/
-ValueObject *interpretNotOpExprNode(OpExprNode *, ScopeObject *);
-ValueObject *interpretArithOpExprNode(OpExprNode *, ScopeObject *);
-ValueObject *interpretBoolOpExprNode(OpExprNode *, ScopeObject *);
-ValueObject *interpretEqualityOpExprNode(OpExprNode *, ScopeObject *);
-ValueObject *interpretConcatOpExprNode(OpExprNode *, ScopeObject *);
+int applyArithOp(OpType, ImmediateValue *, ImmediateValue *, ImmediateValue *);
+int applyEqualityOp(OpType, ImmediateValue *, ImmediateValue *, ImmediateValue *);
+int applyConcatOp(ImmediateValue *, unsigned int, ValueObject **, ImmediateValue *);
+int interpretNotOpExprNode(OpExprNode *, ScopeObject *, ImmediateValue *);
+int interpretArithOpExprNode(OpExprNode *, ScopeObject *, ImmediateValue *);
+int interpretBoolOpExprNode(OpExprNode *, ScopeObject *, ImmediateValue *);
+int interpretEqualityOpExprNode(OpExprNode *, ScopeObject *, ImmediateValue *);
+int appendConcatOpExprNode(OpExprNode *, ScopeObject *, ValueObject **, ImmediateValue *);
+int interpretConcatOpExprNode(OpExprNode *, ScopeObject *, ImmediateValue *);
 ValueObject *interpretOpExprNode(ExprNode *, ScopeObject *);
 /**@}*/
 
@@ -245,6 +426,7 @@ ReturnObject *interpretInputStmtNode(StmtNode *, ScopeObject *);
 ReturnObject *interpretAssignmentStmtNode(StmtNode *, ScopeObject *);
 ReturnObject *interpretDeclarationStmtNode(StmtNode *, ScopeObject *);
 ReturnObject *interpretIfThenElseStmtNode(StmtNode *, ScopeObject *);
+unsigned int matchSwitchGuard(SwitchStmtNode *, ValueObject *);
 ReturnObject *interpretSwitchStmtNode(StmtNode *, ScopeObject *);
 ReturnObject *interpretBreakStmtNode(StmtNode *, ScopeObject *);
 ReturnObject *interpretReturnStmtNode(StmtNode *, ScopeObject *);
@@ -261,13 +443,13 @@ ReturnObject *interpretAltArrayDefStmtNode(StmtNode *, ScopeObject *);
  * Functions for performing integer-integer operations on values.
  */
 /**@{*/
-ValueObject *opAddIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opSubIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opMultIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opDivIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opMaxIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opMinIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opModIntegerInteger(ValueObject *, ValueObject *);
+ImmediateValue opAddIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opSubIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMultIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opDivIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMaxIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMinIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opModIntegerInteger(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -276,13 +458,13 @@ ValueObject *opModIntegerInteger(ValueObject *, ValueObject *);
  * Functions for performing integer-float operations on values.
  */
 /**@{*/
-ValueObject *opAddIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opSubIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opMultIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opDivIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opMaxIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opMinIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opModIntegerFloat(ValueObject *, ValueObject *);
+ImmediateValue opAddIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opSubIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMultIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opDivIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMaxIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMinIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opModIntegerFloat(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -291,13 +473,13 @@ ValueObject *opModIntegerFloat(ValueObject *, ValueObject *);
  * Functions for performing float-integer operations on values.
  */
 /**@{*/
-ValueObject *opAddFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opSubFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opMultFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opDivFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opMaxFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opMinFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opModFloatInteger(ValueObject *, ValueObject *);
+ImmediateValue opAddFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opSubFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMultFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opDivFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMaxFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMinFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opModFloatInteger(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -306,13 +488,13 @@ ValueObject *opModFloatInteger(ValueObject *, ValueObject *);
  * Functions for performing float-float operations on values.
  */
 /**@{*/
-ValueObject *opAddFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opSubFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opMultFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opDivFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opMaxFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opMinFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opModFloatFloat(ValueObject *, ValueObject *);
+ImmediateValue opAddFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opSubFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMultFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opDivFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMaxFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opMinFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opModFloatFloat(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -321,8 +503,8 @@ ValueObject *opModFloatFloat(ValueObject *, ValueObject *);
  * Functions for performing boolean-boolean operations on values.
  */
 /**@{*/
-ValueObject *opEqBooleanBoolean(ValueObject *, ValueObject *);
-ValueObject *opNeqBooleanBoolean(ValueObject *, ValueObject *);
+ImmediateValue opEqBooleanBoolean(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqBooleanBoolean(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -331,8 +513,8 @@ ValueObject *opNeqBooleanBoolean(ValueObject *, ValueObject *);
  * Functions for performing integer-integer operations on values.
  */
 /**@{*/
-ValueObject *opEqIntegerInteger(ValueObject *, ValueObject *);
-ValueObject *opNeqIntegerInteger(ValueObject *, ValueObject *);
+ImmediateValue opEqIntegerInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqIntegerInteger(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -341,8 +523,8 @@ ValueObject *opNeqIntegerInteger(ValueObject *, ValueObject *);
  * Functions for performing integer-float operations on values.
  */
 /**@{*/
-ValueObject *opEqIntegerFloat(ValueObject *, ValueObject *);
-ValueObject *opNeqIntegerFloat(ValueObject *, ValueObject *);
+ImmediateValue opEqIntegerFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqIntegerFloat(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -351,8 +533,8 @@ ValueObject *opNeqIntegerFloat(ValueObject *, ValueObject *);
  * Functions for performing float-integer operations on values.
  */
 /**@{*/
-ValueObject *opEqFloatInteger(ValueObject *, ValueObject *);
-ValueObject *opNeqFloatInteger(ValueObject *, ValueObject *);
+ImmediateValue opEqFloatInteger(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqFloatInteger(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -361,8 +543,8 @@ ValueObject *opNeqFloatInteger(ValueObject *, ValueObject *);
  * Functions for performing float-float operations on values.
  */
 /**@{*/
-ValueObject *opEqFloatFloat(ValueObject *, ValueObject *);
-ValueObject *opNeqFloatFloat(ValueObject *, ValueObject *);
+ImmediateValue opEqFloatFloat(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqFloatFloat(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -371,8 +553,8 @@ ValueObject *opNeqFloatFloat(ValueObject *, ValueObject *);
  * Functions for performing string-string operations on values.
  */
 /**@{*/
-ValueObject *opEqStringString(ValueObject *, ValueObject *);
-ValueObject *opNeqStringString(ValueObject *, ValueObject *);
+ImmediateValue opEqStringString(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqStringString(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 /**
@@ -381,8 +563,8 @@ ValueObject *opNeqStringString(ValueObject *, ValueObject *);
  * Functions for performing nil-nil operations on values.
  */
 /**@{*/
-ValueObject *opEqNilNil(ValueObject *, ValueObject *);
-ValueObject *opNeqNilNil(ValueObject *, ValueObject *);
+ImmediateValue opEqNilNil(ImmediateValue *, ImmediateValue *);
+ImmediateValue opNeqNilNil(ImmediateValue *, ImmediateValue *);
 /**@}*/
 
 #endif /* __INTERPRETER_H__ */
@@ -0,0 +1,557 @@
+#include "jobs.h"
+
+/*
+ * Held while changing a JobQueue or checking whether its jobs are done.
+ */
+static Mutex JobMutex = MUTEX_INITIALIZER;
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * Signaled whenever a job finishes.
+ */
+static Condition JobDone = CONDITION_INITIALIZER;
+#endif
+
+/**
+ * Reads the standard input stream for readSourceBuffer(), starting with any
+ * input which programs have read ahead but not used.
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \param [in] user Unused.
+ *
+ * \return The number of bytes read, or zero at the end of the input.
+ */
+static size_t readStandardInput(char *data,
+                                size_t len,
+                                void *user)
+{
+	(void)user;
+	return readInputBlock(data, len);
+}
+
+/**
+ * Loads the source code of a file named on the command line.
+ *
+ * \param [in] name The name of the file, or "-" for the standard input stream.
+ *
+ * \return The source code of \a name.
+ *
+ * \retval NULL The file could not be opened, read, or closed.
+ */
+static SourceBuffer *loadSourceFile(const char *name)
+{
+	SourceBuffer *source = NULL;
+	FILE *file = NULL;
+	if (!strcmp(name, "-")) return readSourceBuffer(readStandardInput, NULL);
+	file = fopen(name, "r");
+	if (!file) {
+		error(MN_ERROR_OPENING_FILE, name);
+		return NULL;
+	}
+	source = createSourceBuffer(file);
+	if (fclose(file) != 0) {
+		error(MN_ERROR_CLOSING_FILE, name);
+		deleteSourceBuffer(source);
+		return NULL;
+	}
+	return source;
+}
+
+/**
+ * Loads a file named on the command line and readies it to run: its source
+ * code is parsed (or its compiled program loaded), optimized, and resolved.
+ * With \c --compile, the file is compiled instead.
+ *
+ * \param [in] name The name of the file, or "-" for the standard input stream.
+ *
+ * \param [in,out] source The source code of \a name, or NULL to load it.
+ *
+ * \param [in] options How to load \a name.
+ *
+ * \param [out] main The program, or NULL if \a name was compiled instead.
+ *
+ * \post \a source will have been deleted.
+ *
+ * \note A UTF-8 BOM at the start of \a name is written as output.
+ *
+ * \retval 0 \a name was loaded (or compiled).
+ *
+ * \retval 1 An error occurred (unless it ended lci first).
+ */
+static int loadFile(const char *name,
+                    SourceBuffer *source,
+                    const JobOptions *options,
+                    MainNode **main)
+{
+	TokenStream *tokens = NULL;
+	MainNode *node = NULL;
+	const char *fname = "stdin";
+	char *path = NULL;
+	char *buffer = NULL;
+	unsigned int length = 0;
+
+	*main = NULL;
+	if (!source) source = loadSourceFile(name);
+	if (!source) return 1;
+	if (strcmp(name, "-")) {
+		fname = name;
+		/* Only named files have compiled programs */
+		path = getCachePath(fname);
+	}
+	buffer = source->data;
+	length = (unsigned int)source->size;
+
+	/* Remove hash bang line if run as a standalone script */
+	if (buffer[0] == '#' && buffer[1] == '!') {
+		unsigned int n;
+		for (n = 0; buffer[n] != '\n' && buffer[n] != '\r'; n++)
+			buffer[n] = ' ';
+	}
+
+	/*
+	 * Remove UTF-8 BOM if present and add it to the output stream
+	 * (we assume here that if a BOM is present, the system will
+	 * also expect the output to include a BOM).
+	 */
+	if (buffer[0] == (char)0xef
+			|| buffer[1] == (char)0xbb
+			|| buffer[2] == (char)0xbf) {
+		buffer[0] = ' ';
+		buffer[1] = ' ';
+		buffer[2] = ' ';
+		writeOutput("\xef\xbb\xbf", 3);
+	}
+
+	/* Begin main pipeline */
+	/*
+	 * A compiled program which is up to date replaces the lexer,
+	 * tokenizer, and parser.
+	 */
+	if (path && !options->compile)
+		node = loadMainNode(path, fname, buffer, length);
+	if (!node) {
+		/*
+		 * The parser pulls tokens from the stream, which scans
+		 * and tokenizes the source only as far as it is needed,
+		 * so only the statement being parsed is held as tokens.
+		 */
+		if (!(tokens = createTokenStream(buffer, length, fname)))
+			goto loadFileAbort;
+		node = parseMainNode(tokens);
+		deleteTokenStream(tokens);
+		if (!node) goto loadFileAbort;
+	}
+	if (options->compile) {
+		int status = 0;
+		if (!path || !saveMainNode(node, path, buffer, length)) {
+			error(MN_ERROR_WRITING_CACHE, path ? path : fname);
+			status = 1;
+		}
+		deleteMainNode(node);
+		deleteSourceBuffer(source);
+		free(path);
+		return status;
+	}
+	deleteSourceBuffer(source);
+	source = NULL;
+	free(path);
+	path = NULL;
+	if (!optimizeMainNode(node, options->optimize)) goto loadFileAbort;
+	if (!resolveMainNode(node)) goto loadFileAbort;
+	*main = node;
+
+	return 0;
+
+loadFileAbort: /* In case something goes wrong... */
+
+	/* Clean up any allocated structures */
+	if (node) deleteMainNode(node);
+	if (source) deleteSourceBuffer(source);
+	free(path);
+
+	return 1;
+}
+
+/**
+ * Runs a file named on the command line (or, with \c --compile, compiles it).
+ *
+ * \param [in] name The name of the file, or "-" for the standard input stream.
+ *
+ * \param [in,out] source The source code of \a name, or NULL to load it.
+ *
+ * \param [in] options How to run \a name.
+ *
+ * \post \a source will have been deleted.
+ *
+ * \return 0 if \a name ran to completion, or else the exit status lci fails
+ * with (unless an error ended it first).
+ */
+int runFile(const char *name,
+            SourceBuffer *source,
+            const JobOptions *options)
+{
+	MainNode *node = NULL;
+	int status = loadFile(name, source, options, &node);
+	if (status || !node) return status;
+	status = options->execute(node) ? 1 : 0;
+	deleteMainNode(node);
+	return status;
+}
+
+/**
+ * Keeps the output of a job.
+ *
+ * \param [in] data The bytes to keep.
+ *
+ * \param [in] len The number of bytes in \a data.
+ *
+ * \param [in,out] user The Job writing \a data.
+ */
+static void keepJobOutput(const char *data,
+                          size_t len,
+                          void *user)
+{
+	Job *job = user;
+	if (job->len + len > job->size) {
+		size_t size = job->size ? job->size : OUTPUT_BUFFER_SIZE;
+		char *mem = NULL;
+		while (size < job->len + len) size *= 2;
+		mem = realloc(job->output, size);
+		if (!mem) {
+			perror("realloc");
+			return;
+		}
+		job->output = mem;
+		job->size = size;
+	}
+	memcpy(job->output + job->len, data, len);
+	job->len += len;
+}
+
+/**
+ * Keeps the first error of a job.
+ *
+ * \param [in] code The code lci would exit with.
+ *
+ * \param [in] message The error message.
+ *
+ * \param [in,out] data The Job reporting the error.
+ */
+static void keepJobError(int code,
+                         const char *message,
+                         void *data)
+{
+	Job *job = data;
+	size_t len = strlen(message);
+	if (job->status) return;
+	/* Make sure a failure is told apart from success */
+	job->status = code ? code : 1;
+	job->message = malloc(len + 1);
+	if (!job->message) {
+		perror("malloc");
+		return;
+	}
+	memcpy(job->message, message, len + 1);
+}
+
+/**
+ * Reads the input of a job, of which there is none.
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \param [in] user Unused.
+ *
+ * \return 0, for the end of the input.
+ */
+static size_t readJobInput(char *data,
+                           size_t len,
+                           void *user)
+{
+	(void)data;
+	(void)len;
+	(void)user;
+	return 0;
+}
+
+/**
+ * Starts keeping the output and errors of a job.
+ *
+ * \param [in,out] job The job to keep the output and errors of.
+ */
+static void beginJob(Job *job)
+{
+	setOutputWriter(keepJobOutput, job);
+	setErrorHandler(keepJobError, job);
+}
+
+/**
+ * Stops keeping the output and errors of a job.
+ *
+ * \param [in,out] job The job kept the output and errors of.
+ *
+ * \param [in] status The status the job ended with.
+ *
+ * \post Any buffered output will have been kept.
+ */
+static void endJob(Job *job,
+                   int status)
+{
+	setErrorHandler(NULL, NULL);
+	setOutputWriter(NULL, NULL);
+	if (status && !job->status) job->status = status;
+}
+
+/**
+ * Runs a job, keeping its output and errors.
+ *
+ * \param [in,out] job The job to run.
+ *
+ * \param [in] options How to run \a job.
+ *
+ * \post \a job will hold the output and exit status of its file.
+ */
+static void runJob(Job *job,
+                   const JobOptions *options)
+{
+	int status;
+	beginJob(job);
+	setInputReader(readJobInput, NULL);
+	status = runFile(job->name, job->source, options);
+	job->source = NULL;
+	setInputReader(NULL, NULL);
+	endJob(job, status);
+}
+
+/**
+ * Loads a job so that it may be run later, keeping its output and errors.
+ *
+ * \param [in,out] job The job to load.
+ *
+ * \param [in] options How to load \a job.
+ *
+ * \post \a job will hold the program of its file, unless loading it failed.
+ */
+static void loadJob(Job *job,
+                    const JobOptions *options)
+{
+	beginJob(job);
+	endJob(job, loadFile(job->name, job->source, options, &job->node));
+	job->source = NULL;
+}
+
+/**
+ * Runs jobs from a queue, or with a pipeline loads them, until none are left
+ * to start.
+ *
+ * \param [in,out] data The JobQueue to take jobs from.
+ *
+ * \return NULL.
+ */
+static void *workJobs(void *data)
+{
+	JobQueue *queue = data;
+	for (;;) {
+		Job *job = NULL;
+		lockMutex(&JobMutex);
+#ifdef HAVE_PTHREAD_H
+		/* Keep only so many programs loaded ahead of the one running */
+		while (queue->pipeline && !queue->stop
+				&& queue->next < queue->num
+				&& queue->next >= queue->ran + queue->ahead)
+			waitCondition(&JobDone, &JobMutex);
+#endif
+		if (!queue->stop && queue->next < queue->num)
+			job = queue->jobs + queue->next++;
+		unlockMutex(&JobMutex);
+		if (!job) break;
+		/*
+		 * Source code read ahead may have failed to load, and the
+		 * standard input stream is loaded when its job is run, after
+		 * the jobs before it have read from it.
+		 */
+		if (!job->status) {
+			if (!queue->pipeline)
+				runJob(job, queue->options);
+			else if (strcmp(job->name, "-"))
+				loadJob(job, queue->options);
+		}
+		lockMutex(&JobMutex);
+		job->done = 1;
+		/* Jobs after a failed one would never be written */
+		if (job->status) queue->stop = 1;
+#ifdef HAVE_PTHREAD_H
+		signalCondition(&JobDone);
+#endif
+		unlockMutex(&JobMutex);
+	}
+	return NULL;
+}
+
+#ifdef HAVE_PTHREAD_H
+/**
+ * Takes jobs from a queue on a thread of its own.
+ *
+ * \param [in,out] data The JobQueue to take jobs from.
+ *
+ * \post The memory kept by the thread will be freed.
+ *
+ * \return NULL.
+ */
+static void *runWorker(void *data)
+{
+	workJobs(data);
+	deleteAllocationPools();
+	deleteInternBinds();
+	return NULL;
+}
+#endif
+
+/**
+ * Runs a job loaded by a pipeline on this thread, with the standard streams.
+ *
+ * \param [in,out] job The job to run.
+ *
+ * \param [in] options How to run \a job.
+ *
+ * \post \a job will hold the exit status of its file.
+ */
+static void finishJob(Job *job,
+                      const JobOptions *options)
+{
+	int status = 0;
+	/* Keep any error until the output before it has been written */
+	setErrorHandler(keepJobError, job);
+	if (!strcmp(job->name, "-"))
+		status = runFile(job->name, NULL, options);
+	else if (job->node)
+		status = options->execute(job->node) ? 1 : 0;
+	setErrorHandler(NULL, NULL);
+	if (status && !job->status) job->status = status;
+	if (job->node) deleteMainNode(job->node);
+	job->node = NULL;
+}
+
+/**
+ * Runs files named on the command line as jobs taken from a queue by several
+ * threads at once (see \ref jobs).
+ *
+ * \param [in] names The names of the files, with "-" for the standard input
+ * stream.
+ *
+ * \param [in] num The number of files in \a names.
+ *
+ * \param [in] threads The number of threads to take jobs with.
+ *
+ * \param [in] pipeline Whether the threads only load the files, for this
+ * thread to run in order (as with \c --pipeline), or run them too (as with
+ * \c --jobs).
+ *
+ * \param [in] options How to run the files.
+ *
+ * \note If a file fails, this writes its output and error, starts no more
+ * files, and waits for those already started before returning.
+ *
+ * \return 0 if every file ran to completion, 1 if jobs could not be started,
+ * or else the exit status of the first file which failed.
+ */
+int runJobs(char **names,
+            unsigned int num,
+            unsigned int threads,
+            int pipeline,
+            const JobOptions *options)
+{
+	JobQueue queue;
+#ifdef HAVE_PTHREAD_H
+	Thread workers[JOBS_MAX];
+#endif
+	unsigned int started = 0;
+	unsigned int n;
+	int status = 0;
+
+	if (!num) return 0;
+	queue.jobs = calloc(num, sizeof(Job));
+	if (!queue.jobs) {
+		perror("calloc");
+		return 1;
+	}
+	if (threads > num) threads = num;
+	if (threads > JOBS_MAX) threads = JOBS_MAX;
+	queue.num = num;
+	queue.next = 0;
+	queue.ran = 0;
+	queue.ahead = threads * PIPELINE_AHEAD;
+	queue.stop = 0;
+	queue.pipeline = pipeline;
+	queue.options = options;
+	for (n = 0; n < num; n++) {
+		queue.jobs[n].name = names[n];
+		/* Read the standard input stream before it could be shared */
+		if (!pipeline && !strcmp(names[n], "-")) {
+			queue.jobs[n].source = readSourceBuffer(readStandardInput, NULL);
+			if (!queue.jobs[n].source) queue.jobs[n].status = 1;
+		}
+	}
+
+#ifdef HAVE_PTHREAD_H
+	for (started = 0; started < threads; started++) {
+		if (startThread(workers + started, runWorker, &queue)) {
+			perror("pthread_create");
+			break;
+		}
+	}
+#endif
+	/* Without threads, take every job before writing their output */
+	if (!started) workJobs(&queue);
+
+	for (n = 0; n < num && !status; n++) {
+		Job *job = queue.jobs + n;
+		lockMutex(&JobMutex);
+#ifdef HAVE_PTHREAD_H
+		while (!job->done) waitCondition(&JobDone, &JobMutex);
+#endif
+		unlockMutex(&JobMutex);
+		if (job->len) writeOutput(job->output, job->len);
+		free(job->output);
+		job->output = NULL;
+		if (pipeline && !job->status) finishJob(job, options);
+		if (job->status) {
+			flushOutput();
+			if (job->message) fputs(job->message, stderr);
+			fflush(stderr);
+			status = job->status;
+		}
+		lockMutex(&JobMutex);
+		queue.ran = n + 1;
+		/* Nothing after a failed job is written, so start no more */
+		if (status) queue.stop = 1;
+#ifdef HAVE_PTHREAD_H
+		signalCondition(&JobDone);
+#endif
+		unlockMutex(&JobMutex);
+	}
+
+	/*
+	 * Wait for the jobs already started, so that lci exits as it does
+	 * after running the files one after another, writing its profile and
+	 * statistics, rather than while they are still using what it frees.
+	 */
+#ifdef HAVE_PTHREAD_H
+	for (n = 0; n < started; n++)
+		joinThread(workers[n]);
+#endif
+	for (n = 0; n < num; n++) {
+		Job *job = queue.jobs + n;
+		free(job->output);
+		free(job->message);
+		if (job->node) deleteMainNode(job->node);
+		if (job->source) deleteSourceBuffer(job->source);
+	}
+	free(queue.jobs);
+
+	return status;
+}
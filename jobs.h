@@ -0,0 +1,126 @@
+/**
+ * Structures and functions for running the files named on the command line.
+ * Each file is loaded, parsed, optimized, resolved, and run in turn, or, with
+ * \c --jobs or \c --pipeline, by several threads at once (see \ref jobs).
+ *
+ * \file   jobs.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page jobs Jobs
+ *
+ * Running lci with \c --jobs=N runs the files named on the command line on N
+ * threads at once.  Every file is a job of its own, with its own global scope,
+ * allocation pools, output buffer, and error handler (see thread.h), so the
+ * programs do not affect one another.  Only the intern table, which keeps
+ * names rather than values, is shared between them.
+ *
+ * The output of each job is kept until every job before it has finished, and
+ * then written in the order the files were named, so the output is the same
+ * as that of running the files one after another.  So is the exit status: the
+ * first file which fails, in that order, ends lci with its error, and nothing
+ * from the files after it is written.  No more jobs are started once a file
+ * fails, but lci waits for those already running before it exits.
+ *
+ * Jobs read no input, since it could not be shared between them
+ * predictably: \c GIMMEH always finds the end of the input.  A file named
+ * \c - is still read from the standard input stream before any job starts.
+ *
+ * Running lci with \c --pipeline=N instead reads, parses, optimizes, and
+ * resolves the files on N threads while this thread runs them, one after
+ * another in the order they were named, as soon as each is ready.  Programs
+ * run this way read input as usual, and their output and exit status are the
+ * same as without \c --pipeline.  Errors in a file are kept, along with any
+ * byte order mark it writes, until the files before it have run.  The files
+ * loaded ahead are limited to \c PIPELINE_AHEAD for each thread, and a file
+ * named \c - is only read from the standard input stream when its turn to run
+ * comes, after the programs before it have read their input.
+ *
+ * Where threads are not available, the jobs are run one after another (or, with
+ * \c --pipeline, all loaded first).
+ */
+
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "source.h"
+#include "cache.h"
+#include "tokenizer.h"
+#include "parser.h"
+#include "optimizer.h"
+#include "resolver.h"
+#include "interpreter.h"
+#include "output.h"
+#include "error.h"
+#include "thread.h"
+
+#undef DEBUG
+
+/**
+ * The most threads which may take jobs at once.
+ */
+#define JOBS_MAX 256
+
+/**
+ * The number of programs a pipeline keeps loaded ahead of the one running, for
+ * each thread loading them.
+ */
+#define PIPELINE_AHEAD 2
+
+/**
+ * Stores how files are run.
+ */
+typedef struct {
+	int (*execute)(MainNode *); /**< The engine to run programs with. */
+	unsigned int optimize;      /**< The optimization level. */
+	int compile;                /**< Whether to compile programs instead of running them. */
+} JobOptions;
+
+/**
+ * Stores a file run as a job, and what running it produced.
+ */
+typedef struct {
+	const char *name;     /**< The name of the file, or "-" for the standard input stream. */
+	SourceBuffer *source; /**< The source code read ahead, or NULL to load it when run. */
+	MainNode *node;       /**< The program loaded by a pipeline, ready to run. */
+	char *output;         /**< The output written. */
+	size_t len;           /**< The number of bytes in \a output. */
+	size_t size;          /**< The number of bytes allocated for \a output. */
+	char *message;        /**< The message of the first error, or NULL. */
+	int status;           /**< The exit status, or 0 if the job succeeded. */
+	int done;             /**< Whether the job has finished. */
+} Job;
+
+/**
+ * Stores the jobs waiting for, and being run or loaded by, a set of threads.
+ */
+typedef struct {
+	Job *jobs;                  /**< The jobs, in the order the files were named. */
+	unsigned int num;           /**< The number of jobs. */
+	unsigned int next;          /**< The index of the next job to start. */
+	unsigned int ran;           /**< The number of jobs run and written. */
+	unsigned int ahead;         /**< The most jobs a pipeline loads ahead of those run. */
+	int stop;                   /**< Whether a job has failed, so no more are started. */
+	int pipeline;               /**< Whether jobs are only loaded, to be run in order. */
+	const JobOptions *options;  /**< How to run the jobs. */
+} JobQueue;
+
+/**
+ * \name Job functions
+ *
+ * Functions for running files.
+ */
+/**@{*/
+int runFile(const char *, SourceBuffer *, const JobOptions *);
+int runJobs(char **, unsigned int, unsigned int, int, const JobOptions *);
+/**@}*/
+
+#endif /* __JOBS_H__ */
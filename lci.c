@@ -0,0 +1,201 @@
+#include "lci.h"
+
+/**
+ * Records an error and reports it to the embedding program.  Only the first
+ * error of a parse or run is reported, since any others follow from it.
+ *
+ * \param [in] code The code lci would exit with.
+ *
+ * \param [in] message The error message.
+ *
+ * \param [in,out] data The LciErrors to record the error in.
+ */
+static void handleError(int code,
+                        const char *message,
+                        void *data)
+{
+	LciErrors *errors = data;
+	const LciCallbacks *callbacks = errors->callbacks;
+	if (errors->status) return;
+	/* Make sure a failure is told apart from success */
+	errors->status = code ? code : 1;
+	if (callbacks && callbacks->error)
+		callbacks->error(code, message, callbacks->data);
+	else
+		fputs(message, stderr);
+}
+
+/**
+ * Directs input, output, and errors to the callbacks of the embedding program.
+ *
+ * \param [out] errors The errors to record.
+ *
+ * \param [in] callbacks The callbacks to use, or NULL for the standard streams.
+ */
+static void beginCallbacks(LciErrors *errors,
+                           const LciCallbacks *callbacks)
+{
+	errors->callbacks = callbacks;
+	errors->status = 0;
+	setErrorHandler(handleError, errors);
+	setInputReader(callbacks ? callbacks->read : NULL,
+			callbacks ? callbacks->data : NULL);
+	setOutputWriter(callbacks ? callbacks->write : NULL,
+			callbacks ? callbacks->data : NULL);
+}
+
+/**
+ * Directs input, output, and errors back to the standard streams.
+ *
+ * \post Any buffered output will have been written.
+ */
+static void endCallbacks(void)
+{
+	setOutputWriter(NULL, NULL);
+	setInputReader(NULL, NULL);
+	setErrorHandler(NULL, NULL);
+}
+
+/**
+ * Parses a program so that it may be run.
+ *
+ * \param [in] buffer The source code of the program.
+ *
+ * \param [in] size The number of characters in \a buffer.
+ *
+ * \param [in] fname The name of the file the program is from, used in error
+ * messages.
+ *
+ * \param [in] optimize The optimization level (see optimizeMainNode()).
+ *
+ * \param [in] callbacks The callbacks to report errors to, or NULL to print
+ * them to the standard error stream.
+ *
+ * \note \a buffer and \a fname are copied and need not outlive the program.
+ *
+ * \return The program, ready to be run with lciRunProgram().
+ *
+ * \retval NULL An error was reported or memory allocation failed.
+ */
+MainNode *lciParseProgram(const char *buffer,
+                          size_t size,
+                          const char *fname,
+                          unsigned int optimize,
+                          const LciCallbacks *callbacks)
+{
+	LciErrors errors;
+	TokenStream *tokens = NULL;
+	MainNode *node = NULL;
+	char *source = NULL;
+	beginCallbacks(&errors, callbacks);
+	/* Nodes refer to the file name for as long as they live */
+	fname = internString(fname, strlen(fname));
+	if (!fname) goto lciParseProgramAbort;
+	/* The lexer expects its buffer to end with a null character */
+	source = malloc(size + 1);
+	if (!source) {
+		perror("malloc");
+		goto lciParseProgramAbort;
+	}
+	memcpy(source, buffer, size);
+	source[size] = '\0';
+	/* Blank out any hash bang line and UTF-8 BOM as lci does */
+	if (size >= 2 && source[0] == '#' && source[1] == '!') {
+		size_t n;
+		for (n = 0; n < size && source[n] != '\n' && source[n] != '\r'; n++)
+			source[n] = ' ';
+	}
+	else if (size >= 3 && source[0] == (char)0xef
+			&& source[1] == (char)0xbb
+			&& source[2] == (char)0xbf) {
+		source[0] = source[1] = source[2] = ' ';
+	}
+	tokens = createTokenStream(source, (unsigned int)size, fname);
+	if (!tokens) goto lciParseProgramAbort;
+	node = parseMainNode(tokens);
+	deleteTokenStream(tokens);
+	free(source);
+	source = NULL;
+	if (!node || errors.status) goto lciParseProgramAbort;
+	if (!optimizeMainNode(node, optimize) || errors.status)
+		goto lciParseProgramAbort;
+	if (!resolveMainNode(node) || errors.status)
+		goto lciParseProgramAbort;
+	endCallbacks();
+	return node;
+
+lciParseProgramAbort: /* In case something goes wrong... */
+
+	/* Clean up any allocated structures */
+	if (node) deleteMainNode(node);
+	free(source);
+	endCallbacks();
+
+	return NULL;
+}
+
+/**
+ * Runs a program.
+ *
+ * \param [in] main The program to run, from lciParseProgram().
+ *
+ * \param [in] engine The engine to run \a main with.
+ *
+ * \param [in] callbacks The callbacks to handle the input, output, and errors
+ * of \a main with, or NULL for the standard streams.
+ *
+ * \note \a main may be run again afterwards, whether or not this run failed.
+ * Each run starts from a fresh global scope.
+ *
+ * \return 0 if \a main ran to completion, or else the code lci would have
+ * exited with.
+ */
+int lciRunProgram(MainNode *main,
+                  LciEngine engine,
+                  const LciCallbacks *callbacks)
+{
+	LciErrors errors;
+	int status;
+	beginCallbacks(&errors, callbacks);
+	if (engine == LCI_ENGINE_VM)
+		status = executeMainNode(main);
+	else
+		status = interpretMainNode(main);
+	endCallbacks();
+	if (errors.status) return errors.status;
+	return status;
+}
+
+/**
+ * Deletes a program.
+ *
+ * \param [in,out] main The program to delete, from lciParseProgram().
+ *
+ * \post The memory at \a main and all of its members will be freed.
+ */
+void lciDeleteProgram(MainNode *main)
+{
+	deleteMainNode(main);
+}
+
+/**
+ * Frees the memory lci keeps for the calling thread between programs.
+ *
+ * \pre No program is being run by the calling thread.
+ */
+void lciCleanupThread(void)
+{
+	deleteAllocationPools();
+	deleteInternBinds();
+}
+
+/**
+ * Frees the memory lci keeps between programs.
+ *
+ * \pre Every program has been deleted with lciDeleteProgram().
+ */
+void lciCleanup(void)
+{
+	deleteFrameStack();
+	deleteInternTable();
+}
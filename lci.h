@@ -0,0 +1,112 @@
+/**
+ * Structures and functions for embedding lci in other programs.  These tie
+ * the lexer, tokenizer, parser, optimizer, resolver, and engines together so
+ * that a program can be parsed once and then run any number of times, with
+ * its input, output, and errors handled by the embedding program.
+ *
+ * \file   lci.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page embedding Embedding
+ *
+ * Besides the \c lci executable, the build produces \c liblci, a library
+ * holding everything but the command line interface.  A program embedding lci
+ * includes lci.h, parses each LOLCODE program once with lciParseProgram(),
+ * and runs it with lciRunProgram() as often as it likes:
+ *
+ * \code
+ * static void writeToClient(const char *data, size_t len, void *client)
+ * {
+ *     ...
+ * }
+ *
+ * LciCallbacks callbacks = { NULL, writeToClient, NULL, NULL };
+ * MainNode *program = lciParseProgram(source, size, "hello.lol",
+ *         OPTIMIZE_DEFAULT, &callbacks);
+ * while (program && (client = acceptClient())) {
+ *     callbacks.data = client;
+ *     lciRunProgram(program, LCI_ENGINE_AST, &callbacks);
+ * }
+ * lciDeleteProgram(program);
+ * lciCleanup();
+ * \endcode
+ *
+ * Each run starts from a fresh global scope, so nothing one run declares is
+ * seen by the next.  Input, output, and errors go to the standard streams
+ * unless an LciCallbacks structure supplies functions for them.  Errors never
+ * end the embedding program: they are reported to the error callback and the
+ * call which encountered them fails.
+ *
+ * Several threads may parse and run programs at once.  The state of a run
+ * (its allocation pools, output buffer, and callbacks) belongs to the thread
+ * running it, and only the intern table, which is locked while it is used, is
+ * shared between threads.  A program may be run by any thread, but by only
+ * one thread at a time, since a run caches what it looks up in the program.
+ * Before a thread which has used lci exits, it frees what lci keeps for it
+ * with lciCleanupThread().
+ */
+
+#ifndef __LCI_H__
+#define __LCI_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tokenizer.h"
+#include "parser.h"
+#include "optimizer.h"
+#include "resolver.h"
+#include "interpreter.h"
+#include "vm.h"
+#include "output.h"
+#include "error.h"
+
+#undef DEBUG
+
+/**
+ * Stores the functions a program's input, output, and errors are handled
+ * with.  Any of them may be NULL to use the standard streams instead.
+ */
+typedef struct {
+	InputReader read;   /**< Reads input. */
+	OutputWriter write; /**< Writes output. */
+	ErrorHandler error; /**< Reports errors. */
+	void *data;         /**< The data passed to each function. */
+} LciCallbacks;
+
+/**
+ * Represents an engine to run programs with.
+ */
+typedef enum {
+	LCI_ENGINE_AST, /**< The parse tree interpreter. */
+	LCI_ENGINE_VM   /**< The virtual machine. */
+} LciEngine;
+
+/**
+ * Stores the errors reported while parsing or running a program.
+ */
+typedef struct {
+	const LciCallbacks *callbacks; /**< The callbacks to report errors to. */
+	int status;                    /**< The code of the first error, or 0. */
+} LciErrors;
+
+/**
+ * \name Embedding functions
+ *
+ * Functions for parsing and running programs from another program.
+ */
+/**@{*/
+MainNode *lciParseProgram(const char *, size_t, const char *, unsigned int, const LciCallbacks *);
+int lciRunProgram(MainNode *, LciEngine, const LciCallbacks *);
+void lciDeleteProgram(MainNode *);
+void lciCleanupThread(void);
+void lciCleanup(void);
+/**@}*/
+
+#endif /* __LCI_H__ */
@@ -13,20 +13,19 @@
  *
  * \retval NULL Memory allocation failed.
  */
-Lexeme *createLexeme(char *image, const char *fname, unsigned int line)
+Lexeme *createLexeme(const char *image, const char *fname, unsigned int line)
 {
 	Lexeme *ret = malloc(sizeof(Lexeme));
 	if (!ret) {
 		perror("malloc");
 		return NULL;
 	}
-	ret->image = malloc(sizeof(char) * (strlen(image) + 1));
-	if (!(ret->image)) {
-		free(ret);
-		perror("malloc");
-		return NULL;
-	}
-	strcpy(ret->image, image);
+	/**
+	 * \note \a image is not copied because it is either a constant string
+	 * or an image stored in the blocks of a lexeme list (see
+	 * addLexemeImage()), which outlive the lexeme.
+	 */
+	ret->image = image;
 	/**
 	 * \note \a fname is not copied because it only one copy is stored for
 	 * all lexemes from the same file.  This is simply to avoid large
@@ -48,10 +47,9 @@ Lexeme *createLexeme(char *image, const char *fname, unsigned int line)
 void deleteLexeme(Lexeme *lexeme)
 {
 	if (!lexeme) return;
-	free(lexeme->image);
 	/**
-	 * \note We do not free the file name because it is shared between many
-	 * lexemes and is freed by whomever created the file name string.
+	 * \note We do not free the image or file name because they are shared
+	 * between many lexemes and are freed by whomever created them.
 	 */
 	free(lexeme);
 }
@@ -71,7 +69,9 @@ LexemeList *createLexemeList(void)
 		return NULL;
 	}
 	p->num = 0;
+	p->max = 0;
 	p->lexemes = NULL;
+	p->blocks = NULL;
 	return p;
 }
 
@@ -91,49 +91,178 @@ LexemeList *createLexemeList(void)
  */
 Lexeme *addLexeme(LexemeList *list, Lexeme *lexeme)
 {
-	unsigned int newsize;
-	void *mem = NULL;
 	if (!list) return NULL;
-	newsize = list->num + 1;
-	mem = realloc(list->lexemes, sizeof(Lexeme *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return NULL;
+	if (list->num == list->max) {
+		unsigned int newmax = list->max ? list->max * 2 : 256;
+		void *mem = realloc(list->lexemes, sizeof(Lexeme *) * newmax);
+		if (!mem) {
+			perror("realloc");
+			return NULL;
+		}
+		list->lexemes = mem;
+		list->max = newmax;
 	}
-	list->lexemes = mem;
-	list->lexemes[list->num] = lexeme;
-	list->num = newsize;
+	list->lexemes[list->num++] = lexeme;
 	return lexeme;
 }
 
 /**
- * Deletes a list of lexemes.
+ * Copies a lexeme image into the blocks of a list of lexemes.  Images are
+ * packed one after another into large blocks, so that creating a lexeme does
+ * not need its own allocation for its image.
  *
- * \param [in,out] list The lexeme list to delete.
+ * \param [in,out] list The list of lexemes to store the image with.
  *
- * \post The memory at \a list and all of its members will be freed.
+ * \param [in] image The characters of the image (not necessarily ending with a
+ * null character).
+ *
+ * \param [in] len The number of characters in \a image.
+ *
+ * \param [in] hint The number of characters a new block should hold, if one is
+ * needed (for example, the number of characters left to scan).
+ *
+ * \return A null-terminated copy of \a image which lasts as long as \a list.
+ *
+ * \retval NULL Memory allocation failed.
  */
-void deleteLexemeList(LexemeList *list)
+const char *addLexemeImage(LexemeList *list,
+                           const char *image,
+                           unsigned int len,
+                           unsigned int hint)
+{
+	LexemeBlock *block = list->blocks;
+	char *ret = NULL;
+	if (!block || block->size - block->used < len + 1) {
+		unsigned int size = hint;
+		if (size < LEXEME_BLOCK_SIZE) size = LEXEME_BLOCK_SIZE;
+		if (size < len + 1) size = len + 1;
+		block = malloc(sizeof(LexemeBlock) + size);
+		if (!block) {
+			perror("malloc");
+			return NULL;
+		}
+		block->next = list->blocks;
+		block->size = size;
+		block->used = 0;
+		list->blocks = block;
+	}
+	ret = block->data + block->used;
+	memcpy(ret, image, len);
+	ret[len] = '\0';
+	block->used += len + 1;
+	return ret;
+}
+
+/**
+ * Removes lexemes from the start of a list.
+ *
+ * \param [in,out] list The list of lexemes to remove lexemes from.
+ *
+ * \param [in] num The number of lexemes to remove.
+ *
+ * \post The first \a num lexemes of \a list will be deleted and the rest will
+ * be moved to the start of \a list.  Their images are kept until \a list is
+ * deleted (or deleteLexemeBlocks() is called).
+ */
+void removeLexemes(LexemeList *list,
+                   unsigned int num)
+{
+	unsigned int n;
+	if (num > list->num) num = list->num;
+	for (n = 0; n < num; n++)
+		deleteLexeme(list->lexemes[n]);
+	list->num -= num;
+	memmove(list->lexemes, list->lexemes + num, sizeof(Lexeme *) * list->num);
+}
+
+/**
+ * Gets the block of a list of lexemes holding an image.
+ *
+ * \param [in] list The list of lexemes to search the blocks of.
+ *
+ * \param [in] image The image to search for.
+ *
+ * \return The block of \a list holding \a image.
+ *
+ * \retval NULL \a image is not in any block of \a list (for example, it is a
+ * constant string).
+ */
+LexemeBlock *getLexemeBlock(LexemeList *list,
+                            const char *image)
+{
+	LexemeBlock *block;
+	for (block = list->blocks; block; block = block->next)
+		if (image >= block->data && image < block->data + block->size)
+			return block;
+	return NULL;
+}
+
+/**
+ * Deletes the oldest blocks of lexeme images of a list.
+ *
+ * \param [in,out] list The list of lexemes to delete the blocks of.
+ *
+ * \param [in] keep The oldest block to keep, or NULL to keep only the newest.
+ *
+ * \pre No lexeme or token still uses an image in the blocks older than \a keep.
+ *
+ * \post The blocks of \a list older than \a keep will be freed.
+ */
+void deleteLexemeBlocks(LexemeList *list,
+                        LexemeBlock *keep)
+{
+	LexemeBlock *block = keep ? keep : list->blocks;
+	if (!block) return;
+	while (block->next) {
+		LexemeBlock *next = block->next->next;
+		free(block->next);
+		block->next = next;
+	}
+}
+
+/**
+ * Deletes the lexemes in a list, but not their images.  This frees most of the
+ * memory used by a list once it has been tokenized, while the tokens, which
+ * share the lexeme images, are still in use.
+ *
+ * \param [in,out] list The lexeme list to delete the lexemes of.
+ *
+ * \post \a list will be empty, but will still hold the images of the deleted
+ * lexemes until it is deleted.
+ */
+void deleteLexemes(LexemeList *list)
 {
 	unsigned int n;
 	if (!list) return;
 	for (n = 0; n < list->num; n++)
 		deleteLexeme(list->lexemes[n]);
 	free(list->lexemes);
+	list->lexemes = NULL;
+	list->num = 0;
+	list->max = 0;
+}
+
+/**
+ * Deletes a list of lexemes.
+ *
+ * \param [in,out] list The lexeme list to delete.
+ *
+ * \post The memory at \a list and all of its members will be freed.
+ */
+void deleteLexemeList(LexemeList *list)
+{
+	if (!list) return;
+	deleteLexemes(list);
+	while (list->blocks) {
+		LexemeBlock *next = list->blocks->next;
+		free(list->blocks);
+		list->blocks = next;
+	}
 	free(list);
 }
 
 /**
- * Scans a buffer, removing unnecessary characters and grouping characters into
- * lexemes.  Lexemes are strings of characters separated by whitespace (although
- * newline characters are considered separate lexemes).  String literals are
- * handled a bit differently:  Starting at the first quotation character,
- * characters are collected until either a non-escaped quotation character is
- * read (i.e., a quotation character not preceded by a colon which itself is not
- * preceded by a colon) or a newline or carriage return character is read,
- * whichever comes first.  This handles the odd (but possible) case of strings
- * such as "::" which print out a single colon.  Also handled are the effects of
- * commas, ellipses, bangs (!), and array accesses ('Z).
+ * Creates a scanner over a buffer of characters.
  *
  * \param [in] buffer The characters to turn into lexemes.
  *
@@ -141,60 +270,128 @@ void deleteLexemeList(LexemeList *list)
  *
  * \param [in] fname The name of the file \a buffer was read from.
  *
- * \return A list of lexemes created from the contents of \a buffer.
+ * \param [in] blocksize The number of characters in each block of lexeme images
+ * (see addLexemeImage()), or 0 to fit the rest of \a buffer in one block.
+ *
+ * \note \a buffer and \a fname are not copied and must outlive the scanner.
+ *
+ * \return A scanner positioned at the start of \a buffer.
+ *
+ * \retval NULL Memory allocation failed.
  */
-LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
+LexemeScanner *createLexemeScanner(const char *buffer,
+                                   unsigned int size,
+                                   const char *fname,
+                                   unsigned int blocksize)
 {
-	const char *start = buffer;
-	LexemeList *list = NULL;
-	unsigned int line = 1;
-	list = createLexemeList();
-	if (!list) return NULL;
-	while (start < buffer + size) {
-		char *temp = NULL;
+	LexemeScanner *p = malloc(sizeof(LexemeScanner));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->buffer = buffer;
+	p->size = size;
+	p->start = buffer;
+	p->fname = fname;
+	p->line = 1;
+	p->blocksize = blocksize;
+	p->newline = 1;
+	p->done = 0;
+	return p;
+}
+
+/**
+ * Deletes a scanner.
+ *
+ * \param [in,out] scanner The scanner to delete.
+ *
+ * \post The memory at \a scanner will be freed.
+ */
+void deleteLexemeScanner(LexemeScanner *scanner)
+{
+	free(scanner);
+}
+
+/**
+ * Adds a lexeme found by a scanner to a list of lexemes.
+ *
+ * \param [in,out] scanner The scanner which found the lexeme.
+ *
+ * \param [in,out] list The list of lexemes to add the lexeme to.
+ *
+ * \param [in] image The image of the lexeme.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The lexeme was added to \a list.
+ */
+static int addScannedLexeme(LexemeScanner *scanner,
+                            LexemeList *list,
+                            const char *image)
+{
+	Lexeme *lex = createLexeme(image, scanner->fname, scanner->line);
+	if (!lex) return 0;
+	if (!addLexeme(list, lex)) {
+		deleteLexeme(lex);
+		return 0;
+	}
+	scanner->newline = (*image == '\n');
+	return 1;
+}
+
+/**
+ * Scans the next lexeme from a buffer, removing unnecessary characters and
+ * grouping characters into lexemes.  Lexemes are strings of characters
+ * separated by whitespace (although newline characters are considered separate
+ * lexemes).  String literals are handled a bit differently:  Starting at the
+ * first quotation character, characters are collected until either a
+ * non-escaped quotation character is read (i.e., a quotation character not
+ * preceded by a colon which itself is not preceded by a colon) or a newline or
+ * carriage return character is read, whichever comes first.  This handles the
+ * odd (but possible) case of strings such as "::" which print out a single
+ * colon.  Also handled are the effects of commas, ellipses, bangs (!), and
+ * array accesses ('Z).  Once the whole buffer is scanned, an end-of-file lexeme
+ * is added.
+ *
+ * \param [in,out] scanner The scanner to scan the next lexeme with.
+ *
+ * \param [in,out] list The list of lexemes to add the lexeme to.
+ *
+ * \post Unless the end-of-file lexeme was already scanned, at least one more
+ * lexeme will be added to \a list (runs of newlines are added together).
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The next lexemes were added to \a list, or there are none left.
+ */
+int scanLexeme(LexemeScanner *scanner,
+               LexemeList *list)
+{
+	const char *buffer = scanner->buffer;
+	const char *start = scanner->start;
+	const char *fname = scanner->fname;
+	unsigned int size = scanner->size;
+	unsigned int num = list->num;
+	if (scanner->done) return 1;
+	/* Stop once the lexemes at the start of the buffer have been added */
+	while (start < buffer + size && list->num == num) {
+		const char *image = NULL;
 		unsigned int len = 1;
 		/* Comma (,) is a soft newline */
 		if (*start == ',') {
-			Lexeme *lex = createLexeme("\n", fname, line);
-			if (!lex) {
-				deleteLexemeList(list);
-				return NULL;
-			}
-			if (!addLexeme(list, lex)) {
-				deleteLexeme(lex);
-				deleteLexemeList(list);
-				return NULL;
-			}
+			if (!addScannedLexeme(scanner, list, "\n")) return 0;
 			start++;
 			continue;
 		}
 		/* Bang (!) is its own lexeme */
 		if (*start == '!') {
-			Lexeme *lex = createLexeme("!", fname, line);
-			if (!lex) {
-				deleteLexemeList(list);
-				return NULL;
-			}
-			if (!addLexeme(list, lex)) {
-				deleteLexeme(lex);
-				deleteLexemeList(list);
-				return NULL;
-			}
+			if (!addScannedLexeme(scanner, list, "!")) return 0;
 			start++;
 			continue;
 		}
 		/* Apostrophe Z ('Z) is its own lexeme */
 		if (!strncmp(start, "'Z", 2)) {
-			Lexeme *lex = createLexeme("'Z", fname, line);
-			if (!lex) {
-				deleteLexemeList(list);
-				return NULL;
-			}
-			if (!addLexeme(list, lex)) {
-				deleteLexeme(lex);
-				deleteLexemeList(list);
-				return NULL;
-			}
+			if (!addScannedLexeme(scanner, list, "'Z")) return 0;
 			start += 2;
 			continue;
 		}
@@ -210,17 +407,8 @@ LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
 				newline = 1;
 			}
 			if (newline) {
-				Lexeme *lex = createLexeme("\n", fname, line);
-				if (!lex) {
-					deleteLexemeList(list);
-					return NULL;
-				}
-				if (!addLexeme(list, lex)) {
-					deleteLexeme(lex);
-					deleteLexemeList(list);
-					return NULL;
-				}
-				line++;
+				if (!addScannedLexeme(scanner, list, "\n")) return 0;
+				scanner->line++;
 			}
 			start++;
 			continue;
@@ -236,24 +424,21 @@ LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
 			/* Make sure next line is not empty */
 			while (*test && isspace(*test)) {
 				if (*test == '\r' || *test == '\n') {
-					error(LX_LINE_CONTINUATION, fname, line);
-					deleteLexemeList(list);
-					return NULL;
+					error(LX_LINE_CONTINUATION, fname, scanner->line);
+					return 0;
 				}
 				test++;
 			}
 			continue;
 		}
 		/* Skip over comments */
-		if ((list->num == 0
-				|| *(list->lexemes[list->num - 1]->image) == '\n')
-				&& !strncmp(start, "OBTW", 4)) {
+		if (scanner->newline && !strncmp(start, "OBTW", 4)) {
 			start += 4;
 			while (strncmp(start, "TLDR", 4)) {
 				if ((!strncmp(start, "\r\n", 2) && (start += 2))
 						|| (*start == '\r' && start++)
 						|| (*start == '\n' && start++))
-					line++;
+					scanner->line++;
 				else
 					start++;
 			}
@@ -263,9 +448,8 @@ LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
 				start++;
 			if (start == buffer || *start == ',' || *start == '\r' || *start == '\n')
 				continue;
-			error(LX_MULTIPLE_LINE_COMMENT, fname, line);
-			deleteLexemeList(list);
-			return NULL;
+			error(LX_MULTIPLE_LINE_COMMENT, fname, scanner->line);
+			return 0;
 		}
 		if (!strncmp(start, "BTW", 3)) {
 			start += 3;
@@ -295,9 +479,8 @@ LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
 					&& strncmp(start + len, "'Z", 2)
 					&& strncmp(start + len, "...", 3)
 					&& strncmp(start + len, "\xE2\x80\xA6", 3)) {
-				error(LX_EXPECTED_TOKEN_DELIMITER, fname, line);
-				deleteLexemeList(list);
-				return NULL;
+				error(LX_EXPECTED_TOKEN_DELIMITER, fname, scanner->line);
+				return 0;
 			}
 		}
 		else {
@@ -310,39 +493,48 @@ LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
 					&& strncmp(start + len, "\xE2\x80\xA6", 3))
 				len++;
 		}
-		temp = malloc(sizeof(char) * (len + 1));
-		if (!temp) {
-			perror("malloc");
-			deleteLexemeList(list);
-			return NULL;
-		}
-		strncpy(temp, start, len);
-		temp[len] = '\0';
-		Lexeme *lex = createLexeme(temp, fname, line);
-		if (!lex) {
-			free(temp);
-			deleteLexemeList(list);
-			return NULL;
-		}
-		if (!addLexeme(list, lex)) {
-			free(temp);
-			deleteLexeme(lex);
-			deleteLexemeList(list);
-			return NULL;
-		}
-		free(temp);
+		image = addLexemeImage(list, start, len, scanner->blocksize
+				? scanner->blocksize
+				: (unsigned int)((buffer + size) - start) + 1);
+		if (!image) return 0;
+		if (!addScannedLexeme(scanner, list, image)) return 0;
 		start += len;
 	}
+	scanner->start = start;
+	if (list->num != num) return 1;
 	/* Create an end-of-file lexeme */
-	Lexeme *lex = createLexeme("$", fname, line);
-	if (!lex) {
+	scanner->done = 1;
+	return addScannedLexeme(scanner, list, "$");
+}
+
+/**
+ * Scans a whole buffer into lexemes (see scanLexeme()).
+ *
+ * \param [in] buffer The characters to turn into lexemes.
+ *
+ * \param [in] size The number of characters in \a buffer.
+ *
+ * \param [in] fname The name of the file \a buffer was read from.
+ *
+ * \return A list of lexemes created from the contents of \a buffer.
+ */
+LexemeList *scanBuffer(const char *buffer, unsigned int size, const char *fname)
+{
+	LexemeScanner *scanner = NULL;
+	LexemeList *list = createLexemeList();
+	if (!list) return NULL;
+	scanner = createLexemeScanner(buffer, size, fname, 0);
+	if (!scanner) {
 		deleteLexemeList(list);
 		return NULL;
 	}
-	if (!addLexeme(list, lex)) {
-		deleteLexeme(lex);
-		deleteLexemeList(list);
-		return NULL;
+	while (!scanner->done) {
+		if (!scanLexeme(scanner, list)) {
+			deleteLexemeScanner(scanner);
+			deleteLexemeList(list);
+			return NULL;
+		}
 	}
+	deleteLexemeScanner(scanner);
 	return list;
 }
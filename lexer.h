@@ -29,29 +29,67 @@
  * surrounding whitespace or other lexemes.
  */
 typedef struct {
-	char *image;       /**< The string that identifies the lexeme. */
+	const char *image; /**< The string that identifies the lexeme. */
 	const char *fname; /**< The name of the file containing the lexeme. */
 	unsigned int line; /**< The line number the lexeme occurred on. */
 } Lexeme;
 
+/**
+ * The least number of characters in each block of lexeme images after the
+ * first.
+ */
+#define LEXEME_BLOCK_SIZE 4096
+
+/**
+ * Stores a block of lexeme images.  The images are stored one after another,
+ * each followed by a null character.
+ */
+typedef struct lexemeblock {
+	struct lexemeblock *next; /**< The block allocated before this one. */
+	unsigned int size;        /**< The number of characters in the block. */
+	unsigned int used;        /**< The number of characters used so far. */
+	char data[];              /**< The characters in the block. */
+} LexemeBlock;
+
 /**
  * Stores a list of lexemes.
  */
 typedef struct {
-	unsigned int num; /**< The number of lexemes stored. */
-	Lexeme **lexemes; /**< The array of stored lexemes. */
+	unsigned int num;     /**< The number of lexemes stored. */
+	unsigned int max;     /**< The number of lexemes allocated. */
+	Lexeme **lexemes;     /**< The array of stored lexemes. */
+	LexemeBlock *blocks;  /**< The blocks holding the lexeme images. */
 } LexemeList;
 
+/**
+ * Stores the state of scanning a buffer into lexemes.
+ */
+typedef struct {
+	const char *buffer;     /**< The characters being scanned. */
+	unsigned int size;      /**< The number of characters in \a buffer. */
+	const char *start;      /**< The next character to scan. */
+	const char *fname;      /**< The name of the file \a buffer was read from. */
+	unsigned int line;      /**< The line number of the next character. */
+	unsigned int blocksize; /**< The size of each block of lexeme images, or 0. */
+	int newline;            /**< Whether the last lexeme was a newline (or there was none). */
+	int done;               /**< Whether the end-of-file lexeme has been scanned. */
+} LexemeScanner;
+
 /**
  * \name Lexeme modifiers
  *
  * Functions for performing helper tasks.
  */
 /**@{*/
-Lexeme *createLexeme(char *, const char *, unsigned int);
+Lexeme *createLexeme(const char *, const char *, unsigned int);
 void deleteLexeme(Lexeme *);
 LexemeList *createLexemeList(void);
 Lexeme *addLexeme(LexemeList *, Lexeme*);
+const char *addLexemeImage(LexemeList *, const char *, unsigned int, unsigned int);
+void removeLexemes(LexemeList *, unsigned int);
+LexemeBlock *getLexemeBlock(LexemeList *, const char *);
+void deleteLexemeBlocks(LexemeList *, LexemeBlock *);
+void deleteLexemes(LexemeList *);
 void deleteLexemeList(LexemeList *);
 /**@}*/
 
@@ -61,6 +99,9 @@ void deleteLexemeList(LexemeList *);
  * Generates lexemes from a character buffer.
  */
 /**@{*/
+LexemeScanner *createLexemeScanner(const char *, unsigned int, const char *, unsigned int);
+void deleteLexemeScanner(LexemeScanner *);
+int scanLexeme(LexemeScanner *, LexemeList *);
 LexemeList *scanBuffer(const char *, unsigned int, const char *);
 /**@}*/
 
@@ -63,17 +63,64 @@
  *   - \b parser (parser.c, parser.h) - The parser takes the output of the
  *   tokenizer and analyzes it semantically to turn it into a parse tree.
  *
+ * These first three modules work as a pipeline:  the parser pulls tokens from a
+ * token stream, which tokenizes lexemes as they are scanned, so the source is
+ * never held as lexemes or tokens all at once.
+ *
+ *   - \b cache (cache.c, cache.h) - The cache writes the output of the parser
+ *   to a compiled program with \c --compile, and reads it back in place of the
+ *   first three modules when the source has not changed (see \ref cache).
+ *
+ *   - \b optimizer (optimizer.c, optimizer.h) - The optimizer takes the
+ *   output of the parser and folds constant operations and removes branches
+ *   which are never taken (see \ref optimizer).
+ *
+ *   - \b resolver (resolver.c, resolver.h) - The resolver takes the output of
+ *   the parser and annotates identifiers with their static bindings, where
+ *   these can be determined ahead of time (see \ref binding).
+ *
  *   - \b interpreter (interpreter.c, interpreter.h) - The interpreter takes the
  *   output of the parser and executes it.
  *
+ *   - \b profiler (profiler.c, profiler.h) - The profiler hooks into the
+ *   interpreter with \c --profile and reports the time spent in each function
+ *   and line of a program (see \ref profiler).
+ *
+ *   - \b pool (pool.c, pool.h) - Pools allocate the small objects created
+ *   by the interpreter and virtual machine, such as values and scopes, and
+ *   reuse them once they are deleted.  The nodes of a parse tree are instead
+ *   allocated from an arena, which is deleted all at once with the tree.
+ *
+ *   - \b intern (intern.c, intern.h) - The intern table keeps one copy of
+ *   each identifier name and string constant, so that names are compared by
+ *   address and hashed only once.
+ *
+ *   - \b output (output.c, output.h) - The output module buffers what
+ *   programs print and writes it in bulk, when the buffer fills, before input
+ *   is read or an error is printed, and on exit (unless \c --unbuffered is
+ *   given or the output goes to a terminal).  It also reads what programs
+ *   input.
+ *
+ *   - \b jobs (jobs.c, jobs.h) - Jobs run the files named on the command
+ *   line, either one after another or, with \c --jobs, several at once on
+ *   threads of their own.  With \c --pipeline, threads parse later files
+ *   while earlier ones run (see \ref jobs).
+ *
+ *   - \b vm (vm.c, vm.h) - The virtual machine is an alternative to the
+ *   interpreter, used with \c --engine=vm, which compiles the output of the
+ *   parser to bytecode and executes that instead (see \ref vm).
+ *
  * Each of these modules is contained within its own C header and source code
  * files of the same name.
  *
  * To handle the conversion of Unicode code points and normative names to bytes,
  * two additional files, unicode.c and unicode.h are used.
  * 
- * Finally, main.c ties all of these modules together and handles the initial
- * loading of input data for the lexer.
+ * Finally, main.c ties all of these modules together through jobs.c and
+ * jobs.h, loading input data for the lexer with source.c and source.h, which
+ * map regular files into memory instead of copying them.  Everything but main.c is also built as a library,
+ * through which lci.c and lci.h let other programs parse and run programs
+ * themselves (see \ref embedding).
  */
 
 /**
@@ -110,19 +157,32 @@
 #include <stdlib.h>
 #include <getopt.h>
 
+#include "source.h"
+#include "cache.h"
 #include "lexer.h"
 #include "tokenizer.h"
 #include "parser.h"
+#include "optimizer.h"
+#include "resolver.h"
+#include "vm.h"
 #include "interpreter.h"
+#include "profiler.h"
+#include "jobs.h"
 #include "error.h"
 
-#define READSIZE 512
 
 static char *program_name;
 
-static char *shortopt = "hv";
+static char *shortopt = "hvO:";
 static struct option longopt[] = {
+	{ "alloc-stats", no_argument, NULL, (int)'a' },
+	{ "compile", no_argument, NULL, (int)'c' },
+	{ "engine", required_argument, NULL, (int)'e' },
 	{ "help", no_argument, NULL, (int)'h' },
+	{ "jobs", required_argument, NULL, (int)'j' },
+	{ "pipeline", required_argument, NULL, (int)'P' },
+	{ "profile", required_argument, NULL, (int)'p' },
+	{ "unbuffered", no_argument, NULL, (int)'u' },
 	{ "version", no_argument, NULL, (int)'v' },
 	{ 0, 0, 0, 0 }
 };
@@ -131,7 +191,18 @@ static void help(void) {
 	fprintf(stderr, "\
 Usage: %s [FILE] ... \n\
 Interpret FILE(s) as LOLCODE. Let FILE be '-' for stdin.\n\
+  --alloc-stats\t\treport allocation statistics on exit\n\
+  --compile\t\tcompile each FILE to FILEc instead of running it\n\
+  --engine=ENGINE\texecute with ENGINE: 'ast' (default) or 'vm'\n\
   -h, --help\t\toutput this help\n\
+  --jobs=N\t\trun N FILEs at once, each with no input; output is\n\
+\t\t\twritten in order\n\
+  -O LEVEL\t\toptimize with LEVEL: 0 (none) or 1 (default)\n\
+  --pipeline=N\t\tparse FILEs on N threads while running them in order\n\
+  --profile=FILE\twrite a profile of each function and line to FILE\n\
+\t\t\t(and flame graph stacks to FILE.folded); implies\n\
+\t\t\t--engine=ast\n\
+  --unbuffered\t\twrite output immediately instead of buffering it\n\
   -v, --version\t\tprogram version\n", program_name);
 }
 
@@ -139,118 +210,104 @@ static void version (char *revision) {
 	fprintf(stderr, "%s %s\n", program_name, revision);
 }
 
+static void allocStats(void) {
+	printAllocationStats(stderr);
+}
+
 int main(int argc, char **argv)
 {
-	unsigned int size = 0;
-	unsigned int length = 0;
-	char *buffer = NULL;
-	LexemeList *lexemes = NULL;
-	Token **tokens = NULL;
-	MainNode *node = NULL;
-	char *fname = NULL;
-	FILE *file = NULL;
+	JobOptions options;
+	unsigned int jobs = 1;
+	int pipeline = 0;
+	int profile = 0;
+	int stats = 0;
 	int ch;
 
 	char *revision = "v0.10.5";
 	program_name = argv[0];
 
+	options.execute = interpretMainNode;
+	options.optimize = OPTIMIZE_DEFAULT;
+	options.compile = 0;
+
+	/* Show output as it is written to a terminal */
+	detectOutputTerminal();
+
+	/* Write any buffered output however the program exits */
+	atexit(flushOutput);
+	atexit(deleteInternTable);
+	atexit(deleteFrameStack);
+
 	while ((ch = getopt_long(argc, argv, shortopt, longopt, NULL)) != -1) {
 		switch (ch) {
 			default:
 				help();
 				exit(EXIT_FAILURE);
+			case 'a':
+				stats = 1;
+				break;
+			case 'c':
+				options.compile = 1;
+				break;
+			case 'e':
+				if (!strcmp(optarg, "ast"))
+					options.execute = interpretMainNode;
+				else if (!strcmp(optarg, "vm"))
+					options.execute = executeMainNode;
+				else
+					error(MN_UNKNOWN_ENGINE, optarg);
+				break;
 			case 'h':
 				help();
 				exit(EXIT_SUCCESS);
+			case 'j':
+			case 'P': {
+				char *end = NULL;
+				long num = strtol(optarg, &end, 10);
+				if (end == optarg || *end || num < 1 || num > JOBS_MAX)
+					error(MN_INVALID_JOB_COUNT, optarg);
+				jobs = (unsigned int)num;
+				pipeline = ch == 'P';
+				break;
+			}
+			case 'O':
+				if (!strcmp(optarg, "0"))
+					options.optimize = 0;
+				else if (!strcmp(optarg, "1"))
+					options.optimize = 1;
+				else
+					error(MN_UNKNOWN_OPTIMIZATION_LEVEL, optarg);
+				break;
+			case 'p':
+				if (!profile && !startProfile(optarg)) return 1;
+				/* Write the profile even if the program exits with an error */
+				if (!profile) atexit(stopProfile);
+				profile = 1;
+				break;
+			case 'u':
+				setOutputThreshold(0);
+				break;
 			case 'v':
 				version(revision);
 				exit(EXIT_SUCCESS);
 		}
 	}
 
-	for (; optind < argc; optind++) {
-		size = length = 0;
-		buffer = fname = NULL;
-		lexemes = NULL;
-		tokens = NULL;
-		node = NULL;
-		file = NULL;
+	/* Report even if the program exits with an error */
+	if (stats) atexit(allocStats);
 
-		if (!strncmp(argv[optind],"-\0",2)) {
-			file = stdin;
-			fname = "stdin";
-		}
-		else {
-			file = fopen(argv[optind], "r");
-			fname = argv[optind];
-		}
-
-		if (!file) {
-			error(MN_ERROR_OPENING_FILE, argv[optind]);
-			return 1;
-		}
-
-		while (!feof(file)) {
-			size += READSIZE;
-			buffer = realloc(buffer, sizeof(char) * size);
-			length += fread((buffer + size) - READSIZE,
-					1,
-					READSIZE,
-					file);
-		}
-
-		if (fclose(file) != 0) {
-			error(MN_ERROR_CLOSING_FILE, argv[optind]);
-			if (buffer) free(buffer);
-			return 1;
-		}
-		if (!buffer) return 1;
-		buffer[length] = '\0';
-
-		/* Remove hash bang line if run as a standalone script */
-		if (buffer[0] == '#' && buffer[1] == '!') {
-			unsigned int n;
-			for (n = 0; buffer[n] != '\n' && buffer[n] != '\r'; n++)
-				buffer[n] = ' ';
-		}
+	/* Only the interpreter can be profiled, and only on this thread */
+	if (profile) {
+		options.execute = interpretMainNode;
+		if (!pipeline) jobs = 1;
+	}
 
-		/*
-		 * Remove UTF-8 BOM if present and add it to the output stream
-		 * (we assume here that if a BOM is present, the system will
-		 * also expect the output to include a BOM).
-		 */
-		if (buffer[0] == (char)0xef
-				|| buffer[1] == (char)0xbb
-				|| buffer[2] == (char)0xbf) {
-			buffer[0] = ' ';
-			buffer[1] = ' ';
-			buffer[2] = ' ';
-			printf("%c%c%c", 0xef, 0xbb, 0xbf);
-		}
+	if (pipeline || jobs > 1)
+		return runJobs(argv + optind, (unsigned int)(argc - optind), jobs, pipeline, &options);
 
-		/* Begin main pipeline */
-		if (!(lexemes = scanBuffer(buffer, length, fname))) {
-			free(buffer);
-			return 1;
-		}
-		free(buffer);
-		if (!(tokens = tokenizeLexemes(lexemes))) {
-			deleteLexemeList(lexemes);
-			return 1;
-		}
-		deleteLexemeList(lexemes);
-		if (!(node = parseMainNode(tokens))) {
-			deleteTokens(tokens);
-			return 1;
-		}
-		deleteTokens(tokens);
-		if (interpretMainNode(node)) {
-			deleteMainNode(node);
+	for (; optind < argc; optind++) {
+		if (runFile(argv[optind], NULL, &options))
 			return 1;
-		}
-		deleteMainNode(node);
-		/* End main pipeline */
-
 	}
 
 	return 0;
@@ -0,0 +1,490 @@
+#include "optimizer.h"
+
+/**
+ * Gets the constant an expression consists of.
+ *
+ * \param [in] node The expression to check.
+ *
+ * \return The constant \a node consists of.
+ *
+ * \retval NULL \a node is not a constant, or is an interpolated string.
+ */
+static ConstantNode *getConstantNode(ExprNode *node)
+{
+	ConstantNode *expr = NULL;
+	if (!node || node->type != ET_CONSTANT) return NULL;
+	expr = (ConstantNode *)node->expr;
+	if (expr->type == CT_STRING && expr->tmpl) return NULL;
+	return expr;
+}
+
+/**
+ * Evaluates a constant expression as a boolean, as the interpreter would when
+ * testing it.
+ *
+ * \param [in] state The optimizer state to evaluate \a node under.
+ *
+ * \param [in] node The constant expression to evaluate.
+ *
+ * \param [out] truth The truth of \a node.
+ *
+ * \retval 0 An error occurred while evaluating \a node.
+ *
+ * \retval 1 \a truth was set.
+ */
+static int getConstantTruth(OptimizerState *state,
+                            ExprNode *node,
+                            int *truth)
+{
+	ImmediateValue val;
+	int status;
+	if (!interpretUnboxedExprNode(node, state->scope, &val)) return 0;
+	status = castBooleanImmediate(&val, truth);
+	releaseImmediateValue(&val);
+	return status;
+}
+
+/**
+ * Checks if an operation may be folded into a constant.  Its arguments must
+ * all be constants, and evaluating it must not raise an error, since errors
+ * should only be raised if and when the operation is reached.
+ *
+ * \param [in] expr The operation to check.
+ *
+ * \retval 0 \a expr may not be folded.
+ *
+ * \retval 1 \a expr may be folded.
+ */
+static int isFoldableOp(OpExprNode *expr)
+{
+	ConstantNode *a = NULL;
+	ConstantNode *b = NULL;
+	unsigned int n;
+	for (n = 0; n < expr->args->num; n++) {
+		ConstantNode *arg = getConstantNode(expr->args->exprs[n]);
+		if (!arg) return 0;
+		switch (expr->type) {
+			case OP_AND:
+			case OP_OR:
+			case OP_XOR:
+			case OP_NOT:
+				/* Any constant may be cast to a boolean */
+				break;
+			case OP_EQ:
+			case OP_NEQ:
+				if (arg->type == CT_NIL) return 0;
+				break;
+			case OP_CAT:
+				return 0;
+			default:
+				/* Arithmetic on YARNs and NOOBs may raise an error */
+				if (arg->type != CT_INTEGER
+						&& arg->type != CT_FLOAT
+						&& arg->type != CT_BOOLEAN)
+					return 0;
+				break;
+		}
+	}
+	if (expr->type != OP_DIV && expr->type != OP_MOD) return 1;
+	a = getConstantNode(expr->args->exprs[0]);
+	b = getConstantNode(expr->args->exprs[1]);
+	/* Leave division by zero to raise its error */
+	if (b->type == CT_FLOAT ? fabs(b->data.f - 0.0) < FLT_EPSILON : b->data.i == 0)
+		return 0;
+	/* Leave the one integer division which overflows alone, too */
+	if (a->type != CT_FLOAT && a->data.i == LLONG_MIN
+			&& b->type != CT_FLOAT && b->data.i == -1)
+		return 0;
+	return 1;
+}
+
+/**
+ * Folds an operation into the constant it evaluates to, if it may be folded
+ * (see isFoldableOp()).
+ *
+ * \param [in] state The optimizer state to fold \a node under.
+ *
+ * \param [in,out] node The operation expression to fold.
+ *
+ * \post If \a node was folded, it will be a constant expression.
+ *
+ * \retval 0 An error occurred while folding.
+ *
+ * \retval 1 \a node was folded or left alone.
+ */
+static int foldOpExprNode(OptimizerState *state,
+                          ExprNode *node)
+{
+	ConstantNode *folded = NULL;
+	ImmediateValue val;
+	if (!isFoldableOp((OpExprNode *)node->expr)) return 1;
+	if (!interpretUnboxedExprNode(node, state->scope, &val)) return 0;
+	/* The tree owns the new constant */
+	folded = allocArenaObject(&state->main->arena, sizeof(ConstantNode));
+	if (!folded) {
+		releaseImmediateValue(&val);
+		return 0;
+	}
+	switch (val.type) {
+		case VT_BOOLEAN:
+			folded->type = CT_BOOLEAN;
+			folded->data.i = val.data.i;
+			break;
+		case VT_INTEGER:
+			folded->type = CT_INTEGER;
+			folded->data.i = val.data.i;
+			break;
+		case VT_FLOAT:
+			folded->type = CT_FLOAT;
+			folded->data.f = val.data.f;
+			break;
+		default:
+			/* Only scalars are folded */
+			releaseImmediateValue(&val);
+			return 1;
+	}
+	folded->tmpl = NULL;
+	folded->value = createConstantValueObject(folded, &state->main->arena);
+	if (!folded->value) return 0;
+	node->type = ET_CONSTANT;
+	node->expr = folded;
+	return 1;
+}
+
+/**
+ * Removes the branches of an if/then/else statement which can never be taken.
+ *
+ * \param [in] state The optimizer state to prune \a stmt under.
+ *
+ * \param [in,out] stmt The statement to prune.
+ *
+ * \param [in] it The constant expression the \ref impvar "implicit variable"
+ * holds when \a stmt is reached, or NULL if it is not known.
+ *
+ * \retval 0 An error occurred while pruning.
+ *
+ * \retval 1 \a stmt was pruned.
+ */
+static int pruneIfThenElseStmtNode(OptimizerState *state,
+                                   IfThenElseStmtNode *stmt,
+                                   ExprNode *it)
+{
+	unsigned int kept = 0;
+	unsigned int n;
+	int truth;
+	if (it) {
+		if (!getConstantTruth(state, it, &truth)) return 0;
+		if (truth) {
+			/* Only the yes branch is ever taken */
+			stmt->guards->num = 0;
+			stmt->blocks->num = 0;
+			stmt->no = NULL;
+			return 1;
+		}
+		stmt->yes = NULL;
+	}
+	for (n = 0; n < stmt->guards->num; n++) {
+		ExprNode *guard = stmt->guards->exprs[n];
+		truth = 0;
+		if (getConstantNode(guard)) {
+			if (!getConstantTruth(state, guard, &truth)) return 0;
+			/* Guards which are never true are never taken */
+			if (!truth) continue;
+			/* The first guard always true becomes the else branch */
+			if (!kept) {
+				stmt->no = stmt->blocks->blocks[n];
+				break;
+			}
+		}
+		stmt->guards->exprs[kept] = guard;
+		stmt->blocks->blocks[kept] = stmt->blocks->blocks[n];
+		kept++;
+		/* Nothing after a guard always true is taken */
+		if (truth) {
+			stmt->no = NULL;
+			break;
+		}
+	}
+	stmt->guards->num = kept;
+	stmt->blocks->num = kept;
+	return 1;
+}
+
+/**
+ * Optimizes an identifier and any slots it accesses.
+ *
+ * \param [in] state The optimizer state to optimize \a node under.
+ *
+ * \param [in,out] node The identifier to optimize.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a node was optimized.
+ */
+int optimizeIdentifierNode(OptimizerState *state,
+                           IdentifierNode *node)
+{
+	for (; node; node = node->slot) {
+		if (node->type == IT_INDIRECT
+				&& !optimizeExprNode(state, (ExprNode *)node->id))
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Optimizes an expression.
+ *
+ * \param [in] state The optimizer state to optimize \a node under.
+ *
+ * \param [in,out] node The expression to optimize.
+ *
+ * \post \a node may be replaced in place with the constant it evaluates to.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a node was optimized.
+ */
+int optimizeExprNode(OptimizerState *state,
+                     ExprNode *node)
+{
+	if (!node) return 1;
+	switch (node->type) {
+		case ET_CAST: {
+			CastExprNode *expr = (CastExprNode *)node->expr;
+			return optimizeExprNode(state, expr->target);
+		}
+		case ET_IDENTIFIER:
+			return optimizeIdentifierNode(state, node->expr);
+		case ET_FUNCCALL: {
+			FuncCallExprNode *expr = (FuncCallExprNode *)node->expr;
+			if (!optimizeIdentifierNode(state, expr->scope)) return 0;
+			if (!optimizeIdentifierNode(state, expr->name)) return 0;
+			return optimizeExprNodeList(state, expr->args);
+		}
+		case ET_OP: {
+			OpExprNode *expr = (OpExprNode *)node->expr;
+			if (!optimizeExprNodeList(state, expr->args)) return 0;
+			return foldOpExprNode(state, node);
+		}
+		case ET_CONSTANT: {
+			ConstantNode *expr = (ConstantNode *)node->expr;
+			unsigned int n;
+			if (expr->type == CT_STRING && expr->tmpl) {
+				/* Optimize any interpolated variables */
+				for (n = 0; n < expr->tmpl->num; n++)
+					if (!optimizeExprNode(state, expr->tmpl->vars[n]))
+						return 0;
+				return 1;
+			}
+			/* Give the constant a value to share */
+			if (!expr->value)
+				expr->value = createConstantValueObject(expr, &state->main->arena);
+			return expr->value != NULL;
+		}
+		case ET_IMPVAR:
+			return 1;
+		default:
+			error(PR_UNKNOWN_EXPRESSION_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Optimizes a list of expressions.
+ *
+ * \param [in] state The optimizer state to optimize \a list under.
+ *
+ * \param [in,out] list The expressions to optimize.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a list was optimized.
+ */
+int optimizeExprNodeList(OptimizerState *state,
+                         ExprNodeList *list)
+{
+	unsigned int n;
+	if (!list) return 1;
+	for (n = 0; n < list->num; n++)
+		if (!optimizeExprNode(state, list->exprs[n])) return 0;
+	return 1;
+}
+
+/**
+ * Optimizes a statement.
+ *
+ * \param [in] state The optimizer state to optimize \a node under.
+ *
+ * \param [in,out] node The statement to optimize.
+ *
+ * \note Branches of an if/then/else statement are pruned by
+ * optimizeStmtNodeList(), which knows the statement before it.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a node was optimized.
+ */
+int optimizeStmtNode(OptimizerState *state,
+                     StmtNode *node)
+{
+	switch (node->type) {
+		case ST_CAST: {
+			CastStmtNode *stmt = (CastStmtNode *)node->stmt;
+			return optimizeIdentifierNode(state, stmt->target);
+		}
+		case ST_PRINT: {
+			PrintStmtNode *stmt = (PrintStmtNode *)node->stmt;
+			return optimizeExprNodeList(state, stmt->args);
+		}
+		case ST_INPUT: {
+			InputStmtNode *stmt = (InputStmtNode *)node->stmt;
+			return optimizeIdentifierNode(state, stmt->target);
+		}
+		case ST_ASSIGNMENT: {
+			AssignmentStmtNode *stmt = (AssignmentStmtNode *)node->stmt;
+			if (!optimizeIdentifierNode(state, stmt->target)) return 0;
+			return optimizeExprNode(state, stmt->expr);
+		}
+		case ST_DECLARATION: {
+			DeclarationStmtNode *stmt = (DeclarationStmtNode *)node->stmt;
+			if (!optimizeIdentifierNode(state, stmt->scope)) return 0;
+			if (!optimizeIdentifierNode(state, stmt->target)) return 0;
+			if (!optimizeExprNode(state, stmt->expr)) return 0;
+			return optimizeIdentifierNode(state, stmt->parent);
+		}
+		case ST_IFTHENELSE: {
+			IfThenElseStmtNode *stmt = (IfThenElseStmtNode *)node->stmt;
+			unsigned int n;
+			if (!optimizeBlockNode(state, stmt->yes)) return 0;
+			for (n = 0; n < stmt->guards->num; n++) {
+				if (!optimizeExprNode(state, stmt->guards->exprs[n]))
+					return 0;
+				if (!optimizeBlockNode(state, stmt->blocks->blocks[n]))
+					return 0;
+			}
+			return optimizeBlockNode(state, stmt->no);
+		}
+		case ST_SWITCH: {
+			SwitchStmtNode *stmt = (SwitchStmtNode *)node->stmt;
+			unsigned int n;
+			/* Guards are matched by their constants, not evaluated */
+			for (n = 0; n < stmt->blocks->num; n++)
+				if (!optimizeBlockNode(state, stmt->blocks->blocks[n]))
+					return 0;
+			return optimizeBlockNode(state, stmt->def);
+		}
+		case ST_RETURN: {
+			ReturnStmtNode *stmt = (ReturnStmtNode *)node->stmt;
+			return optimizeExprNode(state, stmt->value);
+		}
+		case ST_LOOP: {
+			LoopStmtNode *stmt = (LoopStmtNode *)node->stmt;
+			if (!optimizeExprNode(state, stmt->guard)) return 0;
+			if (!optimizeExprNode(state, stmt->update)) return 0;
+			return optimizeBlockNode(state, stmt->body);
+		}
+		case ST_DEALLOCATION: {
+			DeallocationStmtNode *stmt = (DeallocationStmtNode *)node->stmt;
+			return optimizeIdentifierNode(state, stmt->target);
+		}
+		case ST_FUNCDEF: {
+			FuncDefStmtNode *stmt = (FuncDefStmtNode *)node->stmt;
+			if (!optimizeIdentifierNode(state, stmt->scope)) return 0;
+			if (!optimizeIdentifierNode(state, stmt->name)) return 0;
+			return optimizeBlockNode(state, stmt->body);
+		}
+		case ST_EXPR:
+			return optimizeExprNode(state, node->stmt);
+		case ST_ALTARRAYDEF: {
+			AltArrayDefStmtNode *stmt = (AltArrayDefStmtNode *)node->stmt;
+			if (!optimizeIdentifierNode(state, stmt->name)) return 0;
+			if (!optimizeIdentifierNode(state, stmt->parent)) return 0;
+			return optimizeBlockNode(state, stmt->body);
+		}
+		case ST_BREAK:
+			return 1;
+		default:
+			error(PR_UNKNOWN_STATEMENT_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Optimizes a list of statements.
+ *
+ * \param [in] state The optimizer state to optimize \a list under.
+ *
+ * \param [in,out] list The statements to optimize.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a list was optimized.
+ */
+int optimizeStmtNodeList(OptimizerState *state,
+                         StmtNodeList *list)
+{
+	unsigned int n;
+	for (n = 0; n < list->num; n++) {
+		StmtNode *node = list->stmts[n];
+		ExprNode *it = NULL;
+		if (!optimizeStmtNode(state, node)) return 0;
+		if (node->type != ST_IFTHENELSE) continue;
+		/* A constant expression just before sets the implicit variable */
+		if (n > 0 && list->stmts[n - 1]->type == ST_EXPR
+				&& getConstantNode(list->stmts[n - 1]->stmt))
+			it = list->stmts[n - 1]->stmt;
+		if (!pruneIfThenElseStmtNode(state, node->stmt, it)) return 0;
+	}
+	return 1;
+}
+
+/**
+ * Optimizes a block of code.
+ *
+ * \param [in] state The optimizer state to optimize \a node under.
+ *
+ * \param [in,out] node The block of code to optimize.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a node was optimized.
+ */
+int optimizeBlockNode(OptimizerState *state,
+                      BlockNode *node)
+{
+	if (!node) return 1;
+	return optimizeStmtNodeList(state, node->stmts);
+}
+
+/**
+ * Optimizes the main block of code.
+ *
+ * \param [in,out] main The main block of code to optimize.
+ *
+ * \param [in] level The optimization level; 0 disables optimization.
+ *
+ * \pre \a main contains a block of code created by parseMainNode() and has not
+ * been resolved yet.
+ *
+ * \post The optimizations described in \ref optimizer will have been made to
+ * \a main.  Any nodes and values they create belong to \a main.
+ *
+ * \retval 0 An error occurred while optimizing.
+ *
+ * \retval 1 \a main was optimized.
+ */
+int optimizeMainNode(MainNode *main,
+                     unsigned int level)
+{
+	OptimizerState state;
+	int status;
+	if (!main) return 0;
+	if (level == 0) return 1;
+	state.main = main;
+	state.scope = createScopeObject(NULL);
+	if (!state.scope) return 0;
+	status = optimizeBlockNode(&state, main->block);
+	deleteScopeObject(state.scope);
+	return status;
+}
@@ -0,0 +1,83 @@
+/**
+ * Structures and functions for optimizing a parse tree.  The optimizer walks a
+ * parse tree (generated by the parser) and rewrites the parts of it whose
+ * results can be determined without running the program, so that the
+ * interpreter does not compute them over and over.
+ *
+ * \file   optimizer.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page optimizer Optimization
+ *
+ * At optimization level 1, the default, the optimizer makes the following
+ * changes to a parse tree before it is resolved (see \ref binding):
+ *
+ *   - Arithmetic, boolean, and equality operations whose arguments are all
+ *   constants are replaced with the constant they evaluate to.  Operations
+ *   which would raise an error when evaluated, such as division by zero or
+ *   arithmetic on a YARN, are left alone so that the error is still raised if
+ *   and when the operation is reached.
+ *
+ *   - Each constant is given an immortal value (see \ref IMMORTAL_SEMAPHORE)
+ *   which every evaluation of the constant shares, rather than allocating a
+ *   new value each time.
+ *
+ *   - When the statement before an \c O \c RLY? is a constant expression, so
+ *   the value of the \ref impvar "implicit variable" it tests is known, the
+ *   branches which can never be taken are removed.  \c MEBBE branches whose
+ *   guards are constants are removed or taken in the same way.
+ *
+ * Evaluation is done by the interpreter itself, so optimized programs behave
+ * the same as unoptimized ones.  Optimization level 0 (\c -O0) leaves the tree
+ * unchanged, which is useful for isolating a problem with the optimizer.
+ *
+ * Compiled programs (see \ref cache) store the unoptimized tree, so a program
+ * compiled once may be run at any optimization level.
+ */
+
+#ifndef __OPTIMIZER_H__
+#define __OPTIMIZER_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "parser.h"
+#include "interpreter.h"
+
+#undef DEBUG
+
+/**
+ * The optimization level used unless another is given.
+ */
+#define OPTIMIZE_DEFAULT 1
+
+/**
+ * Stores the state of an optimizer pass.
+ */
+typedef struct {
+	MainNode *main;     /**< The tree being optimized. */
+	ScopeObject *scope; /**< An empty scope to evaluate constants under. */
+} OptimizerState;
+
+/**
+ * \name Optimizer
+ *
+ * Functions for optimizing parse trees.
+ */
+/**@{*/
+int optimizeIdentifierNode(OptimizerState *, IdentifierNode *);
+int optimizeExprNode(OptimizerState *, ExprNode *);
+int optimizeExprNodeList(OptimizerState *, ExprNodeList *);
+int optimizeStmtNode(OptimizerState *, StmtNode *);
+int optimizeStmtNodeList(OptimizerState *, StmtNodeList *);
+int optimizeBlockNode(OptimizerState *, BlockNode *);
+int optimizeMainNode(MainNode *, unsigned int);
+/**@}*/
+
+#endif /* __OPTIMIZER_H__ */
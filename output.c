@@ -0,0 +1,367 @@
+#include "output.h"
+
+#ifdef INPUT_READ
+#include <errno.h>
+#endif
+
+#if defined(INPUT_READ) || defined(OUTPUT_ISATTY)
+#include <unistd.h>
+#endif
+
+/*
+ * The output waiting to be written.  This, like the rest of the state below,
+ * is kept per thread so that each thread runs programs with its own streams.
+ */
+static THREAD_LOCAL char OutputBuffer[OUTPUT_BUFFER_SIZE];
+static THREAD_LOCAL size_t OutputLength = 0;
+
+/*
+ * The amount of buffered output which causes the buffer to be written.  A
+ * threshold of zero writes all output immediately.
+ */
+static THREAD_LOCAL size_t OutputThreshold = OUTPUT_BUFFER_SIZE;
+
+/*
+ * The function output is written with, or NULL for the standard output stream.
+ */
+static THREAD_LOCAL OutputWriter Writer = NULL;
+static THREAD_LOCAL void *WriterData = NULL;
+
+/*
+ * The function input is read with, or NULL for the standard input stream, and
+ * the input it has read: the bytes from InputStart to InputEnd have not been
+ * used yet.  The buffer is allocated when input is first read.
+ */
+static THREAD_LOCAL InputReader Reader = NULL;
+static THREAD_LOCAL void *ReaderData = NULL;
+static THREAD_LOCAL char *InputBuffer = NULL;
+static THREAD_LOCAL size_t InputSize = 0;
+static THREAD_LOCAL size_t InputStart = 0;
+static THREAD_LOCAL size_t InputEnd = 0;
+
+/**
+ * Writes bytes to wherever output goes, without buffering them.
+ *
+ * \param [in] data The bytes to write.
+ *
+ * \param [in] len The number of bytes in \a data.
+ */
+static void emitOutput(const char *data,
+                       size_t len)
+{
+	if (Writer) Writer(data, len, WriterData);
+	else fwrite(data, 1, len, stdout);
+}
+
+/**
+ * Sets the amount of output to buffer before writing it.
+ *
+ * \param [in] threshold The number of bytes to buffer, at most
+ * OUTPUT_BUFFER_SIZE, or zero to write all output immediately.
+ *
+ * \post Any output already buffered will be written.
+ */
+void setOutputThreshold(size_t threshold)
+{
+	flushOutput();
+	if (threshold > OUTPUT_BUFFER_SIZE) threshold = OUTPUT_BUFFER_SIZE;
+	OutputThreshold = threshold;
+}
+
+/**
+ * Writes output immediately if the standard output stream is a terminal, so
+ * that whoever is watching it sees each line as it is written.
+ */
+void detectOutputTerminal(void)
+{
+#ifdef OUTPUT_ISATTY
+	if (isatty(STDOUT_FILENO)) setOutputThreshold(0);
+#endif
+}
+
+/**
+ * Writes output.
+ *
+ * \param [in] data The bytes to write.
+ *
+ * \param [in] len The number of bytes in \a data.
+ *
+ * \post \a data will be appended to the output buffer, or written directly if
+ * it does not fit under the buffering threshold.
+ */
+void writeOutput(const char *data,
+                 size_t len)
+{
+	if (OutputLength + len > OutputThreshold) {
+		flushOutput();
+		if (len > OutputThreshold) {
+			emitOutput(data, len);
+			if (!OutputThreshold && !Writer) fflush(stdout);
+			return;
+		}
+	}
+	memcpy(OutputBuffer + OutputLength, data, len);
+	OutputLength += len;
+}
+
+/**
+ * Writes a string as output.
+ *
+ * \param [in] data The null-terminated string to write.
+ */
+void writeOutputString(const char *data)
+{
+	writeOutput(data, strlen(data));
+}
+
+/**
+ * Writes an integer as output, as it would be cast to a string.
+ *
+ * \param [in] value The integer to write.
+ */
+void writeOutputInteger(long long int value)
+{
+	/* One character per integer bit plus one more for the sign */
+	char digits[sizeof(long long int) * 8 + 1];
+	char *end = digits + sizeof(digits);
+	char *start = end;
+	/* Work with negative numbers so that the most negative one fits */
+	long long int rest = value < 0 ? value : -value;
+	do {
+		*--start = (char)('0' - rest % 10);
+		rest /= 10;
+	} while (rest);
+	if (value < 0) *--start = '-';
+	writeOutput(start, (size_t)(end - start));
+}
+
+/**
+ * Writes a decimal as output, as it would be cast to a string.
+ *
+ * \param [in] value The decimal to write.
+ *
+ * \note Like a cast to a string, this truncates \a value to two decimal
+ * places.
+ */
+void writeOutputFloat(float value)
+{
+	/* Enough for the integer part of the largest decimal and six places */
+	char digits[64];
+	char *point = NULL;
+	size_t len;
+	sprintf(digits, "%f", value);
+	len = strlen(digits);
+	/* Truncate to a certain number of decimal places */
+	point = strchr(digits, '.');
+	if (point && point + 3 < digits + len) len = (size_t)(point + 3 - digits);
+	writeOutput(digits, len);
+}
+
+/**
+ * Writes any buffered output.
+ *
+ * \post The output buffer will be empty and, unless output is written with an
+ * OutputWriter, the standard output stream will be flushed.
+ */
+void flushOutput(void)
+{
+	if (OutputLength) {
+		emitOutput(OutputBuffer, OutputLength);
+		OutputLength = 0;
+	}
+	if (!Writer) fflush(stdout);
+}
+
+/**
+ * Sets the function output is written with.
+ *
+ * \param [in] writer The function to write output with, or NULL to write it to
+ * the standard output stream.
+ *
+ * \param [in] data The data to pass to \a writer.
+ *
+ * \post Any output already buffered will be written where it was going.
+ */
+void setOutputWriter(OutputWriter writer,
+                     void *data)
+{
+	flushOutput();
+	Writer = writer;
+	WriterData = data;
+}
+
+/**
+ * Reads input from wherever it comes from, without buffering it.
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \return The number of bytes read into \a data, or zero at the end of the
+ * input (or if it could not be read).
+ */
+static size_t fillInput(char *data,
+                        size_t len)
+{
+#ifdef INPUT_READ
+	ssize_t got;
+#else
+	size_t got = 0;
+	int c;
+#endif
+	if (Reader) return Reader(data, len, ReaderData);
+#ifdef INPUT_READ
+	do {
+		got = read(STDIN_FILENO, data, len);
+	} while (got < 0 && errno == EINTR);
+	return got > 0 ? (size_t)got : 0;
+#else
+	/* Stop at the end of a line rather than wait for more */
+	while (got < len && (c = getchar()) != EOF) {
+		data[got++] = (char)c;
+		if (c == '\n') break;
+	}
+	return got;
+#endif
+}
+
+/**
+ * Reads more input into the input buffer.  The input not used yet is moved to
+ * the start of the buffer first, and the buffer grows if that fills it.
+ *
+ * \post Any buffered output will have been written.
+ *
+ * \retval 1 More input was read.
+ *
+ * \retval 0 There is no input left.
+ *
+ * \retval -1 Memory allocation failed.
+ */
+static int moreInput(void)
+{
+	size_t got;
+	if (InputStart) {
+		memmove(InputBuffer, InputBuffer + InputStart, InputEnd - InputStart);
+		InputEnd -= InputStart;
+		InputStart = 0;
+	}
+	if (InputEnd == InputSize) {
+		size_t size = InputSize ? InputSize * 2 : INPUT_BUFFER_SIZE;
+		char *mem = realloc(InputBuffer, size);
+		if (!mem) {
+			perror("realloc");
+			return -1;
+		}
+		InputBuffer = mem;
+		InputSize = size;
+	}
+	/* Make sure any prompt is seen before waiting for input */
+	flushOutput();
+	got = fillInput(InputBuffer + InputEnd, InputSize - InputEnd);
+	InputEnd += got;
+	return got ? 1 : 0;
+}
+
+/**
+ * Sets the function input is read with.
+ *
+ * \param [in] reader The function to read input with, or NULL to read it from
+ * the standard input stream.
+ *
+ * \param [in] data The data to pass to \a reader.
+ *
+ * \post Any input read by the previous function but not used yet will be
+ * discarded, and the input buffer freed.
+ */
+void setInputReader(InputReader reader,
+                    void *data)
+{
+	Reader = reader;
+	ReaderData = data;
+	free(InputBuffer);
+	InputBuffer = NULL;
+	InputSize = InputStart = InputEnd = 0;
+}
+
+/**
+ * Reads a character of input.
+ *
+ * \return The character read, as an unsigned char converted to an int.
+ *
+ * \retval EOF There is no input left.
+ */
+int readInput(void)
+{
+	if (InputStart == InputEnd && moreInput() <= 0) return EOF;
+	return (unsigned char)InputBuffer[InputStart++];
+}
+
+/**
+ * Reads a line of input.  The line ends at the first carriage return or line
+ * feed, which is read but not included, or else at the end of the input.  Any
+ * null characters are included.
+ *
+ * \param [out] len The number of bytes in the line.
+ *
+ * \return The line, which is only valid until input is read again.  At the
+ * end of the input, this is an empty line.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+const char *readInputLine(size_t *len)
+{
+	/* The bytes before this have been searched for the end of the line */
+	size_t scan = InputStart;
+	const char *line = NULL;
+	while (1) {
+		size_t left = InputEnd - scan;
+		const char *end = NULL;
+		const char *ret = NULL;
+		int status;
+		if (left) {
+			end = memchr(InputBuffer + scan, '\n', left);
+			/* Carriage returns are rare, so look for them separately */
+			if (end) left = (size_t)(end - InputBuffer) - scan;
+			ret = memchr(InputBuffer + scan, '\r', left);
+			if (ret) end = ret;
+		}
+		if (end) {
+			line = InputBuffer + InputStart;
+			*len = (size_t)(end - line);
+			InputStart = (size_t)(end - InputBuffer) + 1;
+			return line;
+		}
+		/* Keep the start of the line and search only what follows */
+		scan = InputEnd - InputStart;
+		status = moreInput();
+		if (status < 0) return NULL;
+		if (!status) break;
+	}
+	*len = InputEnd - InputStart;
+	line = *len ? InputBuffer + InputStart : "";
+	InputStart = InputEnd;
+	return line;
+}
+
+/**
+ * Reads a block of input, as much as is available at once.  Input which has
+ * been buffered is read first, so that this may be used along with the other
+ * input functions.
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \return The number of bytes read into \a data, or zero at the end of the
+ * input.
+ */
+size_t readInputBlock(char *data,
+                      size_t len)
+{
+	size_t left = InputEnd - InputStart;
+	if (!left) return fillInput(data, len);
+	if (len > left) len = left;
+	memcpy(data, InputBuffer + InputStart, len);
+	InputStart += len;
+	return len;
+}
@@ -0,0 +1,114 @@
+/**
+ * Structures and functions for reading program input and writing program
+ * output.  Output is collected in a large buffer and written to the standard
+ * output stream in bulk, so that printing many small values does not pay for
+ * formatting and locking the stream each time.  Input is likewise read in
+ * large blocks and split into lines within the buffer, so a program reading
+ * many lines does not pay for reading them a character at a time, and each
+ * line is copied only once, into the string which holds it.  Buffered output
+ * is written before waiting for more input, so that any prompt is seen first.
+ *
+ * Programs embedding lci may supply their own functions to read input from and
+ * write output to instead of the standard streams.
+ *
+ * \file   output.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+#ifndef __OUTPUT_H__
+#define __OUTPUT_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "thread.h"
+
+#undef DEBUG
+
+/**
+ * The size of the output buffer, in bytes.
+ */
+#define OUTPUT_BUFFER_SIZE 65536
+
+/**
+ * Whether to tell if the standard output stream is a terminal with POSIX
+ * \c isatty(), to write output to it immediately.  Otherwise, output is always
+ * buffered unless the threshold is set to zero.
+ */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(OUTPUT_NO_ISATTY)
+#define OUTPUT_ISATTY
+#endif
+
+/**
+ * The initial size of the input buffer, in bytes.  The buffer grows to hold
+ * lines longer than this.
+ */
+#define INPUT_BUFFER_SIZE 65536
+
+/**
+ * Whether to read the standard input stream with POSIX \c read(), which
+ * returns whatever input is available rather than waiting for a full buffer.
+ * Otherwise, it is read a line at a time with the C library.
+ */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(INPUT_NO_READ)
+#define INPUT_READ
+#endif
+
+/**
+ * Writes output instead of the standard output stream.
+ *
+ * \param [in] data The bytes to write.
+ *
+ * \param [in] len The number of bytes in \a data.
+ *
+ * \param [in] user The data given to setOutputWriter().
+ */
+typedef void (*OutputWriter)(const char *data, size_t len, void *user);
+
+/**
+ * Reads input instead of the standard input stream.
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \param [in] user The data given to setInputReader().
+ *
+ * \return The number of bytes read into \a data, or zero at the end of the
+ * input.
+ */
+typedef size_t (*InputReader)(char *data, size_t len, void *user);
+
+/**
+ * \name Output functions
+ *
+ * Functions for buffering and writing output.
+ */
+/**@{*/
+void setOutputThreshold(size_t);
+void detectOutputTerminal(void);
+void writeOutput(const char *, size_t);
+void writeOutputString(const char *);
+void writeOutputInteger(long long int);
+void writeOutputFloat(float);
+void flushOutput(void);
+void setOutputWriter(OutputWriter, void *);
+/**@}*/
+
+/**
+ * \name Input functions
+ *
+ * Functions for reading input.
+ */
+/**@{*/
+void setInputReader(InputReader, void *);
+int readInput(void);
+const char *readInputLine(size_t *);
+size_t readInputBlock(char *, size_t);
+/**@}*/
+
+#endif /* __OUTPUT_H__ */
@@ -2,9 +2,10 @@
 
 #include "keywords.h"
 #include "parser.h"
+#include "unicode.h"
 
 #ifdef DEBUG
-static unsigned int shiftwidth = 0;
+static THREAD_LOCAL unsigned int shiftwidth = 0;
 void shiftout(void) { shiftwidth += 4; }
 void shiftin(void) { shiftwidth -= 4; }
 void debug(const char *info)
@@ -16,6 +17,110 @@ void debug(const char *info)
 }
 #endif
 
+/**
+ * The arena which nodes are allocated from until they are taken over by the
+ * next main code block created.
+ */
+static THREAD_LOCAL Arena NodeArena = ARENA_INITIALIZER;
+
+/**
+ * Allocates the memory of a node.
+ *
+ * \param [in] size The number of bytes in the node.
+ *
+ * \return A pointer to uninitialized memory for a node of \a size bytes.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+void *allocNode(size_t size)
+{
+	return allocArenaObject(&NodeArena, size);
+}
+
+/**
+ * Makes room for one more element at the end of an array of a node.  Arrays
+ * grow geometrically, doubling whenever their size reaches a power of two, so
+ * the capacity of an array does not need to be stored.
+ *
+ * \param [in] array The array to grow, or NULL if \a num is 0.
+ *
+ * \param [in] num The number of elements in \a array.
+ *
+ * \param [in] size The number of bytes in each element of \a array.
+ *
+ * \return A pointer to an array with room for at least \a num + 1 elements,
+ * the first \a num of which are those of \a array.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+void *growNodeArray(void *array,
+                    unsigned int num,
+                    size_t size)
+{
+	/* There is room until the size reaches a power of two */
+	if (num & (num - 1)) return array;
+	return resizeArenaObject(&NodeArena, array, size * num, size * (num ? num * 2 : 1));
+}
+
+/**
+ * Copies a string into the memory of a node.
+ *
+ * \param [in] str The string to copy.
+ *
+ * \param [in] len The number of characters of \a str to copy.
+ *
+ * \return A copy of the first \a len characters of \a str, followed by a null
+ * character.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+char *copyNodeString(const char *str,
+                     size_t len)
+{
+	char *p = allocNode(sizeof(char) * (len + 1));
+	if (!p) return NULL;
+	memcpy(p, str, len);
+	p[len] = '\0';
+	return p;
+}
+
+/**
+ * Marks the nodes created so far, so that the nodes created after them can be
+ * released.
+ *
+ * \return A mark which releaseNodes() can release the nodes back to.
+ */
+ArenaMark markNodes(void)
+{
+	return markArena(&NodeArena);
+}
+
+/**
+ * Releases the nodes created since a mark was made.  This is used to throw away
+ * nodes which are only parsed in order to look ahead.
+ *
+ * \param [in] mark The mark returned by markNodes().
+ *
+ * \post The memory of every node created since \a mark was made will be
+ * freed.
+ */
+void releaseNodes(ArenaMark mark)
+{
+	releaseArena(&NodeArena, mark);
+}
+
+/**
+ * Discards the nodes created since the last main code block was created, such
+ * as those of a parse tree which could not be completed.
+ *
+ * \post The memory of every node not belonging to a main code block will be
+ * freed.
+ */
+void discardNodes(void)
+{
+	deleteArena(&NodeArena);
+}
+
 /**
  * Creates the main code block of a program.
  *
@@ -24,6 +129,9 @@ void debug(const char *info)
  * \return A pointer to the main code block with the desired properties.
  *
  * \retval NULL Memory allocation failed.
+ *
+ * \post Every node created since the last main code block was created will
+ * belong to the new main code block.
  */
 MainNode *createMainNode(BlockNode *block)
 {
@@ -33,6 +141,13 @@ MainNode *createMainNode(BlockNode *block)
 		return NULL;
 	}
 	p->block = block;
+	/* Assume the worst until the tree is resolved */
+	p->indirect = 1;
+	/* Take over the nodes created so far */
+	p->arena = NodeArena;
+	NodeArena.blocks = NULL;
+	NodeArena.last = NULL;
+	NodeArena.lastsize = 0;
 	return p;
 }
 
@@ -41,12 +156,12 @@ MainNode *createMainNode(BlockNode *block)
  *
  * \param [in,out] node The main code block to delete.
  *
- * \post The memory at \a node and all of its members will be freed.
+ * \post The memory at \a node and every node of its tree will be freed.
  */
 void deleteMainNode(MainNode *node)
 {
 	if (!node) return;
-	deleteBlockNode(node->block);
+	deleteArena(&node->arena);
 	free(node);
 }
 
@@ -61,29 +176,12 @@ void deleteMainNode(MainNode *node)
  */
 BlockNode *createBlockNode(StmtNodeList *stmts)
 {
-	BlockNode *p = malloc(sizeof(BlockNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	BlockNode *p = allocNode(sizeof(BlockNode));
+	if (!p) return NULL;
 	p->stmts = stmts;
 	return p;
 }
 
-/**
- * Deletes a code block.
- *
- * \param [in,out] node The code block to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteBlockNode(BlockNode *node)
-{
-	if (!node) return;
-	deleteStmtNodeList(node->stmts);
-	free(node);
-}
-
 /**
  * Creates an empty code block list.
  *
@@ -93,11 +191,8 @@ void deleteBlockNode(BlockNode *node)
  */
 BlockNodeList *createBlockNodeList(void)
 {
-	BlockNodeList *p = malloc(sizeof(BlockNodeList));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	BlockNodeList *p = allocNode(sizeof(BlockNodeList));
+	if (!p) return NULL;
 	p->num = 0;
 	p->blocks = NULL;
 	return p;
@@ -119,35 +214,13 @@ BlockNodeList *createBlockNodeList(void)
 int addBlockNode(BlockNodeList *list,
                  BlockNode *node)
 {
-	unsigned int newsize = list->num + 1;
-	void *mem = realloc(list->blocks, sizeof(BlockNode *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return 0;
-	}
+	void *mem = growNodeArray(list->blocks, list->num, sizeof(BlockNode *));
+	if (!mem) return 0;
 	list->blocks = mem;
-	list->blocks[list->num] = node;
-	list->num = newsize;
+	list->blocks[list->num++] = node;
 	return 1;
 }
 
-/**
- * Deletes a code block list.
- *
- * \param [in,out] list The code block list to delete.
- *
- * \post The memory at \a list and all of its members will be freed.
- */
-void deleteBlockNodeList(BlockNodeList *list)
-{
-	unsigned int n;
-	if (!list) return;
-	for (n = 0; n < list->num; n++)
-		deleteBlockNode(list->blocks[n]);
-	free(list->blocks);
-	free(list);
-}
-
 /**
  * Creates a boolean constant.
  *
@@ -160,13 +233,12 @@ void deleteBlockNodeList(BlockNodeList *list)
  */
 ConstantNode *createBooleanConstantNode(int data)
 {
-	ConstantNode *p = malloc(sizeof(ConstantNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ConstantNode *p = allocNode(sizeof(ConstantNode));
+	if (!p) return NULL;
 	p->type = CT_BOOLEAN;
 	p->data.i = (data != 0);
+	p->tmpl = NULL;
+	p->value = NULL;
 	return p;
 }
 
@@ -181,13 +253,12 @@ ConstantNode *createBooleanConstantNode(int data)
  */
 ConstantNode *createIntegerConstantNode(long long int data)
 {
-	ConstantNode *p = malloc(sizeof(ConstantNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ConstantNode *p = allocNode(sizeof(ConstantNode));
+	if (!p) return NULL;
 	p->type = CT_INTEGER;
 	p->data.i = data;
+	p->tmpl = NULL;
+	p->value = NULL;
 	return p;
 }
 
@@ -202,13 +273,12 @@ ConstantNode *createIntegerConstantNode(long long int data)
  */
 ConstantNode *createFloatConstantNode(float data)
 {
-	ConstantNode *p = malloc(sizeof(ConstantNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ConstantNode *p = allocNode(sizeof(ConstantNode));
+	if (!p) return NULL;
 	p->type = CT_FLOAT;
 	p->data.f = data;
+	p->tmpl = NULL;
+	p->value = NULL;
 	return p;
 }
 
@@ -217,34 +287,85 @@ ConstantNode *createFloatConstantNode(float data)
  *
  * \param [in] data The string constant value.
  *
- * \return A pointer to the string constant whose value is \a data.
+ * \param [in] tmpl The interpolated string constant value, or NULL.
+ *
+ * \note Only one of \a data and \a tmpl should be given.
+ *
+ * \note \a data is interned, so it need not outlive the constant.
+ *
+ * \return A pointer to the string constant whose value is \a data or \a tmpl.
  *
  * \retval NULL Memory allocation failed.
  */
-ConstantNode *createStringConstantNode(char *data)
+ConstantNode *createStringConstantNode(char *data,
+                                       StringTemplateNode *tmpl)
 {
-	ConstantNode *p = malloc(sizeof(ConstantNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
+	ConstantNode *p = NULL;
+	if (data) {
+		data = (char *)internString(data, strlen(data));
+		if (!data) return NULL;
 	}
+	p = allocNode(sizeof(ConstantNode));
+	if (!p) return NULL;
 	p->type = CT_STRING;
 	p->data.s = data;
+	p->tmpl = tmpl;
+	p->value = NULL;
 	return p;
 }
 
 /**
- * Deletes a constant.
+ * Creates an empty interpolated string.
  *
- * \param [in,out] node The constant to delete.
+ * \return A pointer to an interpolated string with no parts.
  *
- * \post The memory at \a node and all of its members will be freed.
+ * \retval NULL Memory allocation failed.
  */
-void deleteConstantNode(ConstantNode *node)
+StringTemplateNode *createStringTemplateNode(void)
 {
-	if (!node) return;
-	if (node->type == CT_STRING) free(node->data.s);
-	free(node);
+	StringTemplateNode *p = allocNode(sizeof(StringTemplateNode));
+	if (!p) return NULL;
+	p->num = 0;
+	p->strs = NULL;
+	p->vars = NULL;
+	return p;
+}
+
+/**
+ * Adds a part to an interpolated string.
+ *
+ * \param [in,out] node The interpolated string to add the part to.
+ *
+ * \param [in] str The literal text of the part.
+ *
+ * \param [in] var The variable interpolated after \a str, or NULL.
+ *
+ * \note \a str is interned, so it need not outlive the part.
+ *
+ * \post \a str and \a var will be added to \a node and its size will be
+ * updated.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The part was added to \a node.
+ */
+int addStringTemplatePart(StringTemplateNode *node,
+                          char *str,
+                          ExprNode *var)
+{
+	void *mem1 = NULL, *mem2 = NULL;
+	str = (char *)internString(str, strlen(str));
+	if (!str) return 0;
+	mem1 = growNodeArray(node->strs, node->num, sizeof(char *));
+	if (!mem1) return 0;
+	node->strs = mem1;
+	mem2 = growNodeArray(node->vars, node->num, sizeof(ExprNode *));
+	if (!mem2) return 0;
+	node->vars = mem2;
+	node->strs[node->num] = str;
+	node->vars[node->num] = var;
+	node->num++;
+	return 1;
 }
 
 /**
@@ -260,6 +381,12 @@ void deleteConstantNode(ConstantNode *node)
  *
  * \param [in] line The line the identifier occurred on.
  *
+ * \note \a fname is not copied because only one copy is stored for all
+ * identifiers; it must outlive the identifier.
+ *
+ * \note The names of direct identifiers are interned, so \a id need not
+ * outlive a direct identifier.
+ *
  * \return A pointer to the identifier with the desired properties.
  *
  * \retval NULL Memory allocation failed.
@@ -270,53 +397,24 @@ IdentifierNode *createIdentifierNode(IdentifierType type,
                                      const char *fname,
                                      unsigned int line)
 {
-	IdentifierNode *p = malloc(sizeof(IdentifierNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
+	IdentifierNode *p = NULL;
+	if (type == IT_DIRECT) {
+		id = (void *)internString(id, strlen(id));
+		if (!id) return NULL;
 	}
+	p = allocNode(sizeof(IdentifierNode));
+	if (!p) return NULL;
 	p->type = type;
 	p->id = id;
 	p->slot = slot;
-	if (fname) {
-		p->fname = malloc(sizeof(char) * (strlen(fname) + 1));
-		strcpy(p->fname, fname);
-	}
-	else {
-		p->fname = NULL;
-	}
+	/* Bindings are filled in later by the resolver */
+	p->depth = -1;
+	p->index = 0;
+	p->fname = fname;
 	p->line = line;
 	return p;
 }
 
-/**
- * Deletes an identifier.
- *
- * \param [in,out] node The identifier to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteIdentifierNode(IdentifierNode *node)
-{
-	if (!node) return;
-	switch (node->type) {
-		case IT_DIRECT: {
-			free(node->id);
-			break;
-		}
-		case IT_INDIRECT: {
-			deleteExprNode(node->id);
-			break;
-		}
-		default:
-			error(PR_UNKNOWN_IDENTIFIER_TYPE, node->fname, node->line);
-			break;
-	}
-	if (node->slot) deleteIdentifierNode(node->slot);
-	if (node->fname) free(node->fname);
-	free(node);
-}
-
 /**
  * Creates an identifier list.
  *
@@ -326,11 +424,8 @@ void deleteIdentifierNode(IdentifierNode *node)
  */
 IdentifierNodeList *createIdentifierNodeList(void)
 {
-	IdentifierNodeList *p = malloc(sizeof(IdentifierNodeList));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	IdentifierNodeList *p = allocNode(sizeof(IdentifierNodeList));
+	if (!p) return NULL;
 	p->num = 0;
 	p->ids = NULL;
 	return p;
@@ -353,35 +448,13 @@ IdentifierNodeList *createIdentifierNodeList(void)
 int addIdentifierNode(IdentifierNodeList *list,
                       IdentifierNode *node)
 {
-	unsigned int newsize = list->num + 1;
-	void *mem = realloc(list->ids, sizeof(IdentifierNode *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return 0;
-	}
+	void *mem = growNodeArray(list->ids, list->num, sizeof(IdentifierNode *));
+	if (!mem) return 0;
 	list->ids = mem;
-	list->ids[list->num] = node;
-	list->num = newsize;
+	list->ids[list->num++] = node;
 	return 1;
 }
 
-/**
- * Deletes an identifier list.
- *
- * \param [in,out] list The list of identifiers to delete.
- *
- * \post The memory at \a list and all of its members will be freed.
- */
-void deleteIdentifierNodeList(IdentifierNodeList *list)
-{
-	unsigned int n;
-	if (!list) return;
-	for (n = 0; n < list->num; n++)
-		deleteIdentifierNode(list->ids[n]);
-	free(list->ids);
-	free(list);
-}
-
 /**
  * Creates a type.
  *
@@ -393,28 +466,12 @@ void deleteIdentifierNodeList(IdentifierNodeList *list)
  */
 TypeNode *createTypeNode(ConstantType type)
 {
-	TypeNode *p = malloc(sizeof(TypeNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	TypeNode *p = allocNode(sizeof(TypeNode));
+	if (!p) return NULL;
 	p->type = type;
 	return p;
 }
 
-/**
- * Deletes a type.
- *
- * \param [in,out] node The type to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteTypeNode(TypeNode *node)
-{
-	if (!node) return;
-	free(node);
-}
-
 /**
  * Creates a statement.
  *
@@ -429,101 +486,15 @@ void deleteTypeNode(TypeNode *node)
 StmtNode *createStmtNode(StmtType type,
                          void *stmt)
 {
-	StmtNode *p = malloc(sizeof(StmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	StmtNode *p = allocNode(sizeof(StmtNode));
+	if (!p) return NULL;
 	p->type = type;
 	p->stmt = stmt;
+	p->fname = NULL;
+	p->line = 0;
 	return p;
 }
 
-/**
- * Deletes a statement.
- *
- * \param [in,out] node The statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteStmtNode(StmtNode *node)
-{
-	if (!node) return;
-	switch (node->type) {
-		case ST_CAST: {
-			CastStmtNode *stmt = (CastStmtNode *)node->stmt;
-			deleteCastStmtNode(stmt);
-			break;
-		}
-		case ST_PRINT: {
-			PrintStmtNode *stmt = (PrintStmtNode *)node->stmt;
-			deletePrintStmtNode(stmt);
-			break;
-		}
-		case ST_INPUT: {
-			InputStmtNode *stmt = (InputStmtNode *)node->stmt;
-			deleteInputStmtNode(stmt);
-			break;
-		}
-		case ST_ASSIGNMENT: {
-			AssignmentStmtNode *stmt = (AssignmentStmtNode *)node->stmt;
-			deleteAssignmentStmtNode(stmt);
-			break;
-		}
-		case ST_DECLARATION: {
-			DeclarationStmtNode *stmt = (DeclarationStmtNode *)node->stmt;
-			deleteDeclarationStmtNode(stmt);
-			break;
-		}
-		case ST_IFTHENELSE: {
-			IfThenElseStmtNode *stmt = (IfThenElseStmtNode *)node->stmt;
-			deleteIfThenElseStmtNode(stmt);
-			break;
-		}
-		case ST_SWITCH: {
-			SwitchStmtNode *stmt = (SwitchStmtNode *)node->stmt;
-			deleteSwitchStmtNode(stmt);
-			break;
-		}
-		case ST_BREAK:
-			break; /* This statement type does not have any content */
-		case ST_RETURN: {
-			ReturnStmtNode *stmt = (ReturnStmtNode *)node->stmt;
-			deleteReturnStmtNode(stmt);
-			break;
-		}
-		case ST_LOOP: {
-			LoopStmtNode *stmt = (LoopStmtNode *)node->stmt;
-			deleteLoopStmtNode(stmt);
-			break;
-		}
-		case ST_DEALLOCATION: {
-			DeallocationStmtNode *stmt = (DeallocationStmtNode *)node->stmt;
-			deleteDeallocationStmtNode(stmt);
-			break;
-		}
-		case ST_FUNCDEF: {
-			FuncDefStmtNode *stmt = (FuncDefStmtNode *)node->stmt;
-			deleteFuncDefStmtNode(stmt);
-			break;
-		}
-		case ST_EXPR: {
-			ExprNode *expr = (ExprNode *)node->stmt;
-			deleteExprNode(expr);
-			break;
-		}
-		case ST_ALTARRAYDEF: {
-			AltArrayDefStmtNode *stmt = (AltArrayDefStmtNode *)node->stmt;
-			deleteAltArrayDefStmtNode(stmt);
-			break;
-		}
-		default:
-			error(PR_UNKNOWN_STATEMENT_TYPE);
-			break;
-	}
-	free(node);
-}
-
 /**
  * Creates an empty statement list.
  *
@@ -533,11 +504,8 @@ void deleteStmtNode(StmtNode *node)
  */
 StmtNodeList *createStmtNodeList(void)
 {
-	StmtNodeList *p = malloc(sizeof(StmtNodeList));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	StmtNodeList *p = allocNode(sizeof(StmtNodeList));
+	if (!p) return NULL;
 	p->num = 0;
 	p->stmts = NULL;
 	return p;
@@ -559,35 +527,13 @@ StmtNodeList *createStmtNodeList(void)
 int addStmtNode(StmtNodeList *list,
                 StmtNode *node)
 {
-	unsigned int newsize = list->num + 1;
-	void *mem = realloc(list->stmts, sizeof(StmtNode *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return 0;
-	}
+	void *mem = growNodeArray(list->stmts, list->num, sizeof(StmtNode *));
+	if (!mem) return 0;
 	list->stmts = mem;
-	list->stmts[list->num] = node;
-	list->num = newsize;
+	list->stmts[list->num++] = node;
 	return 1;
 }
 
-/**
- * Deletes a statement list.
- *
- * \param [in,out] list The statement list to delete.
- *
- * \post The memory at \a list and all of its members will be freed.
- */
-void deleteStmtNodeList(StmtNodeList *list)
-{
-	unsigned int n;
-	if (!list) return;
-	for (n = 0; n < list->num; n++)
-		deleteStmtNode(list->stmts[n]);
-	free(list->stmts);
-	free(list);
-}
-
 /**
  * Creates a cast statement.
  *
@@ -602,31 +548,13 @@ void deleteStmtNodeList(StmtNodeList *list)
 CastStmtNode *createCastStmtNode(IdentifierNode *target,
                                  TypeNode *newtype)
 {
-	CastStmtNode *p = malloc(sizeof(CastStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	CastStmtNode *p = allocNode(sizeof(CastStmtNode));
+	if (!p) return NULL;
 	p->target = target;
 	p->newtype = newtype;
 	return p;
 }
 
-/**
- * Deletes a cast statement.
- *
- * \param [in,out] node The cast statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteCastStmtNode(CastStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->target);
-	deleteTypeNode(node->newtype);
-	free(node);
-}
-
 /**
  * Creates a print statement.
  *
@@ -641,30 +569,13 @@ void deleteCastStmtNode(CastStmtNode *node)
 PrintStmtNode *createPrintStmtNode(ExprNodeList *args,
                                    int nonl)
 {
-	PrintStmtNode *p = malloc(sizeof(PrintStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	PrintStmtNode *p = allocNode(sizeof(PrintStmtNode));
+	if (!p) return NULL;
 	p->args = args;
 	p->nonl = nonl;
 	return p;
 }
 
-/**
- * Deletes a print statement.
- *
- * \param [in,out] node The print statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deletePrintStmtNode(PrintStmtNode *node)
-{
-	if (!node) return;
-	deleteExprNodeList(node->args);
-	free(node);
-}
-
 /**
  * Creates an input statement.
  *
@@ -676,29 +587,12 @@ void deletePrintStmtNode(PrintStmtNode *node)
  */
 InputStmtNode *createInputStmtNode(IdentifierNode *target)
 {
-	InputStmtNode *p = malloc(sizeof(InputStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	InputStmtNode *p = allocNode(sizeof(InputStmtNode));
+	if (!p) return NULL;
 	p->target = target;
 	return p;
 }
 
-/**
- * Deletes an input statement.
- *
- * \param [in,out] node The input statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteInputStmtNode(InputStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->target);
-	free(node);
-}
-
 /**
  * Creates an assignment statement.
  *
@@ -713,31 +607,13 @@ void deleteInputStmtNode(InputStmtNode *node)
 AssignmentStmtNode *createAssignmentStmtNode(IdentifierNode *target,
                                              ExprNode *expr)
 {
-	AssignmentStmtNode *p = malloc(sizeof(AssignmentStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	AssignmentStmtNode *p = allocNode(sizeof(AssignmentStmtNode));
+	if (!p) return NULL;
 	p->target = target;
 	p->expr = expr;
 	return p;
 }
 
-/**
- * Deletes an assignment statement.
- *
- * \param [in,out] node The assignment statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteAssignmentStmtNode(AssignmentStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->target);
-	deleteExprNode(node->expr);
-	free(node);
-}
-
 /**
  * Creates a declaration statement.
  *
@@ -761,11 +637,8 @@ DeclarationStmtNode *createDeclarationStmtNode(IdentifierNode *scope,
                                                TypeNode *type,
                                                IdentifierNode *parent)
 {
-	DeclarationStmtNode *p = malloc(sizeof(DeclarationStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	DeclarationStmtNode *p = allocNode(sizeof(DeclarationStmtNode));
+	if (!p) return NULL;
 	p->scope = scope;
 	p->target = target;
 	p->expr = expr;
@@ -774,24 +647,6 @@ DeclarationStmtNode *createDeclarationStmtNode(IdentifierNode *scope,
 	return p;
 }
 
-/**
- * Deletes a declaration statement.
- *
- * \param [in,out] node The declaration statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteDeclarationStmtNode(DeclarationStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->scope);
-	deleteIdentifierNode(node->target);
-	deleteExprNode(node->expr);
-	deleteTypeNode(node->type);
-	deleteIdentifierNode(node->parent);
-	free(node);
-}
-
 /**
  * Creates an if/then/else statement.
  *
@@ -816,11 +671,8 @@ IfThenElseStmtNode *createIfThenElseStmtNode(BlockNode *yes,
                                              ExprNodeList *guards,
                                              BlockNodeList *blocks)
 {
-	IfThenElseStmtNode *p = malloc(sizeof(IfThenElseStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	IfThenElseStmtNode *p = allocNode(sizeof(IfThenElseStmtNode));
+	if (!p) return NULL;
 	p->yes = yes;
 	p->no = no;
 	p->guards = guards;
@@ -828,23 +680,6 @@ IfThenElseStmtNode *createIfThenElseStmtNode(BlockNode *yes,
 	return p;
 }
 
-/**
- * Deletes an if/then/else statement.
- *
- * \param [in,out] node The if/then/else statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteIfThenElseStmtNode(IfThenElseStmtNode *node)
-{
-	if (!node) return;
-	deleteBlockNode(node->yes);
-	deleteBlockNode(node->no);
-	deleteExprNodeList(node->guards);
-	deleteBlockNodeList(node->blocks);
-	free(node);
-}
-
 /**
  * Creates a switch statement.
  *
@@ -865,65 +700,148 @@ SwitchStmtNode *createSwitchStmtNode(ExprNodeList *guards,
                                      BlockNodeList *blocks,
                                      BlockNode *def)
 {
-	SwitchStmtNode *p = malloc(sizeof(SwitchStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	SwitchStmtNode *p = allocNode(sizeof(SwitchStmtNode));
+	if (!p) return NULL;
 	p->guards = guards;
 	p->blocks = blocks;
 	p->def = def;
+	p->numslots = 0;
+	p->slots = NULL;
+	/* Without an index, guards are searched linearly */
+	indexSwitchStmtNode(p);
 	return p;
 }
 
 /**
- * Deletes a switch statement.
+ * Checks whether two constants match as switch statement guards.
  *
- * \param [in,out] node The switch statement to delete.
+ * \param [in] a The first constant to compare.
  *
- * \post The memory at \a node and all of its members will be freed.
+ * \param [in] b The second constant to compare.
+ *
+ * \retval 0 \a a and \a b do not match.
+ *
+ * \retval 1 \a a and \a b have the same type and equivalent values.
  */
-void deleteSwitchStmtNode(SwitchStmtNode *node)
+int matchConstantNode(ConstantNode *a,
+                      ConstantNode *b)
 {
-	if (!node) return;
-	deleteExprNodeList(node->guards);
-	deleteBlockNodeList(node->blocks);
-	deleteBlockNode(node->def);
-	free(node);
+	if (a->type != b->type) return 0;
+	switch (a->type) {
+		case CT_BOOLEAN:
+		case CT_INTEGER:
+			return a->data.i == b->data.i;
+		case CT_FLOAT:
+			return fabs(a->data.f - b->data.f) < FLT_EPSILON;
+		case CT_STRING:
+			/* String constants are interned */
+			return a->data.s && a->data.s == b->data.s;
+		default:
+			return 0;
+	}
 }
 
 /**
- * Creates a return statement.
+ * Hashes the value of a constant for indexing switch statement guards.
  *
- * \param [in] value The return value.
+ * \param [in] node The constant to hash.
  *
- * \return A pointer to a return statement of the desired properties.
+ * \pre \a node is a boolean, integer, or string constant.
  *
- * \retval NULL Memory allocation failed.
+ * \return The hash of the value of \a node.
  */
-ReturnStmtNode *createReturnStmtNode(ExprNode *value)
+unsigned int hashConstantNode(ConstantNode *node)
 {
-	ReturnStmtNode *p = malloc(sizeof(ReturnStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
+	unsigned int hash;
+	if (node->type == CT_STRING)
+		hash = getInternHash(node->data.s);
+	else {
+		unsigned long long int i = (unsigned long long int)node->data.i;
+		hash = (unsigned int)(i ^ (i >> 32)) * 2654435761u;
 	}
-	p->value = value;
-	return p;
+	return hash;
 }
 
 /**
- * Deletes a return statement.
+ * Indexes the guards of a switch statement by value.
+ *
+ * \param [in,out] node The switch statement to index.
+ *
+ * \post \a node will have an index of its boolean, integer, and string guards.
  *
- * \param [in,out] node The return statement to delete.
+ * \retval 0 Memory allocation failed; \a node will be searched linearly.
  *
- * \post The memory at \a node and all of its members will be freed.
+ * \retval 1 \a node was indexed.
  */
-void deleteReturnStmtNode(ReturnStmtNode *node)
+int indexSwitchStmtNode(SwitchStmtNode *node)
+{
+	unsigned int numslots = 16;
+	unsigned int *slots = NULL;
+	unsigned int n;
+	while (numslots < node->guards->num * 2) numslots *= 2;
+	slots = allocNode(sizeof(unsigned int) * numslots);
+	if (!slots) return 0;
+	memset(slots, 0, sizeof(unsigned int) * numslots);
+	for (n = 0; n < node->guards->num; n++) {
+		ConstantNode *guard = node->guards->exprs[n]->expr;
+		unsigned int h;
+		if (guard->type == CT_FLOAT || (guard->type == CT_STRING && !guard->data.s))
+			continue;
+		h = hashConstantNode(guard) & (numslots - 1);
+		while (slots[h]) h = (h + 1) & (numslots - 1);
+		slots[h] = n + 1;
+	}
+	node->slots = slots;
+	node->numslots = numslots;
+	return 1;
+}
+
+/**
+ * Finds the guard of a switch statement which matches a value.
+ *
+ * \param [in] node The switch statement to search.
+ *
+ * \param [in] value A constant holding the value to match.
+ *
+ * \return The index of the first guard of \a node matching \a value.
+ *
+ * \retval -1 None of the guards of \a node match \a value.
+ */
+int findSwitchGuard(SwitchStmtNode *node,
+                    ConstantNode *value)
+{
+	unsigned int n;
+	if (node->slots && value->type != CT_FLOAT) {
+		unsigned int mask = node->numslots - 1;
+		unsigned int h = hashConstantNode(value) & mask;
+		while ((n = node->slots[h])) {
+			if (matchConstantNode(node->guards->exprs[n - 1]->expr, value))
+				return (int)n - 1;
+			h = (h + 1) & mask;
+		}
+		return -1;
+	}
+	for (n = 0; n < node->guards->num; n++)
+		if (matchConstantNode(node->guards->exprs[n]->expr, value))
+			return (int)n;
+	return -1;
+}
+
+/**
+ * Creates a return statement.
+ *
+ * \param [in] value The return value.
+ *
+ * \return A pointer to a return statement of the desired properties.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+ReturnStmtNode *createReturnStmtNode(ExprNode *value)
 {
-	if (!node) return;
-	deleteExprNode(node->value);
-	free(node);
+	ReturnStmtNode *p = allocNode(sizeof(ReturnStmtNode));
+	if (!p) return NULL;
+	p->value = value;
+	return p;
 }
 
 /**
@@ -949,11 +867,8 @@ LoopStmtNode *createLoopStmtNode(IdentifierNode *name,
                                  ExprNode *update,
                                  BlockNode *body)
 {
-	LoopStmtNode *p = malloc(sizeof(LoopStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	LoopStmtNode *p = allocNode(sizeof(LoopStmtNode));
+	if (!p) return NULL;
 	p->name = name;
 	p->var = var;
 	p->guard = guard;
@@ -962,24 +877,6 @@ LoopStmtNode *createLoopStmtNode(IdentifierNode *name,
 	return p;
 }
 
-/**
- * Deletes a loop statement.
- *
- * \param [in,out] node The loop statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteLoopStmtNode(LoopStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->name);
-	deleteIdentifierNode(node->var);
-	deleteExprNode(node->guard);
-	deleteExprNode(node->update);
-	deleteBlockNode(node->body);
-	free(node);
-}
-
 /**
  * Creates a deallocation statement.
  *
@@ -991,29 +888,12 @@ void deleteLoopStmtNode(LoopStmtNode *node)
  */
 DeallocationStmtNode *createDeallocationStmtNode(IdentifierNode *target)
 {
-	DeallocationStmtNode *p = malloc(sizeof(DeallocationStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	DeallocationStmtNode *p = allocNode(sizeof(DeallocationStmtNode));
+	if (!p) return NULL;
 	p->target = target;
 	return p;
 }
 
-/**
- * Deletes a deallocation statement.
- *
- * \param [in,out] node The deallocation statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteDeallocationStmtNode(DeallocationStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->target);
-	free(node);
-}
-
 /**
  * Creates a function definition statement.
  *
@@ -1035,11 +915,8 @@ FuncDefStmtNode *createFuncDefStmtNode(IdentifierNode *scope,
                                        IdentifierNodeList *args,
                                        BlockNode *body)
 {
-	FuncDefStmtNode *p = malloc(sizeof(FuncDefStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	FuncDefStmtNode *p = allocNode(sizeof(FuncDefStmtNode));
+	if (!p) return NULL;
 	p->scope = scope;
 	p->name = name;
 	p->args = args;
@@ -1047,23 +924,6 @@ FuncDefStmtNode *createFuncDefStmtNode(IdentifierNode *scope,
 	return p;
 }
 
-/**
- * Deletes a function definition statement.
- *
- * \param [in,out] node The function definition statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteFuncDefStmtNode(FuncDefStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->scope);
-	deleteIdentifierNode(node->name);
-	deleteIdentifierNodeList(node->args);
-	deleteBlockNode(node->body);
-	free(node);
-}
-
 /**
  * Creates an alternate array definition statement.
  *
@@ -1082,32 +942,14 @@ AltArrayDefStmtNode *createAltArrayDefStmtNode(IdentifierNode *name,
                                                BlockNode *body,
                                                IdentifierNode *parent)
 {
-	AltArrayDefStmtNode *p = malloc(sizeof(AltArrayDefStmtNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	AltArrayDefStmtNode *p = allocNode(sizeof(AltArrayDefStmtNode));
+	if (!p) return NULL;
 	p->name = name;
 	p->body = body;
 	p->parent = parent;
 	return p;
 }
 
-/**
- * Deletes an alternate array definition statement.
- *
- * \param [in,out] node The alternate array definition statement to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteAltArrayDefStmtNode(AltArrayDefStmtNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->name);
-	deleteBlockNode(node->body);
-	free(node);
-}
-
 /**
  * Creates an expression.
  *
@@ -1122,51 +964,13 @@ void deleteAltArrayDefStmtNode(AltArrayDefStmtNode *node)
 ExprNode *createExprNode(ExprType type,
                          void *expr)
 {
-	ExprNode *p = malloc(sizeof(ExprNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ExprNode *p = allocNode(sizeof(ExprNode));
+	if (!p) return NULL;
 	p->type = type;
 	p->expr = expr;
 	return p;
 }
 
-/**
- * Deletes an expression.
- *
- * \param [in,out] node The expression to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteExprNode(ExprNode *node)
-{
-	if (!node) return;
-	switch (node->type) {
-		case ET_CAST:
-			deleteCastExprNode((CastExprNode *)node->expr);
-			break;
-		case ET_CONSTANT:
-			deleteConstantNode((ConstantNode *)node->expr);
-			break;
-		case ET_IDENTIFIER:
-			deleteIdentifierNode((IdentifierNode *)node->expr);
-			break;
-		case ET_FUNCCALL:
-			deleteFuncCallExprNode((FuncCallExprNode *)node->expr);
-			break;
-		case ET_OP:
-			deleteOpExprNode((OpExprNode *)node->expr);
-			break;
-		case ET_IMPVAR:
-			break; /* This expression type does not have any content */
-		default:
-			error(PR_UNKNOWN_EXPRESSION_TYPE);
-			break;
-	}
-	free(node);
-}
-
 /**
  * Creates an empty expression list.
  *
@@ -1176,11 +980,8 @@ void deleteExprNode(ExprNode *node)
  */
 ExprNodeList *createExprNodeList(void)
 {
-	ExprNodeList *p = malloc(sizeof(ExprNodeList));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	ExprNodeList *p = allocNode(sizeof(ExprNodeList));
+	if (!p) return NULL;
 	p->num = 0;
 	p->exprs = NULL;
 	return p;
@@ -1202,35 +1003,13 @@ ExprNodeList *createExprNodeList(void)
 int addExprNode(ExprNodeList *list,
                 ExprNode *node)
 {
-	unsigned int newsize = list->num + 1;
-	void *mem = realloc(list->exprs, sizeof(ExprNode *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return 0;
-	}
+	void *mem = growNodeArray(list->exprs, list->num, sizeof(ExprNode *));
+	if (!mem) return 0;
 	list->exprs = mem;
-	list->exprs[list->num] = node;
-	list->num = newsize;
+	list->exprs[list->num++] = node;
 	return 1;
 }
 
-/**
- * Deletes an expression list.
- *
- * \param [in,out] list The expression list to delete.
- *
- * \post The memory at \a list and all of its members will be freed.
- */
-void deleteExprNodeList(ExprNodeList *list)
-{
-	unsigned int n;
-	if (!list) return;
-	for (n = 0; n < list->num; n++)
-		deleteExprNode(list->exprs[n]);
-	free(list->exprs);
-	free(list);
-}
-
 /**
  * Creates a cast expression.
  *
@@ -1245,31 +1024,13 @@ void deleteExprNodeList(ExprNodeList *list)
 CastExprNode *createCastExprNode(ExprNode *target,
                                  TypeNode *newtype)
 {
-	CastExprNode *p = malloc(sizeof(CastExprNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	CastExprNode *p = allocNode(sizeof(CastExprNode));
+	if (!p) return NULL;
 	p->target = target;
 	p->newtype = newtype;
 	return p;
 }
 
-/**
- * Deletes a cast expression.
- *
- * \param [in,out] node The cast expression to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteCastExprNode(CastExprNode *node)
-{
-	if (!node) return;
-	deleteExprNode(node->target);
-	deleteTypeNode(node->newtype);
-	free(node);
-}
-
 /**
  * Creates a function call expression.
  *
@@ -1287,33 +1048,16 @@ FuncCallExprNode *createFuncCallExprNode(IdentifierNode *scope,
                                          IdentifierNode *name,
                                          ExprNodeList *args)
 {
-	FuncCallExprNode *p = malloc(sizeof(FuncCallExprNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	FuncCallExprNode *p = allocNode(sizeof(FuncCallExprNode));
+	if (!p) return NULL;
 	p->scope = scope;
 	p->name = name;
 	p->args = args;
+	p->holder = NULL;
+	p->index = 0;
 	return p;
 }
 
-/**
- * Deletes a function call expression.
- *
- * \param [in,out] node The function call expression to delete.
- *
- * \post The memory at \a node and all of its members will be freed.
- */
-void deleteFuncCallExprNode(FuncCallExprNode *node)
-{
-	if (!node) return;
-	deleteIdentifierNode(node->scope);
-	deleteIdentifierNode(node->name);
-	deleteExprNodeList(node->args);
-	free(node);
-}
-
 /**
  * Creates an operation expression.
  *
@@ -1328,28 +1072,30 @@ void deleteFuncCallExprNode(FuncCallExprNode *node)
 OpExprNode *createOpExprNode(OpType type,
                              ExprNodeList *args)
 {
-	OpExprNode *p = malloc(sizeof(OpExprNode));
-	if (!p) {
-		perror("malloc");
-		return NULL;
-	}
+	OpExprNode *p = allocNode(sizeof(OpExprNode));
+	if (!p) return NULL;
 	p->type = type;
+	p->quick = OQ_UNSEEN;
 	p->args = args;
 	return p;
 }
 
 /**
- * Deletes an operation expression.
+ * Gets the token at a position in a stream.  Tokens which have already been
+ * read are returned directly, since the parser checks them very often.
  *
- * \param [in,out] node The operation expression to delete.
+ * \param [in,out] stream The stream to get the token from.
  *
- * \post The memory at \a node and all of its members will be freed.
+ * \param [in] pos The position of the token within \a stream.
+ *
+ * \return The token at \a pos (see getStreamToken()).
  */
-void deleteOpExprNode(OpExprNode *node)
+static Token *getToken(TokenStream *stream,
+                       unsigned int pos)
 {
-	if (!node) return;
-	deleteExprNodeList(node->args);
-	free(node);
+	unsigned int n = pos - stream->base;
+	if (n < stream->num) return stream->tokens[n];
+	return getStreamToken(stream, pos);
 }
 
 /**
@@ -1367,13 +1113,12 @@ void deleteOpExprNode(OpExprNode *node)
  *
  * \retval 1 The type of \a tokenp is not \a token.
  */
-int acceptToken(Token ***tokenp,
+int acceptToken(TokenCursor *tokenp,
                 TokenType token)
 {
-	Token **tokens = *tokenp;
-	if ((*tokens)->type != token) return 0;
-	tokens++;
-	*tokenp = tokens;
+	Token *next = getToken(tokenp->stream, tokenp->pos);
+	if (!next || next->type != token) return 0;
+	tokenp->pos++;
 	return 1;
 }
 
@@ -1390,11 +1135,11 @@ int acceptToken(Token ***tokenp,
  *
  * \retval 1 The type of \a tokenp is not \a token.
  */
-int peekToken(Token ***tokenp,
+int peekToken(TokenCursor *tokenp,
               TokenType token)
 {
-	Token **tokens = *tokenp;
-	if ((*tokens)->type != token) return 0;
+	Token *next = getToken(tokenp->stream, tokenp->pos);
+	if (!next || next->type != token) return 0;
 	return 1;
 }
 
@@ -1411,11 +1156,11 @@ int peekToken(Token ***tokenp,
  *
  * \retval 1 The type of the token after \a tokenp is not \a token.
  */
-int nextToken(Token ***tokenp,
+int nextToken(TokenCursor *tokenp,
          TokenType token)
 {
-	Token **tokens = *tokenp;
-	if ((*(tokens + 1))->type != token) return 0;
+	Token *next = getToken(tokenp->stream, tokenp->pos + 1);
+	if (!next || next->type != token) return 0;
 	return 1;
 }
 
@@ -1428,9 +1173,9 @@ int nextToken(Token ***tokenp,
  * \param [in] tokens The tokens being parsed when the error occurred.
  */
 void parser_error(ErrorType type,
-                  Token **tokens)
+                  TokenCursor tokens)
 {
-	error(type, (*tokens)->fname, (*tokens)->line, (*tokens)->image);
+	error(type, getCursorToken(tokens)->fname, getCursorToken(tokens)->line, getCursorToken(tokens)->image);
 }
 
 /**
@@ -1442,13 +1187,13 @@ void parser_error(ErrorType type,
  * \param [in] tokens The tokens being parsed when the error occurred.
  */
 void parser_error_expected_token(TokenType token,
-                                 Token **tokens)
+                                 TokenCursor tokens)
 {
 	error(PR_EXPECTED_TOKEN,
-			(*tokens)->fname,
-			(*tokens)->line,
+			getCursorToken(tokens)->fname,
+			getCursorToken(tokens)->line,
 			keywords[token],
-			(*tokens)->image);
+			getCursorToken(tokens)->image);
 }
 
 /**
@@ -1463,14 +1208,182 @@ void parser_error_expected_token(TokenType token,
  */
 void parser_error_expected_either_token(TokenType token1,
                                         TokenType token2,
-                                        Token **tokens)
+                                        TokenCursor tokens)
 {
 	error(PR_EXPECTED_TOKEN,
-			(*tokens)->fname,
-			(*tokens)->line,
+			getCursorToken(tokens)->fname,
+			getCursorToken(tokens)->line,
 			keywords[token1],
 			keywords[token2],
-			(*tokens)->image);
+			getCursorToken(tokens)->image);
+}
+
+/**
+ * Parses the contents of a string literal into a string constant.  Escape
+ * sequences and Unicode characters are replaced and interpolated variables are
+ * parsed into expressions here so that the string does not need to be scanned
+ * again each time it is interpreted.
+ *
+ * \param [in] image The contents of the string literal, without its quotes.
+ *
+ * \param [in] tokens The string literal token, used for reporting errors.
+ *
+ * \return A pointer to a string constant.
+ *
+ * \retval NULL Unable to parse.
+ */
+ConstantNode *parseStringConstantNode(const char *image,
+                                      TokenCursor tokens)
+{
+	ConstantNode *ret = NULL;
+	StringTemplateNode *tmpl = NULL;
+	ExprNode *var = NULL;
+	char *name = NULL;
+	char *str = NULL;
+	const char *b = image;
+	size_t size = strlen(image) + 1;
+	size_t a = 0;
+	char *data = malloc(sizeof(char) * size);
+	if (!data) {
+		perror("malloc");
+		goto parseStringConstantNodeAbort;
+	}
+	while (*b != '\0') {
+		const char *start = b + 2;
+		const char *end = NULL;
+		if (*b != ':') {
+			data[a++] = *b++;
+			continue;
+		}
+		switch (b[1]) {
+			case ')':
+				data[a++] = '\n';
+				b += 2;
+				break;
+			case '>':
+				data[a++] = '\t';
+				b += 2;
+				break;
+			case 'o':
+				data[a++] = '\a';
+				b += 2;
+				break;
+			case '"':
+				data[a++] = '"';
+				b += 2;
+				break;
+			case ':':
+				data[a++] = ':';
+				b += 2;
+				break;
+			case '(':
+			case '[': {
+				long codepoint;
+				char out[4];
+				size_t len, num;
+				void *mem = NULL;
+				end = strchr(start, b[1] == '(' ? ')' : ']');
+				if (!end) {
+					parser_error(b[1] == '('
+							? PR_EXPECTED_CLOSING_PAREN
+							: PR_EXPECTED_CLOSING_SQUARE_BRACKET,
+							tokens);
+					goto parseStringConstantNodeAbort;
+				}
+				len = (size_t)(end - start);
+				name = malloc(sizeof(char) * (len + 1));
+				if (!name) {
+					perror("malloc");
+					goto parseStringConstantNodeAbort;
+				}
+				strncpy(name, start, len);
+				name[len] = '\0';
+				if (b[1] == '(') {
+					if (len == 0 || strspn(name, "0123456789ABCDEF") != len) {
+						parser_error(PR_INVALID_HEX_NUMBER, tokens);
+						goto parseStringConstantNodeAbort;
+					}
+					codepoint = strtol(name, NULL, 16);
+				}
+				else
+					codepoint = convertNormativeNameToCodePoint(name);
+				free(name);
+				name = NULL;
+				if (codepoint < 0
+						|| !(num = convertCodePointToUTF8((unsigned long)codepoint, out))) {
+					parser_error(PR_INVALID_CODE_POINT, tokens);
+					goto parseStringConstantNodeAbort;
+				}
+				size += num;
+				mem = realloc(data, sizeof(char) * size);
+				if (!mem) {
+					perror("realloc");
+					goto parseStringConstantNodeAbort;
+				}
+				data = mem;
+				memcpy(data + a, out, num);
+				a += num;
+				b = end + 1;
+				break;
+			}
+			case '{': {
+				size_t len;
+				end = strchr(start, '}');
+				if (!end) {
+					parser_error(PR_EXPECTED_CLOSING_CURLY_BRACE, tokens);
+					goto parseStringConstantNodeAbort;
+				}
+				len = (size_t)(end - start);
+				if (len == 2 && !strncmp(start, "IT", 2)) {
+					/* Refer to the implicit variable */
+					var = createExprNode(ET_IMPVAR, NULL);
+					if (!var) goto parseStringConstantNodeAbort;
+				}
+				else {
+					IdentifierNode *id = NULL;
+					const char *temp = internString(start, len);
+					if (!temp) goto parseStringConstantNodeAbort;
+					id = createIdentifierNode(IT_DIRECT, (void *)temp, NULL, getCursorToken(tokens)->fname, getCursorToken(tokens)->line);
+					if (!id) goto parseStringConstantNodeAbort;
+					var = createExprNode(ET_IDENTIFIER, id);
+					if (!var) goto parseStringConstantNodeAbort;
+				}
+				/* End the current part with the variable */
+				if (!tmpl && !(tmpl = createStringTemplateNode()))
+					goto parseStringConstantNodeAbort;
+				if (!(str = copyNodeString(data, a)))
+					goto parseStringConstantNodeAbort;
+				if (!addStringTemplatePart(tmpl, str, var))
+					goto parseStringConstantNodeAbort;
+				/* Start the next part, reusing the buffer */
+				b = end + 1;
+				a = 0;
+				break;
+			}
+			default:
+				data[a++] = *b++;
+				break;
+		}
+	}
+	if (!(str = copyNodeString(data, a)))
+		goto parseStringConstantNodeAbort;
+	if (tmpl) {
+		if (!addStringTemplatePart(tmpl, str, NULL))
+			goto parseStringConstantNodeAbort;
+		str = NULL;
+	}
+	ret = createStringConstantNode(str, tmpl);
+	if (!ret) goto parseStringConstantNodeAbort;
+	free(data);
+	return ret;
+
+parseStringConstantNodeAbort: /* Exception handling */
+
+	/* Clean up any allocated structures */
+	if (data) free(data);
+	if (name) free(name);
+
+	return NULL;
 }
 
 /**
@@ -1484,14 +1397,14 @@ void parser_error_expected_either_token(TokenType token1,
  *
  * \retval NULL Unable to parse.
  */
-ConstantNode *parseConstantNode(Token ***tokenp)
+ConstantNode *parseConstantNode(TokenCursor *tokenp)
 {
 	ConstantNode *ret = NULL;
 	char *data = NULL;
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	shiftout();
@@ -1503,7 +1416,7 @@ ConstantNode *parseConstantNode(Token ***tokenp)
 		debug("CT_BOOLEAN");
 #endif
 		/* Create the ConstantNode structure */
-		ret = createBooleanConstantNode((*tokens)->data.i);
+		ret = createBooleanConstantNode(getCursorToken(tokens)->data.i);
 		if (!ret) goto parseConstantNodeAbort;
 
 		/* This should succeed; it was checked for above */
@@ -1519,7 +1432,7 @@ ConstantNode *parseConstantNode(Token ***tokenp)
 		debug("CT_INTEGER");
 #endif
 		/* Create the ConstantNode structure */
-		ret = createIntegerConstantNode((*tokens)->data.i);
+		ret = createIntegerConstantNode(getCursorToken(tokens)->data.i);
 		if (!ret) goto parseConstantNodeAbort;
 
 		/* This should succeed; it was checked for above */
@@ -1535,7 +1448,7 @@ ConstantNode *parseConstantNode(Token ***tokenp)
 		debug("CT_FLOAT");
 #endif
 		/* Create the ConstantNode structure */
-		ret = createFloatConstantNode((*tokens)->data.f);
+		ret = createFloatConstantNode(getCursorToken(tokens)->data.f);
 		if (!ret) goto parseConstantNodeAbort;
 
 		/* This should succeed; it was checked for above */
@@ -1547,20 +1460,21 @@ ConstantNode *parseConstantNode(Token ***tokenp)
 	}
 	/* String */
 	else if (peekToken(&tokens, TT_STRING)) {
-		size_t len = strlen((*tokens)->image);
+		size_t len = strlen(getCursorToken(tokens)->image);
 		data = malloc(sizeof(char) * (len - 1));
 		if (!data) {
 			perror("malloc");
 			goto parseConstantNodeAbort;
 		}
-		strncpy(data, (*tokens)->image + 1, len - 2);
+		strncpy(data, getCursorToken(tokens)->image + 1, len - 2);
 		data[len - 2] = '\0';
 #ifdef DEBUG
 		debug("CT_STRING");
 #endif
 		/* Create the ConstantNode structure */
-		ret = createStringConstantNode(data);
+		ret = parseStringConstantNode(data, tokens);
 		if (!ret) goto parseConstantNodeAbort;
+		free(data);
 		data = NULL;
 
 		/* This should succeed; it was checked for above */
@@ -1587,7 +1501,6 @@ parseConstantNodeAbort: /* Exception handling */
 
 	/* Clean up any allocated structures */
 	if (data) free(data);
-	if (ret) deleteConstantNode(ret);
 
 	return NULL;
 }
@@ -1603,12 +1516,12 @@ parseConstantNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-TypeNode *parseTypeNode(Token ***tokenp)
+TypeNode *parseTypeNode(TokenCursor *tokenp)
 {
 	TypeNode *ret = NULL;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	shiftout();
@@ -1676,10 +1589,6 @@ TypeNode *parseTypeNode(Token ***tokenp)
 	return ret;
 
 parseTypeNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteTypeNode(ret);
-
 	return NULL;
 }
 
@@ -1694,7 +1603,7 @@ parseTypeNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-IdentifierNode *parseIdentifierNode(Token ***tokenp)
+IdentifierNode *parseIdentifierNode(TokenCursor *tokenp)
 {
 	IdentifierType type = 0 ;
 	void *data = NULL;
@@ -1702,9 +1611,6 @@ IdentifierNode *parseIdentifierNode(Token ***tokenp)
 	const char *fname = NULL;
 	unsigned int line;
 
-	/* For direct identifier */
-	char *temp = NULL;
-
 	/* For indirect identifier */
 	ExprNode *expr = NULL;
 
@@ -1712,14 +1618,14 @@ IdentifierNode *parseIdentifierNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	shiftout();
 #endif
 
-	fname = (*tokens)->fname;
-	line = (*tokens)->line;
+	fname = getCursorToken(tokens)->fname;
+	line = getCursorToken(tokens)->line;
 
 	/* Direct identifier */
 	if (peekToken(&tokens, TT_IDENTIFIER)) {
@@ -1727,11 +1633,8 @@ IdentifierNode *parseIdentifierNode(Token ***tokenp)
 #ifdef DEBUG
 		debug("IT_DIRECT");
 #endif
-		/* Copy the token image */
-		temp = malloc(sizeof(char) * (strlen((*tokens)->image) + 1));
-		if (!temp) goto parseIdentifierNodeAbort;
-		strcpy(temp, (*tokens)->image);
-		data = temp;
+		/* The name is interned when the identifier is created */
+		data = (void *)getCursorToken(tokens)->image;
 
 		/* This should succeed; it was checked for above */
 		status = acceptToken(&tokens, TT_IDENTIFIER);
@@ -1774,19 +1677,6 @@ IdentifierNode *parseIdentifierNode(Token ***tokenp)
 	return ret;
 
 parseIdentifierNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteIdentifierNode(ret);
-	else {
-		/* For indirect identifier */
-		if (expr) deleteExprNode(expr);
-
-		/* For direct identifier */
-		if (temp) free(temp);
-
-		if (slot) deleteIdentifierNode(slot);
-	}
-
 	return NULL;
 }
 
@@ -1801,7 +1691,7 @@ parseIdentifierNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseCastExprNode(Token ***tokenp)
+ExprNode *parseCastExprNode(TokenCursor *tokenp)
 {
 	ExprNode *target = NULL;
 	TypeNode *newtype = NULL;
@@ -1810,7 +1700,7 @@ ExprNode *parseCastExprNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ET_CAST");
@@ -1848,15 +1738,6 @@ ExprNode *parseCastExprNode(Token ***tokenp)
 	return ret;
 
 parseCastExprNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteExprNode(ret);
-	else if (expr) deleteCastExprNode(expr);
-	else {
-		if (newtype) deleteTypeNode(newtype);
-		if (target) deleteExprNode(target);
-	}
-
 	return NULL;
 }
 
@@ -1871,13 +1752,13 @@ parseCastExprNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseConstantExprNode(Token ***tokenp)
+ExprNode *parseConstantExprNode(TokenCursor *tokenp)
 {
 	ConstantNode *node = NULL;
 	ExprNode *ret = NULL;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ET_CONSTANT");
@@ -1897,13 +1778,6 @@ ExprNode *parseConstantExprNode(Token ***tokenp)
 	return ret;
 
 parseConstantExprNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteExprNode(ret);
-	else {
-		if (node) deleteConstantNode(node);
-	}
-
 	return NULL;
 }
 
@@ -1918,13 +1792,13 @@ parseConstantExprNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseIdentifierExprNode(Token ***tokenp)
+ExprNode *parseIdentifierExprNode(TokenCursor *tokenp)
 {
 	IdentifierNode *node = NULL;
 	ExprNode *ret = NULL;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ET_IDENTIFIER");
@@ -1944,13 +1818,6 @@ ExprNode *parseIdentifierExprNode(Token ***tokenp)
 	return ret;
 
 parseIdentifierExprNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteExprNode(ret);
-	else {
-		if (node) deleteIdentifierNode(node);
-	}
-
 	return NULL;
 }
 
@@ -1965,7 +1832,7 @@ parseIdentifierExprNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseFuncCallExprNode(Token ***tokenp)
+ExprNode *parseFuncCallExprNode(TokenCursor *tokenp)
 {
 	IdentifierNode *scope = NULL;
 	IdentifierNode *name = NULL;
@@ -1976,7 +1843,7 @@ ExprNode *parseFuncCallExprNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ET_FUNCCALL");
@@ -2046,17 +1913,6 @@ ExprNode *parseFuncCallExprNode(Token ***tokenp)
 	return ret;
 
 parseFuncCallExprNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteExprNode(ret);
-	else if (expr) deleteFuncCallExprNode(expr);
-	else {
-		if (args) deleteExprNodeList(args);
-		if (arg) deleteExprNode(arg);
-		if (name) deleteIdentifierNode(name);
-		if (scope) deleteIdentifierNode(scope);
-	}
-
 	return NULL;
 }
 
@@ -2071,7 +1927,7 @@ parseFuncCallExprNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseOpExprNode(Token ***tokenp)
+ExprNode *parseOpExprNode(TokenCursor *tokenp)
 {
 	enum ArityType {
 		AT_UNARY,
@@ -2087,7 +1943,7 @@ ExprNode *parseOpExprNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 	/* Unary operations */
 	if (acceptToken(&tokens, TT_NOT)) {
@@ -2280,15 +2136,6 @@ ExprNode *parseOpExprNode(Token ***tokenp)
 	return ret;
 
 parseOpExprNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteExprNode(ret);
-	else if (expr) deleteOpExprNode(expr);
-	else {
-		if (arg) deleteExprNode(arg);
-		if (args) deleteExprNodeList(args);
-	}
-
 	return NULL;
 }
 
@@ -2303,9 +2150,9 @@ parseOpExprNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-ExprNode *parseExprNode(Token ***tokenp)
+ExprNode *parseExprNode(TokenCursor *tokenp)
 {
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 	ExprNode *ret = NULL;
 
 #ifdef DEBUG
@@ -2315,14 +2162,13 @@ ExprNode *parseExprNode(Token ***tokenp)
 	/* Parse context-sensitive expressions */
 	if (peekToken(&tokens, TT_IDENTIFIER)
 			|| peekToken(&tokens, TT_SRS)) {
-		IdentifierNode *id = NULL;
+		ArenaMark mark = markNodes();
 
 		/* Remove the identifier from the token stream */
-		id = parseIdentifierNode(&tokens);
-		if (!id) return NULL;
+		if (!parseIdentifierNode(&tokens)) return NULL;
 
 		/* We do not need to hold onto it */
-		deleteIdentifierNode(id);
+		releaseNodes(mark);
 
 		/* Function call (must come before identifier) */
 		if (peekToken(&tokens, TT_IZ)) {
@@ -2397,7 +2243,7 @@ ExprNode *parseExprNode(Token ***tokenp)
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseCastStmtNode(Token ***tokenp)
+StmtNode *parseCastStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *target = NULL;
 	TypeNode *newtype = NULL;
@@ -2406,7 +2252,7 @@ StmtNode *parseCastStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_CAST");
@@ -2448,15 +2294,6 @@ StmtNode *parseCastStmtNode(Token ***tokenp)
 	return ret;
 
 parseCastStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteCastStmtNode(stmt);
-	else {
-		if (newtype) deleteTypeNode(newtype);
-		if (target) deleteIdentifierNode(target);
-	}
-
 	return NULL;
 }
 
@@ -2471,7 +2308,7 @@ parseCastStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parsePrintStmtNode(Token ***tokenp)
+StmtNode *parsePrintStmtNode(TokenCursor *tokenp)
 {
 	ExprNode *arg = NULL;
 	ExprNodeList *args = NULL;
@@ -2481,7 +2318,7 @@ StmtNode *parsePrintStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_PRINT");
@@ -2536,15 +2373,6 @@ StmtNode *parsePrintStmtNode(Token ***tokenp)
 	return ret;
 
 parsePrintStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deletePrintStmtNode(stmt);
-	else {
-		if (arg) deleteExprNode(arg);
-		if (args) deleteExprNodeList(args);
-	}
-
 	return NULL;
 }
 
@@ -2559,7 +2387,7 @@ parsePrintStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseInputStmtNode(Token ***tokenp)
+StmtNode *parseInputStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *target = NULL;
 	InputStmtNode *stmt = NULL;
@@ -2567,7 +2395,7 @@ StmtNode *parseInputStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_INPUT");
@@ -2605,14 +2433,6 @@ StmtNode *parseInputStmtNode(Token ***tokenp)
 	return ret;
 
 parseInputStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteInputStmtNode(stmt);
-	else {
-		if (target) deleteIdentifierNode(target);
-	}
-
 	return NULL;
 }
 
@@ -2627,7 +2447,7 @@ parseInputStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL unable to parse.
  */ 
-StmtNode *parseAssignmentStmtNode(Token ***tokenp)
+StmtNode *parseAssignmentStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *target = NULL;
 	ExprNode *expr = NULL;
@@ -2636,7 +2456,7 @@ StmtNode *parseAssignmentStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_ASSIGNMENT");
@@ -2677,15 +2497,6 @@ StmtNode *parseAssignmentStmtNode(Token ***tokenp)
 	return ret;
 
 parseAssignmentStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteAssignmentStmtNode(stmt);
-	else {
-		if (expr) deleteExprNode(expr);
-		if (target) deleteIdentifierNode(target);
-	}
-
 	return NULL;
 }
 
@@ -2700,7 +2511,7 @@ parseAssignmentStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseDeclarationStmtNode(Token ***tokenp)
+StmtNode *parseDeclarationStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *scope = NULL;
 	IdentifierNode *target = NULL;
@@ -2712,7 +2523,7 @@ StmtNode *parseDeclarationStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_DECLARATION");
@@ -2772,17 +2583,6 @@ StmtNode *parseDeclarationStmtNode(Token ***tokenp)
 	return ret;
 
 parseDeclarationStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteDeclarationStmtNode(stmt);
-	else {
-		if (type) deleteTypeNode(type);
-		if (expr) deleteExprNode(expr);
-		if (target) deleteIdentifierNode(target);
-		if (scope) deleteIdentifierNode(scope);
-	}
-
 	return NULL;
 }
 
@@ -2797,7 +2597,7 @@ parseDeclarationStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseIfThenElseStmtNode(Token ***tokenp)
+StmtNode *parseIfThenElseStmtNode(TokenCursor *tokenp)
 {
 	BlockNode *yes = NULL;
 	ExprNodeList *guards = NULL;
@@ -2810,7 +2610,7 @@ StmtNode *parseIfThenElseStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_CONDITIONAL");
@@ -2923,19 +2723,6 @@ StmtNode *parseIfThenElseStmtNode(Token ***tokenp)
 	return ret;
 
 parseIfThenElseStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteIfThenElseStmtNode(stmt);
-	else {
-		if (no) deleteBlockNode(no);
-		if (blocks) deleteBlockNodeList(blocks);
-		if (guards) deleteExprNodeList(guards);
-		if (block) deleteBlockNode(block);
-		if (guard) deleteExprNode(guard);
-		if (yes) deleteBlockNode(yes);
-	}
-
 	return NULL;
 }
 
@@ -2950,7 +2737,7 @@ parseIfThenElseStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseSwitchStmtNode(Token ***tokenp)
+StmtNode *parseSwitchStmtNode(TokenCursor *tokenp)
 {
 	ExprNodeList *guards = NULL;
 	BlockNodeList *blocks = NULL;
@@ -2963,7 +2750,7 @@ StmtNode *parseSwitchStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_SWITCH");
@@ -3008,7 +2795,7 @@ StmtNode *parseSwitchStmtNode(Token ***tokenp)
 		if (!c) goto parseSwitchStmtNodeAbort;
 
 		/* String interpolation is not allowed */
-		if (c->type == CT_STRING && strstr(c->data.s, ":{")) {
+		if (c->type == CT_STRING && c->tmpl) {
 			parser_error(PR_CANNOT_USE_STR_AS_LITERAL, tokens);
 			goto parseSwitchStmtNodeAbort;
 		}
@@ -3016,14 +2803,8 @@ StmtNode *parseSwitchStmtNode(Token ***tokenp)
 		/* Make sure the constant is unique to this switch statement */
 		for (n = 0; n < guards->num; n++) {
 			ConstantNode *test = guards->exprs[n]->expr;
-			if (c->type != test->type) continue;
 			/* Check for equivalent types and values */
-			if (((c->type == CT_BOOLEAN || c->type == CT_INTEGER)
-					&& c->data.i == test->data.i)
-					|| (c->type == CT_FLOAT
-					&& fabs(c->data.f - test->data.f) < FLT_EPSILON)
-					|| (c->type == CT_STRING
-					&& !strcmp(c->data.s, test->data.s))) {
+			if (matchConstantNode(c, test)) {
 				parser_error(PR_LITERAL_MUST_BE_UNIQUE, tokens);
 				goto parseSwitchStmtNodeAbort;
 			}
@@ -3097,19 +2878,6 @@ StmtNode *parseSwitchStmtNode(Token ***tokenp)
 	return ret;
 
 parseSwitchStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteSwitchStmtNode(stmt);
-	else {
-		if (def) deleteBlockNode(def);
-		if (block) deleteBlockNode(block);
-		if (guard) deleteExprNode(guard);
-		if (c) deleteConstantNode(c);
-		if (blocks) deleteBlockNodeList(blocks);
-		if (guards) deleteExprNodeList(guards);
-	}
-
 	return NULL;
 }
 
@@ -3124,13 +2892,13 @@ parseSwitchStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseBreakStmtNode(Token ***tokenp)
+StmtNode *parseBreakStmtNode(TokenCursor *tokenp)
 {
 	StmtNode *ret = NULL;
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_BREAK");
@@ -3160,9 +2928,6 @@ StmtNode *parseBreakStmtNode(Token ***tokenp)
 	return ret;
 
 parseBreakStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
 	return NULL;
 }
 
@@ -3177,7 +2942,7 @@ parseBreakStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseReturnStmtNode(Token ***tokenp)
+StmtNode *parseReturnStmtNode(TokenCursor *tokenp)
 {
 	ExprNode *value = NULL;
 	ReturnStmtNode *stmt = NULL;
@@ -3185,7 +2950,7 @@ StmtNode *parseReturnStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_RETURN");
@@ -3223,13 +2988,6 @@ StmtNode *parseReturnStmtNode(Token ***tokenp)
 	return ret;
 
 parseReturnStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteReturnStmtNode(stmt);
-	else {
-		if (value) deleteExprNode(value);
-	}
 	return NULL;
 }
 
@@ -3244,18 +3002,16 @@ parseReturnStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseLoopStmtNode(Token ***tokenp)
+StmtNode *parseLoopStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *name1 = NULL;
 	IdentifierNode *var = NULL;
 	ExprNode *update = NULL;
 	ExprNode *guard = NULL;
 	BlockNode *body = NULL;
-	FuncDefStmtNode *def = NULL;
 	IdentifierNode *name2 = NULL;
 	LoopStmtNode *stmt = NULL;
 	ExprNodeList *args = NULL;
-	char *id = NULL;
 
 	/* For increment and decrement loops */
 	IdentifierNode *varcopy = NULL;
@@ -3279,7 +3035,7 @@ StmtNode *parseLoopStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_LOOP");
@@ -3340,12 +3096,8 @@ StmtNode *parseLoopStmtNode(Token ***tokenp)
 		shiftin();
 #endif
 		/* Make a copy of the variable for use as a function argument */
-		id = malloc(sizeof(char) * (strlen(var->id) + 1));
-		if (!id) goto parseLoopStmtNodeAbort;
-		strcpy(id, var->id);
-		varcopy = createIdentifierNode(IT_DIRECT, id, NULL, var->fname, var->line);
+		varcopy = createIdentifierNode(IT_DIRECT, var->id, NULL, var->fname, var->line);
 		if (!varcopy) goto parseLoopStmtNodeAbort;
-		id = NULL;
 
 		/* Package the variable into an identifier expression */
 		arg1 = createExprNode(ET_IDENTIFIER, varcopy);
@@ -3429,12 +3181,8 @@ StmtNode *parseLoopStmtNode(Token ***tokenp)
 		arg = NULL;
 
 		/* Copy the identifier to make it the loop variable */
-		id = malloc(sizeof(char) * (strlen(temp->id) + 1));
-		if (!id) goto parseLoopStmtNodeAbort;
-		strcpy(id, temp->id);
-		var = createIdentifierNode(IT_DIRECT, id, NULL, temp->fname, temp->line);
+		var = createIdentifierNode(IT_DIRECT, temp->id, NULL, temp->fname, temp->line);
 		if (!var) goto parseLoopStmtNodeAbort;
-		id = NULL;
 
 		/* Check for unary function */
 		status = acceptToken(&tokens, TT_MKAY);
@@ -3523,9 +3271,6 @@ StmtNode *parseLoopStmtNode(Token ***tokenp)
 		goto parseLoopStmtNodeAbort;
 	}
 
-	/* We no longer need the end-of-loop name */
-	deleteIdentifierNode(name2);
-
 	/* The end-of-loop structure should appear on its own line */
 	status = acceptToken(&tokens, TT_NEWLINE);
 	if (!status) {
@@ -3547,39 +3292,6 @@ StmtNode *parseLoopStmtNode(Token ***tokenp)
 	return ret;
 
 parseLoopStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteLoopStmtNode(stmt);
-	else {
-		if (name2) deleteIdentifierNode(name2);
-		if (def) deleteFuncDefStmtNode(def);
-		if (body) deleteBlockNode(body);
-		if (guard) deleteExprNode(guard);
-		if (update) deleteExprNode(update);
-		if (var) deleteIdentifierNode(var);
-		if (name1) deleteIdentifierNode(name1);
-		if (id) free(id);
-
-		/* For increment and decrement loops */
-		if (op) deleteOpExprNode(op);
-		if (args) deleteExprNodeList(args);
-		if (arg2) deleteExprNode(arg2);
-		if (one) deleteConstantNode(one);
-		if (arg1) deleteExprNode(arg1);
-		if (varcopy) deleteIdentifierNode(varcopy);
-
-		/* For function loops */
-		if (arg) deleteExprNode(arg);
-		if (node) deleteFuncCallExprNode(node);
-		if (name) deleteIdentifierNode(name);
-		if (scope) deleteIdentifierNode(scope);
-
-		/* For loop predicates */
-		if (predarg) deleteExprNode(predarg);
-		if (predargs) deleteExprNodeList(predargs);
-		if (predop) deleteOpExprNode(predop);
-	}
 	return NULL;
 }
 
@@ -3594,7 +3306,7 @@ parseLoopStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseDeallocationStmtNode(Token ***tokenp)
+StmtNode *parseDeallocationStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *target = NULL;
 	DeallocationStmtNode *stmt = NULL;
@@ -3602,7 +3314,7 @@ StmtNode *parseDeallocationStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_DEALLOCATION");
@@ -3640,14 +3352,6 @@ StmtNode *parseDeallocationStmtNode(Token ***tokenp)
 	return ret;
 
 parseDeallocationStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteDeallocationStmtNode(stmt);
-	else {
-		if (target) deleteIdentifierNode(target);
-	}
-
 	return NULL;
 }
 
@@ -3662,7 +3366,7 @@ parseDeallocationStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseFuncDefStmtNode(Token ***tokenp)
+StmtNode *parseFuncDefStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *scope = NULL;
 	IdentifierNode *name = NULL;
@@ -3674,7 +3378,7 @@ StmtNode *parseFuncDefStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_FUNCDEF");
@@ -3762,18 +3466,6 @@ StmtNode *parseFuncDefStmtNode(Token ***tokenp)
 	return ret;
 
 parseFuncDefStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteFuncDefStmtNode(stmt);
-	else {
-		if (body) deleteBlockNode(body);
-		if (args) deleteIdentifierNodeList(args);
-		if (arg) deleteIdentifierNode(arg);
-		if (name) deleteIdentifierNode(name);
-		if (scope) deleteIdentifierNode(scope);
-	}
-
 	return NULL;
 }
 
@@ -3788,7 +3480,7 @@ parseFuncDefStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseAltArrayDefStmtNode(Token ***tokenp)
+StmtNode *parseAltArrayDefStmtNode(TokenCursor *tokenp)
 {
 	IdentifierNode *name = NULL;
 	BlockNode *body = NULL;
@@ -3798,7 +3490,7 @@ StmtNode *parseAltArrayDefStmtNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	debug("ST_ALTARRAYDEF");
@@ -3863,15 +3555,6 @@ StmtNode *parseAltArrayDefStmtNode(Token ***tokenp)
 	return ret;
 
 parseAltArrayDefStmtNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (ret) deleteStmtNode(ret);
-	else if (stmt) deleteAltArrayDefStmtNode(stmt);
-	else {
-		if (name) deleteIdentifierNode(name);
-		if (body) deleteBlockNode(body);
-	}
-
 	return NULL;
 }
 
@@ -3886,13 +3569,17 @@ parseAltArrayDefStmtNodeAbort: /* Exception handling */
  *
  * \retval NULL Unable to parse.
  */
-StmtNode *parseStmtNode(Token ***tokenp)
+StmtNode *parseStmtNode(TokenCursor *tokenp)
 {
 	StmtNode *ret = NULL;
 	ExprNode *expr = NULL;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
+
+	/* Statements are located by their first token */
+	const char *fname = getCursorToken(tokens)->fname;
+	unsigned int line = getCursorToken(tokens)->line;
 
 #ifdef DEBUG
 	shiftout();
@@ -3901,14 +3588,13 @@ StmtNode *parseStmtNode(Token ***tokenp)
 	/* Parse context-sensitive expressions */
 	if (peekToken(&tokens, TT_IDENTIFIER)
 			|| peekToken(&tokens, TT_SRS)) {
-		IdentifierNode *id = NULL;
+		ArenaMark mark = markNodes();
 
 		/* Remove the identifier from the token stream */
-		id = parseIdentifierNode(&tokens);
-		if (!id) return NULL;
+		if (!parseIdentifierNode(&tokens)) return NULL;
 
 		/* We do not need to hold onto it */
-		deleteIdentifierNode(id);
+		releaseNodes(mark);
 
 		/* Casting */
 		if (peekToken(&tokens, TT_ISNOWA)) {
@@ -3942,16 +3628,12 @@ StmtNode *parseStmtNode(Token ***tokenp)
 			/* The expression should appear on its own line */
 			if (!acceptToken(&tokens, TT_NEWLINE)) {
 				parser_error(PR_EXPECTED_END_OF_EXPRESSION, tokens);
-				deleteExprNode(expr);
 				return NULL;
 			}
 
 			/* Create the new StmtNode structure */
 			ret = createStmtNode(ST_EXPR, expr);
-			if (!ret) {
-				deleteExprNode(expr);
-				return NULL;
-			}
+			if (!ret) return NULL;
 
 			/* Since we're successful, update the token stream */
 			*tokenp = tokens;
@@ -4005,16 +3687,12 @@ StmtNode *parseStmtNode(Token ***tokenp)
 		status = acceptToken(&tokens, TT_NEWLINE);
 		if (!status) {
 			parser_error(PR_EXPECTED_END_OF_EXPRESSION, tokens);
-			deleteExprNode(expr);
 			return NULL;
 		}
 
 		/* Create the new StmtNode structure */
 		ret = createStmtNode(ST_EXPR, expr);
-		if (!ret) {
-			deleteExprNode(expr);
-			return NULL;
-		}
+		if (!ret) return NULL;
 
 		/* Since we're successful, update the token stream */
 		*tokenp = tokens;
@@ -4023,6 +3701,11 @@ StmtNode *parseStmtNode(Token ***tokenp)
 		parser_error(PR_EXPECTED_STATEMENT, tokens);
 	}
 
+	if (ret) {
+		ret->fname = fname;
+		ret->line = line;
+	}
+
 #ifdef DEBUG
 	shiftin();
 #endif
@@ -4041,7 +3724,7 @@ StmtNode *parseStmtNode(Token ***tokenp)
  *
  * \retval NULL Unable to parse.
  */
-BlockNode *parseBlockNode(Token ***tokenp)
+BlockNode *parseBlockNode(TokenCursor *tokenp)
 {
 	StmtNodeList *stmts = NULL;
 	StmtNode *stmt = NULL;
@@ -4049,7 +3732,7 @@ BlockNode *parseBlockNode(Token ***tokenp)
 	int status;
 
 	/* Work from a copy of the token stream in case something goes wrong */
-	Token **tokens = *tokenp;
+	TokenCursor tokens = *tokenp;
 
 #ifdef DEBUG
 	shiftout();
@@ -4071,6 +3754,9 @@ BlockNode *parseBlockNode(Token ***tokenp)
 			&& !peekToken(&tokens, TT_IMOUTTAYR)
 			&& !peekToken(&tokens, TT_IFUSAYSO)
 			&& !peekToken(&tokens, TT_KTHX)) {
+		/* The tokens of previous statements are no longer needed */
+		releaseStreamTokens(tokens.stream, tokens.pos);
+
 		/* Parse the next statement */
 		stmt = parseStmtNode(&tokens);
 		if (!stmt) goto parseBlockNodeAbort;
@@ -4096,31 +3782,26 @@ BlockNode *parseBlockNode(Token ***tokenp)
 	return block;
 
 parseBlockNodeAbort: /* Exception handling */
-
-	/* Clean up any allocated structures */
-	if (block) deleteBlockNode(block);
-	else {
-		if (stmt) deleteStmtNode(stmt);
-		if (stmts) deleteStmtNodeList(stmts);
-	}
 	return NULL;
 }
 
 /**
  * Parses tokens into a main code block.
  *
- * \param [in] tokens The position in a token list to start parsing at.
+ * \param [in,out] stream The stream of tokens to parse.
  *
- * \post \a tokenp will point to the next unparsed token.
+ * \post The tokens of \a stream will have been read up to the end of the main
+ * block.
  *
  * \return A pointer to a main node block.
  *
  * \retval NULL Unable to parse.
  */
-MainNode *parseMainNode(Token **tokens)
+MainNode *parseMainNode(TokenStream *stream)
 {
 	BlockNode *block = NULL;
 	MainNode *_main = NULL;
+	TokenCursor tokens = { stream, 0 };
 	int status;
 
 	/* All programs must start with the HAI token */
@@ -4131,7 +3812,7 @@ MainNode *parseMainNode(Token **tokens)
 	}
 
 	/* Accept any version */
-	tokens++;
+	tokens.pos++;
 
 #ifdef DEBUG
 	debug("ET_MAINBLOCK");
@@ -4164,8 +3845,7 @@ MainNode *parseMainNode(Token **tokens)
 parseMainNodeAbort: /* In case something goes wrong... */
 
 	/* Clean up any allocated structures */
-	if (_main) deleteMainNode(_main);
-	else if (block) deleteBlockNode(block);
+	discardNodes();
 
 	return NULL;
 }
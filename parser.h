@@ -207,9 +207,14 @@
 #include <float.h>
 
 #include "tokenizer.h"
+#include "pool.h"
+#include "intern.h"
 
 #undef DEBUG
 
+struct valueobject;
+struct scopeobject;
+
 /**
  * Represents a statement type.
  */
@@ -234,8 +239,10 @@ typedef enum {
  * Stores statement data.
  */
 typedef struct {
-	StmtType type; /**< The type of statement in \a node. */
-	void *stmt;    /**< The statement. */
+	StmtType type;     /**< The type of statement in \a node. */
+	void *stmt;        /**< The statement. */
+	const char *fname; /**< The file the statement begins in, or NULL. */
+	unsigned int line; /**< The line the statement begins on. */
 } StmtNode;
 
 /**
@@ -288,9 +295,11 @@ typedef enum {
 typedef struct identifiernode {
 	IdentifierType type;         /**< The type of identifier in \a id. */
 	void *id;                    /**< The identifier. */
-	char *fname;                 /**< The original file name. */
+	const char *fname;           /**< The original file name (not copied). */
 	unsigned int line;           /**< The original line number. */
 	struct identifiernode *slot; /**< The slot to access. */
+	int depth;                   /**< The resolved scope depth (or -1). */
+	unsigned int index;          /**< The resolved value index at \a depth. */
 } IdentifierNode;
 
 /**
@@ -337,12 +346,33 @@ typedef union {
 	char *s;         /**< String data. */
 } ConstantData;
 
+/**
+ * Stores a string constant with interpolated variables.  The string is made up
+ * of \a num parts, each of which is a piece of literal text followed by an
+ * optional interpolated variable.  Escape sequences and Unicode characters
+ * within the literal text have already been replaced.
+ */
+typedef struct {
+	unsigned int num; /**< The number of parts. */
+	char **strs;      /**< The literal text of each part. */
+	ExprNode **vars;  /**< The interpolated variable of each part, or NULL. */
+} StringTemplateNode;
+
 /**
  * Stores a constant.
+ *
+ * \note The data of a string constant has its escape sequences and Unicode
+ * characters replaced.  If the string interpolates any variables, its data is
+ * NULL and its contents are stored in \a tmpl instead.
+ *
+ * \note The optimizer (see optimizer.h) gives each constant a value which is
+ * shared by every evaluation of the constant and lives as long as the tree.
  */
 typedef struct {
-	ConstantType type; /**< The type of constant in \a data. */
-	ConstantData data; /**< The constant. */
+	ConstantType type;          /**< The type of constant in \a data. */
+	ConstantData data;          /**< The constant. */
+	StringTemplateNode *tmpl;   /**< The interpolated string, or NULL. */
+	struct valueobject *value;  /**< The preallocated value, or NULL. */
 } ConstantNode;
 
 /**
@@ -372,6 +402,8 @@ typedef struct {
  */
 typedef struct {
 	BlockNode *block; /**< The first block of code to execute. */
+	Arena arena;      /**< The arena every node of the tree is allocated from. */
+	int indirect;     /**< Whether any identifier may be named at run time. */
 } MainNode;
 
 /**
@@ -449,11 +481,18 @@ typedef struct {
  * impvar "implicit variable" to each of the \a guards and executes the
  * respective block of code in \a blocks if they match.  If no matches are
  * found, the optional default block of code, \a def, is executed.
+ *
+ * \note Guards are always constants, so they are indexed by value when the
+ * statement is created.  Each slot of the index holds one more than the index
+ * of a guard, or 0 if it is empty.  Decimal guards, which match within a
+ * tolerance, are searched linearly instead.
  */
 typedef struct {
 	ExprNodeList *guards;  /**< The expressions to evaluate. */
 	BlockNodeList *blocks; /**< The blocks of code to execute. */
 	BlockNode *def;        /**< An optional default block of code. */
+	unsigned int numslots; /**< The number of slots in the index. */
+	unsigned int *slots;   /**< The index of guards by value hash. */
 } SwitchStmtNode;
 
 /**
@@ -497,11 +536,16 @@ typedef struct {
 /**
  * Stores a function call expression.  This expression calls a named function
  * and evaluates to the return value of that function.
+ *
+ * Calls in the current scope (\c I \c IZ) cache where they last found the
+ * function they call (see getFuncCallValue()).
  */
 typedef struct {
-	IdentifierNode *scope; /**< The scope to call the function in. */
-	IdentifierNode *name;  /**< The name of the function to call. */
-	ExprNodeList *args;    /**< The arguments to supply the function. */
+	IdentifierNode *scope;      /**< The scope to call the function in. */
+	IdentifierNode *name;       /**< The name of the function to call. */
+	ExprNodeList *args;         /**< The arguments to supply the function. */
+	struct scopeobject *holder; /**< The scope last found to hold the function. */
+	unsigned int index;         /**< The position of the function in \a holder. */
 } FuncCallExprNode;
 
 /**
@@ -527,15 +571,45 @@ typedef enum {
 	OP_CAT   /**< String concatenation. */
 } OpType;
 
+/**
+ * Represents the operand types an arithmetic or equality OpExprNode has been
+ * specialized for by the interpreter.  A node starts out unseen, is
+ * specialized by the types of the operands it first evaluates, and falls back
+ * to handling any types for good once they differ.
+ */
+typedef enum {
+	OQ_UNSEEN,  /**< The operation has not been evaluated yet. */
+	OQ_INTEGER, /**< Both operands have always been integers. */
+	OQ_FLOAT,   /**< Both operands have always been decimals. */
+	OQ_GENERIC  /**< The operands have had other types. */
+} OpQuickType;
+
 /**
  * Stores an operation expression.  This expression applies an operator to its
  * arguments.
  */
 typedef struct  {
 	OpType type;        /**< The type of operation to perform. */
+	OpQuickType quick;  /**< The operand types the operation is specialized for. */
 	ExprNodeList *args; /**< The arguments to perform the operation on. */
 } OpExprNode;
 
+/**
+ * \name Node allocation
+ *
+ * Functions for allocating the memory of nodes.  Nodes are never deleted one by
+ * one; instead, every node created since the last MainNode was created belongs
+ * to the next MainNode created, and is deleted along with it.
+ */
+/**@{*/
+void *allocNode(size_t);
+void *growNodeArray(void *, unsigned int, size_t);
+char *copyNodeString(const char *, size_t);
+ArenaMark markNodes(void);
+void releaseNodes(ArenaMark);
+void discardNodes(void);
+/**@}*/
+
 /**
  * \name MainNode modifiers
  *
@@ -549,214 +623,194 @@ void deleteMainNode(MainNode *);
 /**
  * \name BlockNode modifiers
  *
- * Functions for creating and deleting single or multiple BlockNodes.
+ * Functions for creating single or multiple BlockNodes.
  */
 /**@{*/
 BlockNode *createBlockNode(StmtNodeList *);
-void deleteBlockNode(BlockNode *);
 BlockNodeList *createBlockNodeList(void);
 int addBlockNode(BlockNodeList *, BlockNode *);
-void deleteBlockNodeList(BlockNodeList *);
 /**@}*/
 
 /**
  * \name IdentifierNode modifiers
  *
- * Functions for creating and deleting single or multiple IdentifierNodes.
+ * Functions for creating single or multiple IdentifierNodes.
  */
 /**@{*/
 IdentifierNode *createIdentifierNode(IdentifierType, void *, IdentifierNode *, const char *, unsigned int);
-void deleteIdentifierNode(IdentifierNode *);
 IdentifierNodeList *createIdentifierNodeList(void);
 int addIdentifierNode(IdentifierNodeList *, IdentifierNode *);
-void deleteIdentifierNodeList(IdentifierNodeList *);
 
 /**@}*/
 
 /**
  * \name TypeNode modifiers
  *
- * Functions for creating and deleting TypeNodes.
+ * Functions for creating TypeNodes.
  */
 /**@{*/
 TypeNode *createTypeNode(ConstantType);
-void deleteTypeNode(TypeNode *);
 /**@}*/
 
 /**
  * \name StmtNode modifiers
  *
- * Functions for creating and deleting single or multiple of StmtNodes.
+ * Functions for creating single or multiple of StmtNodes.
  */
 /**@{*/
 StmtNode *createStmtNode(StmtType, void *);
-void deleteStmtNode(StmtNode *);
 StmtNodeList *createStmtNodeList(void);
 int addStmtNode(StmtNodeList *, StmtNode *);
-void deleteStmtNodeList(StmtNodeList *);
 /**@}*/
 
 /**
  * \name CastStmtNode modifiers
  *
- * Functions for creating and deleting CastStmtNodes.
+ * Functions for creating CastStmtNodes.
  */
 /**@{*/
 CastStmtNode *createCastStmtNode(IdentifierNode *, TypeNode *);
-void deleteCastStmtNode(CastStmtNode *);
 /**@}*/
 
 /**
  * \name PrintStmtNode modifiers
  *
- * Functions for creating and deleting PrintStmtNodes.
+ * Functions for creating PrintStmtNodes.
  */
 /**@{*/
 PrintStmtNode *createPrintStmtNode(ExprNodeList *, int);
-void deletePrintStmtNode(PrintStmtNode *);
 /**@}*/
 
 /**
  * \name InputStmtNode modifiers
  *
- * Functions for creating and deleting InputStmtNodes.
+ * Functions for creating InputStmtNodes.
  */
 /**@{*/
 InputStmtNode *createInputStmtNode(IdentifierNode *);
-void deleteInputStmtNode(InputStmtNode *);
 /**@}*/
 
 /**
  * \name AssignmentStmtNode modifiers
  *
- * Functions for creating and deleting AssignmentStmtNodes.
+ * Functions for creating AssignmentStmtNodes.
  */
 /**@{*/
 AssignmentStmtNode *createAssignmentStmtNode(IdentifierNode *, ExprNode *);
-void deleteAssignmentStmtNode(AssignmentStmtNode *);
 /**@}*/
 
 /**
  * \name DeclarationStmtNode modifiers
  *
- * Functions for creating and deleting DeclarationStmtNodes.
+ * Functions for creating DeclarationStmtNodes.
  */
 /**@{*/
 DeclarationStmtNode *createDeclarationStmtNode(IdentifierNode *, IdentifierNode *, ExprNode *, TypeNode *, IdentifierNode *);
-void deleteDeclarationStmtNode(DeclarationStmtNode *);
 /**@}*/
 
 /**
  * \name IfThenElseStmtNode modifiers
  *
- * Functions for creating and deleting IfThenElseStmtNodes.
+ * Functions for creating IfThenElseStmtNodes.
  */
 /**@{*/
 IfThenElseStmtNode *createIfThenElseStmtNode(BlockNode *, BlockNode *, ExprNodeList *, BlockNodeList *);
-void deleteIfThenElseStmtNode(IfThenElseStmtNode *);
 /**@}*/
 
 /**
  * \name SwitchStmtNode modifiers
  *
- * Functions for creating and deleting SwitchStmtNodes.
+ * Functions for creating SwitchStmtNodes.
  */
 /**@{*/
 SwitchStmtNode *createSwitchStmtNode(ExprNodeList *, BlockNodeList *, BlockNode *);
-void deleteSwitchStmtNode(SwitchStmtNode *);
+int matchConstantNode(ConstantNode *, ConstantNode *);
+unsigned int hashConstantNode(ConstantNode *);
+int indexSwitchStmtNode(SwitchStmtNode *);
+int findSwitchGuard(SwitchStmtNode *, ConstantNode *);
 /**@}*/
 
 /**
  * \name ReturnStmtNode modifiers
  *
- * Functions for creating and deleting ReturnStmtNodes.
+ * Functions for creating ReturnStmtNodes.
  */
 /**@{*/
 ReturnStmtNode *createReturnStmtNode(ExprNode *);
-void deleteReturnStmtNode(ReturnStmtNode *);
 /**@}*/
 
 /**
  * \name LoopStmtNode modifiers
  *
- * Functions for creating and deleting LoopStmtNodes.
+ * Functions for creating LoopStmtNodes.
  */
 /**@{*/
 LoopStmtNode *createLoopStmtNode(IdentifierNode *, IdentifierNode *, ExprNode *, ExprNode *, BlockNode *);
-void deleteLoopStmtNode(LoopStmtNode *);
 /**@}*/
 
 /**
  * \name DeallocationStmtNode modifiers
  *
- * Functions for creating and deleting DeallocationStmtNodes.
+ * Functions for creating DeallocationStmtNodes.
  */
 /**@{*/
 DeallocationStmtNode *createDeallocationStmtNode(IdentifierNode *);
-void deleteDeallocationStmtNode(DeallocationStmtNode *);
 /**@}*/
 
 /**
  * \name FuncDefStmtNode modifiers
  *
- * Functions for creating and deleting FuncDefStmtNodes.
+ * Functions for creating FuncDefStmtNodes.
  */
 /**@{*/
 FuncDefStmtNode *createFuncDefStmtNode(IdentifierNode *, IdentifierNode *, IdentifierNodeList *, BlockNode *);
-void deleteFuncDefStmtNode(FuncDefStmtNode *);
 /**@}*/
 
 /**
  * \name AltArrayDefStmtNode modifiers
  *
- * Functions for creating and deleting AltArrayDefStmtNodes.
+ * Functions for creating AltArrayDefStmtNodes.
  */
 /**@{*/
 AltArrayDefStmtNode *createAltArrayDefStmtNode(IdentifierNode *, BlockNode *, IdentifierNode *);
-void deleteAltArrayDefStmtNode(AltArrayDefStmtNode *);
 /**@}*/
 
 /**
  * \name ExprNode modifiers
  *
- * Functions for creating and deleting single or multiple ExprNodes.
+ * Functions for creating single or multiple ExprNodes.
  */
 /**@{*/
 ExprNode *createExprNode(ExprType, void *);
-void deleteExprNode(ExprNode *);
 ExprNodeList *createExprNodeList(void);
 int addExprNode(ExprNodeList *, ExprNode *);
-void deleteExprNodeList(ExprNodeList *);
 /**@}*/
 
 /**
  * \name CastExprNode modifiers
  *
- * Functions for creating and deleting CastExprNodes.
+ * Functions for creating CastExprNodes.
  */
 /**@{*/
 CastExprNode *createCastExprNode(ExprNode *, TypeNode *);
-void deleteCastExprNode(CastExprNode *);
 /**@}*/
 
 /**
  * \name FuncCallExprNode modifiers
  *
- * Functions for creating and deleting FuncCallExprNodes.
+ * Functions for creating FuncCallExprNodes.
  */
 /**@{*/
 FuncCallExprNode *createFuncCallExprNode(IdentifierNode *, IdentifierNode *, ExprNodeList *);
-void deleteFuncCallExprNode(FuncCallExprNode *);
 /**@}*/
 
 /**
  * \name OpExprNode modifiers
  *
- * Functions for creating and deleting OpExprNodes.
+ * Functions for creating OpExprNodes.
  */
 /**@{*/
 OpExprNode *createOpExprNode(OpType, ExprNodeList *);
-void deleteOpExprNode(OpExprNode *);
 /**@}*/
 
 /**
@@ -765,9 +819,9 @@ void deleteOpExprNode(OpExprNode *);
  * Functions for performing helper tasks.
  */
 /**@{*/
-int acceptToken(Token ***, TokenType);
-int peekToken(Token ***, TokenType);
-int nextToken(Token ***, TokenType);
+int acceptToken(TokenCursor *, TokenType);
+int peekToken(TokenCursor *, TokenType);
+int nextToken(TokenCursor *, TokenType);
 /**@}*/
 
 /**
@@ -776,44 +830,54 @@ int nextToken(Token ***, TokenType);
  * Functions for parsing a stream of tokens.
  */
 /**@{*/
-ConstantNode *parseConstantNode(Token ***);
-TypeNode *parseTypeNode(Token ***);
-IdentifierNode *parseIdentifierNode(Token ***);
-ExprNode *parseExprNode(Token ***);
-StmtNode *parseStmtNode(Token ***);
-BlockNode *parseBlockNode(Token ***);
-MainNode *parseMainNode(Token **);
-ExprNode *parseCastExprNode(Token ***);
-ExprNode *parseConstantExprNode(Token ***);
-ExprNode *parseIdentifierExprNode(Token ***);
-ExprNode *parseFuncCallExprNode(Token ***);
-ExprNode *parseOpExprNode(Token ***);
-StmtNode *parseCastStmtNode(Token ***);
-StmtNode *parsePrintStmtNode(Token ***);
-StmtNode *parseInputStmtNode(Token ***);
-StmtNode *parseAssignmentStmtNode(Token ***);
-StmtNode *parseDeclarationStmtNode(Token ***);
-StmtNode *parseIfThenElseStmtNode(Token ***);
-StmtNode *parseSwitchStmtNode(Token ***);
-StmtNode *parseBreakStmtNode(Token ***);
-StmtNode *parseReturnStmtNode(Token ***);
-StmtNode *parseLoopStmtNode(Token ***);
-StmtNode *parseDeallocationStmtNode(Token ***);
-StmtNode *parseFuncDefStmtNode(Token ***);
-StmtNode *parseAltArrayDefStmtNode(Token ***);
+ConstantNode *parseConstantNode(TokenCursor *);
+ConstantNode *parseStringConstantNode(const char *, TokenCursor);
+TypeNode *parseTypeNode(TokenCursor *);
+IdentifierNode *parseIdentifierNode(TokenCursor *);
+ExprNode *parseExprNode(TokenCursor *);
+StmtNode *parseStmtNode(TokenCursor *);
+BlockNode *parseBlockNode(TokenCursor *);
+MainNode *parseMainNode(TokenStream *);
+ExprNode *parseCastExprNode(TokenCursor *);
+ExprNode *parseConstantExprNode(TokenCursor *);
+ExprNode *parseIdentifierExprNode(TokenCursor *);
+ExprNode *parseFuncCallExprNode(TokenCursor *);
+ExprNode *parseOpExprNode(TokenCursor *);
+StmtNode *parseCastStmtNode(TokenCursor *);
+StmtNode *parsePrintStmtNode(TokenCursor *);
+StmtNode *parseInputStmtNode(TokenCursor *);
+StmtNode *parseAssignmentStmtNode(TokenCursor *);
+StmtNode *parseDeclarationStmtNode(TokenCursor *);
+StmtNode *parseIfThenElseStmtNode(TokenCursor *);
+StmtNode *parseSwitchStmtNode(TokenCursor *);
+StmtNode *parseBreakStmtNode(TokenCursor *);
+StmtNode *parseReturnStmtNode(TokenCursor *);
+StmtNode *parseLoopStmtNode(TokenCursor *);
+StmtNode *parseDeallocationStmtNode(TokenCursor *);
+StmtNode *parseFuncDefStmtNode(TokenCursor *);
+StmtNode *parseAltArrayDefStmtNode(TokenCursor *);
 /**@}*/
 
 /**
  * \name ConstantNode modifiers
  *
- * Functions for creating and deleting ConstantNode.
+ * Functions for creating ConstantNode.
  */
 /**@{*/
 ConstantNode *createBooleanConstantNode(int);
 ConstantNode *createIntegerConstantNode(long long int);
 ConstantNode *createFloatConstantNode(float);
-ConstantNode *createStringConstantNode(char *);
-void deleteConstantNode(ConstantNode *);
+ConstantNode *createStringConstantNode(char *, StringTemplateNode *);
+/**@}*/
+
+/**
+ * \name StringTemplateNode modifiers
+ *
+ * Functions for creating and adding to StringTemplateNode.
+ */
+/**@{*/
+StringTemplateNode *createStringTemplateNode(void);
+int addStringTemplatePart(StringTemplateNode *, char *, ExprNode *);
 /**@}*/
 
 #endif /* __PARSER_H__ */
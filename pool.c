@@ -0,0 +1,273 @@
+#include "pool.h"
+
+/**
+ * Gets the size of the objects in a pool, rounded up so that each object in a
+ * slab stays aligned and may hold a free list link.
+ *
+ * \param [in] pool The pool to get the object size of.
+ *
+ * \return The number of bytes used by each object in \a pool.
+ */
+static size_t getPoolObjectSize(Pool *pool)
+{
+	return (pool->size + sizeof(PoolSlab) - 1) / sizeof(PoolSlab) * sizeof(PoolSlab);
+}
+
+/**
+ * Allocates an object from a pool.  Deleted objects are reused first; if there
+ * are none, the object is carved out of the newest slab, allocating a new slab
+ * if that one is full.
+ *
+ * \param [in,out] pool The pool to allocate the object from.
+ *
+ * \return A pointer to uninitialized memory for an object of \a pool's size.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+void *allocPoolObject(Pool *pool)
+{
+	void *p = NULL;
+	size_t size = getPoolObjectSize(pool);
+	if (pool->free) {
+		p = pool->free;
+		pool->free = *(void **)p;
+		pool->hits++;
+	}
+	else {
+		if (!pool->unused) {
+			PoolSlab *slab = malloc(sizeof(PoolSlab) + size * POOL_SLAB_SIZE);
+			if (!slab) {
+				perror("malloc");
+				return NULL;
+			}
+			slab->next = pool->slabs;
+			pool->slabs = slab;
+			pool->unused = POOL_SLAB_SIZE;
+			pool->numslabs++;
+		}
+		p = (char *)(pool->slabs + 1) + size * (POOL_SLAB_SIZE - pool->unused);
+		pool->unused--;
+	}
+	pool->allocs++;
+	if (++pool->live > pool->peak) pool->peak = pool->live;
+	return p;
+}
+
+/**
+ * Returns an object to a pool.
+ *
+ * \param [in,out] pool The pool \a object was allocated from.
+ *
+ * \param [in] object The object to return to \a pool.
+ *
+ * \post \a object will be reused by a later call to allocPoolObject().
+ */
+void freePoolObject(Pool *pool,
+                    void *object)
+{
+	if (!object) return;
+	*(void **)object = pool->free;
+	pool->free = object;
+	pool->live--;
+}
+
+/**
+ * Deletes a pool.
+ *
+ * \param [in,out] pool The pool to delete.
+ *
+ * \post The memory of every slab in \a pool, including any objects still
+ * allocated from it, will be freed, and \a pool will be empty, with its
+ * statistics cleared.
+ */
+void deletePool(Pool *pool)
+{
+	while (pool->slabs) {
+		PoolSlab *next = pool->slabs->next;
+		free(pool->slabs);
+		pool->slabs = next;
+	}
+	pool->free = NULL;
+	pool->unused = 0;
+	pool->numslabs = 0;
+	pool->allocs = 0;
+	pool->hits = 0;
+	pool->live = 0;
+	pool->peak = 0;
+}
+
+/**
+ * Adds the allocation statistics of a pool to a total kept for pools of the
+ * same kind, such as those of several threads.
+ *
+ * \param [in,out] total The pool to add the statistics of \a pool to.
+ *
+ * \param [in] pool The pool to add the statistics of.
+ *
+ * \note The peaks are added together, giving the most objects which could
+ * have been allocated at once had the pools peaked at the same time.
+ */
+void addPoolStats(Pool *total,
+                  const Pool *pool)
+{
+	total->allocs += pool->allocs;
+	total->hits += pool->hits;
+	total->live += pool->live;
+	total->peak += pool->peak;
+	total->numslabs += pool->numslabs;
+}
+
+/**
+ * Prints the allocation statistics of a pool as a single line.
+ *
+ * \param [in] pool The pool to print the statistics of.
+ *
+ * \param [in,out] file The file to print the statistics to.
+ */
+void printPoolStats(Pool *pool,
+                    FILE *file)
+{
+	fprintf(file, "%-8s %12lu %12lu %12lu %12lu %8u\n",
+			pool->name,
+			pool->allocs,
+			pool->hits,
+			pool->live,
+			pool->peak,
+			pool->numslabs);
+}
+
+/**
+ * Allocates an object from an arena.  The object is carved out of the newest
+ * block, allocating a new block if that one is full.
+ *
+ * \param [in,out] arena The arena to allocate the object from.
+ *
+ * \param [in] size The number of bytes in the object.
+ *
+ * \return A pointer to uninitialized memory for an object of \a size bytes.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+void *allocArenaObject(Arena *arena,
+                       size_t size)
+{
+	ArenaBlock *block = arena->blocks;
+	size_t header = (sizeof(ArenaBlock) + sizeof(PoolSlab) - 1) / sizeof(PoolSlab) * sizeof(PoolSlab);
+	void *p = NULL;
+	/* Keep every object aligned like the objects of a pool */
+	size = (size + sizeof(PoolSlab) - 1) / sizeof(PoolSlab) * sizeof(PoolSlab);
+	if (!block || block->size - block->used < size) {
+		size_t max = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+		block = malloc(header + max);
+		if (!block) {
+			perror("malloc");
+			return NULL;
+		}
+		block->next = arena->blocks;
+		block->size = max;
+		block->used = 0;
+		arena->blocks = block;
+	}
+	p = (char *)block + header + block->used;
+	block->used += size;
+	arena->last = p;
+	arena->lastsize = size;
+	return p;
+}
+
+/**
+ * Resizes an object allocated from an arena.  The last object allocated is
+ * resized in place if there is room for it; otherwise, a new object is
+ * allocated and the contents of the old one are copied to it.
+ *
+ * \param [in,out] arena The arena \a object was allocated from.
+ *
+ * \param [in] object The object to resize, or NULL to allocate a new one.
+ *
+ * \param [in] oldsize The number of bytes in \a object.
+ *
+ * \param [in] newsize The number of bytes to resize \a object to.
+ *
+ * \return A pointer to the resized object, whose first bytes are those of \a
+ * object.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+void *resizeArenaObject(Arena *arena,
+                        void *object,
+                        size_t oldsize,
+                        size_t newsize)
+{
+	void *p = NULL;
+	if (object && object == arena->last) {
+		ArenaBlock *block = arena->blocks;
+		size_t used = block->used - arena->lastsize;
+		size_t size = (newsize + sizeof(PoolSlab) - 1) / sizeof(PoolSlab) * sizeof(PoolSlab);
+		if (block->size - used >= size) {
+			block->used = used + size;
+			arena->lastsize = size;
+			return object;
+		}
+	}
+	p = allocArenaObject(arena, newsize);
+	if (p && object) memcpy(p, object, oldsize < newsize ? oldsize : newsize);
+	return p;
+}
+
+/**
+ * Marks the current position of an arena.
+ *
+ * \param [in] arena The arena to mark.
+ *
+ * \return A mark which releaseArena() can release \a arena back to.
+ */
+ArenaMark markArena(Arena *arena)
+{
+	ArenaMark mark;
+	mark.block = arena->blocks;
+	mark.used = arena->blocks ? arena->blocks->used : 0;
+	return mark;
+}
+
+/**
+ * Releases the objects allocated from an arena since it was marked.
+ *
+ * \param [in,out] arena The arena to release objects from.
+ *
+ * \param [in] mark The mark returned by markArena() for \a arena.
+ *
+ * \post Every object allocated from \a arena since \a mark was made will be
+ * deleted.
+ */
+void releaseArena(Arena *arena,
+                  ArenaMark mark)
+{
+	while (arena->blocks != mark.block) {
+		ArenaBlock *next = arena->blocks->next;
+		free(arena->blocks);
+		arena->blocks = next;
+	}
+	if (mark.block) mark.block->used = mark.used;
+	/* The last object may have been released */
+	arena->last = NULL;
+	arena->lastsize = 0;
+}
+
+/**
+ * Deletes an arena.
+ *
+ * \param [in,out] arena The arena to delete.
+ *
+ * \post The memory of every block in \a arena, including every object
+ * allocated from it, will be freed, and \a arena will be empty.
+ */
+void deleteArena(Arena *arena)
+{
+	while (arena->blocks) {
+		ArenaBlock *next = arena->blocks->next;
+		free(arena->blocks);
+		arena->blocks = next;
+	}
+	arena->last = NULL;
+	arena->lastsize = 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * Structures and functions for allocating small, fixed-size objects.  A pool
+ * hands out objects of a single size, carving them out of large slabs of
+ * memory and keeping deleted objects on a free list so that they can be reused
+ * without going back to the system allocator.
+ *
+ * An arena instead hands out objects of any size from large blocks of memory,
+ * one after another, and never deletes them individually:  every object in an
+ * arena is deleted at once when the arena is.
+ *
+ * \file   pool.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#undef DEBUG
+
+/**
+ * The number of objects carved out of each slab.
+ */
+#define POOL_SLAB_SIZE 256
+
+/**
+ * Stores the header of a slab.  The objects of the slab follow the header.
+ */
+typedef union poolslab {
+	union poolslab *next; /**< The slab allocated before this one. */
+	long long int i;      /**< Forces integer alignment of the objects. */
+	double f;             /**< Forces decimal alignment of the objects. */
+} PoolSlab;
+
+/**
+ * Stores a pool of objects of a single size.
+ */
+typedef struct {
+	const char *name;      /**< The name of the pool, for reporting. */
+	size_t size;           /**< The size of each object. */
+	void *free;            /**< The list of deleted objects. */
+	PoolSlab *slabs;       /**< The slabs allocated so far. */
+	unsigned int unused;   /**< The number of objects left in the newest slab. */
+	unsigned int numslabs; /**< The number of slabs allocated. */
+	unsigned long allocs;  /**< The number of objects allocated. */
+	unsigned long hits;    /**< The number of allocations reusing an object. */
+	unsigned long live;    /**< The number of objects currently allocated. */
+	unsigned long peak;    /**< The most objects allocated at any one time. */
+} Pool;
+
+/**
+ * Initializes a pool named \a name for objects of type \a type.
+ */
+#define POOL_INITIALIZER(name, type) { name, sizeof(type), NULL, NULL, 0, 0, 0, 0, 0, 0 }
+
+/**
+ * The number of bytes in each block of an arena (larger objects are given a
+ * block of their own).
+ */
+#define ARENA_BLOCK_SIZE 65536
+
+/**
+ * Stores the header of a block of an arena.  The objects of the block follow
+ * the header.
+ */
+typedef struct arenablock {
+	struct arenablock *next; /**< The block allocated before this one. */
+	size_t size;             /**< The number of bytes for objects in the block. */
+	size_t used;             /**< The number of bytes allocated from the block. */
+} ArenaBlock;
+
+/**
+ * Stores an arena of objects which are deleted all at once.
+ */
+typedef struct {
+	ArenaBlock *blocks; /**< The blocks allocated so far, newest first. */
+	void *last;         /**< The object allocated last, or NULL. */
+	size_t lastsize;    /**< The number of bytes used by \a last. */
+} Arena;
+
+/**
+ * Stores a position in an arena to release the arena back to.
+ */
+typedef struct {
+	ArenaBlock *block; /**< The newest block of the arena. */
+	size_t used;       /**< The number of bytes allocated from \a block. */
+} ArenaMark;
+
+/**
+ * Initializes an empty arena.
+ */
+#define ARENA_INITIALIZER { NULL, NULL, 0 }
+
+/**
+ * \name Pool modifiers
+ *
+ * Functions for allocating objects from and returning objects to pools.
+ */
+/**@{*/
+void *allocPoolObject(Pool *);
+void freePoolObject(Pool *, void *);
+void deletePool(Pool *);
+void addPoolStats(Pool *, const Pool *);
+void printPoolStats(Pool *, FILE *);
+/**@}*/
+
+/**
+ * \name Arena modifiers
+ *
+ * Functions for allocating objects from and deleting arenas.
+ */
+/**@{*/
+void *allocArenaObject(Arena *, size_t);
+void *resizeArenaObject(Arena *, void *, size_t, size_t);
+ArenaMark markArena(Arena *);
+void releaseArena(Arena *, ArenaMark);
+void deleteArena(Arena *);
+/**@}*/
+
+#endif /* __POOL_H__ */
@@ -0,0 +1,469 @@
+#include "profiler.h"
+
+/*
+ * The profile records, hashed by location and name, and the chains of function
+ * calls, all allocated from one arena.  Like the rest of the profile, they are
+ * kept per thread, since only the thread which began a profile is hooked.
+ */
+static THREAD_LOCAL Arena ProfileArena = ARENA_INITIALIZER;
+static THREAD_LOCAL ProfileRecord *ProfileBuckets[PROFILE_BUCKETS];
+static THREAD_LOCAL unsigned int ProfileNumRecords = 0;
+static THREAD_LOCAL ProfileNode ProfileRoot = { NULL, NULL, NULL, 0 };
+
+/*
+ * The lines and the functions executing, each with their own stack so that
+ * self times exclude only nested executions of the same kind.
+ */
+static THREAD_LOCAL ProfileStack ProfileLines = { 0, 0, NULL };
+static THREAD_LOCAL ProfileStack ProfileFuncs = { 0, 0, NULL };
+
+/*
+ * The files the profile and the folded stacks are written to.
+ */
+static THREAD_LOCAL FILE *ProfileFile = NULL;
+static THREAD_LOCAL FILE *ProfileFoldedFile = NULL;
+
+/**
+ * Gets the current time.
+ *
+ * \return The current time in nanoseconds, from an arbitrary starting point.
+ */
+static unsigned long long getProfileTime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ull
+			+ (unsigned long long)ts.tv_nsec;
+}
+
+/**
+ * Gets the record of a function or a line, creating it if this has not yet
+ * been done.
+ *
+ * \param [in] name The name of the function, or NULL for a line.
+ *
+ * \param [in] fname The name of the file.
+ *
+ * \param [in] line The line number.
+ *
+ * \note \a name and \a fname are not copied; they must outlive the profile.
+ *
+ * \return The record of \a name at \a fname and \a line.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+static ProfileRecord *getProfileRecord(const char *name,
+                                       const char *fname,
+                                       unsigned int line)
+{
+	unsigned int h = (line * 31u + (unsigned int)((size_t)fname >> 4)
+			+ (unsigned int)((size_t)name >> 4)) % PROFILE_BUCKETS;
+	ProfileRecord *p = NULL;
+	for (p = ProfileBuckets[h]; p; p = p->next) {
+		/* Names are interned and file names are shared, so compare addresses */
+		if (p->line == line && p->fname == fname && p->name == name)
+			return p;
+	}
+	p = allocArenaObject(&ProfileArena, sizeof(ProfileRecord));
+	if (!p) return NULL;
+	p->name = name;
+	p->fname = fname;
+	p->line = line;
+	p->count = 0;
+	p->total = 0;
+	p->self = 0;
+	p->allocs = 0;
+	p->active = 0;
+	p->next = ProfileBuckets[h];
+	ProfileBuckets[h] = p;
+	ProfileNumRecords++;
+	return p;
+}
+
+/**
+ * Gets the chain of function calls extending another with a call to a
+ * function, creating it if this has not yet been done.
+ *
+ * \param [in,out] parent The chain of function calls to extend.
+ *
+ * \param [in] record The function called.
+ *
+ * \return The chain of calls \a parent followed by a call to \a record.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+static ProfileNode *getProfileNode(ProfileNode *parent,
+                                   ProfileRecord *record)
+{
+	ProfileNode *p = NULL;
+	for (p = parent->child; p; p = p->sibling) {
+		if (p->record == record) return p;
+	}
+	p = allocArenaObject(&ProfileArena, sizeof(ProfileNode));
+	if (!p) return NULL;
+	p->record = record;
+	p->child = NULL;
+	p->self = 0;
+	p->sibling = parent->child;
+	parent->child = p;
+	return p;
+}
+
+/**
+ * Begins an execution.
+ *
+ * \param [in,out] stack The stack of executions of the same kind.
+ *
+ * \param [in,out] record The function or line executing, or NULL.
+ *
+ * \param [in,out] node The chain of function calls executing, or NULL.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The execution was begun.
+ */
+static int enterProfile(ProfileStack *stack,
+                        ProfileRecord *record,
+                        ProfileNode *node)
+{
+	ProfileFrame *f = NULL;
+	if (stack->num == stack->max) {
+		unsigned int newmax = stack->max ? stack->max * 2 : 64;
+		void *mem = realloc(stack->frames, sizeof(ProfileFrame) * newmax);
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		stack->frames = mem;
+		stack->max = newmax;
+	}
+	f = stack->frames + stack->num++;
+	f->record = record;
+	f->node = node;
+	f->nested = 0;
+	f->nestedallocs = 0;
+	if (record) {
+		record->count++;
+		record->active++;
+	}
+	f->allocs = getAllocationCount();
+	f->start = getProfileTime();
+	return 1;
+}
+
+/**
+ * Ends the innermost execution of a stack, adding the time it took and the
+ * objects it allocated to its record.
+ *
+ * \param [in,out] stack The stack of executions to end the innermost of.
+ */
+static void leaveProfile(ProfileStack *stack)
+{
+	unsigned long long elapsed = getProfileTime();
+	unsigned long allocs = getAllocationCount();
+	ProfileFrame *f = stack->frames + --stack->num;
+	elapsed -= f->start;
+	allocs -= f->allocs;
+	if (f->record) {
+		ProfileRecord *record = f->record;
+		record->self += elapsed - f->nested;
+		record->allocs += allocs - f->nestedallocs;
+		/* Only count the outermost of recursive executions */
+		if (!--record->active) record->total += elapsed;
+	}
+	if (f->node) f->node->self += elapsed - f->nested;
+	if (stack->num) {
+		f--;
+		f->nested += elapsed;
+		f->nestedallocs += allocs;
+	}
+}
+
+/**
+ * Interprets a statement, recording it with its line.
+ *
+ * \param [in] node The statement to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a node under.
+ *
+ * \return A pointer to a return value set appropriately depending on the
+ * statement interpreted.
+ *
+ * \retval NULL An error occurred during interpretation.
+ */
+static ReturnObject *profileStmtNode(StmtNode *node,
+                                     ScopeObject *scope)
+{
+	ReturnObject *ret = NULL;
+	ProfileRecord *record = getProfileRecord(NULL,
+			node->fname ? node->fname : "?", node->line);
+	if (!enterProfile(&ProfileLines, record, NULL)) return NULL;
+	ret = interpretUnhookedStmtNode(node, scope);
+	leaveProfile(&ProfileLines);
+	return ret;
+}
+
+/**
+ * Checks if an identifier, and any slots it accesses, are named directly, so
+ * that it may be looked up without evaluating anything.
+ *
+ * \param [in] id The identifier to check.
+ *
+ * \return Whether \a id and its slots are all direct names.
+ */
+static int isDirectIdentifier(IdentifierNode *id)
+{
+	for (; id; id = id->slot) {
+		if (id->type != IT_DIRECT) return 0;
+	}
+	return 1;
+}
+
+/**
+ * Gets the record of the function a function call calls.  Calls which can only
+ * be resolved by evaluating an indirect name are recorded under the name \c ?
+ * at the call site, since the call itself evaluates the name.
+ *
+ * \param [in,out] expr The function call.
+ *
+ * \param [in] scope The scope to evaluate \a expr under.
+ *
+ * \return The record of the function \a expr calls.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+static ProfileRecord *getFuncCallRecord(FuncCallExprNode *expr,
+                                        ScopeObject *scope)
+{
+	IdentifierNode *id = expr->name;
+	ScopeObject *target = NULL;
+	ValueObject *def = NULL;
+	if (isDirectIdentifier(expr->scope) && isDirectIdentifier(id))
+		def = getFuncCallValue(scope, expr, &target);
+	if (def && def->type == VT_FUNC) {
+		IdentifierNode *name = getFunction(def)->name;
+		if (name->type == IT_DIRECT)
+			return getProfileRecord(name->id, name->fname, name->line);
+	}
+	return getProfileRecord("?", id->fname, id->line);
+}
+
+/**
+ * Interprets a function call, recording it with the function it calls.
+ *
+ * \param [in] node The function call to interpret.
+ *
+ * \param [in] scope The scope to evaluate \a node under.
+ *
+ * \return The value returned by the function.
+ *
+ * \retval NULL An error occurred during interpretation.
+ */
+static ValueObject *profileFuncCallExprNode(ExprNode *node,
+                                            ScopeObject *scope)
+{
+	ValueObject *ret = NULL;
+	ProfileRecord *record = getFuncCallRecord(node->expr, scope);
+	ProfileNode *parent = ProfileFuncs.frames[ProfileFuncs.num - 1].node;
+	ProfileNode *chain = record ? getProfileNode(parent, record) : NULL;
+	/* Without a record of its own, the call is part of its caller */
+	if (!chain) chain = parent;
+	if (!enterProfile(&ProfileFuncs, record, chain)) return NULL;
+	ret = interpretFuncCallExprNode(node, scope);
+	leaveProfile(&ProfileFuncs);
+	return ret;
+}
+
+/**
+ * Compares profile records by self time, longest first, then by location.
+ *
+ * \param [in] a A pointer to the first record.
+ *
+ * \param [in] b A pointer to the second record.
+ *
+ * \return A negative, zero, or positive number as \a a sorts before, with, or
+ * after \a b.
+ */
+static int compareProfileRecords(const void *a,
+                                 const void *b)
+{
+	const ProfileRecord *r1 = *(ProfileRecord *const *)a;
+	const ProfileRecord *r2 = *(ProfileRecord *const *)b;
+	int cmp;
+	if (r1->self != r2->self) return r1->self > r2->self ? -1 : 1;
+	cmp = strcmp(r1->fname, r2->fname);
+	if (cmp) return cmp;
+	if (r1->line != r2->line) return r1->line < r2->line ? -1 : 1;
+	if (r1->name && r2->name) return strcmp(r1->name, r2->name);
+	return 0;
+}
+
+/**
+ * Writes one table of the profile.
+ *
+ * \param [in,out] file The file to write to.
+ *
+ * \param [in] records The records, sorted.
+ *
+ * \param [in] num The number of records in \a records.
+ *
+ * \param [in] funcs Whether to write the function records, rather than the
+ * line records.
+ */
+static void writeProfileTable(FILE *file,
+                              ProfileRecord **records,
+                              unsigned int num,
+                              int funcs)
+{
+	unsigned int n;
+	fprintf(file, "%s (sorted by self time)\n", funcs ? "Functions" : "Lines");
+	fprintf(file, "%12s %12s %12s %12s  %s\n", funcs ? "calls" : "count",
+			"total ms", "self ms", "allocs", funcs ? "function" : "line");
+	for (n = 0; n < num; n++) {
+		ProfileRecord *r = records[n];
+		if (!r->name != !funcs) continue;
+		fprintf(file, "%12lu %12.3f %12.3f %12lu  ", r->count,
+				r->total / 1e6, r->self / 1e6, r->allocs);
+		if (funcs) fprintf(file, "%s (%s:%u)\n", r->name, r->fname, r->line);
+		else fprintf(file, "%s:%u\n", r->fname, r->line);
+	}
+}
+
+/**
+ * Writes the chains of function calls extending one chain in the folded stack
+ * format.
+ *
+ * \param [in,out] file The file to write to.
+ *
+ * \param [in] node The chain of function calls to write.
+ *
+ * \param [in,out] path The names of the functions in \a node, which is
+ * extended with each chain written.
+ *
+ * \param [in] len The number of characters in \a path.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The chains were written.
+ */
+static int writeProfileNode(FILE *file,
+                            ProfileNode *node,
+                            char **path,
+                            size_t len)
+{
+	ProfileNode *child = NULL;
+	if (node->record) {
+		size_t size = strlen(node->record->name);
+		void *mem = realloc(*path, len + size + 2);
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		*path = mem;
+		(*path)[len++] = ';';
+		memcpy(*path + len, node->record->name, size + 1);
+		len += size;
+	}
+	if (node->self >= 1000)
+		fprintf(file, "%s %llu\n", *path, node->self / 1000);
+	for (child = node->child; child; child = child->sibling) {
+		if (!writeProfileNode(file, child, path, len)) return 0;
+	}
+	return 1;
+}
+
+/**
+ * Begins profiling programs run by the interpreter on the calling thread.
+ * Other threads may run programs, or profile them, at the same time without
+ * being recorded.
+ *
+ * \param [in] path The name of the file to write the profile to.
+ *
+ * \post The interpreter will be hooked to record the statements and function
+ * calls it executes, and the time from now on will be attributed to \c main.
+ *
+ * \retval 0 The profile could not be begun.
+ *
+ * \retval 1 The profile was begun.
+ */
+int startProfile(const char *path)
+{
+	char *folded = NULL;
+	ProfileFile = fopen(path, "w");
+	if (!ProfileFile) goto startProfileAbort;
+	folded = malloc(strlen(path) + strlen(PROFILE_FOLDED_SUFFIX) + 1);
+	if (!folded) {
+		perror("malloc");
+		goto startProfileAbort;
+	}
+	strcpy(folded, path);
+	strcat(folded, PROFILE_FOLDED_SUFFIX);
+	ProfileFoldedFile = fopen(folded, "w");
+	free(folded);
+	if (!ProfileFoldedFile) goto startProfileAbort;
+	if (!enterProfile(&ProfileFuncs, NULL, &ProfileRoot))
+		goto startProfileAbort;
+	hookInterpreter(profileStmtNode, profileFuncCallExprNode);
+	return 1;
+
+startProfileAbort: /* In case something goes wrong... */
+
+	error(MN_ERROR_WRITING_PROFILE, path);
+
+	return 0;
+}
+
+/**
+ * Ends profiling on the calling thread and writes its profile.
+ *
+ * \note Executions still in progress, as when a program exits with an error,
+ * are ended first.
+ *
+ * \post The interpreter will be unhooked, the profile written, and every
+ * record freed, so that a new profile may be begun.
+ */
+void stopProfile(void)
+{
+	ProfileRecord **records = NULL;
+	ProfileRecord *p = NULL;
+	char *path = NULL;
+	unsigned int num = 0;
+	unsigned int n;
+	if (!ProfileFile) return;
+	unhookInterpreter();
+	while (ProfileLines.num) leaveProfile(&ProfileLines);
+	while (ProfileFuncs.num) leaveProfile(&ProfileFuncs);
+	records = malloc(sizeof(ProfileRecord *) * (ProfileNumRecords + 1));
+	if (!records) perror("malloc");
+	else {
+		for (n = 0; n < PROFILE_BUCKETS; n++) {
+			for (p = ProfileBuckets[n]; p; p = p->next)
+				records[num++] = p;
+		}
+		qsort(records, num, sizeof(ProfileRecord *), compareProfileRecords);
+		writeProfileTable(ProfileFile, records, num, 1);
+		fprintf(ProfileFile, "\n");
+		writeProfileTable(ProfileFile, records, num, 0);
+		free(records);
+	}
+	/* Every chain of function calls begins in the main block */
+	path = malloc(sizeof("main"));
+	if (!path) perror("malloc");
+	else {
+		memcpy(path, "main", sizeof("main"));
+		writeProfileNode(ProfileFoldedFile, &ProfileRoot, &path, strlen(path));
+		free(path);
+	}
+	fclose(ProfileFile);
+	fclose(ProfileFoldedFile);
+	ProfileFile = ProfileFoldedFile = NULL;
+	free(ProfileLines.frames);
+	free(ProfileFuncs.frames);
+	ProfileLines.frames = ProfileFuncs.frames = NULL;
+	ProfileLines.max = ProfileFuncs.max = 0;
+	deleteArena(&ProfileArena);
+	memset(ProfileBuckets, 0, sizeof(ProfileBuckets));
+	ProfileNumRecords = 0;
+	ProfileRoot.child = NULL;
+	ProfileRoot.self = 0;
+}
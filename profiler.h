@@ -0,0 +1,128 @@
+/**
+ * Structures and functions for profiling programs.  The profiler hooks into
+ * the interpreter (see hookInterpreter()) to count and time the statements and
+ * functions a program executes, and reports them when lci exits.
+ *
+ * \file   profiler.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page profiler Profiling
+ *
+ * Running lci with \c --profile=FILE executes programs with the interpreter
+ * while recording, for each function (\c HOW \c IZ \c I) and each source line
+ * holding a statement, how many times it ran, how long it took, and how many
+ * objects it allocated (see getAllocationCount()).  When lci exits, FILE is
+ * written with two tables, each sorted by self time:
+ *
+ *   - Functions, named with the place they were defined, with the number of
+ *   calls, the total time spent in them (including the functions they call),
+ *   the time spent in them alone, and the objects they allocated alone.
+ *
+ *   - Lines, with the number of statements executed on them, the total time
+ *   spent in those statements (including the statements nested within them,
+ *   such as the bodies of loops and of functions they call), the time spent in
+ *   them alone, and the objects they allocated alone.
+ *
+ * Times are wall-clock times.  The total time of a recursive function or
+ * statement is only counted for its outermost execution.
+ *
+ * FILE with \c PROFILE_FOLDED_SUFFIX appended is written with the time spent in
+ * each chain of function calls, in the "folded stack" format read by flame
+ * graph tools: one line per chain, naming the functions called from \c main
+ * inwards separated by semicolons, followed by the number of microseconds
+ * spent in the last function alone.
+ *
+ * Without \c --profile, the interpreter is not hooked and runs at full speed.
+ *
+ * Only the thread which begins a profile is hooked and recorded, as the jump
+ * tables of the interpreter and the records of the profile are kept per
+ * thread.  Programs embedding lci may thus profile a program on one thread
+ * while others run unprofiled.
+ */
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "interpreter.h"
+#include "pool.h"
+#include "error.h"
+
+#undef DEBUG
+
+/**
+ * The suffix appended to the name of a profile to name its folded stacks.
+ */
+#define PROFILE_FOLDED_SUFFIX ".folded"
+
+/**
+ * The number of buckets in the table of profile records.
+ */
+#define PROFILE_BUCKETS 1024
+
+/**
+ * Stores what is known about a function or a source line.
+ */
+typedef struct profilerecord {
+	const char *name;           /**< The function name, or NULL for a line. */
+	const char *fname;          /**< The name of the file. */
+	unsigned int line;          /**< The line number. */
+	unsigned long count;        /**< The number of executions. */
+	unsigned long long total;   /**< The nanoseconds spent, including nested executions. */
+	unsigned long long self;    /**< The nanoseconds spent, excluding nested executions. */
+	unsigned long allocs;       /**< The objects allocated, excluding nested executions. */
+	unsigned int active;        /**< The number of executions in progress. */
+	struct profilerecord *next; /**< The next record in the same bucket. */
+} ProfileRecord;
+
+/**
+ * Stores a chain of function calls.
+ */
+typedef struct profilenode {
+	ProfileRecord *record;       /**< The function called last, or NULL for \c main. */
+	struct profilenode *child;   /**< The first chain extending this one. */
+	struct profilenode *sibling; /**< The next chain extending the parent. */
+	unsigned long long self;     /**< The nanoseconds spent in the last function alone. */
+} ProfileNode;
+
+/**
+ * Stores an execution in progress.
+ */
+typedef struct {
+	ProfileRecord *record;       /**< The function or line executing, or NULL. */
+	ProfileNode *node;           /**< The chain of function calls, or NULL. */
+	unsigned long long start;    /**< When the execution began. */
+	unsigned long long nested;   /**< The nanoseconds spent in nested executions. */
+	unsigned long allocs;        /**< The allocation count when the execution began. */
+	unsigned long nestedallocs;  /**< The objects allocated by nested executions. */
+} ProfileFrame;
+
+/**
+ * Stores a stack of executions in progress.
+ */
+typedef struct {
+	unsigned int num;     /**< The number of executions in progress. */
+	unsigned int max;     /**< The number of allocated frames. */
+	ProfileFrame *frames; /**< The executions, innermost last. */
+} ProfileStack;
+
+/**
+ * \name Profiler
+ *
+ * Functions for profiling programs.
+ */
+/**@{*/
+int startProfile(const char *);
+void stopProfile(void);
+/**@}*/
+
+#endif /* __PROFILER_H__ */
@@ -0,0 +1,474 @@
+#include "resolver.h"
+
+/**
+ * Checks if an identifier is a plain, direct name.
+ *
+ * \param [in] id The identifier to check.
+ *
+ * \param [in] name An optional name to compare against.
+ *
+ * \retval 0 \a id is indirect, accesses a slot, or does not match \a name.
+ *
+ * \retval 1 \a id is a direct name (equal to \a name if given).
+ */
+static int isDirectName(IdentifierNode *id,
+                        const char *name)
+{
+	if (!id || id->type != IT_DIRECT || id->slot) return 0;
+	if (name && strcmp((char *)(id->id), name)) return 0;
+	return 1;
+}
+
+/**
+ * Marks the name of an identifier as one that is looked up by name at run time.
+ *
+ * \param [in] id The identifier to mark.
+ */
+static void findName(IdentifierNode *id)
+{
+	if (id && id->type == IT_DIRECT) setInternFound(id->id);
+}
+
+/**
+ * Enters a new scope.
+ *
+ * \param [in,out] state The resolver state to add a frame to.
+ *
+ * \param [in] boundary Whether the parent of the new scope is only known at
+ * run time.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 A frame was added to \a state.
+ */
+static int pushFrame(ResolverState *state,
+                     int boundary)
+{
+	ResolverFrame *frame = NULL;
+	if (state->num == state->max) {
+		unsigned int newmax = state->max ? state->max * 2 : 16;
+		void *mem = realloc(state->frames, sizeof(ResolverFrame) * newmax);
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		state->frames = mem;
+		state->max = newmax;
+	}
+	frame = state->frames + state->num;
+	frame->num = 0;
+	frame->names = NULL;
+	frame->boundary = boundary;
+	frame->poisoned = 0;
+	state->num++;
+	return 1;
+}
+
+/**
+ * Leaves the innermost scope.
+ *
+ * \param [in,out] state The resolver state to remove a frame from.
+ */
+static void popFrame(ResolverState *state)
+{
+	if (!state->num) return;
+	state->num--;
+	free(state->frames[state->num].names);
+}
+
+/**
+ * Records a declaration in the innermost scope.
+ *
+ * \param [in,out] state The resolver state to declare \a name in.
+ *
+ * \param [in] name The declared name.
+ *
+ * \note \a name is not copied; it must outlive \a state.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 \a name was declared.
+ */
+static int declareName(ResolverState *state,
+                       const char *name)
+{
+	ResolverFrame *frame = state->frames + state->num - 1;
+	void *mem = realloc(frame->names, sizeof(const char *) * (frame->num + 1));
+	if (!mem) {
+		perror("realloc");
+		return 0;
+	}
+	frame->names = mem;
+	frame->names[frame->num] = name;
+	frame->num++;
+	return 1;
+}
+
+/**
+ * Records a declaration of an identifier into a scope.  Declarations into the
+ * current scope (\c I) with a direct name are tracked; declarations which may
+ * add an unknown name to the current scope poison it.
+ *
+ * \param [in,out] state The resolver state to declare \a target in.
+ *
+ * \param [in] scope The scope \a target is declared in, or NULL for the
+ * current scope.
+ *
+ * \param [in] target The declared identifier.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The declaration was recorded.
+ */
+static int declareIdentifierNode(ResolverState *state,
+                                 IdentifierNode *scope,
+                                 IdentifierNode *target)
+{
+	ResolverFrame *frame = state->frames + state->num - 1;
+	if (!scope || isDirectName(scope, "I")) {
+		if (isDirectName(target, NULL))
+			return declareName(state, (char *)(target->id));
+		frame->poisoned = 1;
+	}
+	/* Named arrays are never scopes of code blocks */
+	else if (!isDirectName(scope, NULL) || isDirectName(scope, "ME"))
+		frame->poisoned = 1;
+	return 1;
+}
+
+/**
+ * Resolves an identifier.  Any expressions used to name the identifier or its
+ * slots are resolved and, if the identifier is a direct name found in an
+ * enclosing scope, its depth and index are recorded.
+ *
+ * \param [in,out] state The resolver state to resolve \a id under.
+ *
+ * \param [in,out] id The identifier to resolve.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a id was resolved (though it may remain unbound).
+ */
+int resolveIdentifierNode(ResolverState *state,
+                          IdentifierNode *id)
+{
+	IdentifierNode *slot = NULL;
+	if (!id) return 1;
+	if (id->type == IT_INDIRECT) {
+		state->indirect = 1;
+		if (!resolveExprNode(state, id->id)) return 0;
+	}
+	/* The special scope names are never bound */
+	else if (id->type == IT_DIRECT
+			&& strcmp((char *)(id->id), "I")
+			&& strcmp((char *)(id->id), "ME")) {
+		const char *name = (char *)(id->id);
+		unsigned int n;
+		for (n = state->num; n > 0; n--) {
+			ResolverFrame *frame = state->frames + n - 1;
+			unsigned int i;
+			if (frame->poisoned) break;
+			for (i = 0; i < frame->num; i++) {
+				/* Names are interned, so compare addresses */
+				if (frame->names[i] == name) {
+					id->depth = (int)(state->num - n);
+					id->index = i;
+					break;
+				}
+			}
+			if (i < frame->num || frame->boundary) break;
+		}
+		if (id->depth < 0 || id->slot) findName(id);
+	}
+	/* Slots name values in arrays but are evaluated in this scope */
+	for (slot = id->slot; slot; slot = slot->slot) {
+		findName(slot);
+		if (slot->type == IT_INDIRECT) {
+			state->indirect = 1;
+			if (!resolveExprNode(state, slot->id)) return 0;
+		}
+	}
+	return 1;
+}
+
+/**
+ * Resolves an expression.
+ *
+ * \param [in,out] state The resolver state to resolve \a node under.
+ *
+ * \param [in,out] node The expression to resolve.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a node was resolved.
+ */
+int resolveExprNode(ResolverState *state,
+                    ExprNode *node)
+{
+	if (!node) return 1;
+	switch (node->type) {
+		case ET_CAST: {
+			CastExprNode *expr = (CastExprNode *)node->expr;
+			return resolveExprNode(state, expr->target);
+		}
+		case ET_IDENTIFIER:
+			return resolveIdentifierNode(state, node->expr);
+		case ET_FUNCCALL: {
+			FuncCallExprNode *expr = (FuncCallExprNode *)node->expr;
+			if (!resolveIdentifierNode(state, expr->scope)) return 0;
+			if (!resolveIdentifierNode(state, expr->name)) return 0;
+			/* Functions are always looked up by name */
+			findName(expr->name);
+			return resolveExprNodeList(state, expr->args);
+		}
+		case ET_OP: {
+			OpExprNode *expr = (OpExprNode *)node->expr;
+			return resolveExprNodeList(state, expr->args);
+		}
+		case ET_CONSTANT: {
+			ConstantNode *expr = (ConstantNode *)node->expr;
+			unsigned int n;
+			if (expr->type != CT_STRING || !expr->tmpl) return 1;
+			/* Resolve any interpolated variables */
+			for (n = 0; n < expr->tmpl->num; n++)
+				if (!resolveExprNode(state, expr->tmpl->vars[n])) return 0;
+			return 1;
+		}
+		case ET_IMPVAR:
+			return 1;
+		default:
+			error(PR_UNKNOWN_EXPRESSION_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Resolves a list of expressions.
+ *
+ * \param [in,out] state The resolver state to resolve \a list under.
+ *
+ * \param [in,out] list The expressions to resolve.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a list was resolved.
+ */
+int resolveExprNodeList(ResolverState *state,
+                        ExprNodeList *list)
+{
+	unsigned int n;
+	if (!list) return 1;
+	for (n = 0; n < list->num; n++)
+		if (!resolveExprNode(state, list->exprs[n])) return 0;
+	return 1;
+}
+
+/**
+ * Resolves a statement.
+ *
+ * \param [in,out] state The resolver state to resolve \a node under.
+ *
+ * \param [in,out] node The statement to resolve.
+ *
+ * \note Statements are resolved in the same order they are interpreted in so
+ * that declarations are recorded before the identifiers which depend on them.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a node was resolved.
+ */
+int resolveStmtNode(ResolverState *state,
+                    StmtNode *node)
+{
+	switch (node->type) {
+		case ST_CAST: {
+			CastStmtNode *stmt = (CastStmtNode *)node->stmt;
+			return resolveIdentifierNode(state, stmt->target);
+		}
+		case ST_PRINT: {
+			PrintStmtNode *stmt = (PrintStmtNode *)node->stmt;
+			return resolveExprNodeList(state, stmt->args);
+		}
+		case ST_INPUT: {
+			InputStmtNode *stmt = (InputStmtNode *)node->stmt;
+			return resolveIdentifierNode(state, stmt->target);
+		}
+		case ST_ASSIGNMENT: {
+			AssignmentStmtNode *stmt = (AssignmentStmtNode *)node->stmt;
+			if (!resolveExprNode(state, stmt->expr)) return 0;
+			return resolveIdentifierNode(state, stmt->target);
+		}
+		case ST_DECLARATION: {
+			DeclarationStmtNode *stmt = (DeclarationStmtNode *)node->stmt;
+			if (!resolveIdentifierNode(state, stmt->scope)) return 0;
+			if (!resolveExprNode(state, stmt->expr)) return 0;
+			if (!resolveIdentifierNode(state, stmt->parent)) return 0;
+			if (!declareIdentifierNode(state, stmt->scope, stmt->target))
+				return 0;
+			/* Only bind the target when it lives in this scope */
+			if (isDirectName(stmt->scope, "I"))
+				return resolveIdentifierNode(state, stmt->target);
+			return 1;
+		}
+		case ST_IFTHENELSE: {
+			IfThenElseStmtNode *stmt = (IfThenElseStmtNode *)node->stmt;
+			unsigned int n;
+			if (!resolveBlockNode(state, stmt->yes)) return 0;
+			for (n = 0; n < stmt->guards->num; n++) {
+				if (!resolveExprNode(state, stmt->guards->exprs[n]))
+					return 0;
+				if (!resolveBlockNode(state, stmt->blocks->blocks[n]))
+					return 0;
+			}
+			return resolveBlockNode(state, stmt->no);
+		}
+		case ST_SWITCH: {
+			SwitchStmtNode *stmt = (SwitchStmtNode *)node->stmt;
+			unsigned int n;
+			for (n = 0; n < stmt->blocks->num; n++)
+				if (!resolveBlockNode(state, stmt->blocks->blocks[n]))
+					return 0;
+			return resolveBlockNode(state, stmt->def);
+		}
+		case ST_RETURN: {
+			ReturnStmtNode *stmt = (ReturnStmtNode *)node->stmt;
+			return resolveExprNode(state, stmt->value);
+		}
+		case ST_LOOP: {
+			LoopStmtNode *stmt = (LoopStmtNode *)node->stmt;
+			int status = 0;
+			/* Loops get a scope of their own for the loop variable */
+			if (!pushFrame(state, 0)) return 0;
+			if (stmt->var && !declareIdentifierNode(state, NULL, stmt->var))
+				goto resolveLoopAbort;
+			if (!resolveExprNode(state, stmt->guard)) goto resolveLoopAbort;
+			if (!resolveBlockNode(state, stmt->body)) goto resolveLoopAbort;
+			if (!resolveExprNode(state, stmt->update)) goto resolveLoopAbort;
+			status = 1;
+resolveLoopAbort:
+			popFrame(state);
+			return status;
+		}
+		case ST_DEALLOCATION: {
+			DeallocationStmtNode *stmt = (DeallocationStmtNode *)node->stmt;
+			/* Values are always deallocated by name */
+			findName(stmt->target);
+			return resolveIdentifierNode(state, stmt->target);
+		}
+		case ST_FUNCDEF: {
+			FuncDefStmtNode *stmt = (FuncDefStmtNode *)node->stmt;
+			unsigned int n;
+			int status = 0;
+			if (!resolveIdentifierNode(state, stmt->scope)) return 0;
+			if (!declareIdentifierNode(state, stmt->scope, stmt->name))
+				return 0;
+			if (isDirectName(stmt->scope, "I")
+					&& !resolveIdentifierNode(state, stmt->name))
+				return 0;
+			/* Function bodies are parented by their caller's scope */
+			if (!pushFrame(state, 1)) return 0;
+			for (n = 0; n < stmt->args->num; n++) {
+				IdentifierNode *arg = stmt->args->ids[n];
+				if (!declareIdentifierNode(state, NULL, arg))
+					goto resolveFuncDefAbort;
+			}
+			if (!resolveStmtNodeList(state, stmt->body->stmts))
+				goto resolveFuncDefAbort;
+			status = 1;
+resolveFuncDefAbort:
+			popFrame(state);
+			return status;
+		}
+		case ST_EXPR:
+			return resolveExprNode(state, node->stmt);
+		case ST_ALTARRAYDEF: {
+			AltArrayDefStmtNode *stmt = (AltArrayDefStmtNode *)node->stmt;
+			int status;
+			if (!resolveIdentifierNode(state, stmt->parent)) return 0;
+			/* Array bodies may be parented by another array */
+			if (!pushFrame(state, 1)) return 0;
+			status = resolveStmtNodeList(state, stmt->body->stmts);
+			popFrame(state);
+			if (!status) return 0;
+			if (!declareIdentifierNode(state, NULL, stmt->name)) return 0;
+			return resolveIdentifierNode(state, stmt->name);
+		}
+		case ST_BREAK:
+			return 1;
+		default:
+			error(PR_UNKNOWN_STATEMENT_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Resolves a list of statements in the innermost scope.
+ *
+ * \param [in,out] state The resolver state to resolve \a list under.
+ *
+ * \param [in,out] list The statements to resolve.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a list was resolved.
+ */
+int resolveStmtNodeList(ResolverState *state,
+                        StmtNodeList *list)
+{
+	unsigned int n;
+	for (n = 0; n < list->num; n++)
+		if (!resolveStmtNode(state, list->stmts[n])) return 0;
+	return 1;
+}
+
+/**
+ * Resolves a block of code in a new scope.
+ *
+ * \param [in,out] state The resolver state to resolve \a node under.
+ *
+ * \param [in,out] node The block of code to resolve.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a node was resolved.
+ */
+int resolveBlockNode(ResolverState *state,
+                     BlockNode *node)
+{
+	int status;
+	if (!node) return 1;
+	if (!pushFrame(state, 0)) return 0;
+	status = resolveStmtNodeList(state, node->stmts);
+	popFrame(state);
+	return status;
+}
+
+/**
+ * Resolves the main block of code.
+ *
+ * \param [in,out] main The main block of code to resolve.
+ *
+ * \pre \a main contains a block of code created by parseMainNode().
+ *
+ * \post Each direct identifier in \a main whose binding is static will have its
+ * depth and index set.
+ *
+ * \retval 0 An error occurred while resolving.
+ *
+ * \retval 1 \a main was resolved.
+ */
+int resolveMainNode(MainNode *main)
+{
+	ResolverState state;
+	int status;
+	if (!main) return 0;
+	state.num = 0;
+	state.max = 0;
+	state.frames = NULL;
+	state.indirect = 0;
+	status = resolveBlockNode(&state, main->block);
+	main->indirect = state.indirect;
+	while (state.num) popFrame(&state);
+	free(state.frames);
+	return status;
+}
@@ -0,0 +1,90 @@
+/**
+ * Structures and functions for resolving identifiers in a parse tree.  The
+ * resolver walks a parse tree (generated by the parser) and, wherever the
+ * binding of a direct identifier can be determined without running the
+ * program, annotates it with the depth of the scope holding the binding and
+ * the index of the binding within that scope.  This lets the interpreter skip
+ * name lookups for most variable accesses.
+ *
+ * \file   resolver.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page binding Static Binding
+ *
+ * Scopes in lci are created at run time for the main block, function bodies,
+ * loops, and the bodies of conditional statements (see \ref varscope).  Values
+ * are added to a scope in the order in which their declarations are executed
+ * and are never removed, so within a single block the position of a variable
+ * is fixed by the position of its declaration statement.
+ *
+ * Two things prevent every identifier from being bound this way:
+ *
+ *   - Function bodies use the scope of their caller as their parent, so any
+ *   name not declared within the function itself is found dynamically.  Array
+ *   bodies are treated the same way.
+ *
+ *   - Declarations with indirect names (\c SRS) or declarations into \c ME add
+ *   names which cannot be known ahead of time.  Once such a declaration appears
+ *   in a block, identifiers that would have to look through that block are left
+ *   unresolved.
+ *
+ * Unresolved identifiers keep a depth of -1 and are looked up by name.  The
+ * names they use, along with the names of called functions, slots, and
+ * deallocated variables, are marked as found by name (see getInternFound()),
+ * and a tree using any indirect name is marked as such, so that the virtual
+ * machine can tell when a scope can be dropped without changing the result of
+ * a later lookup (see \ref vm).
+ */
+
+#ifndef __RESOLVER_H__
+#define __RESOLVER_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "parser.h"
+
+#undef DEBUG
+
+/**
+ * Stores the names declared so far in a scope.
+ */
+typedef struct {
+	unsigned int num;   /**< The number of names declared. */
+	const char **names; /**< The names in declaration order. */
+	int boundary;       /**< Whether the parent of this scope is dynamic. */
+	int poisoned;       /**< Whether unknown names may be declared here. */
+} ResolverFrame;
+
+/**
+ * Stores the state of a resolver pass.
+ */
+typedef struct {
+	unsigned int num;       /**< The number of active frames. */
+	unsigned int max;       /**< The number of allocated frames. */
+	ResolverFrame *frames;  /**< The frames, innermost last. */
+	int indirect;           /**< Whether any indirect name has been seen. */
+} ResolverState;
+
+/**
+ * \name Resolver
+ *
+ * Functions for resolving parse tree identifiers.
+ */
+/**@{*/
+int resolveIdentifierNode(ResolverState *, IdentifierNode *);
+int resolveExprNode(ResolverState *, ExprNode *);
+int resolveExprNodeList(ResolverState *, ExprNodeList *);
+int resolveStmtNode(ResolverState *, StmtNode *);
+int resolveStmtNodeList(ResolverState *, StmtNodeList *);
+int resolveBlockNode(ResolverState *, BlockNode *);
+int resolveMainNode(MainNode *);
+/**@}*/
+
+#endif /* __RESOLVER_H__ */
@@ -0,0 +1,165 @@
+#include "source.h"
+
+#ifdef SOURCE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Maps a regular file into memory.  The mapping is private and writable, so
+ * changes to it (such as blanking out a hash bang line) are not written back
+ * to the file.
+ *
+ * \param [in] file The file to map.
+ *
+ * \param [out] source The source buffer to map \a file into.
+ *
+ * \retval 0 \a file could not be mapped and must be read instead.
+ *
+ * \retval 1 \a file was mapped into \a source.
+ */
+static int mapSourceBuffer(FILE *file,
+                           SourceBuffer *source)
+{
+	struct stat st;
+	long page = sysconf(_SC_PAGESIZE);
+	void *data = NULL;
+	int fd = fileno(file);
+	if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode)) return 0;
+	/*
+	 * The lexer expects a null character after the source, which a mapping
+	 * only provides when the last page is not full (the rest of the page is
+	 * filled with zeroes).
+	 */
+	if (st.st_size <= 0 || page <= 0 || st.st_size % page == 0) return 0;
+	data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) return 0;
+	source->data = data;
+	source->size = st.st_size;
+	source->mapped = st.st_size;
+	return 1;
+}
+#endif
+
+/**
+ * Loads source code with a function which reads it, until its end.
+ *
+ * \param [in] reader The function to read the source code with.
+ *
+ * \param [in] data The data to pass to \a reader.
+ *
+ * \return The source code read, followed by a null character.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+SourceBuffer *readSourceBuffer(SourceReader reader,
+                               void *data)
+{
+	size_t max = SOURCE_READ_SIZE;
+	SourceBuffer *p = malloc(sizeof(SourceBuffer));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->size = 0;
+	p->mapped = 0;
+	p->data = malloc(max);
+	if (!p->data) {
+		perror("malloc");
+		free(p);
+		return NULL;
+	}
+	while (1) {
+		size_t len;
+		/* Double the buffer, leaving room for the null character */
+		if (p->size + 1 == max) {
+			void *mem = realloc(p->data, max * 2);
+			if (!mem) {
+				perror("realloc");
+				goto readSourceBufferAbort;
+			}
+			p->data = mem;
+			max *= 2;
+		}
+		len = reader(p->data + p->size, max - p->size - 1, data);
+		p->size += len;
+		if (!len) break;
+	}
+	p->data[p->size] = '\0';
+	return p;
+
+readSourceBufferAbort: /* Exception handling */
+
+	free(p->data);
+	free(p);
+	return NULL;
+}
+
+/**
+ * Reads from a file for readSourceBuffer().
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \param [in] file The FILE to read from.
+ *
+ * \return The number of bytes read, or zero at the end of the file or on
+ * error.
+ */
+static size_t readSourceFile(char *data,
+                             size_t len,
+                             void *file)
+{
+	return fread(data, 1, len, file);
+}
+
+/**
+ * Loads source code from a file.  Regular files are mapped into memory where
+ * possible; otherwise, the file is read until its end.
+ *
+ * \param [in] file The file to load.
+ *
+ * \return The contents of \a file, followed by a null character.
+ *
+ * \retval NULL Memory allocation or reading failed.
+ */
+SourceBuffer *createSourceBuffer(FILE *file)
+{
+	SourceBuffer *p = NULL;
+#ifdef SOURCE_MMAP
+	p = malloc(sizeof(SourceBuffer));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	if (mapSourceBuffer(file, p)) return p;
+	free(p);
+#endif
+	p = readSourceBuffer(readSourceFile, file);
+	if (p && ferror(file)) {
+		perror("fread");
+		deleteSourceBuffer(p);
+		return NULL;
+	}
+	return p;
+}
+
+/**
+ * Deletes loaded source code.
+ *
+ * \param [in,out] source The source code to delete.
+ *
+ * \post The memory at \a source and all of its members will be freed, or
+ * unmapped if they were mapped.
+ */
+void deleteSourceBuffer(SourceBuffer *source)
+{
+	if (!source) return;
+#ifdef SOURCE_MMAP
+	if (source->mapped) munmap(source->data, source->mapped);
+	else
+#endif
+	free(source->data);
+	free(source);
+}
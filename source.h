@@ -0,0 +1,70 @@
+/**
+ * Structures and functions for loading source code.  Regular files are mapped
+ * into memory instead of being read, so loading a large program does not copy
+ * it; other files (such as the standard input stream) are read into a buffer
+ * which grows geometrically.
+ *
+ * \file   source.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+#ifndef __SOURCE_H__
+#define __SOURCE_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#undef DEBUG
+
+/**
+ * Whether to map regular files into memory (requires POSIX \c mmap).
+ * Otherwise, every file is read.
+ */
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(SOURCE_NO_MMAP)
+#define SOURCE_MMAP
+#endif
+
+/**
+ * The initial size of the buffer for reading source code, in bytes.
+ */
+#define SOURCE_READ_SIZE 4096
+
+/**
+ * Stores loaded source code.
+ */
+typedef struct {
+	char *data;    /**< The characters of the source, followed by a null character. */
+	size_t size;   /**< The number of characters in the source. */
+	size_t mapped; /**< The number of bytes mapped, or 0 if \a data was allocated. */
+} SourceBuffer;
+
+/**
+ * Reads source code for readSourceBuffer().
+ *
+ * \param [out] data The buffer to read into.
+ *
+ * \param [in] len The most bytes to read into \a data.
+ *
+ * \param [in] user The data given to readSourceBuffer().
+ *
+ * \return The number of bytes read into \a data, or zero at the end of the
+ * source code.
+ */
+typedef size_t (*SourceReader)(char *data, size_t len, void *user);
+
+/**
+ * \name Source buffer modifiers
+ *
+ * Functions for loading and deleting source code.
+ */
+/**@{*/
+SourceBuffer *createSourceBuffer(FILE *);
+SourceBuffer *readSourceBuffer(SourceReader, void *);
+void deleteSourceBuffer(SourceBuffer *);
+/**@}*/
+
+#endif /* __SOURCE_H__ */
@@ -0,0 +1,30 @@
+#!/usr/bin/python
+# Writes a program printing COUNT lines of Unicode escapes to OUTPUT.
+import sys
+
+NAMES = [
+  "LATIN SMALL LETTER A WITH GRAVE",
+  "LATIN CAPITAL LETTER E WITH ACUTE",
+  "GREEK SMALL LETTER ALPHA",
+  "GREEK CAPITAL LETTER OMEGA",
+  "LATIN SMALL LETTER SHARP S",
+  "HEBREW LETTER SHIN",
+  "DEVANAGARI LETTER KA",
+  "EURO SIGN",
+  "DOLLAR SIGN",
+  "CENT SIGN",
+  "BLACK HEART SUIT",
+  "SNOWMAN",
+]
+
+output = sys.argv[1]
+count = int(sys.argv[2]) if len(sys.argv) > 2 else 50000
+
+lines = ["HAI 1.3"]
+for n in range(count):
+  names = [NAMES[(n + k) % len(NAMES)] for k in range(4)]
+  lines.append("\tVISIBLE \"%d :[%s]:[%s] :(%04X) :[%s]:[%s]\"" % (n, names[0], names[1], 0x2600 + n % 64, names[2], names[3]))
+lines.append("KTHXBYE")
+
+with open(output, "w") as f:
+  f.write("\n".join(lines) + "\n")
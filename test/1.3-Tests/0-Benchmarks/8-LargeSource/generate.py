@@ -0,0 +1,28 @@
+#!/usr/bin/python
+# Writes a program defining and calling COUNT functions to OUTPUT.
+import sys
+
+output = sys.argv[1]
+count = int(sys.argv[2]) if len(sys.argv) > 2 else 10000
+
+lines = ["HAI 1.3"]
+for n in range(count):
+  lines += [
+    "\tBTW function %d of %d" % (n, count),
+    "\tHOW IZ I f%d YR a AN YR b" % n,
+    "\t\tI HAS A c ITZ SUM OF a AN PRODUKT OF b AN %d" % n,
+    "\t\tBOTH SAEM c AN BIGGR OF c AN %d, O RLY?" % (n * 2),
+    "\t\t\tYA RLY, c R DIFF OF c AN %d" % n,
+    "\t\t\tNO WAI, c R MOD OF c AN 7",
+    "\t\tOIC",
+    "\t\tFOUND YR SMOOSH \"f%d \" AN c MKAY" % n,
+    "\tIF U SAY SO",
+  ]
+lines.append("\tI HAS A last")
+for n in range(count):
+  lines.append("\tlast R I IZ f%d YR %d AN YR 2 MKAY" % (n, n))
+lines.append("\tVISIBLE last")
+lines.append("KTHXBYE")
+
+with open(output, "w") as f:
+  f.write("\n".join(lines) + "\n")
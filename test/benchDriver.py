@@ -0,0 +1,141 @@
+#!/usr/bin/python
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+parser = argparse.ArgumentParser(description="Driver for lci benchmarks")
+parser.add_argument('pathToLCI', help="The absolute path to the lci executable")
+parser.add_argument('-b', '--benchmark', nargs=3, action='append', default=[], metavar=('NAME', 'LOLCODE', 'INPUT'), help="A benchmark to run, with '-' for no input")
+parser.add_argument('-e', '--engine', action='append', default=[], help="An engine to run the benchmarks with (default: ast)")
+parser.add_argument('-n', '--repeat', type=int, default=5, help="The number of times to run each benchmark")
+parser.add_argument('-s', '--statsLibrary', default=None, help="The library to preload to measure allocations and peak RSS")
+parser.add_argument('-o', '--outputFile', default=None, help="The file to write the results to as JSON")
+parser.add_argument('-c', '--baselineFile', default=None, help="Results to compare against, as written by --outputFile")
+parser.add_argument('-t', '--threshold', type=float, default=10.0, help="The slowdown, in percent, counted as a regression")
+
+args = parser.parse_args()
+
+if not args.engine:
+  args.engine = ["ast"]
+
+# Runs lci once, returning its wall time in seconds, its peak RSS in
+# kilobytes, and its allocation count (or None if it is not measured)
+def runOnce(lolcode, input, engine):
+  command = [args.pathToLCI, "--engine=" + engine, lolcode]
+  env = dict(os.environ)
+  statsFile = None
+  if args.statsLibrary:
+    fd, statsFile = tempfile.mkstemp()
+    os.close(fd)
+    env["LD_PRELOAD"] = args.statsLibrary
+    env["LCI_BENCH_STATS"] = statsFile
+  stdin = open(input, 'rb') if input != "-" else open(os.devnull, 'rb')
+  try:
+    start = time.time()
+    p = subprocess.Popen(command, stdin=stdin, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, env=env)
+    # wait4 reports the resource usage of this child alone
+    pid, status, usage = os.wait4(p.pid, 0)
+    wall = time.time() - start
+    if os.WIFEXITED(status):
+      p.returncode = os.WEXITSTATUS(status)
+    else:
+      p.returncode = -os.WTERMSIG(status)
+    error = p.stderr.read()
+    p.stderr.close()
+  finally:
+    stdin.close()
+  if p.returncode != 0:
+    print("Failure! " + " ".join(command) + " returned " + str(p.returncode))
+    print(error)
+    sys.exit(1)
+  # This also counts the memory of this process when it forked lci, so it is
+  # only used when the stats library is not
+  maxrss = usage.ru_maxrss
+  if sys.platform == "darwin":
+    maxrss //= 1024
+  mallocs = None
+  if statsFile:
+    with open(statsFile) as f:
+      stats = f.read().split()
+    os.remove(statsFile)
+    if stats:
+      mallocs = int(stats[0])
+      maxrss = int(stats[1]) or maxrss
+  return wall, maxrss, mallocs
+
+def median(values):
+  values = sorted(values)
+  mid = len(values) // 2
+  if len(values) % 2:
+    return values[mid]
+  return (values[mid - 1] + values[mid]) / 2.0
+
+# Formats the change from an old measurement to a new one
+def change(new, old):
+  if new is None or not old:
+    return "-"
+  return "%+.1f%%" % ((float(new) / old - 1) * 100)
+
+results = []
+print("%-24s %-6s %10s %10s %10s %10s %12s" % ("benchmark", "engine", "min s", "median s", "max s", "peak KB", "mallocs"))
+for name, lolcode, input in args.benchmark:
+  for engine in args.engine:
+    walls = []
+    maxrss = 0
+    mallocs = None
+    for n in range(args.repeat):
+      wall, rss, count = runOnce(lolcode, input, engine)
+      walls.append(wall)
+      maxrss = max(maxrss, rss)
+      mallocs = count
+    result = {
+      "name": name,
+      "engine": engine,
+      "runs": args.repeat,
+      "wall": {
+        "min": min(walls),
+        "median": median(walls),
+        "mean": sum(walls) / len(walls),
+        "max": max(walls),
+      },
+      "maxrss": maxrss,
+      "mallocs": mallocs,
+    }
+    results.append(result)
+    print("%-24s %-6s %10.3f %10.3f %10.3f %10d %12s" % (name, engine, min(walls), result["wall"]["median"], max(walls), maxrss, "-" if mallocs is None else str(mallocs)))
+    sys.stdout.flush()
+
+if args.outputFile:
+  with open(args.outputFile, 'w') as f:
+    json.dump({"lci": args.pathToLCI, "benchmarks": results}, f, indent=2, sort_keys=True)
+    f.write("\n")
+  print("Wrote results to " + args.outputFile)
+
+if args.baselineFile:
+  with open(args.baselineFile) as f:
+    baseline = json.load(f)
+  previous = {}
+  for result in baseline["benchmarks"]:
+    previous[(result["name"], result["engine"])] = result
+  regressions = 0
+  print("")
+  print("Compared with " + args.baselineFile + ":")
+  print("%-24s %-6s %10s %10s %10s" % ("benchmark", "engine", "median", "peak KB", "mallocs"))
+  for result in results:
+    old = previous.get((result["name"], result["engine"]))
+    if not old:
+      print("%-24s %-6s %10s" % (result["name"], result["engine"], "new"))
+      continue
+    slowdown = (result["wall"]["median"] / old["wall"]["median"] - 1) * 100 if old["wall"]["median"] else 0
+    mark = ""
+    if slowdown > args.threshold:
+      mark = "  REGRESSION"
+      regressions += 1
+    print("%-24s %-6s %10s %10s %10s%s" % (result["name"], result["engine"], change(result["wall"]["median"], old["wall"]["median"]), change(result["maxrss"], old["maxrss"]), change(result["mallocs"], old["mallocs"]), mark))
+  if regressions:
+    print("Failure! " + str(regressions) + " benchmark(s) slowed down by more than " + str(args.threshold) + "%")
+    sys.exit(1)
@@ -0,0 +1,61 @@
+/*
+ * Measures the memory used by a process.  This is preloaded into lci by
+ * benchDriver.py, and writes to the file named by LCI_BENCH_STATS, when the
+ * process exits, the number of calls made to malloc(), calloc(), and realloc()
+ * and the peak resident set size in kilobytes.
+ *
+ * The peak is read from /proc rather than left to the parent's getrusage(),
+ * which also counts the memory of the parent when it forked the process.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+static unsigned long Mallocs = 0;
+
+void *malloc(size_t size)
+{
+	Mallocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+	Mallocs++;
+	return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	Mallocs++;
+	return __libc_realloc(ptr, size);
+}
+
+static void __attribute__((destructor)) writeStats(void)
+{
+	unsigned long mallocs = Mallocs;
+	unsigned long maxrss = 0;
+	const char *path = getenv("LCI_BENCH_STATS");
+	char line[256];
+	FILE *file = NULL;
+	if (!path) return;
+	file = fopen("/proc/self/status", "r");
+	if (file) {
+		while (fgets(line, sizeof(line), file)) {
+			if (!strncmp(line, "VmHWM:", 6)) {
+				maxrss = strtoul(line + 6, NULL, 10);
+				break;
+			}
+		}
+		fclose(file);
+	}
+	file = fopen(path, "w");
+	if (!file) return;
+	fprintf(file, "%lu %lu\n", mallocs, maxrss);
+	fclose(file);
+}
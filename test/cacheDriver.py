@@ -0,0 +1,182 @@
+#!/usr/bin/python
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+parser = argparse.ArgumentParser(description="Driver for lci compiled program tests")
+parser.add_argument('pathToLCI', help="The absolute path to the lci executable")
+parser.add_argument('lolcodeFile', help="The absolute path to the lolcode file to compile")
+parser.add_argument('-o', '--outputFile', required=True, help="The expected output, which must contain the marker")
+parser.add_argument('-c', '--case', required=True, choices=['roundtrip', 'stale', 'damaged'], help="What to check")
+parser.add_argument('-m', '--marker', default="cached", help="A string constant in the program which the checks change")
+parser.add_argument('-a', '--lciArgument', action='append', default=[], help="An extra argument to pass to lci")
+
+args = parser.parse_args()
+
+# These must match cache.c
+HASH_BASIS = 0xcbf29ce484222325
+HASH_PRIME = 0x100000001b3
+HASH_SIZE = 8
+MAGIC = b"LOLC"
+
+# The most runs of lci for each kind of damage
+SAMPLES = 200
+
+expectedOutput = open(args.outputFile, 'rb').read()
+marker = args.marker.encode()
+failures = []
+
+# Hashes bytes as compiled programs do (64-bit FNV-1a)
+def hashBytes(data):
+  hash = HASH_BASIS
+  for byte in bytearray(data):
+    hash ^= byte
+    hash = (hash * HASH_PRIME) & 0xffffffffffffffff
+  return hash
+
+# Replaces the hash ending a compiled program with one that matches it, so
+# that damage to it gets past the hash check
+def reseal(data):
+  body = data[:-HASH_SIZE]
+  hash = hashBytes(body)
+  return body + bytes(bytearray((hash >> (8 * n)) & 0xff for n in range(HASH_SIZE)))
+
+# Returns the positions to damage in a compiled program of a given size: the
+# whole header, then evenly spaced positions after it
+def positions(size):
+  step = max(1, size // SAMPLES)
+  return sorted(set(list(range(min(size, 32))) + list(range(32, size, step))))
+
+def fail(what):
+  print("Failure! " + what)
+  failures.append(what)
+
+# Runs lci on a file, returning its exit status and output; the output is
+# discarded when only whether lci crashed matters, since damage which gets
+# past every check may run a different (possibly endless) program
+def run(source, extra=[], keepOutput=True, timeout=None):
+  command = [args.pathToLCI] + extra + args.lciArgument + [source]
+  stdout = subprocess.PIPE if keepOutput else subprocess.DEVNULL
+  p = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=stdout, stderr=subprocess.PIPE)
+  try:
+    results = p.communicate(timeout=timeout)
+  except subprocess.TimeoutExpired:
+    p.kill()
+    p.communicate()
+    return None, b"", b""
+  return p.returncode, results[0] or b"", results[1]
+
+# Checks that lci did not crash or report a memory error
+def checkSound(what, status, errors):
+  if status is not None and status < 0:
+    fail(what + ": lci was killed by signal " + str(-status))
+  elif b"Sanitizer" in errors or b"runtime error" in errors:
+    fail(what + ": " + errors.decode('utf-8', 'replace'))
+
+# Checks that lci ran the program as its source says
+def checkRun(what, source, expected):
+  status, output, errors = run(source)
+  checkSound(what, status, errors)
+  if status != 0:
+    fail(what + ": exit status " + str(status))
+  elif output != expected:
+    fail(what + ": output differs")
+    print("Expected output:")
+    print(expected)
+    print("Actual output:")
+    print(output)
+
+def compileProgram(source):
+  status, output, errors = run(source, ['--compile'])
+  checkSound("compiling", status, errors)
+  if status != 0 or output:
+    fail("compiling did not succeed quietly")
+  if not os.path.exists(source + "c"):
+    fail("compiling did not write " + source + "c")
+    return None
+  return open(source + "c", 'rb').read()
+
+if marker not in expectedOutput:
+  print("Failure! The expected output does not contain the marker")
+  sys.exit(1)
+
+directory = tempfile.mkdtemp()
+try:
+  source = os.path.join(directory, "test.lol")
+  cache = source + "c"
+  shutil.copyfile(args.lolcodeFile, source)
+  text = open(source, 'rb').read()
+  print("Case: " + args.case)
+
+  compiled = compileProgram(source)
+  if compiled is None:
+    sys.exit(1)
+  if compiled[:len(MAGIC)] != MAGIC or reseal(compiled) != compiled:
+    fail("the compiled program does not have the expected format")
+  if marker not in compiled:
+    fail("the compiled program does not contain the marker")
+
+  # The compiled program is what runs: a change to it shows in the output
+  changed = marker.upper()
+  open(cache, 'wb').write(reseal(compiled.replace(marker, changed, 1)))
+  checkRun("running changed compiled", source, expectedOutput.replace(marker, changed))
+  open(cache, 'wb').write(compiled)
+
+  if args.case == 'roundtrip':
+    # The compiled program gives the same output as the source
+    checkRun("running compiled", source, expectedOutput)
+    if open(cache, 'rb').read() != compiled:
+      fail("running changed the compiled program")
+    # Compiling again replaces it
+    compileProgram(source)
+    checkRun("running recompiled", source, expectedOutput)
+
+  elif args.case == 'stale':
+    # Changes of the same size and of another size to the source
+    for replacement in [b"x" * len(marker), marker + b" and then changed"]:
+      open(cache, 'wb').write(compiled)
+      open(source, 'wb').write(text.replace(marker, replacement))
+      checkRun("running stale (" + replacement.decode() + ")", source, expectedOutput.replace(marker, replacement))
+    # A compiled program from another version
+    open(source, 'wb').write(text)
+    versioned = bytearray(compiled)
+    versioned[len(MAGIC)] += 1
+    open(cache, 'wb').write(reseal(bytes(versioned)))
+    checkRun("running another version", source, expectedOutput)
+
+  elif args.case == 'damaged':
+    body = compiled[:-HASH_SIZE]
+    # Damage caught by the hash: the source is parsed instead
+    for length in positions(len(compiled)):
+      open(cache, 'wb').write(compiled[:length])
+      checkRun("truncated to " + str(length), source, expectedOutput)
+    for position in positions(len(compiled)):
+      damaged = bytearray(compiled)
+      damaged[position] ^= 0xff
+      open(cache, 'wb').write(bytes(damaged))
+      checkRun("flipped at " + str(position), source, expectedOutput)
+    # Truncation which gets past the hash is caught while reading the nodes
+    for length in positions(len(body)):
+      if length < len(MAGIC):
+        continue
+      open(cache, 'wb').write(reseal(body[:length] + bytes(HASH_SIZE)))
+      checkRun("resealed truncated to " + str(length), source, expectedOutput)
+    # Other damage which gets past the hash may read as another program,
+    # which need only not crash lci
+    for position in positions(len(body)):
+      for change in [0xff, 0x01, 0x80]:
+        damaged = bytearray(compiled)
+        damaged[position] ^= change
+        open(cache, 'wb').write(reseal(bytes(damaged)))
+        status, output, errors = run(source, keepOutput=False, timeout=5)
+        checkSound("resealed flipped at " + str(position) + " by " + hex(change), status, errors)
+finally:
+  shutil.rmtree(directory)
+
+if failures:
+  print(str(len(failures)) + " failure(s)")
+  sys.exit(1)
+print("Success!")
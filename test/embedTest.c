@@ -0,0 +1,298 @@
+/*
+ * Tests embedding lci through liblci: programs are parsed once and run many
+ * times, with their input, output, and errors handled by callbacks.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "intern.h"
+#include "lci.h"
+#include "profiler.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+typedef struct {
+	const char *input;  /* The input not read yet. */
+	char output[256];   /* The output written. */
+	size_t len;         /* The number of bytes in output. */
+	int errors;         /* The number of errors reported. */
+	int code;           /* The code of the last error reported. */
+} Client;
+
+static size_t readClient(char *data, size_t len, void *user)
+{
+	Client *client = user;
+	size_t left = strlen(client->input);
+	if (len > left) len = left;
+	memcpy(data, client->input, len);
+	client->input += len;
+	return len;
+}
+
+static void writeClient(const char *data, size_t len, void *user)
+{
+	Client *client = user;
+	if (client->len + len >= sizeof(client->output)) return;
+	memcpy(client->output + client->len, data, len);
+	client->len += len;
+	client->output[client->len] = '\0';
+}
+
+static void reportClient(int code, const char *message, void *user)
+{
+	Client *client = user;
+	(void)message;
+	client->errors++;
+	client->code = code;
+}
+
+static int failures = 0;
+
+static void check(int ok, const char *what)
+{
+	if (ok) return;
+	printf("Failure! %s\n", what);
+	failures++;
+}
+
+static const char greet[] =
+	"HAI 1.3\n"
+	"\tI HAS A name\n"
+	"\tGIMMEH name\n"
+	"\tI HAS A count ITZ 0\n"
+	"\tcount R SUM OF count AN 1\n"
+	"\tVISIBLE \"HAI \" name \" \" count\n"
+	"KTHXBYE\n";
+
+static const char divide[] =
+	"HAI 1.3\n"
+	"\tVISIBLE \"before\"\n"
+	"\tVISIBLE QUOSHUNT OF 1 AN 0\n"
+	"\tVISIBLE \"after\"\n"
+	"KTHXBYE\n";
+
+static const char broken[] =
+	"HAI 1.3\n"
+	"\tVISIBLE 1..23\n"
+	"KTHXBYE\n";
+
+static const char keys[] =
+	"HAI 1.3\n"
+	"\tI HAS A k\n"
+	"\tGIMMEH k\n"
+	"\tI HAS A b ITZ A BUKKIT\n"
+	"\tb HAS A x ITZ 1\n"
+	"\tb HAS A SRS k ITZ 2\n"
+	"\tb HAS A SRS SUM OF 123455 AN 1 ITZ 3\n"
+	"\tb'Z SRS k R SUM OF b'Z SRS k AN b'Z SRS \"x\"\n"
+	"\tVISIBLE b'Z SRS k \" \" b'Z x \" \" b'Z SRS 123456\n"
+	"KTHXBYE\n";
+
+static const char *unicode[] = {
+	"HAI 1.3\n"
+	"\tVISIBLE \":[NOT A CHARACTER NAME]\"\n"
+	"KTHXBYE\n",
+	"HAI 1.3\n"
+	"\tVISIBLE \":(110000)\"\n"
+	"KTHXBYE\n"
+};
+
+static void runGreet(MainNode *program, LciEngine engine, const char *name, const char *expected)
+{
+	Client client;
+	LciCallbacks callbacks = { readClient, writeClient, reportClient, NULL };
+	memset(&client, 0, sizeof(client));
+	client.input = name;
+	callbacks.data = &client;
+	check(lciRunProgram(program, engine, &callbacks) == 0, "greet run failed");
+	check(!strcmp(client.output, expected), "greet output differs");
+	check(client.errors == 0, "greet reported an error");
+}
+
+/* Gets the number of executions a profile records for a line or function */
+static unsigned long getProfileCount(const char *path, const char *place)
+{
+	char row[256];
+	char name[128];
+	unsigned long count = 0;
+	unsigned long n, allocs;
+	double total, self;
+	FILE *file = fopen(path, "r");
+	if (!file) return 0;
+	while (fgets(row, sizeof(row), file)) {
+		if (sscanf(row, "%lu %lf %lf %lu %127s", &n, &total, &self, &allocs, name) == 5
+				&& !strcmp(name, place))
+			count = n;
+	}
+	fclose(file);
+	return count;
+}
+
+#ifdef HAVE_PTHREAD_H
+static const char count[] =
+	"HAI 1.3\n"
+	"\tI HAS A name\n"
+	"\tGIMMEH name\n"
+	"\tIM IN YR loop UPPIN YR n TIL BOTH SAEM n AN 50\n"
+	"\t\tVISIBLE n\n"
+	"\tIM OUTTA YR loop\n"
+	"\tVISIBLE name\n"
+	"KTHXBYE\n";
+
+/* Runs its own copy of a program many times alongside other threads */
+static void *runCount(void *data)
+{
+	const char *name = data;
+	char expected[256];
+	MainNode *program = lciParseProgram(count, strlen(count), "count.lol", OPTIMIZE_DEFAULT, NULL);
+	int *ok = malloc(sizeof(int));
+	int n;
+	expected[0] = '\0';
+	for (n = 0; n < 50; n++)
+		sprintf(expected + strlen(expected), "%d\n", n);
+	strcat(expected, name);
+	strcat(expected, "\n");
+	*ok = program != NULL;
+	for (n = 0; program && n < 50; n++) {
+		Client client;
+		LciCallbacks callbacks = { readClient, writeClient, reportClient, NULL };
+		memset(&client, 0, sizeof(client));
+		client.input = name;
+		callbacks.data = &client;
+		if (lciRunProgram(program, n % 2 ? LCI_ENGINE_VM : LCI_ENGINE_AST, &callbacks)
+				|| strcmp(client.output, expected))
+			*ok = 0;
+	}
+	lciDeleteProgram(program);
+	lciCleanupThread();
+	return ok;
+}
+#endif
+
+int main(void)
+{
+	Client client;
+	LciCallbacks callbacks = { readClient, writeClient, reportClient, NULL };
+	MainNode *program = NULL;
+	MainNode *failing = NULL;
+	int n;
+
+	/* Parse once, run many times, each from a fresh global scope */
+	program = lciParseProgram(greet, strlen(greet), "greet.lol", OPTIMIZE_DEFAULT, NULL);
+	check(program != NULL, "greet did not parse");
+	if (!program) return 1;
+	for (n = 0; n < 3; n++) {
+		runGreet(program, LCI_ENGINE_AST, "Ceiling Cat\n", "HAI Ceiling Cat 1\n");
+		runGreet(program, LCI_ENGINE_VM, "Basement Cat", "HAI Basement Cat 1\n");
+	}
+
+	/* Keys computed at run time are not interned */
+	failing = lciParseProgram(keys, strlen(keys), "keys.lol", OPTIMIZE_DEFAULT, NULL);
+	check(failing != NULL, "keys did not parse");
+	for (n = 0; failing && n < 2; n++) {
+		memset(&client, 0, sizeof(client));
+		client.input = "zebra";
+		callbacks.data = &client;
+		check(lciRunProgram(failing, n ? LCI_ENGINE_VM : LCI_ENGINE_AST, &callbacks) == 0, "keys run failed");
+		check(!strcmp(client.output, "3 1 3\n"), "keys output differs");
+	}
+	check(!findInternedString("zebra", 5), "a run-time key was interned");
+	check(!findInternedString("123456", 6), "a sparse integer key was interned");
+	lciDeleteProgram(failing);
+
+	/* Runtime errors are reported once and do not end this program */
+	failing = lciParseProgram(divide, strlen(divide), "divide.lol", OPTIMIZE_DEFAULT, NULL);
+	check(failing != NULL, "divide did not parse");
+	for (n = 0; failing && n < 2; n++) {
+		memset(&client, 0, sizeof(client));
+		client.input = "";
+		callbacks.data = &client;
+		check(lciRunProgram(failing, n ? LCI_ENGINE_VM : LCI_ENGINE_AST, &callbacks) == 531, "divide did not fail with its code");
+		check(client.errors == 1 && client.code == 531, "divide did not report one error");
+		check(!strcmp(client.output, "before\n"), "divide output differs");
+	}
+	lciDeleteProgram(failing);
+
+	/* As are errors in source code */
+	memset(&client, 0, sizeof(client));
+	callbacks.data = &client;
+	failing = lciParseProgram(broken, strlen(broken), "broken.lol", OPTIMIZE_DEFAULT, &callbacks);
+	check(failing == NULL, "broken parsed");
+	check(client.errors == 1, "broken did not report one error");
+	lciDeleteProgram(failing);
+
+	/* Including bad Unicode characters, which are reported nowhere else */
+	for (n = 0; n < 2; n++) {
+		FILE *captured = tmpfile();
+		int saved = dup(fileno(stderr));
+		fflush(stderr);
+		dup2(fileno(captured), fileno(stderr));
+		memset(&client, 0, sizeof(client));
+		callbacks.data = &client;
+		failing = lciParseProgram(unicode[n], strlen(unicode[n]), "unicode.lol", OPTIMIZE_DEFAULT, &callbacks);
+		fflush(stderr);
+		dup2(saved, fileno(stderr));
+		close(saved);
+		check(failing == NULL, "bad Unicode parsed");
+		check(client.errors == 1 && client.code == 424, "bad Unicode did not report one error");
+		fseek(captured, 0, SEEK_END);
+		check(ftell(captured) == 0, "bad Unicode was reported to stderr");
+		fclose(captured);
+		lciDeleteProgram(failing);
+	}
+
+	/* Earlier programs still run */
+	runGreet(program, LCI_ENGINE_AST, "Ceiling Cat", "HAI Ceiling Cat 1\n");
+
+	/* Profiles record only the runs made while profiling */
+	check(startProfile("embedTest.profile"), "profile did not start");
+	for (n = 0; n < 3; n++)
+		runGreet(program, LCI_ENGINE_AST, "Ceiling Cat", "HAI Ceiling Cat 1\n");
+	stopProfile();
+	check(getProfileCount("embedTest.profile", "greet.lol:5") == 3, "profile did not record each run");
+	/* ...after which the interpreter is no longer hooked */
+	runGreet(program, LCI_ENGINE_AST, "Ceiling Cat", "HAI Ceiling Cat 1\n");
+	check(startProfile("embedTest.profile"), "profile did not start again");
+	runGreet(program, LCI_ENGINE_AST, "Ceiling Cat", "HAI Ceiling Cat 1\n");
+	stopProfile();
+	check(getProfileCount("embedTest.profile", "greet.lol:5") == 1, "profile recorded a run made without profiling");
+	remove("embedTest.profile");
+	remove("embedTest.profile" PROFILE_FOLDED_SUFFIX);
+
+#ifdef HAVE_PTHREAD_H
+	/*
+	 * Threads run programs at once, each with its own output, and are not
+	 * recorded by a profile this thread makes meanwhile
+	 */
+	{
+		static char *names[] = { "Ceiling Cat", "Basement Cat", "Longcat", "Tacgnol" };
+		pthread_t threads[4];
+		check(startProfile("embedTest.profile"), "profile did not start alongside threads");
+		for (n = 0; n < 4; n++)
+			check(!pthread_create(threads + n, NULL, runCount, names[n]), "thread did not start");
+		runGreet(program, LCI_ENGINE_AST, "Ceiling Cat", "HAI Ceiling Cat 1\n");
+		for (n = 0; n < 4; n++) {
+			void *ok = NULL;
+			pthread_join(threads[n], &ok);
+			check(ok && *(int *)ok, "thread output differs");
+			free(ok);
+		}
+		stopProfile();
+		check(getProfileCount("embedTest.profile", "greet.lol:5") == 1, "profile did not record this thread");
+		check(getProfileCount("embedTest.profile", "count.lol:5") == 0, "profile recorded other threads");
+		remove("embedTest.profile");
+		remove("embedTest.profile" PROFILE_FOLDED_SUFFIX);
+	}
+#endif
+
+	lciDeleteProgram(program);
+	lciCleanup();
+
+	if (failures) return 1;
+	printf("Success!\n");
+	return 0;
+}
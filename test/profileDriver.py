@@ -0,0 +1,138 @@
+#!/usr/bin/python
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+parser = argparse.ArgumentParser(description="Driver for lci profile tests")
+parser.add_argument('pathToLCI', help="The absolute path to the lci executable")
+parser.add_argument('lolcodeFile', nargs='+', help="The absolute paths to the lolcode files to profile, run one after another")
+parser.add_argument('-f', '--function', action='append', default=[], help="A function and the number of times it is called, as NAME=CALLS")
+parser.add_argument('-a', '--lciArgument', action='append', default=[], help="An extra argument to pass to lci when profiling")
+
+args = parser.parse_args()
+
+# These must match profiler.c
+FOLDED_SUFFIX = ".folded"
+NUMBER = r"\s*(\d+)\s+(\d+\.\d{3})\s+(\d+\.\d{3})\s+(\d+)  "
+FUNCTION_ROW = re.compile("^" + NUMBER + r"(\S+) \((.*):(\d+)\)$")
+LINE_ROW = re.compile("^" + NUMBER + r"(.*):(\d+)$")
+FOLDED_ROW = re.compile(r"^main(;\S+)* (\d+)$")
+
+sources = {}
+for name in args.lolcodeFile:
+  sources[name] = open(name, 'rb').read().decode('utf-8', 'replace').split('\n')
+failures = []
+
+def fail(what):
+  print("Failure! " + what)
+  failures.append(what)
+
+def run(extra):
+  command = [args.pathToLCI] + extra + args.lolcodeFile
+  print("Command: " + " ".join(command))
+  p = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+  results = p.communicate()
+  return p.returncode, results[0], results[1]
+
+# Checks the source line a record names, which must hold what it records
+def checkPlace(row, fname, line, what):
+  source = sources.get(fname)
+  if source is None:
+    fail("row names another file: " + row)
+  elif not 0 < line <= len(source) or not source[line - 1].strip():
+    fail("row names a line without " + what + ": " + row)
+  elif what == "a function" and not re.match(r"\s*HOW IZ ", source[line - 1]):
+    fail("row names a line not defining a function: " + row)
+
+# Checks the rows of one table, returning the names and calls of functions
+def checkTable(rows, pattern, what):
+  calls = {}
+  last = None
+  for row in rows:
+    match = pattern.match(row)
+    if not match:
+      fail("malformed row: " + row)
+      continue
+    count, total, self = int(match.group(1)), float(match.group(2)), float(match.group(3))
+    if count < 1:
+      fail("row counts no executions: " + row)
+    if self > total:
+      fail("row has more self than total time: " + row)
+    if last is not None and self > last:
+      fail("row is not sorted by self time: " + row)
+    last = self
+    if what == "a function":
+      calls[match.group(5)] = count
+      checkPlace(row, match.group(6), int(match.group(7)), what)
+    else:
+      checkPlace(row, match.group(5), int(match.group(6)), what)
+  return calls
+
+directory = tempfile.mkdtemp()
+try:
+  profile = os.path.join(directory, "profile")
+
+  # Profiling, with any other options, changes neither what the programs
+  # write nor how lci exits
+  status, output, errors = run([])
+  profiledStatus, profiledOutput, profiledErrors = run(["--profile=" + profile] + args.lciArgument)
+  if profiledStatus != status:
+    fail("exit status " + str(profiledStatus) + " differs from " + str(status))
+  if profiledOutput != output:
+    fail("output differs")
+    print("Expected output:")
+    print(output)
+    print("Actual output:")
+    print(profiledOutput)
+  if profiledErrors != errors:
+    fail("errors differ")
+    print("Expected errors:")
+    print(errors)
+    print("Actual errors:")
+    print(profiledErrors)
+
+  # The profile is a table of functions and a table of lines
+  report = open(profile).read()
+  print("Profile:")
+  print(report)
+  tables = report.split("\n\n")
+  if len(tables) != 2 or not report.endswith("\n"):
+    fail("the profile does not have two tables")
+    tables = [report, ""]
+  functions = tables[0].strip("\n").split("\n")
+  lines = tables[1].strip("\n").split("\n")
+  if functions[:2] != ["Functions (sorted by self time)",
+      "%12s %12s %12s %12s  %s" % ("calls", "total ms", "self ms", "allocs", "function")]:
+    fail("the table of functions has the wrong heading")
+  if lines[:2] != ["Lines (sorted by self time)",
+      "%12s %12s %12s %12s  %s" % ("count", "total ms", "self ms", "allocs", "line")]:
+    fail("the table of lines has the wrong heading")
+  calls = checkTable(functions[2:], FUNCTION_ROW, "a function")
+  checkTable(lines[2:], LINE_ROW, "a statement")
+  if len(lines) < 3:
+    fail("the table of lines is empty")
+  for expected in args.function:
+    name, count = expected.split("=")
+    if calls.get(name, 0) != int(count):
+      fail(name + " was not called " + count + " times")
+
+  # The folded stacks name the functions profiled
+  folded = open(profile + FOLDED_SUFFIX).read().splitlines()
+  if not folded:
+    fail("the folded stacks are empty")
+  for row in folded:
+    if not FOLDED_ROW.match(row):
+      fail("malformed folded stack: " + row)
+    elif any(name not in calls for name in row.split(" ")[0].split(";")[1:]):
+      fail("folded stack names an unknown function: " + row)
+finally:
+  shutil.rmtree(directory)
+
+if failures:
+  print(str(len(failures)) + " failure(s)")
+  sys.exit(1)
+print("Success!")
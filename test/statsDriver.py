@@ -0,0 +1,41 @@
+#!/usr/bin/python
+import argparse
+import subprocess
+import sys
+
+parser = argparse.ArgumentParser(description="Driver for lci allocation statistics tests")
+parser.add_argument('pathToLCI', help="The absolute path to the lci executable")
+parser.add_argument('lolcodeFile', nargs='+', help="The absolute paths to the lolcode files to run")
+parser.add_argument('-a', '--lciArgument', action='append', default=[], help="An extra argument to pass to lci, compared with running the files one after another")
+
+args = parser.parse_args()
+
+# This must match printAllocationStats()
+HEADING = ["pool", "allocs", "hits", "live", "peak", "slabs"]
+
+# Runs lci with --alloc-stats, returning the objects allocated from each pool
+def allocs(extra):
+  command = [args.pathToLCI, "--alloc-stats"] + extra + args.lolcodeFile
+  print("Command: " + " ".join(command))
+  p = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+  rows = [row.split() for row in p.communicate()[1].decode().splitlines()]
+  print("\n".join(" ".join(row) for row in rows))
+  if p.returncode != 0:
+    print("Failure! Return error code: " + str(p.returncode))
+    sys.exit(1)
+  if rows.count(HEADING) != 1 or rows[0] != HEADING:
+    print("Failure! The statistics are not reported once")
+    sys.exit(1)
+  return dict((row[0], int(row[1])) for row in rows[1:])
+
+# The same objects are allocated however the files are run, counting those
+# allocated on every thread
+expected = allocs([])
+actual = allocs(args.lciArgument)
+if not expected.get("values"):
+  print("Failure! No values were allocated")
+  sys.exit(1)
+if actual != expected:
+  print("Failure! Allocations differ from running the files one after another")
+  sys.exit(1)
+print("Success!")
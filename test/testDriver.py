@@ -12,7 +12,9 @@ parser.add_argument('lolcodeFile', help="The absolute path to the lolcode file t
 parser.add_argument('-o', '--outputFile', type=argparse.FileType('r'), default=None, help="The expected output")
 parser.add_argument('-i', '--inputFile', type=argparse.FileType('r'), default=None, help="File to be used as input")
 parser.add_argument('-e', '--expectError', action="store_true", help="Specify that an error should occur")
+parser.add_argument('-s', '--sameStream', action='store_true', help="Write errors to the output stream, to check their order")
 parser.add_argument('-m', '--memCheck', action='store_true', help="Do a memory check")
+parser.add_argument('-a', '--lciArgument', action='append', default=[], help="An extra argument to pass to lci")
 
 args = parser.parse_args()
 
@@ -37,10 +39,10 @@ if args.memCheck:
 else:
   print("Not doing memory check.")
 
-expectedOutput = ""
+expectedOutput = b""
 if args.outputFile != None:
-  expectedOutput = args.outputFile.read()
   args.outputFile.close()
+  expectedOutput = open(args.outputFile.name, 'rb').read()
 
 command = []
 if args.memCheck:
@@ -49,11 +51,13 @@ if args.memCheck:
   command.append("--leak-check=full")
   command.append("--error-exitcode=" + str(MEMERR))
 command.append(args.pathToLCI)
+command.extend(args.lciArgument)
 command.append(args.lolcodeFile)
 
 print("Command: " + " ".join(command))
 
-p = subprocess.Popen(command, stdin=args.inputFile, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+errors = subprocess.STDOUT if args.sameStream else subprocess.PIPE
+p = subprocess.Popen(command, stdin=args.inputFile, stdout=subprocess.PIPE, stderr=errors)
 results = p.communicate()
 
 if p.returncode == MEMERR:
@@ -70,7 +74,7 @@ if args.expectError:
     print(results[1])
  
 if args.outputFile:
-  if p.returncode != 0:
+  if p.returncode != 0 and not args.expectError:
     print("Failure! Return error code: " + str(p.returncode))
     sys.exit(1)
   elif expectedOutput != results[0]:
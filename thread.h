@@ -0,0 +1,130 @@
+/**
+ * Macros and functions for sharing lci between threads.  State which belongs
+ * to a single run of a program, such as the allocation pools, the output
+ * buffer, and the error handler, is kept per thread with \ref THREAD_LOCAL, so
+ * that each thread runs programs with a context of its own.  The little state
+ * shared by every thread, such as the intern table, is guarded by a Mutex.
+ *
+ * Threads are only used where POSIX threads are available (\c HAVE_PTHREAD_H
+ * is defined by the build); elsewhere, mutexes do nothing and lci runs
+ * everything on a single thread.
+ *
+ * \file   thread.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+#ifndef __THREAD_H__
+#define __THREAD_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#undef DEBUG
+
+/**
+ * Declares a variable with a separate instance for each thread.
+ */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL
+#endif
+
+/**
+ * Reads a variable written by other threads, seeing everything written before
+ * it was stored with storeShared().
+ */
+#if defined(__GNUC__)
+#define loadShared(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#else
+#define loadShared(var) (var)
+#endif
+
+/**
+ * Writes a variable read by other threads with loadShared().
+ */
+#if defined(__GNUC__)
+#define storeShared(var, val) __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#else
+#define storeShared(var, val) ((var) = (val))
+#endif
+
+#ifdef HAVE_PTHREAD_H
+
+/**
+ * Stores a lock held by one thread at a time.
+ */
+typedef pthread_mutex_t Mutex;
+
+/**
+ * Initializes an unlocked mutex.
+ */
+#define MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+/**
+ * Waits for a mutex and locks it.
+ */
+#define lockMutex(mutex) pthread_mutex_lock(mutex)
+
+/**
+ * Unlocks a mutex.
+ */
+#define unlockMutex(mutex) pthread_mutex_unlock(mutex)
+
+/**
+ * Stores a condition which threads wait for while holding a Mutex.
+ */
+typedef pthread_cond_t Condition;
+
+/**
+ * Initializes a condition nobody is waiting for.
+ */
+#define CONDITION_INITIALIZER PTHREAD_COND_INITIALIZER
+
+/**
+ * Unlocks a mutex, waits for a condition to be signaled, and locks the mutex
+ * again.
+ */
+#define waitCondition(cond, mutex) pthread_cond_wait(cond, mutex)
+
+/**
+ * Wakes every thread waiting for a condition.
+ */
+#define signalCondition(cond) pthread_cond_broadcast(cond)
+
+/**
+ * Stores a thread.
+ */
+typedef pthread_t Thread;
+
+/**
+ * Starts a thread running a function, evaluating to zero on success.
+ */
+#define startThread(thread, func, data) pthread_create(thread, NULL, func, data)
+
+/**
+ * Waits for a thread to finish.
+ */
+#define joinThread(thread) pthread_join(thread, NULL)
+
+#else
+
+typedef int Mutex;
+#define MUTEX_INITIALIZER 0
+#define lockMutex(mutex) ((void)(mutex))
+#define unlockMutex(mutex) ((void)(mutex))
+
+#endif
+
+#endif /* __THREAD_H__ */
@@ -116,13 +116,12 @@ Token *createToken(TokenType type,
 		return NULL;
 	}
 	ret->type = type;
-	ret->image = malloc(sizeof(char) * (strlen(image) + 1));
-	if (!(ret->image)) {
-		free(ret);
-		perror("malloc");
-		return NULL;
-	}
-	strcpy(ret->image, image);
+	/**
+	 * \note image is not copied because it is either a constant string or
+	 * the image of a lexeme, and the lexemes outlive the tokens made from
+	 * them.
+	 */
+	ret->image = image;
 	/**
 	 * \note fname is not copied because only one copy is stored for all
 	 * Token structures that share it.
@@ -142,7 +141,6 @@ Token *createToken(TokenType type,
 void deleteToken(Token *token)
 {
 	if (!token) return;
-	free(token->image);
 	free(token);
 }
 
@@ -167,12 +165,15 @@ int addToken(Token ***list,
              Token *token)
 {
 	unsigned int newsize = *num + 1;
-	void *mem = realloc(*list, sizeof(Token *) * newsize);
-	if (!mem) {
-		perror("realloc");
-		return 0;
+	/* Grow the list geometrically, whenever it fills a power of two */
+	if (!(*num & (*num - 1))) {
+		void *mem = realloc(*list, sizeof(Token *) * (*num ? *num * 2 : 1));
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		*list = mem;
 	}
-	*list = mem;
 	(*list)[*num] = token;
 	*num = newsize;
 #ifdef DEBUG
@@ -232,12 +233,55 @@ unsigned int acceptLexemes(LexemeList *lexemes,
 	return offset + 1;
 }
 
+/**
+ * Hashes the first word of a string.  This uses the 32-bit FNV-1a hash.
+ *
+ * \param [in] image The string whose first (space-delimited) word to hash.
+ *
+ * \return The hash of the first word of \a image.
+ */
+unsigned int hashKeywordWord(const char *image)
+{
+	unsigned int hash = 2166136261u;
+	while (*image && *image != ' ') {
+		hash ^= (unsigned char)*image++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * Indexes the keywords by their first word.
+ *
+ * \param [out] index The index to fill in.
+ *
+ * \post \a index will refer to every keyword in the keywords array.
+ */
+void indexKeywords(KeywordIndex *index)
+{
+	int type;
+	memset(index->slots, 0, sizeof(index->slots));
+	/* Prepend in reverse so that each chain is in token type order */
+	for (type = TT_ENDOFTOKENS - 1; type >= 0; type--) {
+		unsigned int slot;
+		index->next[type] = 0;
+		if (!*keywords[type]) continue;
+		index->hashes[type] = hashKeywordWord(keywords[type]);
+		slot = index->hashes[type] & (KEYWORD_INDEX_SIZE - 1);
+		index->next[type] = index->slots[slot];
+		index->slots[slot] = type + 1;
+	}
+}
+
 /**
  * Checks if the next lexemes in a list comprise a keyword and, if so, generates
  * a new token representing that keyword.  Specifically, \a lexemes is searched,
  * starting at \a start for keywords.  If one is found, an appropriate token is
  * created and returned and \a start is incremented by the number of lexemes
- * matched minus one.
+ * matched minus one.  Only the keywords whose first word hashes like the lexeme
+ * at \a start are compared against \a lexemes.
+ *
+ * \param index [in] The index of keywords to search.
  *
  * \param lexemes [in] A list of lexemes to search for keywords in.
  *
@@ -251,18 +295,23 @@ unsigned int acceptLexemes(LexemeList *lexemes,
  *
  * \retval NULL No keywords were found or there was an error allocating memory.
  */
-Token *isKeyword(LexemeList *lexemes,
+Token *isKeyword(KeywordIndex *index,
+                 LexemeList *lexemes,
                  unsigned int *start)
 {
 	Token *token = NULL;
-	TokenType type;
 	const char *fname = lexemes->lexemes[*start]->fname;
 	unsigned int line = lexemes->lexemes[*start]->line;
-	/* For each keyword, */
-	for (type = 0; type != TT_ENDOFTOKENS; type++) {
+	unsigned int hash = hashKeywordWord(lexemes->lexemes[*start]->image);
+	unsigned int n;
+	/* For each keyword with the same first word, */
+	for (n = index->slots[hash & (KEYWORD_INDEX_SIZE - 1)];
+			n; n = index->next[n - 1]) {
+		TokenType type = n - 1;
+		unsigned int num;
+		if (index->hashes[type] != hash) continue;
 		/* Check if the start of lexemes match */
-		unsigned int num = acceptLexemes(lexemes,
-				*start, keywords[type]);
+		num = acceptLexemes(lexemes, *start, keywords[type]);
 		if (!num) continue;
 		/* If so, create a new token for the keyword */
 		token = createToken(type, keywords[type], fname, line);
@@ -273,6 +322,120 @@ Token *isKeyword(LexemeList *lexemes,
 	return token;
 }
 
+/**
+ * Generates the token for the lexemes at a position in a list.  Also parses
+ * integers, floats, and strings into tokens with semantic meaning.
+ *
+ * \param [in] index The index of keywords to search.
+ *
+ * \param [in] list A list of lexemes to tokenize.
+ *
+ * \param [in,out] start The position within \a list of the lexemes to
+ * tokenize.
+ *
+ * \param [in] last The type of the last token generated, or \ref TT_ENDOFTOKENS
+ * if there is none.
+ *
+ * \param [out] token The token generated, or NULL if the lexemes do not
+ * generate a token (such as duplicate newlines).
+ *
+ * \pre Unless the end-of-file lexeme is among them, \a list holds at least
+ * \ref KEYWORD_MAX_WORDS lexemes starting at \a start.
+ *
+ * \post \a start will be incremented by the number of lexemes used minus one.
+ *
+ * \retval 0 An unrecognized token was encountered or memory allocation failed.
+ *
+ * \retval 1 The lexemes were tokenized.
+ */
+int tokenizeLexeme(KeywordIndex *index,
+                   LexemeList *list,
+                   unsigned int *start,
+                   TokenType last,
+                   Token **token)
+{
+	unsigned int n = *start;
+	Lexeme *lexeme = list->lexemes[n];
+	const char *image = lexeme->image;
+	const char *fname = lexeme->fname;
+	unsigned int line = lexeme->line;
+	*token = NULL;
+	/* String */
+	if (isString(image)) {
+		*token = createToken(TT_STRING, image, fname, line);
+	}
+	/* Float */
+	else if (isFloat(image)) {
+		*token = createToken(TT_FLOAT, image, fname, line);
+		if (*token && sscanf(lexeme->image, "%f", &((*token)->data.f)) != 1)
+			error(TK_EXPECTED_FLOATING_POINT, fname, line);
+	}
+	/* Integer */
+	else if (isInteger(image)) {
+		*token = createToken(TT_INTEGER, image, fname, line);
+		if (*token && sscanf(lexeme->image, "%lli", &((*token)->data.i)) != 1)
+			error(TK_EXPECTED_INTEGER, fname, line);
+	}
+	/* FAIL */
+	else if (!strcmp(image, "FAIL")) {
+		*token = createToken(TT_BOOLEAN, "FAIL", fname, line);
+		if (*token) (*token)->data.i = 0;
+	}
+	/* WIN */
+	else if (!strcmp(image, "WIN")) {
+		*token = createToken(TT_BOOLEAN, "WIN", fname, line);
+		if (*token) (*token)->data.i = 1;
+	}
+	/* CAN HAS STDIO? */
+	else if (n < list->num - 2
+			&& !strcmp(lexeme->image, "CAN")
+			&& !strcmp(list->lexemes[n + 1]->image, "HAS")
+			&& !strcmp(list->lexemes[n + 2]->image, "STDIO?")) {
+		*start += 2;
+		/* Just for fun; not actually in spec */
+		return 1;
+	}
+	/* Newline */
+	/* Note that the spec is unclear as to whether a command *must*
+	 * follow a comma.  For now, we let commas end a line. */
+	else if (!strcmp(image, "\n")) {
+		/* Note that we ignore any initial newlines */
+		if (last == TT_ENDOFTOKENS) {
+#ifdef DEBUG
+			fprintf(stderr, "Skipping initial newline.\n");
+#endif
+			return 1;
+		}
+		else if (last == TT_NEWLINE) {
+#ifdef DEBUG
+			fprintf(stderr, "Skipping duplicate newline.\n");
+#endif
+			return 1;
+		}
+		else {
+			*token = createToken(TT_NEWLINE, "end of line", fname, line);
+		}
+	}
+	/* Keyword */
+	else if ((*token = isKeyword(index, list, start))) {
+	}
+	/* Identifier */
+	/* This must be placed after keyword parsing or else most
+	 * keywords would be tokenized as identifiers. */
+	else if (isIdentifier(image)) {
+		*token = createToken(TT_IDENTIFIER, image, fname, line);
+	}
+	/* EOF */
+	else if (!strcmp(image, "$")) {
+		*token = createToken(TT_EOF, "end of file", fname, line);
+	}
+	else {
+		error(TK_UNKNOWN_TOKEN, fname, line, image);
+		return 0;
+	}
+	return *token != NULL;
+}
+
 /**
  * Converts a list of lexemes into tokens.  Also parses integers, floats, and
  * strings into tokens with semantic meaning.
@@ -289,109 +452,229 @@ Token **tokenizeLexemes(LexemeList *list)
 	void *mem = NULL;
 	Token **ret = NULL;
 	unsigned int retsize = 0;
+	KeywordIndex index;
+	TokenType last = TT_ENDOFTOKENS;
 	unsigned int n;
+	indexKeywords(&index);
 	for (n = 0; n < list->num; n++) {
-		Lexeme *lexeme = list->lexemes[n];
-		const char *image = lexeme->image;
-		const char *fname = lexeme->fname;
-		unsigned int line = lexeme->line;
 		Token *token = NULL;
-		/* String */
-		if (isString(image)) {
-			token = createToken(TT_STRING, image, fname, line);
-		}
-		/* Float */
-		else if (isFloat(image)) {
-			token = createToken(TT_FLOAT, image, fname, line);
-			if (sscanf(lexeme->image, "%f", &(token->data.f)) != 1)
-				error(TK_EXPECTED_FLOATING_POINT, fname, line);
-		}
-		/* Integer */
-		else if (isInteger(image)) {
-			token = createToken(TT_INTEGER, image, fname, line);
-			if (sscanf(lexeme->image, "%lli", &(token->data.i)) != 1)
-				error(TK_EXPECTED_INTEGER, fname, line);
-		}
-		/* FAIL */
-		else if (!strcmp(image, "FAIL")) {
-			token = createToken(TT_BOOLEAN, "FAIL", fname, line);
-			token->data.i = 0;
-		}
-		/* WIN */
-		else if (!strcmp(image, "WIN")) {
-			token = createToken(TT_BOOLEAN, "WIN", fname, line);
-			token->data.i = 1;
-		}
-		/* CAN HAS STDIO? */
-		else if (n < list->num - 2
-				&& !strcmp(lexeme->image, "CAN")
-				&& !strcmp(list->lexemes[n + 1]->image, "HAS")
-				&& !strcmp(list->lexemes[n + 2]->image, "STDIO?")) {
-			n += 2;
-			/* Just for fun; not actually in spec */
-			continue;
-		}
-		/* Newline */
-		/* Note that the spec is unclear as to whether a command *must*
-		 * follow a comma.  For now, we let commas end a line. */
-		else if (!strcmp(image, "\n")) {
-			/* Note that we ignore any initial newlines */
-			if (retsize < 1) {
-#ifdef DEBUG
-				fprintf(stderr, "Skipping initial newline.\n");
-#endif
-				continue;
-			}
-			else if (ret[retsize - 1]->type == TT_NEWLINE) {
-#ifdef DEBUG
-				fprintf(stderr, "Skipping duplicate newline.\n");
-#endif
-				continue;
-			}
-			else {
-				token = createToken(TT_NEWLINE, "end of line", fname, line);
-			}
-		}
-		/* Keyword */
-		else if ((token = isKeyword(list, &n))) {
-		}
-		/* Identifier */
-		/* This must be placed after keyword parsing or else most
-		 * keywords would be tokenized as identifiers. */
-		else if (isIdentifier(image)) {
-			token = createToken(TT_IDENTIFIER, image, fname, line);
-		}
-		/* EOF */
-		else if (!strcmp(image, "$")) {
-			token = createToken(TT_EOF, "end of file", fname, line);
-		}
-		else {
-			error(TK_UNKNOWN_TOKEN, fname, line, image);
-			/* Clean up */
-			deleteToken(ret[retsize - 1]);
-			ret[retsize - 1] = NULL;
-			deleteTokens(ret);
-			return NULL;
-		}
-
+		if (!tokenizeLexeme(&index, list, &n, last, &token))
+			goto tokenizeLexemesAbort;
+		if (!token) continue;
 		/* Add the token to the token array */
 		if (!addToken(&ret, &retsize, token)) {
-			/* Clean up */
-			if (token) deleteToken(token);
-			deleteToken(ret[retsize - 1]);
-			ret[retsize - 1] = NULL;
-			deleteTokens(ret);
-			return NULL;
+			deleteToken(token);
+			goto tokenizeLexemesAbort;
 		}
+		last = token->type;
 	}
 	mem = realloc(ret, sizeof(Token *) * ++retsize);
 	if (!mem) {
-		deleteToken(ret[retsize - 2]);
-		ret[retsize - 2] = NULL;
-		deleteTokens(ret);
-		return NULL;
+		perror("realloc");
+		retsize--;
+		goto tokenizeLexemesAbort;
 	}
 	ret = mem;
 	ret[retsize - 1] = NULL;
 	return ret;
+
+tokenizeLexemesAbort: /* Exception handling */
+
+	/* Clean up */
+	for (n = 0; n < retsize; n++)
+		deleteToken(ret[n]);
+	free(ret);
+	return NULL;
+}
+
+/**
+ * Creates a stream of tokens from a buffer of characters.  Lexemes are scanned
+ * and tokenized only as the tokens are needed (see getStreamToken()), so the
+ * whole buffer is never held as lexemes or tokens at once.
+ *
+ * \param [in] buffer The characters to tokenize.
+ *
+ * \param [in] size The number of characters in \a buffer.
+ *
+ * \param [in] fname The name of the file \a buffer was read from.
+ *
+ * \note \a buffer and \a fname are not copied and must outlive the stream.
+ *
+ * \return A stream of the tokens in \a buffer.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+TokenStream *createTokenStream(const char *buffer,
+                               unsigned int size,
+                               const char *fname)
+{
+	TokenStream *p = malloc(sizeof(TokenStream));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->scanner = createLexemeScanner(buffer, size, fname, LEXEME_BLOCK_SIZE);
+	p->lexemes = createLexemeList();
+	if (!p->scanner || !p->lexemes) {
+		deleteLexemeScanner(p->scanner);
+		deleteLexemeList(p->lexemes);
+		free(p);
+		return NULL;
+	}
+	indexKeywords(&p->index);
+	p->last = TT_ENDOFTOKENS;
+	p->base = 0;
+	p->num = 0;
+	p->max = 0;
+	p->tokens = NULL;
+	return p;
+}
+
+/**
+ * Deletes a stream of tokens.
+ *
+ * \param [in,out] stream The stream to delete.
+ *
+ * \post The memory at \a stream and all of its members will be freed.
+ */
+void deleteTokenStream(TokenStream *stream)
+{
+	unsigned int n;
+	if (!stream) return;
+	for (n = 0; n < stream->num; n++)
+		deleteToken(stream->tokens[n]);
+	free(stream->tokens);
+	deleteLexemeList(stream->lexemes);
+	deleteLexemeScanner(stream->scanner);
+	free(stream);
+}
+
+/**
+ * Reads the next token of a stream, scanning and tokenizing as many lexemes as
+ * it takes.
+ *
+ * \param [in,out] stream The stream to read the next token of.
+ *
+ * \post The next token will be added to the end of the tokens of \a stream.
+ * If the source could not be scanned or tokenized, which has been reported as
+ * an error, that token will be an end-of-file token which ends the stream, so
+ * that the parser stops there.
+ *
+ * \retval 0 There are no tokens left or memory allocation failed.
+ *
+ * \retval 1 The next token was read.
+ */
+int readStreamToken(TokenStream *stream)
+{
+	Token *token = NULL;
+	while (!token) {
+		LexemeList *lexemes = stream->lexemes;
+		LexemeScanner *scanner = stream->scanner;
+		unsigned int n = 0;
+		int status = 1;
+		if (stream->last == TT_EOF) return 0;
+		/* Make sure the lexemes of the longest keyword are scanned */
+		while (status && lexemes->num < KEYWORD_MAX_WORDS && !scanner->done)
+			status = scanLexeme(scanner, lexemes);
+		if (status)
+			status = tokenizeLexeme(&stream->index, lexemes, &n, stream->last, &token);
+		if (!status) {
+			token = createToken(TT_EOF, "end of file", scanner->fname, scanner->line);
+			if (!token) return 0;
+			break;
+		}
+		removeLexemes(lexemes, n + 1);
+	}
+	if (stream->num == stream->max) {
+		unsigned int newmax = stream->max ? stream->max * 2 : 64;
+		void *mem = realloc(stream->tokens, sizeof(Token *) * newmax);
+		if (!mem) {
+			perror("realloc");
+			deleteToken(token);
+			return 0;
+		}
+		stream->tokens = mem;
+		stream->max = newmax;
+	}
+	stream->tokens[stream->num++] = token;
+	stream->last = token->type;
+	return 1;
+}
+
+/**
+ * Gets the token at a position in a stream, reading tokens up to it if needed.
+ *
+ * \param [in,out] stream The stream to get the token from.
+ *
+ * \param [in] pos The position of the token within \a stream.
+ *
+ * \pre The token at \a pos has not been released (see releaseStreamTokens()).
+ *
+ * \return The token at \a pos; positions past the end of \a stream get the
+ * end-of-file token.
+ *
+ * \retval NULL An unrecognized token was encountered or memory allocation
+ * failed.
+ */
+Token *getStreamToken(TokenStream *stream,
+                      unsigned int pos)
+{
+	while (pos - stream->base >= stream->num) {
+		if (stream->last == TT_EOF)
+			return stream->tokens[stream->num - 1];
+		if (!readStreamToken(stream)) return NULL;
+	}
+	return stream->tokens[pos - stream->base];
+}
+
+/**
+ * Releases the tokens of a stream before a position.  Once a parser is done
+ * with a sequence of tokens (such as a whole statement), it releases them so
+ * that the stream only holds the tokens still to be parsed.
+ *
+ * \param [in,out] stream The stream to release the tokens of.
+ *
+ * \param [in] pos The position of the first token to keep.
+ *
+ * \post The tokens before \a pos, along with any lexeme images only they used,
+ * will be deleted.
+ */
+void releaseStreamTokens(TokenStream *stream,
+                         unsigned int pos)
+{
+	LexemeBlock *keep = NULL;
+	unsigned int num = pos - stream->base;
+	unsigned int n;
+	if (pos <= stream->base) return;
+	if (num > stream->num) num = stream->num;
+	/* Always keep the end-of-file token for positions past it */
+	if (num == stream->num && stream->last == TT_EOF) num--;
+	for (n = 0; n < num; n++)
+		deleteToken(stream->tokens[n]);
+	stream->num -= num;
+	memmove(stream->tokens, stream->tokens + num,
+			sizeof(Token *) * stream->num);
+	stream->base += num;
+	/* Keep the oldest image block still used by a token or lexeme */
+	for (n = 0; !keep && n < stream->num; n++)
+		keep = getLexemeBlock(stream->lexemes, stream->tokens[n]->image);
+	for (n = 0; !keep && n < stream->lexemes->num; n++)
+		keep = getLexemeBlock(stream->lexemes,
+				stream->lexemes->lexemes[n]->image);
+	deleteLexemeBlocks(stream->lexemes, keep);
+}
+
+/**
+ * Gets the token at a cursor.
+ *
+ * \param [in] cursor The cursor to get the token at.
+ *
+ * \return The token at \a cursor.
+ *
+ * \retval NULL An unrecognized token was encountered or memory allocation
+ * failed.
+ */
+Token *getCursorToken(TokenCursor cursor)
+{
+	return getStreamToken(cursor.stream, cursor.pos);
 }
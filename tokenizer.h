@@ -186,6 +186,23 @@ static const char *keywords[] = {
 };
 #endif
 
+/**
+ * The number of slots in a keyword index.  This must be a power of two.
+ */
+#define KEYWORD_INDEX_SIZE 128
+
+/**
+ * Stores an index of keywords by their first word.  Keywords sharing a slot
+ * are chained in the order of their token types, so that when one keyword
+ * begins with another (like \c ITZ \c A and \c ITZ), the longer keyword is
+ * tried first, just as when searching the keywords array in order.
+ */
+typedef struct {
+	unsigned int hashes[TT_ENDOFTOKENS];    /**< The hash of the first word of each keyword. */
+	unsigned int next[TT_ENDOFTOKENS];      /**< One more than the next keyword in the same slot, or 0. */
+	unsigned int slots[KEYWORD_INDEX_SIZE]; /**< One more than the first keyword in each slot, or 0. */
+} KeywordIndex;
+
 /**
  * Stores token data with semantic meaning.
  */
@@ -200,11 +217,40 @@ typedef union {
 typedef struct {
 	TokenType type;    /**< The type of token. */
 	TokenData data;    /**< The stored data of type \a type. */
-	char *image;       /**< The characters that comprise the token. */
+	const char *image; /**< The characters that comprise the token. */
 	const char *fname; /**< The name of the file containing the token. */
 	unsigned int line; /**< The line number the token was on. */
 } Token;
 
+/**
+ * The most lexemes (words) in any keyword.
+ */
+#define KEYWORD_MAX_WORDS 4
+
+/**
+ * Stores a stream of tokens, read from a buffer of characters as they are
+ * needed.  Tokens are numbered by their position in the stream; the stream
+ * holds those from the first one not yet released onward.
+ */
+typedef struct {
+	LexemeScanner *scanner; /**< The scanner lexemes are read from. */
+	LexemeList *lexemes;    /**< The lexemes scanned but not yet tokenized. */
+	KeywordIndex index;     /**< The index of keywords. */
+	TokenType last;         /**< The type of the last token read, or \ref TT_ENDOFTOKENS. */
+	unsigned int base;      /**< The position of the first token in \a tokens. */
+	unsigned int num;       /**< The number of tokens in \a tokens. */
+	unsigned int max;       /**< The number of tokens allocated. */
+	Token **tokens;         /**< The tokens read but not yet released. */
+} TokenStream;
+
+/**
+ * Stores a position in a stream of tokens.
+ */
+typedef struct {
+	TokenStream *stream; /**< The stream of tokens. */
+	unsigned int pos;    /**< The position within \a stream. */
+} TokenCursor;
+
 /**
  * \name Utilities
  *
@@ -215,7 +261,9 @@ int isInteger(const char *);
 int isFloat(const char *);
 int isString(const char *);
 int isIdentifier(const char *);
-Token *isKeyword(LexemeList *, unsigned int *);
+unsigned int hashKeywordWord(const char *);
+void indexKeywords(KeywordIndex *);
+Token *isKeyword(KeywordIndex *, LexemeList *, unsigned int *);
 /**@}*/
 
 /**
@@ -237,7 +285,22 @@ unsigned int acceptLexemes(LexemeList *, unsigned int, const char *);
  * Generates tokens from lexemes.
  */
 /**@{*/
+int tokenizeLexeme(KeywordIndex *, LexemeList *, unsigned int *, TokenType, Token **);
 Token **tokenizeLexemes(LexemeList *);
 /**@}*/
 
+/**
+ * \name Token streams
+ *
+ * Generates tokens from a buffer as they are needed.
+ */
+/**@{*/
+TokenStream *createTokenStream(const char *, unsigned int, const char *);
+void deleteTokenStream(TokenStream *);
+int readStreamToken(TokenStream *);
+Token *getStreamToken(TokenStream *, unsigned int);
+void releaseStreamTokens(TokenStream *, unsigned int);
+Token *getCursorToken(TokenCursor);
+/**@}*/
+
 #endif /* __TOKENIZER_H__ */
@@ -15,7 +15,14 @@
 #include <stdio.h>
 #include <string.h>
 
-int binarySearch(const char **, int, int, const char *);
+#include "thread.h"
+
+/**
+ * The number of slots in the normative name index.  This must be a power of
+ * two larger than the number of names.
+ */
+#define UNICODE_INDEX_SIZE 65536
+
 long convertNormativeNameToCodePoint(const char *);
 size_t convertCodePointToUTF8(unsigned long, char *);
 
@@ -0,0 +1,1723 @@
+#include "vm.h"
+
+/**
+ * Creates an empty sequence of instructions.
+ *
+ * \return A pointer to an empty sequence of instructions.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+VmCode *createVmCode(void)
+{
+	VmCode *p = malloc(sizeof(VmCode));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->num = 0;
+	p->max = 0;
+	p->instrs = NULL;
+	p->maxstack = 0;
+	p->numconsts = 0;
+	p->consts = NULL;
+	p->numcalls = 0;
+	p->calls = NULL;
+	return p;
+}
+
+/**
+ * Deletes a sequence of instructions.
+ *
+ * \param [in,out] code The sequence of instructions to delete.
+ *
+ * \post The memory at \a code and all of its members will be freed.
+ */
+void deleteVmCode(VmCode *code)
+{
+	unsigned int n;
+	if (!code) return;
+	for (n = 0; n < code->numconsts; n++)
+		releaseImmediateValue(code->consts + n);
+	free(code->consts);
+	for (n = 0; n < code->numcalls; n++)
+		deleteVmCall(code->calls[n]);
+	free(code->calls);
+	free(code->instrs);
+	free(code);
+}
+
+/**
+ * Adds a constant to a sequence of instructions.
+ *
+ * \param [in,out] code The sequence of instructions to add \a value to.
+ *
+ * \param [in] value The constant to add.
+ *
+ * \post On success, \a code will own the reference held by \a value.
+ *
+ * \return The index of the constant in \a code.
+ *
+ * \retval -1 Memory allocation failed.
+ */
+int addVmConstant(VmCode *code,
+                  ImmediateValue *value)
+{
+	void *mem = realloc(code->consts, sizeof(ImmediateValue) * (code->numconsts + 1));
+	if (!mem) {
+		perror("realloc");
+		return -1;
+	}
+	code->consts = mem;
+	code->consts[code->numconsts] = *value;
+	return code->numconsts++;
+}
+
+/**
+ * Creates a function call site.
+ *
+ * \param [in] node The function call expression.
+ *
+ * \return A pointer to a call site for \a node.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+VmCall *createVmCall(FuncCallExprNode *node)
+{
+	VmCall *p = malloc(sizeof(VmCall));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->node = node;
+	p->def = NULL;
+	p->body = NULL;
+	return p;
+}
+
+/**
+ * Deletes a function call site.
+ *
+ * \param [in,out] call The function call site to delete.
+ *
+ * \post The memory at \a call will be freed.
+ */
+void deleteVmCall(VmCall *call)
+{
+	free(call);
+}
+
+/**
+ * Appends an instruction to the code being compiled.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] op The opcode of the instruction.
+ *
+ * \param [in] a The first operand of the instruction.
+ *
+ * \param [in] b The second operand of the instruction.
+ *
+ * \param [in] p The parse tree node operand of the instruction.
+ *
+ * \param [in] delta The change in stack depth caused by the instruction.
+ *
+ * \post The instruction will be the last instruction of \a c's code.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The instruction was appended.
+ */
+int emitVmInstr(VmCompiler *c,
+                VmOpcode op,
+                int a,
+                int b,
+                void *p,
+                int delta)
+{
+	VmCode *code = c->code;
+	VmInstr *instr = NULL;
+	if (code->num == code->max) {
+		unsigned int newmax = code->max ? code->max * 2 : 16;
+		void *mem = realloc(code->instrs, sizeof(VmInstr) * newmax);
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		code->instrs = mem;
+		code->max = newmax;
+	}
+	instr = code->instrs + code->num++;
+	instr->op = op;
+	instr->a = a;
+	instr->b = b;
+	instr->p = p;
+	c->stack += delta;
+	if (c->stack > code->maxstack) code->maxstack = c->stack;
+	return 1;
+}
+
+/**
+ * Points a chain of jumps at a target.  Jumps which have not been patched yet
+ * are chained together through their first operand, ending with -1.
+ *
+ * \param [in,out] code The code containing the jumps.
+ *
+ * \param [in] chain The index of the last jump in the chain.
+ *
+ * \param [in] target The index of the instruction to jump to.
+ */
+void patchVmJumps(VmCode *code,
+                  int chain,
+                  int target)
+{
+	while (chain >= 0) {
+		int next = code->instrs[chain].a;
+		code->instrs[chain].a = target;
+		chain = next;
+	}
+}
+
+/**
+ * Checks if an identifier is a direct name without any slots.
+ *
+ * \param [in] id The identifier to check.
+ *
+ * \return Whether \a id can be evaluated without side effects.
+ */
+int isSimpleIdentifier(IdentifierNode *id)
+{
+	return id->type == IT_DIRECT && !id->slot;
+}
+
+/**
+ * Compiles an operation.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] expr The operation to compile.
+ *
+ * \post Code to push the value of \a expr will be appended to \a c's code.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a expr was compiled.
+ */
+int compileOpExprNode(VmCompiler *c,
+                      OpExprNode *expr)
+{
+	ExprNodeList *args = expr->args;
+	unsigned int n;
+	switch (expr->type) {
+		case OP_ADD:
+		case OP_SUB:
+		case OP_MULT:
+		case OP_DIV:
+		case OP_MOD:
+		case OP_MAX:
+		case OP_MIN:
+			if (!compileExprNode(c, args->exprs[0])) return 0;
+			if (!compileExprNode(c, args->exprs[1])) return 0;
+			/* Fold a scalar constant second operand into the operation */
+			if (c->code->instrs[c->code->num - 1].op == VO_CONST) {
+				VmInstr *last = c->code->instrs + c->code->num - 1;
+				if (!c->code->consts[last->a].value) {
+					last->op = VO_ARITHCONST;
+					last->b = last->a;
+					last->a = expr->type;
+					c->stack--;
+					return 1;
+				}
+			}
+			return emitVmInstr(c, VO_ARITH, expr->type, 0, NULL, -1);
+		case OP_AND:
+		case OP_OR:
+		case OP_XOR: {
+			int chain = -1;
+			for (n = 0; n < args->num; n++) {
+				if (!compileExprNode(c, args->exprs[n])) return 0;
+				if (n == 0) {
+					if (!emitVmInstr(c, VO_BOOLFIRST, 0, expr->type, NULL, 0))
+						return 0;
+				}
+				else if (!emitVmInstr(c, VO_BOOLNEXT, 0, expr->type, NULL, -1))
+					return 0;
+				/* Only AND and OR short circuit */
+				if (expr->type != OP_XOR) {
+					if (!emitVmInstr(c, VO_BOOLTEST, chain, expr->type, NULL, 0))
+						return 0;
+					chain = c->code->num - 1;
+				}
+			}
+			patchVmJumps(c->code, chain, c->code->num);
+			return emitVmInstr(c, VO_BOOLEND, 0, 0, NULL, 0);
+		}
+		case OP_NOT:
+			if (!compileExprNode(c, args->exprs[0])) return 0;
+			return emitVmInstr(c, VO_NOT, 0, 0, NULL, 0);
+		case OP_EQ:
+		case OP_NEQ:
+			if (!compileExprNode(c, args->exprs[0])) return 0;
+			if (!compileExprNode(c, args->exprs[1])) return 0;
+			return emitVmInstr(c, VO_EQUAL, expr->type, 0, NULL, -1);
+		case OP_CAT:
+			for (n = 0; n < args->num; n++) {
+				if (!compileExprNode(c, args->exprs[n])) return 0;
+				if (!emitVmInstr(c, VO_STRING, 0, 0, NULL, 0)) return 0;
+			}
+			return emitVmInstr(c, VO_CONCAT, args->num, 0, NULL, 1 - (int)args->num);
+		default:
+			error(VM_UNKNOWN_OPERATION_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Compiles an interpolated string.  Each piece of literal text is pushed as a
+ * constant and each variable is cast to a string, and the pieces are then
+ * concatenated.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] node The interpolated string to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a node was compiled.
+ */
+int compileStringTemplateNode(VmCompiler *c,
+                              StringTemplateNode *node)
+{
+	unsigned int n;
+	int num = 0;
+	for (n = 0; n < node->num; n++) {
+		if (getInternLength(node->strs[n])) {
+			ImmediateValue val;
+			int index;
+			char *str = createString(node->strs[n], getInternLength(node->strs[n]));
+			ValueObject *value = NULL;
+			if (!str) return 0;
+			value = createStringValueObject(str);
+			if (!value) {
+				deleteString(str);
+				return 0;
+			}
+			val = unboxValueObject(value);
+			index = addVmConstant(c->code, &val);
+			if (index < 0) {
+				releaseImmediateValue(&val);
+				return 0;
+			}
+			if (!emitVmInstr(c, VO_CONST, index, 0, NULL, 1)) return 0;
+			num++;
+		}
+		if (node->vars[n]) {
+			if (!compileExprNode(c, node->vars[n])) return 0;
+			if (!emitVmInstr(c, VO_STRING, 0, 0, NULL, 0)) return 0;
+			num++;
+		}
+	}
+	return emitVmInstr(c, VO_CONCAT, num, 0, NULL, 1 - num);
+}
+
+/**
+ * Compiles a function call.  The arguments are evaluated between the
+ * instruction which creates the frame for the call and the one which makes it.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] expr The function call to compile.
+ *
+ * \param [in] tail Whether the value of the call is returned as soon as the
+ * call returns.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a expr was compiled.
+ */
+int compileFuncCallExprNode(VmCompiler *c,
+                            FuncCallExprNode *expr,
+                            int tail)
+{
+	VmCode *code = c->code;
+	VmCall *call = NULL;
+	VmOpcode op = VO_CALL;
+	void *mem = NULL;
+	unsigned int n;
+	call = createVmCall(expr);
+	if (!call) return 0;
+	mem = realloc(code->calls, sizeof(VmCall *) * (code->numcalls + 1));
+	if (!mem) {
+		perror("realloc");
+		deleteVmCall(call);
+		return 0;
+	}
+	code->calls = mem;
+	code->calls[code->numcalls++] = call;
+	if (!emitVmInstr(c, VO_PREPARE, 0, 0, call, 0)) return 0;
+	for (n = 0; n < expr->args->num; n++) {
+		if (!compileExprNode(c, expr->args->exprs[n])) return 0;
+	}
+	/* Only functions called from the current scope replace their caller */
+	if (tail && isSimpleIdentifier(expr->scope)
+			&& !strcmp((char *)(expr->scope->id), "I"))
+		op = VO_TAILCALL;
+	return emitVmInstr(c, op, (int)expr->args->num, 0, call,
+			1 - (int)expr->args->num);
+}
+
+/**
+ * Compiles an expression.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] node The expression to compile.
+ *
+ * \post Code to push the value of \a node will be appended to \a c's code.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a node was compiled.
+ */
+int compileExprNode(VmCompiler *c,
+                    ExprNode *node)
+{
+	switch (node->type) {
+		case ET_CAST: {
+			CastExprNode *expr = (CastExprNode *)node->expr;
+			if (!compileExprNode(c, expr->target)) return 0;
+			return emitVmInstr(c, VO_CAST, expr->newtype->type, 0, NULL, 0);
+		}
+		case ET_CONSTANT: {
+			ConstantNode *expr = (ConstantNode *)node->expr;
+			ImmediateValue val;
+			int index;
+			if (expr->type == CT_STRING && expr->tmpl)
+				return compileStringTemplateNode(c, expr->tmpl);
+			if (!interpretUnboxedExprNode(node, NULL, &val)) return 0;
+			index = addVmConstant(c->code, &val);
+			if (index < 0) {
+				releaseImmediateValue(&val);
+				return 0;
+			}
+			return emitVmInstr(c, VO_CONST, index, 0, NULL, 1);
+		}
+		case ET_IDENTIFIER:
+			return emitVmInstr(c, VO_LOAD, 0, 0, node->expr, 1);
+		case ET_FUNCCALL:
+			return compileFuncCallExprNode(c, (FuncCallExprNode *)node->expr, 0);
+		case ET_OP:
+			return compileOpExprNode(c, (OpExprNode *)node->expr);
+		case ET_IMPVAR:
+			return emitVmInstr(c, VO_LOADIT, 0, 0, NULL, 1);
+		default:
+			error(VM_UNKNOWN_EXPRESSION_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Compiles an if/then/else statement.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] stmt The statement to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a stmt was compiled.
+ */
+int compileIfThenElseStmtNode(VmCompiler *c,
+                              IfThenElseStmtNode *stmt)
+{
+	int next = -1;
+	int end = -1;
+	unsigned int n;
+	if (!emitVmInstr(c, VO_JUMPITF, -1, 0, NULL, 0)) return 0;
+	next = c->code->num - 1;
+	if (stmt->yes && !compileBlockNode(c, stmt->yes)) return 0;
+	if (!emitVmInstr(c, VO_JUMP, end, 0, NULL, 0)) return 0;
+	end = c->code->num - 1;
+	for (n = 0; n < stmt->guards->num; n++) {
+		patchVmJumps(c->code, next, c->code->num);
+		if (!compileExprNode(c, stmt->guards->exprs[n])) return 0;
+		if (!emitVmInstr(c, VO_JUMPF, -1, 0, NULL, -1)) return 0;
+		next = c->code->num - 1;
+		if (!compileBlockNode(c, stmt->blocks->blocks[n])) return 0;
+		if (!emitVmInstr(c, VO_JUMP, end, 0, NULL, 0)) return 0;
+		end = c->code->num - 1;
+	}
+	patchVmJumps(c->code, next, c->code->num);
+	if (stmt->no && !compileBlockNode(c, stmt->no)) return 0;
+	patchVmJumps(c->code, end, c->code->num);
+	return 1;
+}
+
+/**
+ * Compiles a switch statement.  The guard matching the implicit variable is
+ * looked up in the index of the statement and selects a jump to the start of
+ * its block, from which execution falls through the following blocks until a
+ * break is encountered.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] stmt The statement to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a stmt was compiled.
+ */
+int compileSwitchStmtNode(VmCompiler *c,
+                          SwitchStmtNode *stmt)
+{
+	int breakdepth = c->breakdepth;
+	int breaks = c->breaks;
+	int *cases = NULL;
+	int def = -1;
+	unsigned int n;
+	cases = malloc(sizeof(int) * (stmt->guards->num + 1));
+	if (!cases) {
+		perror("malloc");
+		return 0;
+	}
+	/* Jump through a table indexed by the matching guard */
+	if (!emitVmInstr(c, VO_SWITCH, 0, 0, stmt, 0)) goto compileSwitchStmtNodeAbort;
+	for (n = 0; n < stmt->guards->num; n++) {
+		if (!emitVmInstr(c, VO_JUMP, -1, 0, NULL, 0)) goto compileSwitchStmtNodeAbort;
+		cases[n] = c->code->num - 1;
+	}
+	if (!emitVmInstr(c, VO_JUMP, -1, 0, NULL, 0)) goto compileSwitchStmtNodeAbort;
+	def = c->code->num - 1;
+	/* Breaks within the blocks leave the switch */
+	c->breakdepth = c->depth;
+	c->breaks = -1;
+	for (n = 0; n < stmt->blocks->num; n++) {
+		patchVmJumps(c->code, cases[n], c->code->num);
+		if (!compileBlockNode(c, stmt->blocks->blocks[n])) goto compileSwitchStmtNodeAbort;
+	}
+	if (stmt->def) {
+		if (!emitVmInstr(c, VO_JUMP, c->breaks, 0, NULL, 0)) goto compileSwitchStmtNodeAbort;
+		c->breaks = c->code->num - 1;
+		patchVmJumps(c->code, def, c->code->num);
+		if (!compileBlockNode(c, stmt->def)) goto compileSwitchStmtNodeAbort;
+	}
+	else
+		patchVmJumps(c->code, def, c->code->num);
+	patchVmJumps(c->code, c->breaks, c->code->num);
+	c->breakdepth = breakdepth;
+	c->breaks = breaks;
+	free(cases);
+	return 1;
+
+compileSwitchStmtNodeAbort: /* In case something goes wrong... */
+
+	/* Clean up any allocated structures */
+	free(cases);
+
+	return 0;
+}
+
+/**
+ * Compiles a loop statement.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] stmt The statement to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a stmt was compiled.
+ */
+int compileLoopStmtNode(VmCompiler *c,
+                        LoopStmtNode *stmt)
+{
+	int breakdepth = c->breakdepth;
+	int breaks = c->breaks;
+	int end = -1;
+	int top;
+	if (!emitVmInstr(c, VO_LOOPENTER, 0, 0, stmt, 0)) return 0;
+	c->depth++;
+	top = c->code->num;
+	if (stmt->guard) {
+		if (!compileExprNode(c, stmt->guard)) return 0;
+		if (!emitVmInstr(c, VO_LOOPTEST, -1, 0, NULL, -1)) return 0;
+		end = c->code->num - 1;
+	}
+	/* Breaks within the body leave the loop */
+	c->breakdepth = c->depth;
+	c->breaks = end;
+	if (stmt->body) {
+		/* Each iteration reuses the body scope of the last one */
+		if (!emitVmInstr(c, VO_ENTER, 0, 1, NULL, 0)) return 0;
+		c->depth++;
+		if (!compileStmtNodeList(c, stmt->body->stmts)) return 0;
+		c->depth--;
+		if (!emitVmInstr(c, VO_LEAVE, 1, 1, NULL, 0)) return 0;
+	}
+	if (stmt->update) {
+		/*
+		 * As in the interpreter, if we know the operation to perform,
+		 * don't bother evaluating the ExprNode structure, just go ahead
+		 * and do it to the loop variable.
+		 */
+		if (stmt->update->type == ET_OP) {
+			OpExprNode *op = (OpExprNode *)stmt->update->expr;
+			int step = 0;
+			if (op->type == OP_ADD) step = 1;
+			else if (op->type == OP_SUB) step = -1;
+			if (!emitVmInstr(c, VO_LOOPSTEP, step, 0, stmt->var, 0)) return 0;
+		}
+		else {
+			if (!compileExprNode(c, stmt->update)) return 0;
+			if (!emitVmInstr(c, VO_LOOPSTORE, 0, 0, stmt->var, -1)) return 0;
+		}
+	}
+	if (!emitVmInstr(c, VO_JUMP, top, 0, NULL, 0)) return 0;
+	patchVmJumps(c->code, c->breaks, c->code->num);
+	c->breakdepth = breakdepth;
+	c->breaks = breaks;
+	c->depth--;
+	return emitVmInstr(c, VO_LEAVE, 1, 0, NULL, 0);
+}
+
+/**
+ * Compiles a statement.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] node The statement to compile.
+ *
+ * \post Code to execute \a node will be appended to \a c's code.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a node was compiled.
+ */
+int compileStmtNode(VmCompiler *c,
+                    StmtNode *node)
+{
+	switch (node->type) {
+		case ST_PRINT: {
+			PrintStmtNode *stmt = (PrintStmtNode *)node->stmt;
+			unsigned int n;
+			for (n = 0; n < stmt->args->num; n++) {
+				if (!compileExprNode(c, stmt->args->exprs[n])) return 0;
+				if (!emitVmInstr(c, VO_PRINT, 0, 0, NULL, -1)) return 0;
+			}
+			if (!stmt->nonl)
+				return emitVmInstr(c, VO_NEWLINE, 0, 0, NULL, 0);
+			return 1;
+		}
+		case ST_ASSIGNMENT: {
+			AssignmentStmtNode *stmt = (AssignmentStmtNode *)node->stmt;
+			if (!compileExprNode(c, stmt->expr)) return 0;
+			/* Let a concatenation append to the target in place */
+			if (stmt->expr->type == ET_OP
+					&& ((OpExprNode *)stmt->expr->expr)->type == OP_CAT
+					&& isSimpleIdentifier(stmt->target))
+				c->code->instrs[c->code->num - 1].p = stmt->target;
+			return emitVmInstr(c, VO_STORE, 0, 0, stmt->target, -1);
+		}
+		case ST_DECLARATION: {
+			DeclarationStmtNode *stmt = (DeclarationStmtNode *)node->stmt;
+			/*
+			 * The scope and target are evaluated twice, so only
+			 * compile declarations where this has no side effects.
+			 */
+			if (!stmt->expr
+					|| !isSimpleIdentifier(stmt->scope)
+					|| !isSimpleIdentifier(stmt->target))
+				return emitVmInstr(c, VO_STMT, 0, 0, node, 0);
+			if (!emitVmInstr(c, VO_DECLCHECK, 0, 0, stmt, 0)) return 0;
+			if (!compileExprNode(c, stmt->expr)) return 0;
+			return emitVmInstr(c, VO_DECLARE, 0, 0, stmt, -1);
+		}
+		case ST_IFTHENELSE:
+			return compileIfThenElseStmtNode(c, (IfThenElseStmtNode *)node->stmt);
+		case ST_SWITCH:
+			return compileSwitchStmtNode(c, (SwitchStmtNode *)node->stmt);
+		case ST_BREAK:
+			/* Breaks outside of loops and switches end the code */
+			if (c->breakdepth < 0)
+				return emitVmInstr(c, VO_BREAK, 0, 0, NULL, 0);
+			if (c->depth > (unsigned int)c->breakdepth
+					&& !emitVmInstr(c, VO_LEAVE, c->depth - c->breakdepth, 0, NULL, 0))
+				return 0;
+			if (!emitVmInstr(c, VO_JUMP, c->breaks, 0, NULL, 0)) return 0;
+			c->breaks = c->code->num - 1;
+			return 1;
+		case ST_RETURN: {
+			ReturnStmtNode *stmt = (ReturnStmtNode *)node->stmt;
+			if (stmt->value->type == ET_FUNCCALL) {
+				if (!compileFuncCallExprNode(c, stmt->value->expr, 1))
+					return 0;
+			}
+			else if (!compileExprNode(c, stmt->value)) return 0;
+			return emitVmInstr(c, VO_RETURN, 0, 0, NULL, -1);
+		}
+		case ST_LOOP:
+			return compileLoopStmtNode(c, (LoopStmtNode *)node->stmt);
+		case ST_EXPR:
+			if (!compileExprNode(c, (ExprNode *)node->stmt)) return 0;
+			return emitVmInstr(c, VO_STOREIT, 0, 0, NULL, -1);
+		case ST_CAST:
+		case ST_INPUT:
+		case ST_DEALLOCATION:
+		case ST_FUNCDEF:
+		case ST_ALTARRAYDEF:
+			return emitVmInstr(c, VO_STMT, 0, 0, node, 0);
+		default:
+			error(VM_UNKNOWN_STATEMENT_TYPE);
+			return 0;
+	}
+}
+
+/**
+ * Compiles a list of statements.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] list The statements to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a list was compiled.
+ */
+int compileStmtNodeList(VmCompiler *c,
+                        StmtNodeList *list)
+{
+	unsigned int n;
+	for (n = 0; n < list->num; n++) {
+		if (!compileStmtNode(c, list->stmts[n])) return 0;
+	}
+	return 1;
+}
+
+/**
+ * Compiles a block of code, which is executed in its own scope.
+ *
+ * \param [in,out] c The compiler state.
+ *
+ * \param [in] node The block of code to compile.
+ *
+ * \retval 0 An error occurred during compilation.
+ *
+ * \retval 1 \a node was compiled.
+ */
+int compileBlockNode(VmCompiler *c,
+                     BlockNode *node)
+{
+	if (!emitVmInstr(c, VO_ENTER, 0, 0, NULL, 0)) return 0;
+	c->depth++;
+	if (!compileStmtNodeList(c, node->stmts)) return 0;
+	c->depth--;
+	return emitVmInstr(c, VO_LEAVE, 1, 0, NULL, 0);
+}
+
+/**
+ * Compiles the body of a function.  As in the interpreter, the body is executed
+ * directly in the scope created for the call.
+ *
+ * \param [in] def The function definition to compile.
+ *
+ * \return The compiled code.
+ *
+ * \retval NULL An error occurred during compilation.
+ */
+VmCode *compileFuncCode(FuncDefStmtNode *def)
+{
+	VmCompiler c;
+	c.code = createVmCode();
+	if (!c.code) return NULL;
+	c.depth = 0;
+	c.stack = 0;
+	c.breakdepth = -1;
+	c.breaks = -1;
+	if (!compileStmtNodeList(&c, def->body->stmts)
+			|| !emitVmInstr(&c, VO_END, 0, 0, NULL, 0)) {
+		deleteVmCode(c.code);
+		return NULL;
+	}
+	return c.code;
+}
+
+/**
+ * Compiles the main block of code.
+ *
+ * \param [in] main The main block of code to compile.
+ *
+ * \return The compiled code.
+ *
+ * \retval NULL An error occurred during compilation.
+ */
+VmCode *compileMainCode(MainNode *main)
+{
+	VmCompiler c;
+	c.code = createVmCode();
+	if (!c.code) return NULL;
+	c.depth = 0;
+	c.stack = 0;
+	c.breakdepth = -1;
+	c.breaks = -1;
+	if (!compileBlockNode(&c, main->block)
+			|| !emitVmInstr(&c, VO_END, 0, 0, NULL, 0)) {
+		deleteVmCode(c.code);
+		return NULL;
+	}
+	return c.code;
+}
+
+/**
+ * Creates a virtual machine.
+ *
+ * \return A pointer to a virtual machine with an empty stack.
+ *
+ * \retval NULL Memory allocation failed.
+ */
+VmState *createVmState(void)
+{
+	VmState *p = malloc(sizeof(VmState));
+	if (!p) {
+		perror("malloc");
+		return NULL;
+	}
+	p->sp = 0;
+	p->max = 0;
+	p->stack = NULL;
+	p->numfuncs = 0;
+	p->defs = NULL;
+	p->funcs = NULL;
+	p->numframes = 0;
+	p->maxframes = 0;
+	p->frames = NULL;
+	p->tailcalls = 0;
+	return p;
+}
+
+/**
+ * Deletes a virtual machine.
+ *
+ * \param [in,out] vm The virtual machine to delete.
+ *
+ * \pre No calls are in progress on \a vm.
+ *
+ * \post The memory at \a vm, any values on its stack, and its compiled
+ * functions will be freed.
+ */
+void deleteVmState(VmState *vm)
+{
+	unsigned int n;
+	if (!vm) return;
+	while (vm->sp > 0)
+		releaseImmediateValue(vm->stack + --vm->sp);
+	free(vm->stack);
+	free(vm->frames);
+	for (n = 0; n < vm->numfuncs; n++)
+		deleteVmCode(vm->funcs[n]);
+	free(vm->defs);
+	free(vm->funcs);
+	free(vm);
+}
+
+/**
+ * Gets the compiled body of a function, compiling it if this has not yet been
+ * done.
+ *
+ * \param [in,out] vm The virtual machine to store the compiled body in.
+ *
+ * \param [in] def The function definition to get the compiled body of.
+ *
+ * \return The compiled body of \a def.
+ *
+ * \retval NULL An error occurred during compilation.
+ */
+VmCode *getFuncCode(VmState *vm,
+                    FuncDefStmtNode *def)
+{
+	unsigned int n;
+	VmCode *code = NULL;
+	void *mem = NULL;
+	for (n = 0; n < vm->numfuncs; n++) {
+		if (vm->defs[n] == def) return vm->funcs[n];
+	}
+	code = compileFuncCode(def);
+	if (!code) return NULL;
+	mem = realloc(vm->defs, sizeof(FuncDefStmtNode *) * (vm->numfuncs + 1));
+	if (!mem) {
+		perror("realloc");
+		deleteVmCode(code);
+		return NULL;
+	}
+	vm->defs = mem;
+	mem = realloc(vm->funcs, sizeof(VmCode *) * (vm->numfuncs + 1));
+	if (!mem) {
+		perror("realloc");
+		deleteVmCode(code);
+		return NULL;
+	}
+	vm->funcs = mem;
+	vm->defs[vm->numfuncs] = def;
+	vm->funcs[vm->numfuncs] = code;
+	vm->numfuncs++;
+	return code;
+}
+
+/**
+ * Gets a value to cast from an unboxed value.  Scalar values are copied into
+ * \a tmp rather than boxed, which is safe because casts never keep a
+ * reference to the value they cast.
+ *
+ * \param [in] val The unboxed value to cast.
+ *
+ * \param [out] tmp Storage for the value if \a val is a scalar value.
+ *
+ * \return A value with the same type and contents as \a val, which must not be
+ * used after \a val is released.
+ */
+static ValueObject *getCastValue(ImmediateValue *val,
+                                 ValueObject *tmp)
+{
+	if (val->value) return val->value;
+	tmp->type = val->type;
+	tmp->data = val->data;
+	tmp->semaphore = 1;
+	return tmp;
+}
+
+/**
+ * Pushes a value onto the stack of the virtual machine.
+ */
+#define PUSH(value) (vm->stack[vm->sp++] = (value))
+
+/**
+ * Pops a value from the stack of the virtual machine.
+ */
+#define POP() (vm->stack[--vm->sp])
+
+/**
+ * Releases a value popped from the stack of the virtual machine.  Scalar values
+ * hold no reference, so this is checked before calling releaseImmediateValue().
+ */
+#define RELEASE(val) do { if ((val)->value) releaseImmediateValue(val); } while (0)
+
+/**
+ * Retrieves a pointer to the value at the top of the stack of the virtual
+ * machine.
+ */
+#define TOP() (vm->stack + vm->sp - 1)
+
+/**
+ * Stores an unboxed value as storeImmediateValue() does, overwriting a scalar
+ * value which is not shared without calling it.
+ */
+#define STORE(dest, val) ((*(dest))->semaphore == 1 \
+		&& isScalarType((*(dest))->type) && !(val)->value \
+		? ((*(dest))->type = (val)->type, (*(dest))->data = (val)->data, 1) \
+		: storeImmediateValue(dest, val))
+
+/**
+ * Casts an unboxed value to a boolean, as castBooleanImmediate() does, without
+ * calling it for values which are already booleans.
+ */
+#define TRUTH(val, truth) ((val)->type == VT_BOOLEAN \
+		? (*(truth) = (int)(val)->data.i, 1) \
+		: castBooleanImmediate(val, truth))
+
+#ifdef VM_THREADED
+/**
+ * Marks the handler for an opcode.
+ */
+#define VM_OP(op) do_##op:
+
+/**
+ * Jumps to the handler for the current instruction.
+ */
+#define VM_DISPATCH() __extension__ ({ goto *labels[pc->op]; })
+#else
+#define VM_OP(op) case op:
+#define VM_DISPATCH() goto dispatch
+#endif
+
+/**
+ * Advances to and executes the next instruction.
+ */
+#define VM_NEXT() do { pc++; VM_DISPATCH(); } while (0)
+
+/**
+ * Jumps to and executes the instruction at \a target.
+ */
+#define VM_JUMP(target) do { pc = code->instrs + (target); VM_DISPATCH(); } while (0)
+
+/**
+ * Makes sure the stack of a virtual machine can hold a number of values in
+ * addition to those already on it.
+ *
+ * \param [in,out] vm The virtual machine whose stack to grow.
+ *
+ * \param [in] num The number of values to make room for.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The stack of \a vm can hold \a num more values.
+ */
+static int reserveVmStack(VmState *vm,
+                          unsigned int num)
+{
+	unsigned int newmax;
+	void *mem = NULL;
+	if (vm->sp + num <= vm->max) return 1;
+	newmax = (vm->sp + num) * 2;
+	mem = realloc(vm->stack, sizeof(ImmediateValue) * newmax);
+	if (!mem) {
+		perror("realloc");
+		return 0;
+	}
+	vm->stack = mem;
+	vm->max = newmax;
+	return 1;
+}
+
+/**
+ * Adds a pending call to the frames of a virtual machine.
+ *
+ * \param [in,out] vm The virtual machine to add the call to.
+ *
+ * \param [in] def The function being called.
+ *
+ * \param [in] frame The scope created for the call.
+ *
+ * \retval 0 Memory allocation failed.
+ *
+ * \retval 1 The call was added.
+ */
+static int pushVmFrame(VmState *vm,
+                       FuncDefStmtNode *def,
+                       ScopeObject *frame)
+{
+	VmFrame *f = NULL;
+	if (vm->numframes == vm->maxframes) {
+		unsigned int newmax = vm->maxframes ? vm->maxframes * 2 : 64;
+		void *mem = realloc(vm->frames, sizeof(VmFrame) * newmax);
+		if (!mem) {
+			perror("realloc");
+			return 0;
+		}
+		vm->frames = mem;
+		vm->maxframes = newmax;
+	}
+	f = vm->frames + vm->numframes++;
+	f->def = def;
+	f->frame = frame;
+	f->code = NULL;
+	return 1;
+}
+
+/**
+ * Moves the arguments of the innermost pending call from the stack into its
+ * frame and gets the code of the function being called.
+ *
+ * \param [in,out] vm The virtual machine making the call.
+ *
+ * \param [in] pc The calling instruction.
+ *
+ * \param [in] scope The scope the call is made from.
+ *
+ * \post The arguments will have been popped from the stack of \a vm.
+ *
+ * \return The code of the function, with room made on the stack for it.
+ *
+ * \retval NULL An error occurred.
+ */
+static VmCode *bindVmCall(VmState *vm,
+                          VmInstr *pc,
+                          ScopeObject *scope)
+{
+	VmCall *call = pc->p;
+	VmFrame *f = vm->frames + vm->numframes - 1;
+	IdentifierNodeList *args = f->def->args;
+	unsigned int n;
+	vm->sp -= pc->a;
+	for (n = 0; n < args->num; n++) {
+		ImmediateValue *val = vm->stack + vm->sp + n;
+		if (!updateScopeImmediate(scope, f->frame, args->ids[n], val)) {
+			/* Release the arguments not yet moved */
+			for (; n < args->num; n++)
+				RELEASE(vm->stack + vm->sp + n);
+			return NULL;
+		}
+	}
+	/* Most call sites always call the same function */
+	if (call->def != f->def) {
+		call->body = getFuncCode(vm, f->def);
+		if (!call->body) {
+			call->def = NULL;
+			return NULL;
+		}
+		call->def = f->def;
+	}
+	if (!reserveVmStack(vm, call->body->maxstack)) return NULL;
+	return call->body;
+}
+
+/**
+ * Checks whether the scopes of the innermost call in progress may be dropped
+ * before the call returns without the program being able to tell.
+ *
+ * \param [in] scope The current scope of the call.
+ *
+ * \param [in] base The frame of the call.
+ *
+ * \retval 0 A value in the scopes may be looked up by name or an array may
+ * refer to one of them.
+ *
+ * \retval 1 The scopes may be dropped.
+ */
+static int isDroppable(ScopeObject *scope,
+                       ScopeObject *base)
+{
+	for (;;) {
+		unsigned int n;
+		if (scope->owner || scope->numelems) return 0;
+		for (n = 0; n < scope->numvals; n++) {
+			if (getInternFound(scope->names[n])) return 0;
+		}
+		if (scope == base) return 1;
+		scope = scope->parent;
+	}
+}
+
+/**
+ * Executes code.
+ *
+ * \param [in,out] vm The virtual machine to execute \a code on.
+ *
+ * \param [in] code The code to execute.
+ *
+ * \param [in,out] scope The scope to execute \a code under.
+ *
+ * \param [out] type How execution of \a code ended.
+ *
+ * \param [out] value The returned value or, for code compiled from an
+ * expression, the value of the expression (nil if there is none).
+ *
+ * \post Any scopes entered by \a code, and any functions it called, will have
+ * been left.
+ *
+ * \retval 0 An error occurred during execution.
+ *
+ * \retval 1 \a code was executed.
+ */
+int executeVmCode(VmState *vm,
+                  VmCode *code,
+                  ScopeObject *scope,
+                  ReturnType *type,
+                  ImmediateValue *value)
+{
+#ifdef VM_THREADED
+	static const void *labels[VO_MAX] = {
+		__extension__ &&do_VO_END,
+		__extension__ &&do_VO_STMT,
+		__extension__ &&do_VO_CONST,
+		__extension__ &&do_VO_LOAD,
+		__extension__ &&do_VO_LOADIT,
+		__extension__ &&do_VO_STORE,
+		__extension__ &&do_VO_STOREIT,
+		__extension__ &&do_VO_DECLCHECK,
+		__extension__ &&do_VO_DECLARE,
+		__extension__ &&do_VO_CAST,
+		__extension__ &&do_VO_ARITH,
+		__extension__ &&do_VO_ARITHCONST,
+		__extension__ &&do_VO_EQUAL,
+		__extension__ &&do_VO_NOT,
+		__extension__ &&do_VO_BOOLFIRST,
+		__extension__ &&do_VO_BOOLNEXT,
+		__extension__ &&do_VO_BOOLTEST,
+		__extension__ &&do_VO_BOOLEND,
+		__extension__ &&do_VO_STRING,
+		__extension__ &&do_VO_CONCAT,
+		__extension__ &&do_VO_PRINT,
+		__extension__ &&do_VO_NEWLINE,
+		__extension__ &&do_VO_PREPARE,
+		__extension__ &&do_VO_CALL,
+		__extension__ &&do_VO_TAILCALL,
+		__extension__ &&do_VO_JUMP,
+		__extension__ &&do_VO_JUMPF,
+		__extension__ &&do_VO_JUMPITF,
+		__extension__ &&do_VO_SWITCH,
+		__extension__ &&do_VO_ENTER,
+		__extension__ &&do_VO_LEAVE,
+		__extension__ &&do_VO_LOOPENTER,
+		__extension__ &&do_VO_LOOPTEST,
+		__extension__ &&do_VO_LOOPSTEP,
+		__extension__ &&do_VO_LOOPSTORE,
+		__extension__ &&do_VO_BREAK,
+		__extension__ &&do_VO_RETURN };
+#endif
+	ScopeObject *base = scope;
+	unsigned int bottom = vm->sp;
+	unsigned int entry = vm->sp;
+	unsigned int depth = vm->numframes;
+	VmInstr *pc = code->instrs;
+	ImmediateValue val;
+	ImmediateValue ret;
+	ReturnType rtype;
+	ValueObject tmp;
+	ValueObject *cast = NULL;
+	int truth;
+
+	*type = RT_DEFAULT;
+	*value = createNilImmediateValue();
+
+	/* Make sure the stack can hold everything this code pushes */
+	if (!reserveVmStack(vm, code->maxstack)) return 0;
+
+#ifdef VM_THREADED
+	VM_DISPATCH();
+#else
+dispatch:
+	switch (pc->op) {
+#endif
+
+	VM_OP(VO_END)
+		rtype = RT_DEFAULT;
+		if (vm->sp > bottom) val = POP();
+		else val = createNilImmediateValue();
+		goto executeVmCodeDone;
+
+	VM_OP(VO_STMT) {
+		ReturnObject *r = interpretStmtNode(pc->p, scope);
+		if (!r) goto executeVmCodeAbort;
+		deleteReturnObject(r);
+		VM_NEXT();
+	}
+
+	VM_OP(VO_CONST)
+		val = code->consts[pc->a];
+		if (val.value) {
+			/* Avoid overflowing the semaphore of the constant */
+			if (val.value->semaphore < UINT_MAX)
+				copyValueObject(val.value);
+			else if (!(val.value = duplicateValueObject(val.value)))
+				goto executeVmCodeAbort;
+			val.data = val.value->data;
+		}
+		PUSH(val);
+		VM_NEXT();
+
+	VM_OP(VO_LOAD) {
+		IdentifierNode *id = pc->p;
+		ScopeObject *holder = NULL;
+		ValueObject *load = NULL;
+		/* Read the static binding of the identifier if it has one */
+		if (!id->slot && (holder = getBoundScopeObject(scope, id)))
+			load = holder->values[id->index];
+		else if (!(load = getScopeValue(scope, scope, id)))
+			goto executeVmCodeAbort;
+		/* Copy it as copyImmediateValue() does */
+		val.type = load->type;
+		val.data = load->data;
+		val.value = isScalarType(load->type) ? NULL : copyValueObject(load);
+		PUSH(val);
+		VM_NEXT();
+	}
+
+	VM_OP(VO_LOADIT)
+		PUSH(copyImmediateValue(scope->impvar));
+		VM_NEXT();
+
+	VM_OP(VO_STORE) {
+		IdentifierNode *id = pc->p;
+		ScopeObject *holder = NULL;
+		val = POP();
+		/* Write the static binding of the identifier if it has one */
+		if (!id->slot && (holder = getBoundScopeObject(scope, id))
+				? !STORE(holder->values + id->index, &val)
+				: !updateScopeImmediate(scope, scope, id, &val)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+	}
+
+	VM_OP(VO_STOREIT)
+		val = POP();
+		if (!STORE(&scope->impvar, &val)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+
+	VM_OP(VO_DECLCHECK) {
+		DeclarationStmtNode *stmt = pc->p;
+		ScopeObject *dest = getScopeObject(scope, scope, stmt->scope);
+		if (!dest) goto executeVmCodeAbort;
+		if (getScopeValueLocal(scope, dest, stmt->target)) {
+			IdentifierNode *id = (IdentifierNode *)(stmt->target);
+			const char *name = resolveIdentifierName(id, scope);
+			if (name) {
+				error(IN_REDEFINITION_OF_VARIABLE, id->fname, id->line, name);
+				releaseString(name);
+			}
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+	}
+
+	VM_OP(VO_DECLARE) {
+		DeclarationStmtNode *stmt = pc->p;
+		ScopeObject *dest = NULL;
+		val = POP();
+		dest = getScopeObject(scope, scope, stmt->scope);
+		if (!dest
+				|| !createScopeValue(scope, dest, stmt->target)
+				|| !updateScopeImmediate(scope, dest, stmt->target, &val)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+	}
+
+	VM_OP(VO_CAST)
+		val = POP();
+		cast = castValueExplicit(getCastValue(&val, &tmp), pc->a);
+		RELEASE(&val);
+		if (!cast) goto executeVmCodeAbort;
+		PUSH(unboxValueObject(cast));
+		VM_NEXT();
+
+	VM_OP(VO_ARITHCONST)
+		val = code->consts[pc->b];
+		goto executeVmCodeArith;
+
+	VM_OP(VO_ARITH)
+		val = POP();
+executeVmCodeArith:
+		/* Apply the operation to two integers in place */
+		if (val.type == VT_INTEGER && TOP()->type == VT_INTEGER) {
+			long long int *a = &getInteger(TOP());
+			long long int b = val.data.i;
+			switch (pc->a) {
+				case OP_ADD:
+					*a += b;
+					VM_NEXT();
+				case OP_SUB:
+					*a -= b;
+					VM_NEXT();
+				case OP_MULT:
+					*a *= b;
+					VM_NEXT();
+				case OP_MAX:
+					if (b > *a) *a = b;
+					VM_NEXT();
+				case OP_MIN:
+					if (b < *a) *a = b;
+					VM_NEXT();
+				default:
+					/* Division checks for zero below */
+					if (!b) break;
+					if (pc->a == OP_DIV) *a /= b;
+					else *a %= b;
+					VM_NEXT();
+			}
+		}
+		truth = applyArithOp(pc->a, TOP(), &val, &ret);
+		RELEASE(&val);
+		RELEASE(TOP());
+		if (!truth) {
+			vm->sp--;
+			goto executeVmCodeAbort;
+		}
+		*TOP() = ret;
+		VM_NEXT();
+
+	VM_OP(VO_EQUAL)
+		val = POP();
+		/* Compare two integers in place */
+		if (val.type == VT_INTEGER && TOP()->type == VT_INTEGER) {
+			truth = getInteger(TOP()) == val.data.i;
+			TOP()->type = VT_BOOLEAN;
+			getInteger(TOP()) = pc->a == OP_EQ ? truth : !truth;
+			VM_NEXT();
+		}
+		truth = applyEqualityOp(pc->a, TOP(), &val, &ret);
+		RELEASE(&val);
+		RELEASE(TOP());
+		if (!truth) {
+			vm->sp--;
+			goto executeVmCodeAbort;
+		}
+		*TOP() = ret;
+		VM_NEXT();
+
+	VM_OP(VO_NOT)
+		if (!TRUTH(TOP(), &truth))
+			goto executeVmCodeAbort;
+		RELEASE(TOP());
+		*TOP() = createBooleanImmediateValue(!truth);
+		VM_NEXT();
+
+	VM_OP(VO_BOOLFIRST)
+		if (!castBooleanImmediate(TOP(), &truth))
+			goto executeVmCodeAbort;
+		RELEASE(TOP());
+		/* The accumulator is kept on the stack as an integer */
+		*TOP() = createIntegerImmediateValue(truth);
+		VM_NEXT();
+
+	VM_OP(VO_BOOLNEXT)
+		val = POP();
+		if (!castBooleanImmediate(&val, &truth)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		RELEASE(&val);
+		switch (pc->b) {
+			case OP_AND:
+				getInteger(TOP()) &= truth;
+				break;
+			case OP_OR:
+				getInteger(TOP()) |= truth;
+				break;
+			default:
+				getInteger(TOP()) ^= truth;
+				break;
+		}
+		VM_NEXT();
+
+	VM_OP(VO_BOOLTEST)
+		truth = getInteger(TOP());
+		if ((pc->b == OP_AND && truth == 0) || (pc->b == OP_OR && truth == 1))
+			VM_JUMP(pc->a);
+		VM_NEXT();
+
+	VM_OP(VO_BOOLEND)
+		*TOP() = createBooleanImmediateValue((int)getInteger(TOP()));
+		VM_NEXT();
+
+	VM_OP(VO_STRING)
+		if (!castStringImmediate(TOP())) {
+			vm->sp--;
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+
+	VM_OP(VO_CONCAT) {
+		ScopeObject *parent = NULL;
+		ValueObject **dest = NULL;
+		/* Append in place to the target of the following store */
+		if (pc->p && (parent = getBoundScopeObject(scope, pc->p)))
+			dest = parent->values + ((IdentifierNode *)pc->p)->index;
+		vm->sp -= pc->a;
+		if (!applyConcatOp(vm->stack + vm->sp, pc->a, dest, &val))
+			goto executeVmCodeAbort;
+		PUSH(val);
+		VM_NEXT();
+	}
+
+	VM_OP(VO_PRINT)
+		val = POP();
+		if (!printImmediateValue(&val)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		RELEASE(&val);
+		VM_NEXT();
+
+	VM_OP(VO_NEWLINE)
+		writeOutput("\n", 1);
+		VM_NEXT();
+
+	VM_OP(VO_PREPARE) {
+		FuncCallExprNode *expr = ((VmCall *)pc->p)->node;
+		IdentifierNode *id = (IdentifierNode *)(expr->name);
+		ScopeObject *target = NULL;
+		ScopeObject *frame = NULL;
+		ValueObject *def = getFuncCallValue(scope, expr, &target);
+		FuncDefStmtNode *fn = NULL;
+		if (!target) goto executeVmCodeAbort;
+		if (!def || def->type != VT_FUNC) {
+			const char *name = resolveIdentifierName(id, scope);
+			if (name) {
+				error(IN_UNDEFINED_FUNCTION, id->fname, id->line, name);
+				releaseString(name);
+			}
+			goto executeVmCodeAbort;
+		}
+		fn = getFunction(def);
+		/* Check for correct supplied arity */
+		if (fn->args->num != expr->args->num) {
+			const char *name = resolveIdentifierName(id, scope);
+			if (name) {
+				error(IN_INCORRECT_NUMBER_OF_ARGUMENTS, id->fname, id->line, name);
+				releaseString(name);
+			}
+			goto executeVmCodeAbort;
+		}
+		frame = createFrameScopeObject(scope, target, fn->args);
+		if (!frame) goto executeVmCodeAbort;
+		if (!pushVmFrame(vm, fn, frame)) {
+			releaseFrameScopeObject(frame);
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+	}
+
+	VM_OP(VO_CALL)
+executeVmCodeCall: {
+		VmFrame *f = vm->frames + vm->numframes - 1;
+		VmCode *body = bindVmCall(vm, pc, scope);
+		if (!body) goto executeVmCodeAbort;
+		/* Save the state of the caller until the call returns */
+		f->code = code;
+		f->pc = pc;
+		f->base = base;
+		f->scope = scope;
+		f->bottom = bottom;
+		code = body;
+		base = scope = f->frame;
+		bottom = vm->sp;
+		pc = code->instrs;
+		VM_DISPATCH();
+	}
+
+	VM_OP(VO_TAILCALL) {
+		VmFrame *f = vm->frames + vm->numframes - 1;
+		VmCode *body = NULL;
+		/* Only calls made by this code can be replaced */
+		if (vm->numframes - 1 <= depth || !vm->tailcalls
+				|| !isDroppable(scope, base))
+			goto executeVmCodeCall;
+		body = bindVmCall(vm, pc, scope);
+		if (!body) goto executeVmCodeAbort;
+		/* Drop the scopes of this call and let the new call return in its place */
+		while (scope != base) {
+			ScopeObject *parent = scope->parent;
+			deleteScopeObject(scope);
+			scope = parent;
+		}
+		f->frame->parent = base->parent;
+		f->frame->root = base->root;
+		releaseFrameScopeObject(base);
+		vm->numframes--;
+		code = body;
+		base = scope = f->frame;
+		pc = code->instrs;
+		VM_DISPATCH();
+	}
+
+	VM_OP(VO_JUMP)
+		VM_JUMP(pc->a);
+
+	VM_OP(VO_JUMPF)
+		val = POP();
+		if (!TRUTH(&val, &truth)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		RELEASE(&val);
+		if (!truth) VM_JUMP(pc->a);
+		VM_NEXT();
+
+	VM_OP(VO_JUMPITF)
+		if (scope->impvar->type == VT_BOOLEAN)
+			truth = (int)getInteger(scope->impvar);
+		else {
+			val = copyImmediateValue(scope->impvar);
+			if (!castBooleanImmediate(&val, &truth)) {
+				RELEASE(&val);
+				goto executeVmCodeAbort;
+			}
+			RELEASE(&val);
+		}
+		if (!truth) VM_JUMP(pc->a);
+		VM_NEXT();
+
+	VM_OP(VO_SWITCH)
+		/* One jump follows for each guard, then one for no match */
+		VM_JUMP(pc[1 + matchSwitchGuard(pc->p, scope->impvar)].a);
+
+	VM_OP(VO_ENTER) {
+		ScopeObject *inner = pc->b ? reuseScopeObject(scope)
+				: createScopeObject(scope);
+		if (!inner) goto executeVmCodeAbort;
+		scope = inner;
+		VM_NEXT();
+	}
+
+	VM_OP(VO_LEAVE) {
+		int n;
+		for (n = 0; n < pc->a; n++) {
+			ScopeObject *parent = scope->parent;
+			if (pc->b) releaseScopeObject(scope);
+			else deleteScopeObject(scope);
+			scope = parent;
+		}
+		VM_NEXT();
+	}
+
+	VM_OP(VO_LOOPENTER) {
+		LoopStmtNode *stmt = pc->p;
+		ScopeObject *outer = createScopeObject(scope);
+		if (!outer) goto executeVmCodeAbort;
+		/* Create a temporary loop variable if required */
+		if (stmt->var) {
+			ValueObject *var = createScopeValue(scope, outer, stmt->var);
+			if (!var) {
+				deleteScopeObject(outer);
+				goto executeVmCodeAbort;
+			}
+			var->type = VT_INTEGER;
+			var->data.i = 0;
+			var->semaphore = 1;
+		}
+		scope = outer;
+		VM_NEXT();
+	}
+
+	VM_OP(VO_LOOPTEST)
+		/* As in the interpreter, casts are done in the enclosing scope */
+		val = POP();
+		if (!TRUTH(&val, &truth)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		RELEASE(&val);
+		if (!truth) VM_JUMP(pc->a);
+		VM_NEXT();
+
+	VM_OP(VO_LOOPSTEP) {
+		/* The loop variable is the only value in the loop scope */
+		ValueObject *var = scope->values[0];
+		/* Leave any copies of the variable unchanged */
+		if (var->semaphore > 1 && var->type != VT_STRING
+				&& var->type != VT_ARRAY) {
+			ValueObject *copy = duplicateValueObject(var);
+			if (!copy) goto executeVmCodeAbort;
+			deleteValueObject(var);
+			scope->values[0] = var = copy;
+		}
+		var->data.i += pc->a;
+		VM_NEXT();
+	}
+
+	VM_OP(VO_LOOPSTORE)
+		val = POP();
+		if (!updateScopeImmediate(scope->parent, scope, pc->p, &val)) {
+			RELEASE(&val);
+			goto executeVmCodeAbort;
+		}
+		VM_NEXT();
+
+	VM_OP(VO_BREAK)
+		rtype = RT_BREAK;
+		val = createNilImmediateValue();
+		goto executeVmCodeDone;
+
+	VM_OP(VO_RETURN)
+		rtype = RT_RETURN;
+		val = POP();
+		goto executeVmCodeDone;
+
+#ifndef VM_THREADED
+	default:
+		error(VM_UNKNOWN_OPCODE);
+		goto executeVmCodeAbort;
+	}
+#endif
+
+executeVmCodeDone: /* Leave any scopes still entered */
+
+	while (scope != base) {
+		ScopeObject *parent = scope->parent;
+		deleteScopeObject(scope);
+		scope = parent;
+	}
+
+	/* Return to the caller of a function */
+	if (vm->numframes > depth) {
+		VmFrame *f = vm->frames + --vm->numframes;
+		if (rtype == RT_DEFAULT) {
+			/* Extract return value */
+			RELEASE(&val);
+			val = unboxValueObject(base->impvar);
+			base->impvar = NULL;
+		}
+		releaseFrameScopeObject(base);
+		code = f->code;
+		pc = f->pc;
+		base = f->base;
+		scope = f->scope;
+		bottom = f->bottom;
+		PUSH(val);
+		VM_NEXT();
+	}
+
+	*type = rtype;
+	*value = val;
+
+	return 1;
+
+executeVmCodeAbort: /* In case something goes wrong... */
+
+	/* Clean up any calls, values, and scopes left behind */
+	while (vm->numframes > depth) {
+		VmFrame *f = vm->frames + --vm->numframes;
+		if (!f->code) {
+			releaseFrameScopeObject(f->frame);
+			continue;
+		}
+		while (scope != base) {
+			ScopeObject *parent = scope->parent;
+			deleteScopeObject(scope);
+			scope = parent;
+		}
+		releaseFrameScopeObject(base);
+		base = f->base;
+		scope = f->scope;
+	}
+	while (vm->sp > entry)
+		releaseImmediateValue(vm->stack + --vm->sp);
+	while (scope != base) {
+		ScopeObject *parent = scope->parent;
+		deleteScopeObject(scope);
+		scope = parent;
+	}
+
+	return 0;
+}
+
+/**
+ * Compiles and executes the main block of code.
+ *
+ * \param [in] main The main block of code to execute.
+ *
+ * \pre \a main contains a block of code created by parseMainNode().
+ *
+ * \return The final status of the program.
+ *
+ * \retval 0 \a main was executed without any errors.
+ *
+ * \retval 1 An error occurred while executing \a main.
+ */
+int executeMainNode(MainNode *main)
+{
+	VmState *vm = NULL;
+	VmCode *code = NULL;
+	ImmediateValue value;
+	ReturnType type;
+	int status;
+	if (!main) return 1;
+	code = compileMainCode(main);
+	if (!code) return 1;
+	vm = createVmState();
+	if (!vm) {
+		deleteVmCode(code);
+		return 1;
+	}
+	/* Scopes can only be dropped if every name is known ahead of time */
+	vm->tailcalls = !main->indirect;
+	status = executeVmCode(vm, code, NULL, &type, &value);
+	if (status) releaseImmediateValue(&value);
+	deleteVmState(vm);
+	deleteVmCode(code);
+	return status ? 0 : 1;
+}
@@ -0,0 +1,251 @@
+/**
+ * Structures and functions for compiling a parse tree to bytecode and
+ * executing it.  The compiler lowers a parse tree (generated by the parser)
+ * into a linear sequence of instructions for a simple stack machine, and the
+ * virtual machine executes these instructions.  This is an alternative to the
+ * interpreter, which remains the reference implementation of the language.
+ *
+ * \file   vm.h
+ *
+ * \author Justin J. Meza
+ *
+ * \date   2014
+ */
+
+/**
+ * \page vm Virtual Machine
+ *
+ * When run with \c --engine=vm, lci compiles each block of code to bytecode
+ * before executing it.  Each instruction pops its operands from and pushes its
+ * result to a stack of values.  Control flow (conditionals, switches, loops,
+ * breaks, and returns) is lowered to jumps, and every scope the interpreter
+ * would create is created by an explicit instruction, so identifiers are
+ * looked up exactly as they are by the interpreter.
+ *
+ * Values on the stack are unboxed (see ImmediateValue), so integers, decimals,
+ * booleans, and nil are pushed, operated on, and popped without allocating any
+ * memory.  Other constants are created once, when they are compiled, and
+ * shared by every value produced from them.
+ *
+ * Function bodies are compiled the first time they are called.  Calls do not
+ * recurse in C: the arguments of a call are evaluated on the value stack, and
+ * the state of the caller is saved on a growable stack of frames (see VmFrame)
+ * while the body of the function executes.  Recursion depth is therefore
+ * limited by memory rather than by the size of the C stack.
+ *
+ * A call whose value is returned immediately (\c FOUND \c YR \c I \c IZ ...)
+ * replaces the frame of the function it is made from rather than adding a new
+ * one, so tail-recursive functions run in constant space.  The scopes of the
+ * returning function are only dropped early if this cannot be observed: the
+ * program names no identifiers at run time (\c SRS), no value in those scopes
+ * is ever looked up by name (see \ref binding), and no array was created in
+ * them.  Otherwise, the call is made as usual.
+ *
+ * Statements which do not benefit from compilation (such as input, casts, and
+ * function definitions) are executed by the interpreter from within the
+ * virtual machine.
+ *
+ * The handlers of the most frequent instructions take shortcuts for the common
+ * case: loads and stores of statically bound identifiers go straight to the
+ * scope holding them, arithmetic and equality on two integers are done in place
+ * on the stack, and an arithmetic operation whose second operand is a scalar
+ * constant takes it from the instruction (see \c VO_ARITHCONST).
+ *
+ * The virtual machine is not much faster than the interpreter, though.  Both
+ * look up values in the same scopes, which is where most of the time goes, and
+ * the interpreter specializes operations for the types of their operands too.
+ * With the benchmarks in \c test/1.3-Tests/0-Benchmarks, the virtual machine
+ * runs deep recursion about 1.5 times as fast as the interpreter, and the other
+ * benchmarks (arithmetic loops, strings, arrays, and switches) at about the
+ * same speed, within 15% either way.
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "interpreter.h"
+
+#undef DEBUG
+
+/**
+ * Whether to dispatch instructions by jumping directly between their handlers
+ * (requires the GNU C "labels as values" extension).  Otherwise, a switch
+ * statement is used.
+ */
+#if defined(__GNUC__) && !defined(VM_NO_THREADING)
+#define VM_THREADED
+#endif
+
+/**
+ * Represents an instruction opcode.
+ */
+typedef enum {
+	VO_END,        /**< Ends the code, returning any value on the stack. */
+	VO_STMT,       /**< Interprets a statement with the interpreter. */
+	VO_CONST,      /**< Pushes a copy of a constant. */
+	VO_LOAD,       /**< Pushes the value of an identifier. */
+	VO_LOADIT,     /**< Pushes the \ref impvar "implicit variable". */
+	VO_STORE,      /**< Pops a value into an identifier. */
+	VO_STOREIT,    /**< Pops a value into the implicit variable. */
+	VO_DECLCHECK,  /**< Checks that a declaration does not redefine a value. */
+	VO_DECLARE,    /**< Pops a value into a newly-declared identifier. */
+	VO_CAST,       /**< Casts the top of the stack. */
+	VO_ARITH,      /**< Pops two values and pushes an arithmetic result. */
+	VO_ARITHCONST, /**< Applies an arithmetic operation to the top value and constant \c b. */
+	VO_EQUAL,      /**< Pops two values and pushes an equality result. */
+	VO_NOT,        /**< Negates the top of the stack. */
+	VO_BOOLFIRST,  /**< Starts a boolean accumulator from the top value. */
+	VO_BOOLNEXT,   /**< Pops a value into the boolean accumulator. */
+	VO_BOOLTEST,   /**< Jumps if the boolean accumulator short circuits. */
+	VO_BOOLEND,    /**< Converts the boolean accumulator to a value. */
+	VO_STRING,     /**< Casts the top of the stack to a string. */
+	VO_CONCAT,     /**< Pops strings and pushes their concatenation (appending to \c p if set). */
+	VO_PRINT,      /**< Pops a value and prints it. */
+	VO_NEWLINE,    /**< Prints a newline. */
+	VO_PREPARE,    /**< Finds a function and creates the frame for a call to it. */
+	VO_CALL,       /**< Pops the arguments of a call and executes the function. */
+	VO_TAILCALL,   /**< Calls a function in place of the current one if possible. */
+	VO_JUMP,       /**< Jumps unconditionally. */
+	VO_JUMPF,      /**< Pops a value and jumps if it is false. */
+	VO_JUMPITF,    /**< Jumps if the implicit variable is false. */
+	VO_SWITCH,     /**< Jumps through the jump following the guard matching the implicit variable. */
+	VO_ENTER,      /**< Enters a new scope (reusing a released one if \c b is set). */
+	VO_LEAVE,      /**< Leaves one or more scopes (releasing them if \c b is set). */
+	VO_LOOPENTER,  /**< Enters the scope of a loop and creates its variable. */
+	VO_LOOPTEST,   /**< Pops a loop guard and jumps if it is false. */
+	VO_LOOPSTEP,   /**< Increments or decrements a loop variable. */
+	VO_LOOPSTORE,  /**< Pops a value into a loop variable. */
+	VO_BREAK,      /**< Ends the code with a break. */
+	VO_RETURN,     /**< Pops a value and ends the code with a return. */
+	VO_MAX         /**< The number of opcodes. */
+} VmOpcode;
+
+/**
+ * Stores an instruction.
+ */
+typedef struct {
+	VmOpcode op; /**< The opcode of the instruction. */
+	int a;       /**< The first operand (usually a jump target). */
+	int b;       /**< The second operand. */
+	void *p;     /**< The parse tree node operand. */
+} VmInstr;
+
+/**
+ * Stores a sequence of instructions.
+ */
+typedef struct vmcode {
+	unsigned int num;       /**< The number of instructions. */
+	unsigned int max;       /**< The number of allocated instructions. */
+	VmInstr *instrs;        /**< The instructions. */
+	unsigned int maxstack;  /**< The maximum stack depth used. */
+	unsigned int numconsts; /**< The number of constants. */
+	ImmediateValue *consts; /**< The constants in the instructions. */
+	unsigned int numcalls;  /**< The number of call sites. */
+	struct vmcall **calls;  /**< The call sites in the instructions. */
+} VmCode;
+
+/**
+ * Stores a function call site.
+ */
+typedef struct vmcall {
+	FuncCallExprNode *node; /**< The function call expression. */
+	FuncDefStmtNode *def;   /**< The function last called from here. */
+	VmCode *body;           /**< The compiled body of \a def. */
+} VmCall;
+
+/**
+ * Stores a function call in progress.  A call is pending, with only its
+ * function and frame set, while its arguments are evaluated.
+ */
+typedef struct {
+	FuncDefStmtNode *def; /**< The function being called. */
+	ScopeObject *frame;   /**< The scope created for the call. */
+	VmCode *code;         /**< The code of the caller, or NULL if pending. */
+	VmInstr *pc;          /**< The calling instruction. */
+	ScopeObject *base;    /**< The scope the caller's code started in. */
+	ScopeObject *scope;   /**< The current scope of the caller. */
+	unsigned int bottom;  /**< The stack depth where the caller's code began. */
+} VmFrame;
+
+/**
+ * Stores the state of the compiler.
+ */
+typedef struct {
+	VmCode *code;       /**< The code being compiled. */
+	unsigned int depth; /**< The number of scopes entered by the code. */
+	unsigned int stack; /**< The stack depth at the current instruction. */
+	int breakdepth;     /**< The scope depth breaks return to, or -1. */
+	int breaks;         /**< The last break jump to patch, or -1. */
+} VmCompiler;
+
+/**
+ * Stores the state of the virtual machine.
+ */
+typedef struct {
+	unsigned int sp;         /**< The number of values on the stack. */
+	unsigned int max;        /**< The number of allocated stack values. */
+	ImmediateValue *stack;   /**< The value stack. */
+	unsigned int numfuncs;   /**< The number of compiled functions. */
+	FuncDefStmtNode **defs;  /**< The compiled function definitions. */
+	VmCode **funcs;          /**< The compiled function bodies. */
+	unsigned int numframes;  /**< The number of calls in progress. */
+	unsigned int maxframes;  /**< The number of allocated frames. */
+	VmFrame *frames;         /**< The calls in progress, innermost last. */
+	int tailcalls;           /**< Whether calling frames may be replaced. */
+} VmState;
+
+/**
+ * \name Code modifiers
+ *
+ * Functions for creating and deleting compiled code.
+ */
+/**@{*/
+VmCode *createVmCode(void);
+void deleteVmCode(VmCode *);
+int addVmConstant(VmCode *, ImmediateValue *);
+VmCall *createVmCall(FuncCallExprNode *);
+void deleteVmCall(VmCall *);
+int emitVmInstr(VmCompiler *, VmOpcode, int, int, void *, int);
+void patchVmJumps(VmCode *, int, int);
+/**@}*/
+
+/**
+ * \name Compiler
+ *
+ * Functions for compiling parse tree nodes to code.
+ */
+/**@{*/
+int isSimpleIdentifier(IdentifierNode *);
+int compileOpExprNode(VmCompiler *, OpExprNode *);
+int compileStringTemplateNode(VmCompiler *, StringTemplateNode *);
+int compileFuncCallExprNode(VmCompiler *, FuncCallExprNode *, int);
+int compileExprNode(VmCompiler *, ExprNode *);
+int compileIfThenElseStmtNode(VmCompiler *, IfThenElseStmtNode *);
+int compileSwitchStmtNode(VmCompiler *, SwitchStmtNode *);
+int compileLoopStmtNode(VmCompiler *, LoopStmtNode *);
+int compileStmtNode(VmCompiler *, StmtNode *);
+int compileStmtNodeList(VmCompiler *, StmtNodeList *);
+int compileBlockNode(VmCompiler *, BlockNode *);
+VmCode *compileFuncCode(FuncDefStmtNode *);
+VmCode *compileMainCode(MainNode *);
+/**@}*/
+
+/**
+ * \name Virtual machine
+ *
+ * Functions for executing code.
+ */
+/**@{*/
+VmState *createVmState(void);
+void deleteVmState(VmState *);
+VmCode *getFuncCode(VmState *, FuncDefStmtNode *);
+int executeVmCode(VmState *, VmCode *, ScopeObject *, ReturnType *, ImmediateValue *);
+int executeMainNode(MainNode *);
+/**@}*/
+
+#endif /* __VM_H__ */